@@ -0,0 +1,81 @@
+// 由 dlcv_infer::flow::GenerateFlowSource 生成，请勿手工修改。
+// 加载的流程编译出的结构哈希与本文件一致时，GraphExecutor 改用本文件的代码执行；
+// 节点类型、连线或输出掩码变化后不再匹配，自动回落为通用执行。
+#include "flow/FlowCodeGen.h"
+
+namespace {
+
+using ::dlcv_infer::flow::GeneratedFlowFrame;
+using ::dlcv_infer::flow::GeneratedNodeOutput;
+using ::dlcv_infer::flow::SharedChannel;
+
+void RunBBoxDedupSampleFlow(GeneratedFlowFrame& f) {
+    SharedChannel n0_0;
+    SharedChannel n1_0;
+    SharedChannel n2_0;
+    SharedChannel n3_0;
+    SharedChannel n4_0;
+
+    // [0] id=1 input/frontend_image
+    {
+        GeneratedNodeOutput out = f.Invoke(0, SharedChannel(), std::vector<SharedChannel>());
+        n0_0 = out.TakePair(0);
+    }
+
+    // [1] id=2 input/build_results
+    if (!f.GatedOff(1)) {
+        SharedChannel in;
+        in.ImageList = n0_0.ImageList;
+        in.ResultList = n0_0.ResultList;
+        in.Detections = n0_0.Detections;
+        GeneratedNodeOutput out = f.Invoke(1, std::move(in), std::vector<SharedChannel>());
+        n1_0 = out.TakePair(0);
+    }
+
+    // [2] id=3 input/build_results
+    if (!f.GatedOff(2)) {
+        SharedChannel in;
+        in.ImageList = std::move(n0_0.ImageList);
+        in.ResultList = std::move(n0_0.ResultList);
+        in.Detections = std::move(n0_0.Detections);
+        GeneratedNodeOutput out = f.Invoke(2, std::move(in), std::vector<SharedChannel>());
+        n2_0 = out.TakePair(0);
+    }
+
+    // [3] id=4 post_process/merge_results
+    if (!f.GatedOff(3)) {
+        SharedChannel in;
+        std::vector<SharedChannel> extra(1);
+        in.ImageList = std::move(n1_0.ImageList);
+        in.ResultList = std::move(n1_0.ResultList);
+        in.Detections = std::move(n1_0.Detections);
+        extra[0].ImageList = std::move(n2_0.ImageList);
+        extra[0].ResultList = std::move(n2_0.ResultList);
+        extra[0].Detections = std::move(n2_0.Detections);
+        GeneratedNodeOutput out = f.Invoke(3, std::move(in), std::move(extra));
+        n3_0 = out.TakePair(0);
+    }
+
+    // [4] id=5 post_process/bbox_iou_dedup
+    if (!f.GatedOff(4)) {
+        SharedChannel in;
+        in.ImageList = std::move(n3_0.ImageList);
+        in.ResultList = std::move(n3_0.ResultList);
+        in.Detections = std::move(n3_0.Detections);
+        GeneratedNodeOutput out = f.Invoke(4, std::move(in), std::vector<SharedChannel>());
+        n4_0 = out.TakePair(0);
+    }
+
+    // [5] id=6 output/return_json
+    if (!f.GatedOff(5)) {
+        SharedChannel in;
+        in.ImageList = std::move(n4_0.ImageList);
+        in.ResultList = std::move(n4_0.ResultList);
+        in.Detections = std::move(n4_0.Detections);
+        (void)f.Invoke(5, std::move(in), std::vector<SharedChannel>());
+    }
+}
+
+} // namespace
+
+DLCV_FLOW_REGISTER_GENERATED(0x74d2cb406a723882ULL, RunBBoxDedupSampleFlow)
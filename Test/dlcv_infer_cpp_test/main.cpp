@@ -2,15 +2,19 @@
 #include <psapi.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <functional>
 #include <iomanip>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -20,6 +24,9 @@
 
 #include "../../dlcv_infer_cpp_dll/ImageInputUtils.h"
 #include "../../dlcv_infer_cpp_dll/flow/FlowGraphModel.h"
+#include "../../dlcv_infer_cpp_dll/InferInputArena.h"
+#include "../../dlcv_infer_cpp_dll/InferRequestQueue.h"
+#include "../../dlcv_infer_cpp_dll/InferStatistics.h"
 #include "dlcv_infer.h"
 
 namespace {
@@ -2374,6 +2381,386 @@ int RunBBoxIoUDedupSelfTest() {
     std::cout << "bbox_iou_dedup 自测通过\n";
     return 0;
 }
+
+// generated_bbox_dedup_flow.cpp 由 codegen-generate 按 BuildBBoxDedupFlow 生成，流程结构变化后需重新生成
+constexpr const char* kCodegenSampleFunction = "RunBBoxDedupSampleFlow";
+
+int RunCodegenGenerate(const std::string& outPath) {
+    try {
+        const std::string source = dlcv_infer::flow::FlowGraphModel::GenerateSource(
+            BuildBBoxDedupFlow(true), kCodegenSampleFunction);
+        std::ofstream ofs(outPath, std::ios::binary);
+        if (!ofs) {
+            std::cout << "无法写入: " << outPath << "\n";
+            return 1;
+        }
+        ofs << source;
+    } catch (const std::exception& ex) {
+        std::cout << "生成失败: " << ex.what() << "\n";
+        return 1;
+    }
+    std::cout << "已生成: " << outPath << "\n";
+    return 0;
+}
+
+// 生成代码只依赖流程结构：cross_model 不同的两个流程共用同一份生成代码
+bool RunGeneratedFlowCase(bool crossModel, int expectedCount, std::string& error) {
+    const std::string tempDir = BuildTempRectCorrectionDir();
+    const std::string flowPath = JoinPathA(tempDir, crossModel ? "codegen_cross.json" : "codegen_strict.json");
+    const json flow = BuildBBoxDedupFlow(crossModel);
+    {
+        std::ofstream ofs(flowPath, std::ios::binary);
+        if (!ofs) {
+            error = "无法写入临时流程文件";
+            return false;
+        }
+        ofs << flow.dump(2);
+    }
+
+    try {
+        dlcv_infer::flow::FlowGraphModel model;
+        const json loadReport = model.Load(flowPath, kGpuDeviceId);
+        if (!loadReport.is_object() || loadReport.value("code", 1) != 0) {
+            error = std::string("流程加载失败: ") + loadReport.dump();
+            DeleteFileA(flowPath.c_str());
+            return false;
+        }
+        if (!model.HasGeneratedExecutor()) {
+            error = "未匹配到预生成执行代码，请用 codegen-generate 重新生成 generated_bbox_dedup_flow.cpp";
+            DeleteFileA(flowPath.c_str());
+            return false;
+        }
+
+        cv::Mat image(320, 320, CV_8UC3, cv::Scalar(0, 255, 0));
+        const json report = model.VerifyGeneratedExecutor(std::vector<cv::Mat>{image}, json::object());
+        if (!report.is_object() || report.value("code", 1) != 0 || !report.value("equal", false)) {
+            error = std::string("生成代码与通用执行结果不一致: ") + report.dump();
+            DeleteFileA(flowPath.c_str());
+            return false;
+        }
+
+        // 当前生成器的输出应登记同一结构哈希
+        const std::string source = dlcv_infer::flow::FlowGraphModel::GenerateSource(flow, kCodegenSampleFunction);
+        const std::string registration = "DLCV_FLOW_REGISTER_GENERATED(0x" +
+            report.value("structure_hash", std::string()) + "ULL, " + kCodegenSampleFunction + ")";
+        if (source.find(registration) == std::string::npos) {
+            error = "生成器输出的注册语句不符: " + registration;
+            DeleteFileA(flowPath.c_str());
+            return false;
+        }
+
+        const json inferRoot = model.InferInternal(std::vector<cv::Mat>{image}, json::object());
+        const json results = inferRoot.contains("result_list") ? inferRoot.at("result_list") : json::array();
+        const int kept = CountBBoxDedupDetections(results);
+        if (kept != expectedCount) {
+            error = "生成代码执行的保留数量不符合预期，actual=" + std::to_string(kept) +
+                ", expected=" + std::to_string(expectedCount) + ", root=" + inferRoot.dump();
+            DeleteFileA(flowPath.c_str());
+            return false;
+        }
+    } catch (const std::exception& ex) {
+        error = std::string("异常: ") + ex.what();
+        DeleteFileA(flowPath.c_str());
+        return false;
+    }
+
+    DeleteFileA(flowPath.c_str());
+    return true;
+}
+
+int RunCodegenSelfTest() {
+    std::string error;
+    if (!RunGeneratedFlowCase(true, 1, error) || !RunGeneratedFlowCase(false, 2, error)) {
+        std::cout << "codegen 自测失败: " << error << "\n";
+        return 1;
+    }
+    std::cout << "codegen 自测通过\n";
+    return 0;
+}
+
+bool CheckHistogramPercentiles(std::string& error) {
+    // 64us 以下逐微秒分桶，取值精确
+    {
+        dlcv_infer::LatencyHistogram h;
+        for (int i = 0; i < 100; i++) h.Record(0.063);
+        const auto s = h.Summarize();
+        if (s.Count != 100 || s.P50Ms != 0.063 || s.P99Ms != 0.063 || s.MaxMs != 0.063) {
+            error = "线性区 p50=" + std::to_string(s.P50Ms) + " max=" + std::to_string(s.MaxMs);
+            return false;
+        }
+    }
+    // 127us/128us 分属相邻两桶：名次落在 127us 一侧时取 127us 桶，越过分界后取 128us 桶
+    {
+        dlcv_infer::LatencyHistogram h;
+        for (int i = 0; i < 51; i++) h.Record(0.127);
+        for (int i = 0; i < 50; i++) h.Record(0.128);
+        h.Record(1.0);
+        const auto s = h.Summarize();   // 102 个样本，p50 名次 51
+        if (s.P50Ms != 0.127) {
+            error = "桶边界 p50 应为 127us: " + std::to_string(s.P50Ms);
+            return false;
+        }
+        h.Record(0.128);
+        const auto s2 = h.Summarize();  // 103 个样本，p50 名次 52
+        if (s2.P50Ms < 0.128 || s2.P50Ms > 0.128 * (1.0 + 1.0 / 32.0)) {
+            error = "桶边界 p50 应落在 128us 桶: " + std::to_string(s2.P50Ms);
+            return false;
+        }
+    }
+    // 名次边界：ceil(q*n) 恰好落在两组样本的分界处
+    {
+        dlcv_infer::LatencyHistogram h;
+        for (int i = 0; i < 50; i++) h.Record(1.0);
+        for (int i = 0; i < 40; i++) h.Record(2.0);
+        for (int i = 0; i < 10; i++) h.Record(4.0);
+        const auto s = h.Summarize();
+        if (s.P50Ms != 1.0 || s.P90Ms != 2.0 || s.P99Ms != 4.0 || s.MaxMs != 4.0) {
+            error = "名次边界 p50/p90/p99=" + std::to_string(s.P50Ms) + "/" + std::to_string(s.P90Ms) + "/" + std::to_string(s.P99Ms);
+            return false;
+        }
+        if (std::fabs(s.MeanMs - 1.7) > 1e-9) {
+            error = "均值 " + std::to_string(s.MeanMs);
+            return false;
+        }
+    }
+    // 每个 2 的幂区间的首尾：相对误差不超过 1/32，且不超过最大值
+    for (int bit = 6; bit <= 30; bit++) {
+        for (std::uint64_t us : { (1ULL << bit) - 1, 1ULL << bit, (1ULL << bit) + 1 }) {
+            dlcv_infer::LatencyHistogram h;
+            h.Record(static_cast<double>(us) / 1000.0);
+            h.Record(static_cast<double>(us) * 4.0 / 1000.0);
+            const auto s = h.Summarize();
+            const double expected = static_cast<double>(us) / 1000.0;
+            if (std::fabs(s.P50Ms - expected) > expected / 32.0) {
+                error = "区间首尾 " + std::to_string(us) + "us p50=" + std::to_string(s.P50Ms);
+                return false;
+            }
+        }
+    }
+    // 重置后清空
+    {
+        dlcv_infer::LatencyHistogram h;
+        h.Record(5.0);
+        h.Reset();
+        const auto s = h.Summarize();
+        if (s.Count != 0 || s.P99Ms != 0.0 || s.MaxMs != 0.0) {
+            error = "重置后未清空";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CheckInferStatisticsCounts(std::string& error) {
+    dlcv_infer::InferStatistics stats;
+    std::vector<dlcv_infer::FlowNodeTiming> nodes(2);
+    nodes[0].nodeId = 3;
+    nodes[0].elapsedMs = 1.0;
+    nodes[1].nodeId = 7;
+    nodes[1].elapsedMs = 2.0;
+    for (int i = 0; i < 10; i++) {
+        dlcv_infer::InferCallScope call(&stats, 4);
+        call.Preprocessed();
+        call.Inferred(-1.0, &nodes);
+        if (i % 5 != 0) call.Commit();   // 未提交即析构记为失败
+    }
+    const json snap = stats.Snapshot();
+    if (snap.value("requests", 0) != 8 || snap.value("images", 0) != 32 || snap.value("errors", 0) != 2) {
+        error = "请求计数不符: " + snap.dump();
+        return false;
+    }
+    if (!snap.contains("flow_nodes") || snap.at("flow_nodes").size() != 2 ||
+        snap.at("flow_nodes").at(1).value("count", 0) != 8) {
+        error = "节点统计不符: " + snap.dump();
+        return false;
+    }
+    stats.Reset();
+    if (stats.Snapshot().value("requests", -1) != 0) {
+        error = "重置后请求数不为 0";
+        return false;
+    }
+    return true;
+}
+
+int RunInferStatisticsSelfTest() {
+    std::string error;
+    if (!CheckHistogramPercentiles(error) || !CheckInferStatisticsCounts(error)) {
+        std::cout << "infer_statistics 自测失败: " << error << "\n";
+        return 1;
+    }
+    std::cout << "infer_statistics 自测通过\n";
+    return 0;
+}
+
+bool CheckInputArenaReuse(std::string& error) {
+    dlcv_infer::InferInputArena arena(static_cast<size_t>(1) << 20);
+    const uchar* first = nullptr;
+    {
+        cv::Mat a;
+        a.allocator = arena.Allocator();
+        a.create(100, 100, CV_8UC1);
+        first = a.data;
+        if ((reinterpret_cast<std::uintptr_t>(first) & 4095) != 0) {
+            error = "缓冲区未按页对齐";
+            return false;
+        }
+    }
+    {
+        // 尺寸相近的分配复用同一缓冲区
+        cv::Mat b;
+        b.allocator = arena.Allocator();
+        b.create(99, 101, CV_8UC1);
+        const json s = arena.Stats();
+        if (b.data != first || s.value("hits", 0) != 1 || s.value("misses", 0) != 1) {
+            error = "未复用空闲缓冲区: " + s.dump();
+            return false;
+        }
+    }
+    {
+        // 超出剩余容量的缓冲区释放回系统，不计入保留量
+        cv::Mat big;
+        big.allocator = arena.Allocator();
+        big.create(1000, 1000, CV_8UC1);
+    }
+    json s = arena.Stats();
+    if (s.value("outstanding_bytes", -1) != 0 || s.value("retained_bytes", 0) > s.value("capacity_bytes", 0)) {
+        error = "容量限制不符: " + s.dump();
+        return false;
+    }
+    arena.Trim();
+    if (arena.Stats().value("retained_bytes", -1) != 0) {
+        error = "Trim 后仍有保留缓冲区";
+        return false;
+    }
+    arena.SetCapacity(0);
+    {
+        cv::Mat c;
+        c.allocator = arena.Allocator();
+        c.create(10, 10, CV_8UC1);
+    }
+    if (arena.Stats().value("retained_bytes", -1) != 0) {
+        error = "容量为 0 时保留了缓冲区";
+        return false;
+    }
+    return true;
+}
+
+bool CheckInputArenaOutlivesOwner(std::string& error) {
+    // 池销毁后，借出的缓冲区仍可读写，最后一个 Mat 释放时直接释放
+    cv::Mat kept;
+    {
+        dlcv_infer::InferInputArena arena;
+        kept.allocator = arena.Allocator();
+        kept.create(500, 500, CV_8UC3);
+        kept.setTo(cv::Scalar(1, 2, 3));
+    }
+    cv::Mat alias = kept;
+    kept.release();
+    const cv::Vec3b px = alias.at<cv::Vec3b>(499, 499);
+    if (px[0] != 1 || px[1] != 2 || px[2] != 3) {
+        error = "池销毁后缓冲区内容被破坏";
+        return false;
+    }
+    alias.release();
+    return true;
+}
+
+int RunInputArenaSelfTest() {
+    std::string error;
+    if (!CheckInputArenaReuse(error) || !CheckInputArenaOutlivesOwner(error)) {
+        std::cout << "input_arena 自测失败: " << error << "\n";
+        return 1;
+    }
+    std::cout << "input_arena 自测通过\n";
+    return 0;
+}
+
+// 可控的排队请求：Run 开始后等待放行，记录执行与取消
+struct QueueProbe {
+    std::atomic<bool> Release{ false };
+    std::atomic<int> Started{ 0 };
+    std::atomic<int> Cancelled{ 0 };
+    std::mutex Mu;
+    std::vector<int> Ran;
+
+    dlcv_infer::InferRequestQueue::Request Make(int id, bool hold) {
+        dlcv_infer::InferRequestQueue::Request r;
+        r.Run = [this, id, hold]() {
+            Started++;
+            while (hold && !Release.load()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            std::lock_guard<std::mutex> lk(Mu);
+            Ran.push_back(id);
+        };
+        r.Cancel = [this](std::exception_ptr e) { if (e) Cancelled++; };
+        return r;
+    }
+
+    bool WaitStarted(int n) {
+        for (int i = 0; i < 2000 && Started.load() < n; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return Started.load() >= n;
+    }
+};
+
+bool CheckQueueBlock(std::string& error) {
+    QueueProbe probe;
+    dlcv_infer::InferRequestQueue queue(1, 1, dlcv_infer::AsyncOverflowPolicy::Block);
+    queue.Submit(probe.Make(1, true));
+    if (!probe.WaitStarted(1)) { error = "Block: 首个请求未开始"; return false; }
+
+    std::atomic<bool> submitted{ false };
+    std::thread producer([&]() {
+        queue.Submit(probe.Make(2, false));
+        submitted = true;
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const bool blocked = !submitted.load();
+    probe.Release = true;
+    producer.join();
+    queue.WaitIdle();
+    if (!blocked) { error = "Block: 满时提交未阻塞"; return false; }
+    if (probe.Ran != std::vector<int>{ 1, 2 } || probe.Cancelled != 0) { error = "Block: 执行顺序或取消数不符"; return false; }
+    return true;
+}
+
+bool CheckQueueReject(std::string& error) {
+    QueueProbe probe;
+    dlcv_infer::InferRequestQueue queue(1, 1, dlcv_infer::AsyncOverflowPolicy::Reject);
+    queue.Submit(probe.Make(1, true));
+    if (!probe.WaitStarted(1)) { error = "Reject: 首个请求未开始"; return false; }
+    const bool accepted = queue.Submit(probe.Make(2, false));
+    const int cancelledOnSubmit = probe.Cancelled.load();
+    probe.Release = true;
+    queue.WaitIdle();
+    if (accepted || cancelledOnSubmit != 1) { error = "Reject: 满时未拒绝新请求"; return false; }
+    if (probe.Ran != std::vector<int>{ 1 }) { error = "Reject: 被拒绝的请求仍被执行"; return false; }
+    return true;
+}
+
+bool CheckQueueDropOldest(std::string& error) {
+    QueueProbe probe;
+    dlcv_infer::InferRequestQueue queue(1, 2, dlcv_infer::AsyncOverflowPolicy::DropOldest);
+    queue.Submit(probe.Make(1, true));
+    if (!probe.WaitStarted(1)) { error = "DropOldest: 首个请求未开始"; return false; }
+    queue.Submit(probe.Make(2, false));
+    const bool accepted = queue.Submit(probe.Make(3, false));
+    const int cancelledOnSubmit = probe.Cancelled.load();
+    const size_t inFlight = queue.InFlight();
+    probe.Release = true;
+    queue.WaitIdle();
+    if (!accepted || cancelledOnSubmit != 1 || inFlight != 2) { error = "DropOldest: 未丢弃最早的排队请求"; return false; }
+    if (probe.Ran != std::vector<int>{ 1, 3 }) { error = "DropOldest: 执行的请求不符"; return false; }
+    return true;
+}
+
+int RunAsyncQueueSelfTest() {
+    std::string error;
+    if (!CheckQueueBlock(error) || !CheckQueueReject(error) || !CheckQueueDropOldest(error)) {
+        std::cout << "async_queue 自测失败: " << error << "\n";
+        return 1;
+    }
+    std::cout << "async_queue 自测通过\n";
+    return 0;
+}
 }  // namespace
 
 int main(int argc, char* argv[]) {
@@ -2447,6 +2834,30 @@ int main(int argc, char* argv[]) {
         return RunDvstSingleLoadSelfTest();
     }
 
+    if (argc >= 2 && std::string(argv[1]) == "infer-statistics-selftest") {
+        return RunInferStatisticsSelfTest();
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "input-arena-selftest") {
+        return RunInputArenaSelfTest();
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "async-queue-selftest") {
+        return RunAsyncQueueSelfTest();
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "codegen-selftest") {
+        return RunCodegenSelfTest();
+    }
+
+    if (argc >= 2 && std::string(argv[1]) == "codegen-generate") {
+        if (argc < 3) {
+            std::cout << "用法: dlcv_infer_cpp_test codegen-generate <输出文件>\n";
+            return 2;
+        }
+        return RunCodegenGenerate(argv[2]);
+    }
+
     std::cout << "==== C++ 测试程序 ====\n";
     std::cout << "模型目录: " << WideToUtf8(kModelRoot) << "\n";
     std::cout << "固定设备: GPU(" << kGpuDeviceId << ")\n";
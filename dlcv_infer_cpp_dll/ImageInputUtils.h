@@ -6,7 +6,8 @@
 namespace dlcv_infer {
 namespace image_input {
 
-inline cv::Mat ConvertMatDepthTo8U(const cv::Mat& src) {
+// allocator 非空时，转换产生的新 Mat 从该分配器取缓冲区（例如推理输入缓冲池）
+inline cv::Mat ConvertMatDepthTo8U(const cv::Mat& src, cv::MatAllocator* allocator = nullptr) {
     if (src.empty()) {
         return {};
     }
@@ -15,6 +16,7 @@ inline cv::Mat ConvertMatDepthTo8U(const cv::Mat& src) {
     }
 
     cv::Mat dst;
+    dst.allocator = allocator;
     if (src.depth() == CV_16U) {
         src.convertTo(dst, CV_8U, 1.0 / 256.0);
         return dst;
@@ -39,7 +41,7 @@ inline cv::Mat ConvertMatDepthTo8U(const cv::Mat& src) {
     return dst;
 }
 
-inline cv::Mat ConvertMatChannels(const cv::Mat& src, int expectedChannels) {
+inline cv::Mat ConvertMatChannels(const cv::Mat& src, int expectedChannels, cv::MatAllocator* allocator = nullptr) {
     if (src.empty()) {
         return {};
     }
@@ -53,6 +55,7 @@ inline cv::Mat ConvertMatChannels(const cv::Mat& src, int expectedChannels) {
     }
 
     cv::Mat converted;
+    converted.allocator = allocator;
     if (expectedChannels == 3) {
         if (srcChannels == 1) {
             cv::cvtColor(src, converted, cv::COLOR_GRAY2RGB);
@@ -70,13 +73,13 @@ inline cv::Mat ConvertMatChannels(const cv::Mat& src, int expectedChannels) {
     return converted.empty() ? src : converted;
 }
 
-inline cv::Mat NormalizeInferInputImage(const cv::Mat& src, int expectedChannels) {
+inline cv::Mat NormalizeInferInputImage(const cv::Mat& src, int expectedChannels, cv::MatAllocator* allocator = nullptr) {
     if (src.empty()) {
         return {};
     }
 
-    cv::Mat normalizedDepth = ConvertMatDepthTo8U(src);
-    return ConvertMatChannels(normalizedDepth, expectedChannels);
+    cv::Mat normalizedDepth = ConvertMatDepthTo8U(src, allocator);
+    return ConvertMatChannels(normalizedDepth, expectedChannels, allocator);
 }
 
 } // namespace image_input
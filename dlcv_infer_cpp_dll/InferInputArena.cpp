@@ -0,0 +1,231 @@
+﻿#include "InferInputArena.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace dlcv_infer {
+
+namespace {
+
+constexpr size_t kPageSize = 4096;
+constexpr size_t kLinearClassLimit = static_cast<size_t>(64) << 10;
+
+void* AllocatePages(size_t bytes) {
+#ifdef _WIN32
+    void* p = _aligned_malloc(bytes, kPageSize);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, kPageSize, bytes) != 0) p = nullptr;
+#endif
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void FreePages(void* p) {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+// 尺寸分级：64KB 以内按页取整；更大的按 2 的幂四等分取整（浪费不超过 25%，仍是整页）
+size_t SizeClass(size_t bytes) {
+    const size_t pages = (bytes + kPageSize - 1) / kPageSize * kPageSize;
+    if (pages <= kLinearClassLimit) return pages == 0 ? kPageSize : pages;
+    size_t base = kLinearClassLimit;
+    while (base * 2 < pages) base *= 2;
+    const size_t step = base / 4;
+    return (pages + step - 1) / step * step;
+}
+
+} // namespace
+
+class InferInputArena::Pool final : public cv::MatAllocator {
+public:
+    explicit Pool(size_t capacityBytes) : _capacity(capacityBytes) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data0, size_t* step,
+        cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const override {
+        size_t total = CV_ELEM_SIZE(type);
+        for (int i = dims - 1; i >= 0; i--) {
+            if (step) {
+                if (data0 && step[i] != CV_AUTOSTEP) {
+                    CV_Assert(total <= step[i]);
+                    total = step[i];
+                } else {
+                    step[i] = total;
+                }
+            }
+            total *= static_cast<size_t>(sizes[i]);
+        }
+
+        cv::UMatData* u = new cv::UMatData(this);
+        u->size = total;
+        if (data0) {
+            u->data = u->origdata = static_cast<uchar*>(data0);
+            u->flags |= cv::UMatData::USER_ALLOCATED;
+            return u;
+        }
+        try {
+            u->data = u->origdata = static_cast<uchar*>(Take(total));
+        } catch (...) {
+            delete u;
+            throw;
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const override {
+        return u != nullptr;
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (!u) return;
+        if (!(u->flags & cv::UMatData::USER_ALLOCATED) && u->origdata) {
+            Give(u->origdata, u->size);
+        }
+        u->origdata = nullptr;
+        delete u;
+    }
+
+    void Close() {
+        bool destroy = false;
+        {
+            std::lock_guard<std::mutex> lk(_mu);
+            _closed = true;
+            ReleaseFreeLocked(0);
+            destroy = _outstandingBuffers == 0;
+        }
+        if (destroy) delete this;
+    }
+
+    void SetCapacity(size_t bytes) {
+        std::lock_guard<std::mutex> lk(_mu);
+        _capacity = bytes;
+        ReleaseFreeLocked(_capacity);
+    }
+
+    size_t GetCapacity() const {
+        std::lock_guard<std::mutex> lk(_mu);
+        return _capacity;
+    }
+
+    void Trim() {
+        std::lock_guard<std::mutex> lk(_mu);
+        ReleaseFreeLocked(0);
+    }
+
+    json Stats() const {
+        std::lock_guard<std::mutex> lk(_mu);
+        json out;
+        out["capacity_bytes"] = _capacity;
+        out["retained_bytes"] = _retainedBytes;
+        out["outstanding_bytes"] = _outstandingBytes;
+        out["hits"] = _hits;
+        out["misses"] = _misses;
+        return out;
+    }
+
+private:
+    void* Take(size_t bytes) const {
+        const size_t cls = SizeClass(bytes);
+        {
+            std::lock_guard<std::mutex> lk(_mu);
+            auto it = _free.find(cls);
+            if (it != _free.end() && !it->second.empty()) {
+                void* p = it->second.back();
+                it->second.pop_back();
+                _retainedBytes -= cls;
+                _outstandingBytes += cls;
+                _outstandingBuffers++;
+                _hits++;
+                return p;
+            }
+            _misses++;
+        }
+        void* p = AllocatePages(cls);
+        std::lock_guard<std::mutex> lk(_mu);
+        _outstandingBytes += cls;
+        _outstandingBuffers++;
+        return p;
+    }
+
+    // size 为 Mat 的数据字节数，与分配时相同，映射回同一级别
+    void Give(void* p, size_t size) const {
+        const size_t cls = SizeClass(size);
+        bool destroy = false;
+        bool keep = false;
+        {
+            std::lock_guard<std::mutex> lk(_mu);
+            _outstandingBytes -= cls;
+            _outstandingBuffers--;
+            if (!_closed && _retainedBytes + cls <= _capacity) {
+                _free[cls].push_back(p);
+                _retainedBytes += cls;
+                keep = true;
+            }
+            destroy = _closed && _outstandingBuffers == 0;
+        }
+        if (!keep) FreePages(p);
+        if (destroy) delete this;
+    }
+
+    void ReleaseFreeLocked(size_t keepBytes) const {
+        // 从大到小释放，直到保留量不超过 keepBytes
+        for (auto it = _free.rbegin(); it != _free.rend() && _retainedBytes > keepBytes; ++it) {
+            auto& list = it->second;
+            while (!list.empty() && _retainedBytes > keepBytes) {
+                FreePages(list.back());
+                list.pop_back();
+                _retainedBytes -= it->first;
+            }
+        }
+    }
+
+    mutable std::mutex _mu;
+    mutable std::map<size_t, std::vector<void*>> _free;
+    mutable size_t _retainedBytes = 0;
+    mutable size_t _outstandingBytes = 0;
+    mutable size_t _outstandingBuffers = 0;
+    mutable std::uint64_t _hits = 0;
+    mutable std::uint64_t _misses = 0;
+    size_t _capacity;
+    bool _closed = false;
+};
+
+InferInputArena::InferInputArena(size_t capacityBytes) : _pool(new Pool(capacityBytes)) {}
+
+InferInputArena::~InferInputArena() {
+    try { _pool->Close(); } catch (...) {}
+}
+
+cv::MatAllocator* InferInputArena::Allocator() const {
+    return _pool;
+}
+
+void InferInputArena::SetCapacity(size_t capacityBytes) {
+    _pool->SetCapacity(capacityBytes);
+}
+
+size_t InferInputArena::GetCapacity() const {
+    return _pool->GetCapacity();
+}
+
+void InferInputArena::Trim() {
+    _pool->Trim();
+}
+
+json InferInputArena::Stats() const {
+    return _pool->Stats();
+}
+
+} // namespace dlcv_infer
@@ -0,0 +1,51 @@
+﻿#pragma once
+
+#include <cstddef>
+
+#include "dlcv_infer.h"
+
+namespace dlcv_infer {
+
+/// <summary>
+/// 推理输入缓冲池：作为 cv::MatAllocator 分配推理前转换/紧凑化的输入图像，
+/// 缓冲区按尺寸分级（页对齐，相邻级别相差不超过 25%），Mat 释放后回到池中供后续调用复用。
+/// 分配出的 Mat 仍按引用计数管理，可被流程或缓存持有；池本身关闭后，借出的缓冲区在其 Mat 释放时直接释放。
+/// 池中保留的空闲缓冲区总量不超过容量，超出部分释放回系统。
+/// </summary>
+class InferInputArena final {
+public:
+    static constexpr size_t kDefaultCapacityBytes = static_cast<size_t>(256) << 20;
+
+    explicit InferInputArena(size_t capacityBytes = kDefaultCapacityBytes);
+    ~InferInputArena();
+
+    InferInputArena(const InferInputArena&) = delete;
+    InferInputArena& operator=(const InferInputArena&) = delete;
+
+    /// <summary>
+    /// 赋给目标 Mat 的 allocator 后再写入（convertTo/cvtColor/copyTo 等），即从池中取缓冲区
+    /// </summary>
+    cv::MatAllocator* Allocator() const;
+
+    /// <summary>
+    /// 容量为 0 时不保留空闲缓冲区（等同于直接分配）；调小时立即释放多余的空闲缓冲区
+    /// </summary>
+    void SetCapacity(size_t capacityBytes);
+    size_t GetCapacity() const;
+
+    /// <summary>
+    /// 释放全部空闲缓冲区
+    /// </summary>
+    void Trim();
+
+    /// <summary>
+    /// {capacity_bytes,retained_bytes,outstanding_bytes,hits,misses}：命中为复用空闲缓冲区的分配次数
+    /// </summary>
+    json Stats() const;
+
+private:
+    class Pool;
+    Pool* _pool;
+};
+
+} // namespace dlcv_infer
@@ -0,0 +1,124 @@
+﻿#include "InferRequestQueue.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace dlcv_infer {
+
+InferRequestQueue::InferRequestQueue(int workerThreads, int maxInFlight, AsyncOverflowPolicy policy)
+    : _maxInFlight(static_cast<size_t>(std::max(1, maxInFlight))),
+      _policy(policy) {
+    // 工作线程多于在途上限没有意义
+    const int threads = std::max(1, std::min(workerThreads, static_cast<int>(_maxInFlight)));
+    _workers.reserve(static_cast<size_t>(threads));
+    for (int i = 0; i < threads; i++) {
+        _workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+InferRequestQueue::~InferRequestQueue() {
+    try { Close(true); } catch (...) {}
+}
+
+bool InferRequestQueue::Submit(Request request) {
+    std::vector<Request> dropped;
+    bool rejected = false;
+    {
+        std::unique_lock<std::mutex> lk(_mu);
+        if (!_closed && _pending.size() + _running >= _maxInFlight) {
+            if (_policy == AsyncOverflowPolicy::Reject) {
+                rejected = true;
+            } else if (_policy == AsyncOverflowPolicy::DropOldest && !_pending.empty()) {
+                dropped.push_back(std::move(_pending.front()));
+                _pending.pop_front();
+            } else {
+                _hasSpace.wait(lk, [this]() { return _closed || _pending.size() + _running < _maxInFlight; });
+            }
+        }
+        if (!_closed && !rejected) {
+            _pending.push_back(std::move(request));
+            _hasWork.notify_one();
+        }
+        if (_closed) rejected = true;
+    }
+
+    CancelAll(dropped, "async infer request dropped: queue full");
+    if (rejected) {
+        std::vector<Request> self;
+        self.push_back(std::move(request));
+        CancelAll(self, "async infer request rejected: queue full or closed");
+        return false;
+    }
+    return true;
+}
+
+void InferRequestQueue::WaitIdle() {
+    std::unique_lock<std::mutex> lk(_mu);
+    _idle.wait(lk, [this]() { return _pending.empty() && _running == 0; });
+}
+
+void InferRequestQueue::Close(bool cancelPending) {
+    std::vector<Request> cancelled;
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        _closed = true;
+        if (cancelPending) {
+            for (auto& r : _pending) cancelled.push_back(std::move(r));
+            _pending.clear();
+        }
+        workers.swap(_workers);
+        _hasWork.notify_all();
+        _hasSpace.notify_all();
+    }
+    CancelAll(cancelled, "async infer request cancelled: model released");
+    for (auto& t : workers) {
+        if (t.joinable()) t.join();
+    }
+    std::lock_guard<std::mutex> lk(_mu);
+    _idle.notify_all();
+}
+
+size_t InferRequestQueue::InFlight() const {
+    std::lock_guard<std::mutex> lk(_mu);
+    return _pending.size() + _running;
+}
+
+void InferRequestQueue::WorkerLoop() {
+    for (;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lk(_mu);
+            _hasWork.wait(lk, [this]() { return _closed || !_pending.empty(); });
+            // 关闭后仍把已排队的请求执行完（Close(false)）
+            if (_pending.empty()) return;
+            request = std::move(_pending.front());
+            _pending.pop_front();
+            _running++;
+        }
+
+        try {
+            if (request.Run) request.Run();
+        } catch (...) {
+        }
+
+        std::lock_guard<std::mutex> lk(_mu);
+        _running--;
+        _hasSpace.notify_one();
+        if (_pending.empty() && _running == 0) _idle.notify_all();
+    }
+}
+
+void InferRequestQueue::CancelAll(std::vector<Request>& requests, const char* reason) {
+    for (auto& r : requests) {
+        if (!r.Cancel) continue;
+        try {
+            r.Cancel(std::make_exception_ptr(std::runtime_error(reason)));
+        } catch (...) {
+        }
+    }
+    requests.clear();
+}
+
+} // namespace dlcv_infer
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "dlcv_infer.h"
+
+namespace dlcv_infer {
+
+/// <summary>
+/// Model 异步推理的有界请求队列：自带工作线程，在途请求（排队 + 执行中）不超过 maxInFlight。
+/// 达到上限时按 AsyncOverflowPolicy 处理新请求：Block 阻塞提交线程，Reject 拒绝新请求，
+/// DropOldest 丢弃最早一条尚未开始执行的请求（全部在执行时等同 Block）。
+/// 被拒绝、丢弃或因关闭而取消的请求调用其 Cancel，并在调用 Submit/Close 的线程上执行。
+/// </summary>
+class InferRequestQueue final {
+public:
+    struct Request {
+        std::function<void()> Run;                          // 在工作线程执行，自行处理异常
+        std::function<void(std::exception_ptr)> Cancel;     // 未执行即结束时调用
+    };
+
+    InferRequestQueue(int workerThreads, int maxInFlight, AsyncOverflowPolicy policy);
+    ~InferRequestQueue();
+
+    InferRequestQueue(const InferRequestQueue&) = delete;
+    InferRequestQueue& operator=(const InferRequestQueue&) = delete;
+
+    /// <summary>
+    /// 提交请求。返回 false 表示请求被拒绝（已调用其 Cancel）或队列已关闭。
+    /// </summary>
+    bool Submit(Request request);
+
+    /// <summary>
+    /// 等待全部在途请求结束
+    /// </summary>
+    void WaitIdle();
+
+    /// <summary>
+    /// 停止接收新请求：cancelPending 为 true 时取消排队中的请求，否则执行完；随后等待工作线程退出。
+    /// 不得在工作线程（完成回调）中调用。
+    /// </summary>
+    void Close(bool cancelPending);
+
+    size_t InFlight() const;
+
+private:
+    void WorkerLoop();
+    static void CancelAll(std::vector<Request>& requests, const char* reason);
+
+    const size_t _maxInFlight;
+    const AsyncOverflowPolicy _policy;
+    mutable std::mutex _mu;
+    std::condition_variable _hasWork;
+    std::condition_variable _hasSpace;
+    std::condition_variable _idle;
+    std::deque<Request> _pending;
+    size_t _running = 0;
+    bool _closed = false;
+    std::vector<std::thread> _workers;
+};
+
+} // namespace dlcv_infer
@@ -0,0 +1,261 @@
+﻿#include "InferStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dlcv_infer {
+
+namespace {
+
+std::int64_t SteadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int HighestBit(std::uint64_t v) {
+    int bit = 0;
+    while (v >>= 1) bit++;
+    return bit;
+}
+
+json SummaryToJson(const LatencyHistogram::Summary& s) {
+    json out;
+    out["count"] = s.Count;
+    out["mean"] = s.MeanMs;
+    out["p50"] = s.P50Ms;
+    out["p90"] = s.P90Ms;
+    out["p99"] = s.P99Ms;
+    out["max"] = s.MaxMs;
+    return out;
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+    for (auto& b : _buckets) b.store(0, std::memory_order_relaxed);
+}
+
+size_t LatencyHistogram::BucketIndex(std::uint64_t us) {
+    const std::uint64_t linear = 1ULL << kSubBucketBits;
+    if (us < linear) return static_cast<size_t>(us);
+    const int magnitude = HighestBit(us);
+    const int shift = (magnitude < kMaxMagnitude ? magnitude : kMaxMagnitude) - (kSubBucketBits - 1);
+    const std::uint64_t sub = std::min(us >> shift, linear - 1);
+    return static_cast<size_t>(shift) * (linear / 2) + static_cast<size_t>(sub);
+}
+
+double LatencyHistogram::BucketValueMs(size_t index) {
+    const size_t linear = static_cast<size_t>(1) << kSubBucketBits;
+    if (index < linear) return static_cast<double>(index) / 1000.0;
+    const size_t shift = index / (linear / 2) - 1;
+    const std::uint64_t sub = static_cast<std::uint64_t>(index % (linear / 2) + linear / 2);
+    // 取桶的中点
+    const double lower = static_cast<double>(sub << shift);
+    const double width = static_cast<double>(1ULL << shift);
+    return (lower + width / 2.0) / 1000.0;
+}
+
+void LatencyHistogram::Record(double ms) {
+    const std::uint64_t us = ms > 0.0 ? static_cast<std::uint64_t>(std::llround(ms * 1000.0)) : 0;
+    _buckets[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    _sumUs.fetch_add(us, std::memory_order_relaxed);
+    std::uint64_t prev = _maxUs.load(std::memory_order_relaxed);
+    while (us > prev && !_maxUs.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::Summarize() const {
+    Summary s;
+    std::vector<std::uint64_t> counts(kBucketCount);
+    std::uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) return s;
+
+    s.Count = total;
+    s.MaxMs = static_cast<double>(_maxUs.load(std::memory_order_relaxed)) / 1000.0;
+    s.MeanMs = static_cast<double>(_sumUs.load(std::memory_order_relaxed)) / 1000.0 / static_cast<double>(total);
+
+    const auto percentile = [&](double q) {
+        const std::uint64_t rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(total))));
+        std::uint64_t seen = 0;
+        for (size_t i = 0; i < kBucketCount; i++) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(BucketValueMs(i), s.MaxMs);
+        }
+        return s.MaxMs;
+    };
+    s.P50Ms = percentile(0.50);
+    s.P90Ms = percentile(0.90);
+    s.P99Ms = percentile(0.99);
+    return s;
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& b : _buckets) b.store(0, std::memory_order_relaxed);
+    _sumUs.store(0, std::memory_order_relaxed);
+    _maxUs.store(0, std::memory_order_relaxed);
+}
+
+InferStatistics::InferStatistics() {
+    _resetAtNs.store(SteadyNowNs());
+}
+
+void InferStatistics::RecordCall(const CallTiming& timing) {
+    _requests.fetch_add(1, std::memory_order_relaxed);
+    _images.fetch_add(timing.Images, std::memory_order_relaxed);
+    _total.Record(timing.TotalMs);
+    _native.Record(timing.NativeMs);
+    _preprocess.Record(timing.PreprocessMs);
+    _parse.Record(timing.ParseMs);
+    if (timing.NodeTimings == nullptr || timing.NodeTimings->empty()) return;
+
+    const NodeTable* table = _table.load(std::memory_order_acquire);
+    if (table != nullptr) {
+        bool complete = true;
+        for (const auto& t : *timing.NodeTimings) {
+            if (table->Find(t.nodeId) == nullptr) {
+                complete = false;
+                break;
+            }
+        }
+        if (!complete) table = PublishNodes(*timing.NodeTimings);
+    } else {
+        table = PublishNodes(*timing.NodeTimings);
+    }
+    for (const auto& t : *timing.NodeTimings) {
+        LatencyHistogram* h = table->Find(t.nodeId);
+        if (h != nullptr) h->Record(t.elapsedMs);
+    }
+}
+
+void InferStatistics::RecordError() {
+    _errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+LatencyHistogram* InferStatistics::NodeTable::Find(int nodeId) const {
+    const auto it = std::lower_bound(Entries.begin(), Entries.end(), nodeId,
+        [](const std::pair<int, NodeEntry*>& e, int id) { return e.first < id; });
+    return it != Entries.end() && it->first == nodeId ? &it->second->Latency : nullptr;
+}
+
+const InferStatistics::NodeTable* InferStatistics::PublishNodes(const std::vector<FlowNodeTiming>& timings) {
+    std::lock_guard<std::mutex> lk(_nodeMu);
+    bool added = false;
+    for (const auto& t : timings) {
+        std::unique_ptr<NodeEntry>& entry = _nodes[t.nodeId];
+        if (!entry) {
+            entry.reset(new NodeEntry());
+            entry->Type = t.nodeType;
+            entry->Title = t.nodeTitle;
+            added = true;
+        }
+    }
+    const NodeTable* current = _table.load(std::memory_order_relaxed);
+    if (!added && current != nullptr) return current;
+
+    std::unique_ptr<NodeTable> table(new NodeTable());
+    table->Entries.reserve(_nodes.size());
+    for (const auto& kv : _nodes) table->Entries.emplace_back(kv.first, kv.second.get());
+    const NodeTable* published = table.get();
+    _tables.push_back(std::move(table));
+    _table.store(published, std::memory_order_release);
+    return published;
+}
+
+json InferStatistics::Snapshot() const {
+    const double elapsedS = std::max(0.0, static_cast<double>(SteadyNowNs() - _resetAtNs.load()) / 1e9);
+    const std::uint64_t requests = _requests.load(std::memory_order_relaxed);
+    const std::uint64_t images = _images.load(std::memory_order_relaxed);
+
+    json out;
+    out["since_reset_s"] = elapsedS;
+    out["requests"] = requests;
+    out["images"] = images;
+    out["errors"] = _errors.load(std::memory_order_relaxed);
+    out["requests_per_s"] = elapsedS > 0.0 ? static_cast<double>(requests) / elapsedS : 0.0;
+    out["images_per_s"] = elapsedS > 0.0 ? static_cast<double>(images) / elapsedS : 0.0;
+    out["total_ms"] = SummaryToJson(_total.Summarize());
+    out["native_ms"] = SummaryToJson(_native.Summarize());
+    out["preprocess_ms"] = SummaryToJson(_preprocess.Summarize());
+    out["parse_ms"] = SummaryToJson(_parse.Summarize());
+
+    json nodes = json::array();
+    {
+        std::lock_guard<std::mutex> lk(_nodeMu);
+        for (const auto& kv : _nodes) {
+            const LatencyHistogram::Summary s = kv.second->Latency.Summarize();
+            if (s.Count == 0) continue;
+            json one = SummaryToJson(s);
+            one["node_id"] = kv.first;
+            one["node_type"] = kv.second->Type;
+            one["node_title"] = kv.second->Title;
+            nodes.push_back(std::move(one));
+        }
+    }
+    out["flow_nodes"] = std::move(nodes);
+    return out;
+}
+
+void InferStatistics::Reset() {
+    _requests.store(0, std::memory_order_relaxed);
+    _images.store(0, std::memory_order_relaxed);
+    _errors.store(0, std::memory_order_relaxed);
+    _total.Reset();
+    _native.Reset();
+    _preprocess.Reset();
+    _parse.Reset();
+    {
+        std::lock_guard<std::mutex> lk(_nodeMu);
+        for (auto& kv : _nodes) kv.second->Latency.Reset();
+    }
+    _resetAtNs.store(SteadyNowNs());
+}
+
+InferCallScope::InferCallScope(InferStatistics* stats, size_t images)
+    : _stats(stats), _images(images) {
+    if (_stats != nullptr) {
+        _begin = Clock::now();
+        _preprocessed = _begin;
+        _inferred = _begin;
+    }
+}
+
+InferCallScope::~InferCallScope() {
+    if (_stats != nullptr && !_committed) _stats->RecordError();
+}
+
+void InferCallScope::Preprocessed() {
+    if (_stats == nullptr) return;
+    _preprocessed = Clock::now();
+    _inferred = _preprocessed;
+}
+
+void InferCallScope::Inferred(double nativeMs, const std::vector<FlowNodeTiming>* nodeTimings) {
+    if (_stats == nullptr) return;
+    _inferred = Clock::now();
+    _nativeMs = nativeMs;
+    _nodeTimings = nodeTimings;
+}
+
+void InferCallScope::Commit() {
+    if (_stats == nullptr || _committed) return;
+    _committed = true;
+    const Clock::time_point end = Clock::now();
+    const auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+
+    InferStatistics::CallTiming timing;
+    timing.Images = _images;
+    timing.TotalMs = ms(_begin, end);
+    timing.PreprocessMs = ms(_begin, _preprocessed);
+    timing.NativeMs = _nativeMs >= 0.0 ? _nativeMs : ms(_preprocessed, _inferred);
+    timing.ParseMs = ms(_inferred, end);
+    timing.NodeTimings = _nodeTimings;
+    _stats->RecordCall(timing);
+}
+
+} // namespace dlcv_infer
@@ -0,0 +1,140 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "dlcv_infer.h"
+
+namespace dlcv_infer {
+
+/// <summary>
+/// 延迟直方图（HDR 风格的对数-线性分桶，单位微秒）：每个 2 的幂区间再等分 32 桶，相对误差约 1.6%，
+/// 覆盖到约 38 小时。记录只做原子加，不加锁；Reset 与并发记录同时发生时统计可能少计个别样本。
+/// </summary>
+class LatencyHistogram final {
+public:
+    struct Summary {
+        std::uint64_t Count = 0;
+        double MeanMs = 0.0;
+        double P50Ms = 0.0;
+        double P90Ms = 0.0;
+        double P99Ms = 0.0;
+        double MaxMs = 0.0;
+    };
+
+    LatencyHistogram();
+
+    void Record(double ms);
+    Summary Summarize() const;
+    void Reset();
+
+private:
+    static constexpr int kSubBucketBits = 6;
+    static constexpr int kMaxMagnitude = 37;
+    static constexpr size_t kBucketCount = static_cast<size_t>((kMaxMagnitude - kSubBucketBits + 3) << (kSubBucketBits - 1));
+
+    static size_t BucketIndex(std::uint64_t us);
+    static double BucketValueMs(size_t index);
+
+    std::array<std::atomic<std::uint64_t>, kBucketCount> _buckets;
+    std::atomic<std::uint64_t> _sumUs{ 0 };
+    std::atomic<std::uint64_t> _maxUs{ 0 };
+};
+
+/// <summary>
+/// Model 的推理统计：请求数、图像数、失败数与总耗时/SDK 推理/预处理/结果解析/各流程节点的延迟直方图。
+/// 由各推理线程并发记录，GetInferStatistics 随时读取，与调用线程无关。
+/// </summary>
+class InferStatistics final {
+public:
+    struct CallTiming {
+        size_t Images = 0;
+        double TotalMs = 0.0;
+        double NativeMs = 0.0;
+        double PreprocessMs = 0.0;
+        double ParseMs = 0.0;
+        const std::vector<FlowNodeTiming>* NodeTimings = nullptr;
+    };
+
+    InferStatistics();
+
+    void RecordCall(const CallTiming& timing);
+    void RecordError();
+
+    /// <summary>
+    /// 自上次重置起的统计快照：{since_reset_s,requests,images,errors,requests_per_s,images_per_s,
+    /// total_ms,native_ms,preprocess_ms,parse_ms,flow_nodes}；各延迟项为 {count,mean,p50,p90,p99,max}。
+    /// </summary>
+    json Snapshot() const;
+    void Reset();
+
+private:
+    struct NodeEntry {
+        std::string Type;
+        std::string Title;
+        LatencyHistogram Latency;
+    };
+
+    // 按 nodeId 升序的只读节点表：发布后不再修改，记录时无锁二分查找
+    struct NodeTable {
+        std::vector<std::pair<int, NodeEntry*>> Entries;
+        LatencyHistogram* Find(int nodeId) const;
+    };
+
+    // 查找不到的节点在锁内补建，并发布包含它们的新表
+    const NodeTable* PublishNodes(const std::vector<FlowNodeTiming>& timings);
+
+    std::atomic<std::uint64_t> _requests{ 0 };
+    std::atomic<std::uint64_t> _images{ 0 };
+    std::atomic<std::uint64_t> _errors{ 0 };
+    std::atomic<std::int64_t> _resetAtNs{ 0 };
+    LatencyHistogram _total;
+    LatencyHistogram _native;
+    LatencyHistogram _preprocess;
+    LatencyHistogram _parse;
+    // 节点直方图只增不删（Reset 时原地清零）；旧表随对象保留，读者无需回收同步
+    mutable std::mutex _nodeMu;
+    std::map<int, std::unique_ptr<NodeEntry>> _nodes;
+    std::vector<std::unique_ptr<NodeTable>> _tables;
+    std::atomic<const NodeTable*> _table{ nullptr };
+};
+
+/// <summary>
+/// 一次推理调用的分段计时：构造时开始，依次标记预处理完成与推理完成，Commit 时写入统计；
+/// 未 Commit 即析构（抛出异常）记为失败。stats 为空时不记录。
+/// </summary>
+class InferCallScope final {
+public:
+    InferCallScope(InferStatistics* stats, size_t images);
+    ~InferCallScope();
+
+    InferCallScope(const InferCallScope&) = delete;
+    InferCallScope& operator=(const InferCallScope&) = delete;
+
+    void Preprocessed();
+    /// nativeMs < 0 时取预处理完成到此刻的耗时；nodeTimings 须在 Commit 前保持有效
+    void Inferred(double nativeMs = -1.0, const std::vector<FlowNodeTiming>* nodeTimings = nullptr);
+    void Commit();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    InferStatistics* _stats;
+    size_t _images;
+    Clock::time_point _begin;
+    Clock::time_point _preprocessed;
+    Clock::time_point _inferred;
+    double _nativeMs = -1.0;
+    const std::vector<FlowNodeTiming>* _nodeTimings = nullptr;
+    bool _committed = false;
+};
+
+} // namespace dlcv_infer
@@ -1,8 +1,13 @@
 #include "dlcv_infer.h"
 #include "dlcv_sntl_admin.h"
 #include "ImageInputUtils.h"
+#include "InferRequestQueue.h"
+#include "InferStatistics.h"
+#include "InferInputArena.h"
 #include "flow/FlowGraphModel.h"
+#include "flow/FlowNodeCache.h"
 #include "flow/FlowPayloadTypes.h"
+#include "flow/modules/ModelModules.h"
 #include "flow/utils/MaskRleUtils.h"
 #ifdef _WIN32
 #include <Windows.h>
@@ -21,6 +26,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <iterator>
 #include <locale>
 #include <random>
 #include <stdexcept>
@@ -39,6 +45,28 @@ using Json = dlcv_infer::json;
 thread_local double g_lastDlcvInferMs = 0.0;
 thread_local double g_lastTotalInferMs = 0.0;
 thread_local std::vector<dlcv_infer::FlowNodeTiming> g_lastFlowNodeTimings;
+// 当前线程正在为哪个模型执行单图合批（该模型合并后的 InferBatch 不重复计入推理统计；
+// 其它模型的嵌套调用照常统计）
+thread_local const dlcv_infer::Model* g_microBatchModel = nullptr;
+
+// 推理调用计数：AutoTune 进行中时拒绝新的推理（与 Model::AutoTune 的检查顺序相反，二者至少一方能看到对方）
+class ActiveCallScope final {
+public:
+    ActiveCallScope(std::atomic<int>& active, const std::atomic<bool>& tuning) : _active(active) {
+        _active.fetch_add(1);
+        if (tuning.load()) {
+            _active.fetch_sub(1);
+            throw std::runtime_error("AutoTune in progress, inference is not allowed");
+        }
+    }
+    ~ActiveCallScope() { _active.fetch_sub(1); }
+
+    ActiveCallScope(const ActiveCallScope&) = delete;
+    ActiveCallScope& operator=(const ActiveCallScope&) = delete;
+
+private:
+    std::atomic<int>& _active;
+};
 
 void SetLastInferTiming(double dlcvInferMs, double totalInferMs, std::vector<dlcv_infer::FlowNodeTiming> nodeTimings = {}) {
     g_lastDlcvInferMs = std::max(0.0, dlcvInferMs);
@@ -385,14 +413,7 @@ void RewritePipelineModelPath(Json& pipelineRoot, const std::unordered_map<std::
     }
 }
 
-void WriteUtf8Text(const std::string& path, const std::string& content) {
-    std::ofstream ofs(path, std::ios::binary);
-    if (!ofs) throw std::runtime_error("failed to write file: " + path);
-    ofs.write(content.data(), static_cast<std::streamsize>(content.size()));
-    if (!ofs) throw std::runtime_error("failed to write file: " + path);
-}
-
-DvsUnpackResult UnpackDvsArchiveToTemp(const std::wstring& archivePathW) {
+FILE* OpenArchiveOrThrow(const std::wstring& archivePathW) {
 #ifdef _WIN32
     FILE* fp = nullptr;
     if (_wfopen_s(&fp, archivePathW.c_str(), L"rb") != 0 || fp == nullptr) {
@@ -402,6 +423,68 @@ DvsUnpackResult UnpackDvsArchiveToTemp(const std::wstring& archivePathW) {
 #endif
         throw std::runtime_error("failed to open dvst file");
     }
+    return fp;
+}
+
+// 归档标识（16 位十六进制）：路径、文件大小与最后修改时间的哈希，作为流程快照与解包目录的查找键。
+// 只读取文件元数据，启动时不通读归档；原地覆盖且大小与修改时间都不变的归档不会被识别为新归档。
+std::string ArchiveIdentityHex(const std::wstring& archivePathW) {
+    unsigned long long size = 0;
+    unsigned long long mtime = 0;
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(archivePathW.c_str(), GetFileExInfoStandard, &data) ||
+        (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+        throw std::runtime_error("failed to stat dvst file");
+    }
+    size = (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+    mtime = (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    const std::string pathUtf8 = dlcv_infer::convertWstringToUtf8(archivePathW);
+#else
+    const std::string pathUtf8 = WideToUtf8Portable(archivePathW);
+    std::error_code ec;
+    size = static_cast<unsigned long long>(fs::file_size(pathUtf8, ec));
+    if (ec) throw std::runtime_error("failed to stat dvst file");
+    const auto writeTime = fs::last_write_time(pathUtf8, ec);
+    if (ec) throw std::runtime_error("failed to stat dvst file");
+    mtime = static_cast<unsigned long long>(writeTime.time_since_epoch().count());
+#endif
+    std::uint64_t h = dlcv_infer::flow::FlowHashBuffer(1469598103934665603ULL, pathUtf8.data(), pathUtf8.size());
+    h = dlcv_infer::flow::FlowHashBuffer(h, &size, sizeof(size));
+    h = dlcv_infer::flow::FlowHashBuffer(h, &mtime, sizeof(mtime));
+
+    char hex[17] = { 0 };
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(h));
+    return std::string(hex);
+}
+
+void EnsureDirectory(const std::string& dir) {
+#ifdef _WIN32
+    // 逐级创建（CreateDirectoryA 只创建最后一级）
+    size_t pos = dir.find_first_of("\\/", dir.size() > 3 ? 3 : 0);
+    while (pos != std::string::npos) {
+        (void)CreateDirectoryA(dir.substr(0, pos).c_str(), nullptr);
+        pos = dir.find_first_of("\\/", pos + 1);
+    }
+    (void)CreateDirectoryA(dir.c_str(), nullptr);
+    const DWORD attr = GetFileAttributesA(dir.c_str());
+    if (attr == INVALID_FILE_ATTRIBUTES || (attr & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+        throw std::runtime_error("failed to create directory: " + dir);
+    }
+#else
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (!fs::is_directory(dir, ec)) {
+        throw std::runtime_error("failed to create directory: " + dir);
+    }
+#endif
+}
+
+// targetDir 为空时解包到新建的临时目录；否则解包到 targetDir（须已存在）。失败时删除解包目录。
+// pathDir 非空时流程中的模型路径按 pathDir 改写（解包后整体改名为 pathDir 时使用）
+DvsUnpackResult UnpackDvsArchive(const std::wstring& archivePathW, const std::string& targetDir,
+                                 const std::string& pathDir = std::string()) {
+    FILE* fp = OpenArchiveOrThrow(archivePathW);
 
     DvsUnpackResult out;
     try {
@@ -420,7 +503,7 @@ DvsUnpackResult UnpackDvsArchiveToTemp(const std::wstring& archivePathW) {
             throw std::runtime_error("invalid dvst header: file_list/file_size mismatch");
         }
 
-        out.tempDir = CreateTempDir();
+        out.tempDir = targetDir.empty() ? CreateTempDir() : targetDir;
         TempDirGuard unpackGuard(out.tempDir);
         std::unordered_map<std::string, std::string> fileNameToTemp;
         bool gotPipeline = false;
@@ -448,8 +531,9 @@ DvsUnpackResult UnpackDvsArchiveToTemp(const std::wstring& archivePathW) {
                 const std::string fullPath = JoinPath(out.tempDir, safeName);
 
                 CopyStreamToFile(fp, fullPath, size);
-                fileNameToTemp[ToLowerAscii(fileName)] = fullPath;
-                fileNameToTemp[ToLowerAscii(GetFileNameOnly(fileName))] = fullPath;
+                const std::string finalPath = pathDir.empty() ? fullPath : JoinPath(pathDir, safeName);
+                fileNameToTemp[ToLowerAscii(fileName)] = finalPath;
+                fileNameToTemp[ToLowerAscii(GetFileNameOnly(fileName))] = finalPath;
             }
         }
 
@@ -465,6 +549,166 @@ DvsUnpackResult UnpackDvsArchiveToTemp(const std::wstring& archivePathW) {
     return out;
 }
 
+// 只读取归档中的 pipeline.json（跳过模型文件，不解包），用于生成执行代码等离线处理
+Json ReadDvsPipeline(const std::wstring& archivePathW) {
+    FILE* fp = OpenArchiveOrThrow(archivePathW);
+
+    Json root;
+    bool gotPipeline = false;
+    try {
+        char magic[3] = { 0 };
+        ReadExactOrThrow(fp, magic, 3, "failed to read dvst magic");
+        if (!(magic[0] == 'D' && magic[1] == 'V' && magic[2] == '\n')) {
+            throw std::runtime_error("invalid dvst format: missing DV header");
+        }
+
+        const Json header = Json::parse(ReadLineOrThrow(fp));
+        if (!header.is_object() ||
+            !header.contains("file_list") || !header.at("file_list").is_array() ||
+            !header.contains("file_size") || !header.at("file_size").is_array() ||
+            header.at("file_list").size() != header.at("file_size").size()) {
+            throw std::runtime_error("invalid dvst header: file_list/file_size mismatch");
+        }
+
+        const auto& fileList = header.at("file_list");
+        const auto& fileSize = header.at("file_size");
+        for (size_t i = 0; i < fileList.size() && !gotPipeline; i++) {
+            if (!fileList.at(i).is_string()) throw std::runtime_error("invalid dvst header: file_list item is not string");
+            const long long size = ReadFileSizeFromJson(fileSize.at(i));
+            if (size < 0) throw std::runtime_error("invalid file size in dvst header");
+
+            if (ToLowerAscii(fileList.at(i).get<std::string>()) == "pipeline.json") {
+                std::string text(static_cast<size_t>(size), '\0');
+                if (size > 0) {
+                    ReadExactOrThrow(fp, &text[0], static_cast<size_t>(size), "failed to read pipeline.json");
+                }
+                root = Json::parse(text);
+                gotPipeline = true;
+                continue;
+            }
+            // 按块跳过（单次偏移受 long 范围限制）
+            long long remaining = size;
+            while (remaining > 0) {
+                const long step = static_cast<long>(std::min<long long>(remaining, 1LL << 30));
+                if (std::fseek(fp, step, SEEK_CUR) != 0) throw std::runtime_error("failed to read dvst file content");
+                remaining -= step;
+            }
+        }
+    } catch (...) {
+        std::fclose(fp);
+        throw;
+    }
+
+    std::fclose(fp);
+    if (!gotPipeline) throw std::runtime_error("pipeline.json not found in dvst archive");
+    return root;
+}
+
+int ReadReportCode(const Json& report) {
+    int code = 1;
+    try { code = report.contains("code") ? report.at("code").get<int>() : 1; } catch (...) { code = 1; }
+    return code;
+}
+
+// 共享解包目录中记录改写后流程根对象的文件（模型文件名为随机串，不会与之重名）
+const char* const kUnpackedPipelineName = "pipeline.json";
+
+// 读取已发布的共享解包目录：根对象可解析且引用的模型文件都在时返回 true
+bool TryReadUnpackedPipeline(const std::string& unpackDir, Json& root) {
+    try {
+        std::ifstream ifs(JoinPath(unpackDir, kUnpackedPipelineName), std::ios::binary);
+        if (!ifs) return false;
+        const std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        Json parsed = Json::parse(text);
+        if (!parsed.is_object() || !parsed.contains("nodes") || !parsed.at("nodes").is_array()) return false;
+        for (const auto& node : parsed.at("nodes")) {
+            if (!node.is_object() || !node.contains("properties") || !node.at("properties").is_object()) continue;
+            const auto& props = node.at("properties");
+            if (!props.contains("model_path") || !props.at("model_path").is_string()) continue;
+            std::ifstream modelFile(props.at("model_path").get<std::string>(), std::ios::binary);
+            if (!modelFile) return false;
+        }
+        root = std::move(parsed);
+        return true;
+    } catch (...) {
+        return false;
+    }
+}
+
+bool RenameDirectory(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+    return MoveFileA(from.c_str(), to.c_str()) != 0;
+#else
+    return std::rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+// 把归档解包到固定目录 unpackDir 并返回改写了模型路径的流程根对象。unpackDir 已发布时直接复用；
+// 否则先解包到同级临时目录、写入根对象后整体改名，目录要么完整要么不存在。
+// 并发解包同一归档时只有一方改名成功，其余删除各自的临时目录并复用已发布的目录。
+Json UnpackArchiveToSharedDir(const std::wstring& archivePathW, const std::string& unpackDir) {
+    Json root;
+    if (TryReadUnpackedPipeline(unpackDir, root)) return root;
+    // 目录存在但模型文件缺失（被外部清理过）：删除后重新解包
+    (void)DeleteDirectoryRecursive(unpackDir);
+
+    const std::string stagingDir = unpackDir + "_" + RandomHex(8) + ".tmp";
+    EnsureDirectory(stagingDir);
+    TempDirGuard stagingGuard(stagingDir);
+    DvsUnpackResult unpack = UnpackDvsArchive(archivePathW, stagingDir, unpackDir);
+    {
+        std::ofstream ofs(JoinPath(stagingDir, kUnpackedPipelineName), std::ios::binary | std::ios::trunc);
+        if (!ofs) throw std::runtime_error("failed to write unpacked pipeline: " + stagingDir);
+        ofs << unpack.pipelineRoot.dump();
+        if (!ofs) throw std::runtime_error("failed to write unpacked pipeline: " + stagingDir);
+    }
+    if (!RenameDirectory(stagingDir, unpackDir)) {
+        if (TryReadUnpackedPipeline(unpackDir, root)) return root;
+        throw std::runtime_error("failed to publish unpacked dvst directory: " + unpackDir);
+    }
+    stagingGuard.Release();
+    return unpack.pipelineRoot;
+}
+
+// 加载流程归档。启用快照目录（FlowGraphModel::SetSnapshotDirectory）时按归档标识（路径、大小、修改时间）
+// 查找快照：命中则直接恢复已编译的流程，跳过解包、解析与编译；未命中则把归档解包到快照目录下的
+// 固定子目录 <标识>（已存在则复用），加载成功后写入快照（替换旧快照文件）。同一归档始终只占用一个解包目录。
+// tempDir 返回需要随 Model 一起清理的解包目录（快照目录下的共享目录不清理）。
+Json LoadFlowArchive(dlcv_infer::flow::FlowGraphModel& flowModel, const std::wstring& archivePathW, int deviceId, std::string& tempDir) {
+    const std::string snapshotRoot = dlcv_infer::flow::FlowGraphModel::GetSnapshotDirectory();
+    std::string key;
+    if (!snapshotRoot.empty()) {
+        try { key = ArchiveIdentityHex(archivePathW); } catch (...) { key.clear(); }
+    }
+    if (!key.empty()) {
+        const std::string snapshotPath = JoinPath(snapshotRoot, key + ".snapshot");
+        Json report;
+        if (flowModel.LoadSnapshot(snapshotPath, deviceId, report)) return report;
+
+        Json pipelineRoot;
+        bool unpacked = false;
+        try {
+            EnsureDirectory(snapshotRoot);
+            pipelineRoot = UnpackArchiveToSharedDir(archivePathW, JoinPath(snapshotRoot, key));
+            unpacked = true;
+        } catch (...) {
+            unpacked = false;
+        }
+        if (unpacked) {
+            report = flowModel.LoadFromRoot(pipelineRoot, deviceId);
+            if (ReadReportCode(report) == 0) {
+                try { flowModel.SaveSnapshot(snapshotPath); } catch (...) {}
+            }
+            return report;
+        }
+    }
+
+    // 未启用快照或共享目录不可用：解包到临时目录，随 Model 释放删除
+    DvsUnpackResult unpack = UnpackDvsArchive(archivePathW, std::string());
+    tempDir = unpack.tempDir;
+    return flowModel.LoadFromRoot(unpack.pipelineRoot, deviceId);
+}
+
 std::wstring DecodeModelPathString(const std::string& modelPath) {
     try {
         const std::wstring utf8Path = dlcv_infer::convertUtf8ToWstring(modelPath);
@@ -998,13 +1242,13 @@ int ParseInputChFromModelInfo(const MIJson& modelInfoRoot) {
     return 0;
 }
 
-cv::Mat NormalizeInferInputImage(const cv::Mat& src, int expectedChannels) {
+cv::Mat NormalizeInferInputImage(const cv::Mat& src, int expectedChannels, cv::MatAllocator* allocator = nullptr) {
     if (src.empty()) {
         return {};
     }
     // 应用层负责把 OpenCV 读盘得到的 BGR/BGRA 颜色图整理为 RGB；
     // 接口层再按模型期望通道数补齐/压缩通道，并统一位深到 8U。
-    return dlcv_infer::image_input::NormalizeInferInputImage(src, expectedChannels);
+    return dlcv_infer::image_input::NormalizeInferInputImage(src, expectedChannels, allocator);
 }
 
     class NvmlLibrary {
@@ -1077,6 +1321,13 @@ namespace dlcv_infer {
     static std::mutex g_modelIndexRefMu;
     static std::unordered_map<int, int> g_modelIndexRefCount;
 
+    // 单图推理合批的生效配置（发布后只读）；调整等待时间或上限时沿用同一合批队列，统计不清零
+    struct Model::MicroBatchConfig {
+        std::shared_ptr<flow::ModelBatcher> Batcher;
+        double WaitMs = 0.0;
+        int MaxBatch = 1;
+    };
+
 #ifdef _WIN32
     std::wstring Win32MultiByteToWide(const std::string& input, uint32_t codePage) {
         int len = MultiByteToWideChar(codePage, 0, input.c_str(), -1, nullptr, 0);
@@ -1415,27 +1666,21 @@ namespace dlcv_infer {
     }
 
     // Model类实现
-    Model::Model() {}
+    Model::Model() : _stats(new InferStatistics()), _inputArena(new InferInputArena()) {}
 
     Model::Model(const std::string& modelPath, int device_id)
-        : _deviceId(device_id) {
+        : _deviceId(device_id), _stats(new InferStatistics()), _inputArena(new InferInputArena()) {
         const std::wstring modelPathW = DecodeModelPathString(modelPath);
         const std::string modelPathUtf8 = convertWstringToUtf8(modelPathW);
 
         if (IsFlowArchivePath(modelPathUtf8)) {
             _isFlowGraphMode = true;
             _flowModel = new flow::FlowGraphModel();
+            // 归档旁的调优配置（AutoTune 生成）在加载时自动应用
+            _flowModel->SetTuningProfilePath(modelPathUtf8 + ".tune.json");
             try {
-                DvsUnpackResult unpack = UnpackDvsArchiveToTemp(modelPathW);
-                _tempDir = unpack.tempDir;
-
-                const std::string pipelinePath = JoinPath(unpack.tempDir, "pipeline.json");
-                WriteUtf8Text(pipelinePath, unpack.pipelineRoot.dump());
-
-                json report = _flowModel->Load(pipelinePath, device_id);
-                int code = 1;
-                try { code = report.contains("code") ? report.at("code").get<int>() : 1; } catch (...) { code = 1; }
-                if (code != 0) {
+                json report = LoadFlowArchive(*_flowModel, modelPathW, device_id, _tempDir);
+                if (ReadReportCode(report) != 0) {
                     throw std::runtime_error(report.dump());
                 }
                 modelIndex = 1; // dvst 模式下仅作为“已加载”标记
@@ -1483,23 +1728,17 @@ namespace dlcv_infer {
     }
 
     Model::Model(const std::wstring& modelPath, int device_id)
-        : _deviceId(device_id) {
+        : _deviceId(device_id), _stats(new InferStatistics()), _inputArena(new InferInputArena()) {
         const std::string modelPathUtf8 = convertWstringToUtf8(modelPath);
 
         if (IsFlowArchivePath(modelPathUtf8)) {
             _isFlowGraphMode = true;
             _flowModel = new flow::FlowGraphModel();
+            // 归档旁的调优配置（AutoTune 生成）在加载时自动应用
+            _flowModel->SetTuningProfilePath(modelPathUtf8 + ".tune.json");
             try {
-                DvsUnpackResult unpack = UnpackDvsArchiveToTemp(modelPath);
-                _tempDir = unpack.tempDir;
-
-                const std::string pipelinePath = JoinPath(unpack.tempDir, "pipeline.json");
-                WriteUtf8Text(pipelinePath, unpack.pipelineRoot.dump());
-
-                json report = _flowModel->Load(pipelinePath, device_id);
-                int code = 1;
-                try { code = report.contains("code") ? report.at("code").get<int>() : 1; } catch (...) { code = 1; }
-                if (code != 0) {
+                json report = LoadFlowArchive(*_flowModel, modelPath, device_id, _tempDir);
+                if (ReadReportCode(report) != 0) {
                     throw std::runtime_error(report.dump());
                 }
                 modelIndex = 1;
@@ -1546,17 +1785,24 @@ namespace dlcv_infer {
         }
     }
 
-    Model::Model(Model&& other) noexcept
-        : modelIndex(other.modelIndex),
-        OwnModelIndex(other.OwnModelIndex),
-        _isFlowGraphMode(other._isFlowGraphMode),
-        _deviceId(other._deviceId),
-        _flowModel(other._flowModel),
-        _expectedChCache(other._expectedChCache),
-        _tempDir(std::move(other._tempDir)),
-        _dllLoader(other._dllLoader),
-        _loadedDogProvider(other._loadedDogProvider),
-        _loadedNativeDllName(std::move(other._loadedNativeDllName)) {
+    Model::Model(Model&& other) noexcept {
+        // 先执行完源对象的异步请求：工作线程仍在读取源对象的统计、输入缓冲池等字段，停下后再转移
+        other.stopAsyncQueue(false);
+
+        modelIndex = other.modelIndex;
+        OwnModelIndex = other.OwnModelIndex;
+        _isFlowGraphMode = other._isFlowGraphMode;
+        _deviceId = other._deviceId;
+        _flowModel = other._flowModel;
+        _expectedChCache = other._expectedChCache;
+        _tempDir = std::move(other._tempDir);
+        _asyncOptions = other._asyncOptions;
+        _stats = std::move(other._stats);
+        _inputArena = std::move(other._inputArena);
+        _dllLoader = other._dllLoader;
+        _loadedDogProvider = other._loadedDogProvider;
+        _loadedNativeDllName = std::move(other._loadedNativeDllName);
+        moveMicroBatching(other);
         other.modelIndex = -1;
         other.OwnModelIndex = true;
         other._isFlowGraphMode = false;
@@ -1575,6 +1821,7 @@ namespace dlcv_infer {
         }
 
         try { FreeModel(); } catch (...) {}
+        other.stopAsyncQueue(false);
 
         modelIndex = other.modelIndex;
         OwnModelIndex = other.OwnModelIndex;
@@ -1586,6 +1833,10 @@ namespace dlcv_infer {
         _dllLoader = other._dllLoader;
         _loadedDogProvider = other._loadedDogProvider;
         _loadedNativeDllName = std::move(other._loadedNativeDllName);
+        _asyncOptions = other._asyncOptions;
+        _stats = std::move(other._stats);
+        _inputArena = std::move(other._inputArena);
+        moveMicroBatching(other);
 
         other.modelIndex = -1;
         other.OwnModelIndex = true;
@@ -1600,12 +1851,34 @@ namespace dlcv_infer {
         return *this;
     }
 
+    void Model::moveMicroBatching(Model& other) noexcept {
+        // 合批队列引用模型对象本身，为新对象按原配置重建（统计清零）
+        std::shared_ptr<const MicroBatchConfig> source = std::atomic_load(&other._microBatch);
+        std::atomic_store(&other._microBatch, std::shared_ptr<const MicroBatchConfig>());
+        std::shared_ptr<const MicroBatchConfig> rebuilt;
+        if (source) {
+            try {
+                auto config = std::make_shared<MicroBatchConfig>();
+                config->Batcher = std::make_shared<flow::ModelBatcher>(this);
+                config->WaitMs = source->WaitMs;
+                config->MaxBatch = source->MaxBatch;
+                rebuilt = std::move(config);
+            } catch (...) {
+                rebuilt.reset();
+            }
+        }
+        std::atomic_store(&_microBatch, rebuilt);
+    }
+
     Model::~Model() {
         try { FreeModel(); } catch (...) {}
     }
 
     void Model::FreeModel() {
+        stopAsyncQueue(true);
+        std::atomic_store(&_microBatch, std::shared_ptr<const MicroBatchConfig>());
         _expectedChCache = -2;
+        if (_inputArena) _inputArena->Trim();
         if (_isFlowGraphMode) {
             delete _flowModel;
             _flowModel = nullptr;
@@ -1705,12 +1978,13 @@ namespace dlcv_infer {
         std::vector<cv::Mat> out;
         out.reserve(images.size());
         const bool allowFlowFastPassThrough = _isFlowGraphMode;
+        cv::MatAllocator* allocator = _inputArena ? _inputArena->Allocator() : nullptr;
         for (const auto& im : images) {
             if (allowFlowFastPassThrough && !im.empty() && im.depth() == CV_8U && im.channels() == ec) {
                 out.push_back(im);
                 continue;
             }
-            out.push_back(NormalizeInferInputImage(im, ec));
+            out.push_back(NormalizeInferInputImage(im, ec, allocator));
         }
         return out;
     }
@@ -1718,6 +1992,8 @@ namespace dlcv_infer {
     std::pair<json, void*> Model::InferInternal(const std::vector<cv::Mat>& images, const json& params_json) {
         json imageInfoList = json::array();
         std::vector<std::pair<cv::Mat, bool>> processImages;
+        processImages.reserve(images.size());
+        cv::MatAllocator* allocator = _inputArena ? _inputArena->Allocator() : nullptr;
 
         try
         {
@@ -1729,7 +2005,10 @@ namespace dlcv_infer {
                 bool needDispose = false;
                 if (!image.isContinuous())
                 {
-                    processImage = image.clone();
+                    // 紧凑副本从输入缓冲池取缓冲区，推理结束随 processImages 析构归还
+                    processImage = cv::Mat();
+                    processImage.allocator = allocator;
+                    image.copyTo(processImage);
                     needDispose = true;
                 }
 
@@ -1915,6 +2194,12 @@ namespace dlcv_infer {
     }
 
     Result Model::Infer(const cv::Mat& image, const json& params_json) {
+        ActiveCallScope active(_activeCalls, _tuning);
+        const std::shared_ptr<const MicroBatchConfig> microBatch = std::atomic_load(&_microBatch);
+        if (microBatch && microBatch->WaitMs > 0.0 && !image.empty()) {
+            return inferMicroBatched(*microBatch, image, params_json);
+        }
+        InferCallScope call(_stats.get(), 1);
         if (_isFlowGraphMode) {
             if (!_flowModel) throw std::runtime_error("dvs model not loaded");
             if (image.empty()) throw std::invalid_argument("image is empty");
@@ -1923,6 +2208,7 @@ namespace dlcv_infer {
             if (prepared.empty() || prepared.front().empty()) {
                 throw std::invalid_argument("image is empty after preparation");
             }
+            call.Preprocessed();
 
             const auto begin = std::chrono::steady_clock::now();
             json flowRoot = _flowModel->InferInternal(prepared, params_json);
@@ -1939,11 +2225,13 @@ namespace dlcv_infer {
                 dlcvInferMs = totalInferMs;
             }
             SetLastInferTiming(dlcvInferMs, totalInferMs, std::move(nodeTimings));
+            call.Inferred(dlcvInferMs, &g_lastFlowNodeTimings);
 
             const bool emitMaskOutput = ResolveWithMaskOutputFlag(params_json, true);
             const Json resultListToken = ExtractFlowResultListToken(flowRoot);
             std::vector<SampleResult> sampleResults =
                 ConvertFlowResultListTokenToSampleResults(resultListToken, 1, emitMaskOutput);
+            call.Commit();
             return Result(std::move(sampleResults));
         }
 
@@ -1951,18 +2239,21 @@ namespace dlcv_infer {
         if (prepared.empty() || prepared.front().empty()) {
             throw std::invalid_argument("image is empty after preparation");
         }
+        call.Preprocessed();
 
         const auto begin = std::chrono::steady_clock::now();
         auto resultTuple = InferInternal(prepared, params_json);
         const auto end = std::chrono::steady_clock::now();
         const double inferMs = std::chrono::duration<double, std::milli>(end - begin).count();
         SetLastInferTiming(inferMs, inferMs);
+        call.Inferred(inferMs);
 
         try
         {
             Result result = ParseToStructResult(resultTuple.first);
             // 完成后释放结果
             _dllLoader->GetFreeModelResultFunc()(resultTuple.second);
+            call.Commit();
             return result;
         }
         catch (...)
@@ -1974,10 +2265,13 @@ namespace dlcv_infer {
     }
 
     Result Model::InferBatch(const std::vector<cv::Mat>& image_list, const json& params_json) {
+        ActiveCallScope active(_activeCalls, _tuning);
+        InferCallScope call(g_microBatchModel == this ? nullptr : _stats.get(), image_list.size());
         if (_isFlowGraphMode) {
             if (!_flowModel) throw std::runtime_error("dvs model not loaded");
             if (image_list.empty()) {
                 SetLastInferTiming(0.0, 0.0);
+                call.Commit();
                 return Result(std::vector<SampleResult>{});
             }
 
@@ -1990,6 +2284,7 @@ namespace dlcv_infer {
                     throw std::invalid_argument("image is empty after preparation");
                 }
             }
+            call.Preprocessed();
 
             const auto begin = std::chrono::steady_clock::now();
             json flowRoot = _flowModel->InferInternal(prepared, params_json);
@@ -2006,11 +2301,13 @@ namespace dlcv_infer {
                 dlcvInferMs = totalInferMs;
             }
             SetLastInferTiming(dlcvInferMs, totalInferMs, std::move(nodeTimings));
+            call.Inferred(dlcvInferMs, &g_lastFlowNodeTimings);
 
             const bool emitMaskOutput = ResolveWithMaskOutputFlag(params_json, true);
             const Json resultListToken = ExtractFlowResultListToken(flowRoot);
             std::vector<SampleResult> sampleResults =
                 ConvertFlowResultListTokenToSampleResults(resultListToken, image_list.size(), emitMaskOutput);
+            call.Commit();
             return Result(std::move(sampleResults));
         }
 
@@ -2023,18 +2320,21 @@ namespace dlcv_infer {
                 throw std::invalid_argument("image is empty after preparation");
             }
         }
+        call.Preprocessed();
 
         const auto begin = std::chrono::steady_clock::now();
         auto resultTuple = InferInternal(prepared, params_json);
         const auto end = std::chrono::steady_clock::now();
         const double inferMs = std::chrono::duration<double, std::milli>(end - begin).count();
         SetLastInferTiming(inferMs, inferMs);
+        call.Inferred(inferMs);
 
         try
         {
             Result result = ParseToStructResult(resultTuple.first);
             // 完成后释放结果
             _dllLoader->GetFreeModelResultFunc()(resultTuple.second);
+            call.Commit();
             return result;
         }
         catch (...)
@@ -2046,6 +2346,8 @@ namespace dlcv_infer {
     }
 
     json Model::InferOneOutJson(const cv::Mat& image, const json& params_json) {
+        ActiveCallScope active(_activeCalls, _tuning);
+        InferCallScope call(_stats.get(), 1);
         if (_isFlowGraphMode) {
             if (!_flowModel) throw std::runtime_error("dvs model not loaded");
             if (image.empty()) throw std::invalid_argument("image is empty");
@@ -2054,6 +2356,7 @@ namespace dlcv_infer {
             if (prepared.empty() || prepared.front().empty()) {
                 throw std::invalid_argument("image is empty after preparation");
             }
+            call.Preprocessed();
 
             const auto begin = std::chrono::steady_clock::now();
             json flowRoot = _flowModel->InferInternal(prepared, params_json);
@@ -2070,6 +2373,7 @@ namespace dlcv_infer {
                 dlcvInferMs = totalInferMs;
             }
             SetLastInferTiming(dlcvInferMs, totalInferMs, std::move(nodeTimings));
+            call.Inferred(dlcvInferMs, &g_lastFlowNodeTimings);
 
             const bool emitMaskOutput = ResolveWithMaskOutputFlag(params_json, true);
             const Json resultListToken = ExtractFlowResultListToken(flowRoot);
@@ -2088,19 +2392,23 @@ namespace dlcv_infer {
             } catch (...) {
                 flowResults = json::array();
             }
-            return NormalizeFlowOneOutJson(flowResults, emitMaskOutput);
+            json normalized = NormalizeFlowOneOutJson(flowResults, emitMaskOutput);
+            call.Commit();
+            return normalized;
         }
 
         const std::vector<cv::Mat> prepared = prepareInferInputBatch({ image });
         if (prepared.empty() || prepared.front().empty()) {
             throw std::invalid_argument("image is empty after preparation");
         }
+        call.Preprocessed();
 
         const auto begin = std::chrono::steady_clock::now();
         auto resultTuple = InferInternal(prepared, params_json);
         const auto end = std::chrono::steady_clock::now();
         const double inferMs = std::chrono::duration<double, std::milli>(end - begin).count();
         SetLastInferTiming(inferMs, inferMs);
+        call.Inferred(inferMs);
 
         try
         {
@@ -2147,6 +2455,7 @@ namespace dlcv_infer {
 
             // 完成后释放结果
             _dllLoader->GetFreeModelResultFunc()(resultTuple.second);
+            call.Commit();
             return results;
         }
         catch (...)
@@ -2157,6 +2466,233 @@ namespace dlcv_infer {
         }
     }
 
+    std::string Model::GenerateFlowSource(const std::wstring& archivePath, const std::string& functionName) {
+        return flow::FlowGraphModel::GenerateSource(ReadDvsPipeline(archivePath), functionName);
+    }
+
+    json Model::VerifyGeneratedFlow(const cv::Mat& image, const json& params_json) {
+        if (!_isFlowGraphMode) throw std::runtime_error("VerifyGeneratedFlow only supports flow archive models (.dvst/.dvso/.dvsp)");
+        if (!_flowModel) throw std::runtime_error("dvs model not loaded");
+        if (image.empty()) throw std::invalid_argument("image is empty");
+        ActiveCallScope active(_activeCalls, _tuning);
+
+        const std::vector<cv::Mat> prepared = prepareInferInputBatch({ image });
+        if (prepared.empty() || prepared.front().empty()) {
+            throw std::invalid_argument("image is empty after preparation");
+        }
+        return _flowModel->VerifyGeneratedExecutor(prepared, params_json);
+    }
+
+    json Model::AutoTune(const cv::Mat& sampleImage, const json& options) {
+        if (!_isFlowGraphMode) throw std::runtime_error("AutoTune only supports flow archive models (.dvst/.dvso/.dvsp)");
+        if (!_flowModel) throw std::runtime_error("dvs model not loaded");
+        if (sampleImage.empty()) throw std::invalid_argument("sample image is empty");
+
+        // 调优改写节点属性、重建执行计划并清空节点缓存，须独占流程：先置标志阻止新的推理，再确认没有在途推理
+        bool expected = false;
+        if (!_tuning.compare_exchange_strong(expected, true)) {
+            throw std::runtime_error("AutoTune already in progress");
+        }
+        struct TuningReset {
+            std::atomic<bool>& flag;
+            ~TuningReset() { flag.store(false); }
+        } tuningReset{ _tuning };
+        if (_activeCalls.load() > 0 || GetAsyncInFlight() > 0) {
+            throw std::runtime_error("AutoTune cannot run while inference is in flight");
+        }
+
+        const std::vector<cv::Mat> prepared = prepareInferInputBatch({ sampleImage });
+        if (prepared.empty() || prepared.front().empty()) {
+            throw std::invalid_argument("image is empty after preparation");
+        }
+        return _flowModel->AutoTune(prepared.front(), options);
+    }
+
+    void Model::SetAsyncOptions(const AsyncInferOptions& options) {
+        stopAsyncQueue(false);
+        _asyncOptions = options;
+    }
+
+    InferRequestQueue& Model::ensureAsyncQueue() {
+        std::lock_guard<std::mutex> lk(_asyncMu);
+        if (!_asyncQueue) {
+            if (_isFlowGraphMode ? _flowModel == nullptr : modelIndex < 0) {
+                throw std::runtime_error("model not loaded");
+            }
+            // 在提交线程解析输入通道数，工作线程并发推理时只读该缓存
+            resolveEffectiveInputCh();
+            _asyncQueue.reset(new InferRequestQueue(
+                _asyncOptions.workerThreads, _asyncOptions.maxInFlight, _asyncOptions.overflowPolicy));
+        }
+        return *_asyncQueue;
+    }
+
+    void Model::stopAsyncQueue(bool cancelPending) {
+        std::unique_ptr<InferRequestQueue> queue;
+        {
+            std::lock_guard<std::mutex> lk(_asyncMu);
+            queue = std::move(_asyncQueue);
+        }
+        if (!queue) return;
+        try { queue->Close(cancelPending); } catch (...) {}
+    }
+
+    void Model::submitAsync(std::vector<cv::Mat> images, const json& params_json, bool batch,
+        std::shared_ptr<std::promise<Result>> promise, AsyncInferCallback onDone) {
+        // 包装外部缓冲区的图像不持有引用计数，调用方可能在完成前复用该缓冲区
+        for (auto& im : images) {
+            if (!im.empty() && im.u == nullptr) im = im.clone();
+        }
+
+        auto finish = [promise, onDone](Result* result, std::exception_ptr error) {
+            Result empty(std::vector<SampleResult>{});
+            Result& delivered = result ? *result : empty;
+            if (onDone) {
+                try { onDone(delivered, error); } catch (...) {}
+            }
+            if (promise) {
+                if (error) promise->set_exception(error);
+                else promise->set_value(std::move(delivered));
+            }
+        };
+
+        InferRequestQueue::Request request;
+        auto shared = std::make_shared<std::vector<cv::Mat>>(std::move(images));
+        request.Run = [this, shared, params_json, batch, finish]() {
+            try {
+                Result result = batch ? InferBatch(*shared, params_json) : Infer(shared->front(), params_json);
+                finish(&result, nullptr);
+            } catch (...) {
+                finish(nullptr, std::current_exception());
+            }
+        };
+        request.Cancel = [finish](std::exception_ptr error) { finish(nullptr, error); };
+        ensureAsyncQueue().Submit(std::move(request));
+    }
+
+    std::future<Result> Model::InferAsync(const cv::Mat& image, const json& params_json) {
+        auto promise = std::make_shared<std::promise<Result>>();
+        std::future<Result> future = promise->get_future();
+        submitAsync({ image }, params_json, false, promise, nullptr);
+        return future;
+    }
+
+    std::future<Result> Model::InferBatchAsync(const std::vector<cv::Mat>& image_list, const json& params_json) {
+        auto promise = std::make_shared<std::promise<Result>>();
+        std::future<Result> future = promise->get_future();
+        submitAsync(image_list, params_json, true, promise, nullptr);
+        return future;
+    }
+
+    void Model::InferAsync(const cv::Mat& image, const json& params_json, AsyncInferCallback onDone) {
+        submitAsync({ image }, params_json, false, nullptr, std::move(onDone));
+    }
+
+    void Model::InferBatchAsync(const std::vector<cv::Mat>& image_list, const json& params_json, AsyncInferCallback onDone) {
+        submitAsync(image_list, params_json, true, nullptr, std::move(onDone));
+    }
+
+    void Model::WaitAsyncIdle() {
+        InferRequestQueue* queue = nullptr;
+        {
+            std::lock_guard<std::mutex> lk(_asyncMu);
+            queue = _asyncQueue.get();
+        }
+        if (queue) queue->WaitIdle();
+    }
+
+    int Model::GetAsyncInFlight() const {
+        std::lock_guard<std::mutex> lk(_asyncMu);
+        return _asyncQueue ? static_cast<int>(_asyncQueue->InFlight()) : 0;
+    }
+
+    void Model::SetMicroBatching(double maxWaitMs, int maxBatch) {
+        int effectiveMax = 1;
+        if (maxWaitMs > 0.0) {
+            if (_isFlowGraphMode ? _flowModel == nullptr : modelIndex < 0) {
+                throw std::runtime_error("model not loaded");
+            }
+            // 在设置线程解析输入通道数与最大 batch，合批后的并发推理只读这些缓存
+            resolveEffectiveInputCh();
+            effectiveMax = maxBatch > 0 ? maxBatch : flow::GetModelBatchLimit(*this);
+        }
+
+        // 新配置整体发布：正在合批的请求持有旧配置（及其合批队列）直至完成，不会访问已释放的队列
+        std::lock_guard<std::mutex> lk(_asyncMu);
+        const std::shared_ptr<const MicroBatchConfig> current = std::atomic_load(&_microBatch);
+        if (maxWaitMs <= 0.0 && !current) return;
+        auto config = std::make_shared<MicroBatchConfig>();
+        config->Batcher = current ? current->Batcher : std::make_shared<flow::ModelBatcher>(this);
+        config->WaitMs = maxWaitMs > 0.0 ? std::min(maxWaitMs, 1000.0) : 0.0;
+        config->MaxBatch = maxWaitMs > 0.0 ? effectiveMax : (current ? current->MaxBatch : 1);
+        std::atomic_store(&_microBatch, std::shared_ptr<const MicroBatchConfig>(std::move(config)));
+    }
+
+    json Model::GetMicroBatchingStats() const {
+        flow::ModelBatcher::Stats st;
+        const std::shared_ptr<const MicroBatchConfig> microBatch = std::atomic_load(&_microBatch);
+        if (microBatch) st = microBatch->Batcher->GetStats();
+        json out;
+        out["requests"] = st.Requests;
+        out["batches"] = st.Batches;
+        out["images"] = st.Images;
+        out["avg_batch_size"] = st.Batches > 0 ? static_cast<double>(st.Images) / static_cast<double>(st.Batches) : 0.0;
+        out["max_batch_size"] = st.MaxBatchImages;
+        out["avg_wait_ms"] = st.Requests > 0 ? st.TotalWaitMs / static_cast<double>(st.Requests) : 0.0;
+        out["max_wait_ms"] = st.MaxWaitMs;
+        return out;
+    }
+
+    void Model::ResetMicroBatchingStats() {
+        const std::shared_ptr<const MicroBatchConfig> microBatch = std::atomic_load(&_microBatch);
+        if (microBatch) microBatch->Batcher->ResetStats();
+    }
+
+    Result Model::inferMicroBatched(const MicroBatchConfig& config, const cv::Mat& image, const json& params_json) {
+        InferCallScope call(_stats.get(), 1);
+        call.Preprocessed();
+        const auto begin = std::chrono::steady_clock::now();
+        double sdkMs = 0.0;
+        std::vector<SampleResult> sampleResults;
+        const Model* const outerBatchModel = g_microBatchModel;
+        g_microBatchModel = this;
+        try {
+            sampleResults = config.Batcher->InferBatch({ image }, params_json, config.MaxBatch, config.WaitMs, sdkMs);
+        } catch (...) {
+            g_microBatchModel = outerBatchModel;
+            throw;
+        }
+        g_microBatchModel = outerBatchModel;
+        const auto end = std::chrono::steady_clock::now();
+        const double totalMs = std::chrono::duration<double, std::milli>(end - begin).count();
+        SetLastInferTiming(sdkMs > 0.0 ? sdkMs : totalMs, totalMs);
+        call.Inferred(sdkMs > 0.0 ? sdkMs : totalMs);
+        if (sampleResults.empty()) {
+            sampleResults.push_back(SampleResult(std::vector<ObjectResult>{}));
+        }
+        call.Commit();
+        return Result(std::move(sampleResults));
+    }
+
+    json Model::GetInferStatistics() const {
+        if (!_stats) return InferStatistics().Snapshot();
+        return _stats->Snapshot();
+    }
+
+    void Model::ResetInferStatistics() {
+        if (_stats) _stats->Reset();
+    }
+
+    void Model::SetInputArenaCapacity(size_t capacityBytes) {
+        if (!_inputArena) _inputArena.reset(new InferInputArena(capacityBytes));
+        else _inputArena->SetCapacity(capacityBytes);
+    }
+
+    json Model::GetInputArenaStats() const {
+        if (!_inputArena) return InferInputArena(0).Stats();
+        return _inputArena->Stats();
+    }
+
     void Model::GetLastInferTiming(double& dlcvInferMs, double& totalInferMs) {
         dlcvInferMs = g_lastDlcvInferMs;
         totalInferMs = g_lastTotalInferMs;
@@ -8,7 +8,10 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <future>
 #include <map>
+#include <mutex>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
@@ -31,9 +34,14 @@
 namespace dlcv_infer {
 
     class DllLoader;
+    class InferRequestQueue;
+    class InferStatistics;
+    class InferInputArena;
 
     namespace flow {
         class FlowGraphModel;
+        class ModelPool;
+        class ModelBatcher;
     }
 
     DLCV_INFER_CPP_DLL_API std::wstring convertStringToWstring(const std::string& inputString);
@@ -192,6 +200,22 @@ namespace dlcv_infer {
         double elapsedMs = 0.0;
     };
 
+    // 异步推理在途请求达到上限时的处理方式
+    enum class AsyncOverflowPolicy {
+        Block = 0,      // 阻塞提交线程直到有空位
+        Reject = 1,     // 拒绝新请求
+        DropOldest = 2  // 丢弃最早一条尚未开始执行的请求
+    };
+
+    struct AsyncInferOptions {
+        int workerThreads = 2;  // 工作线程数（不超过 maxInFlight）
+        int maxInFlight = 8;    // 在途请求上限（排队 + 执行中）
+        AsyncOverflowPolicy overflowPolicy = AsyncOverflowPolicy::Block;
+    };
+
+    // 异步推理完成回调（在工作线程执行）：成功时 error 为空；失败、被拒绝或被丢弃时 error 非空、result 为空结果
+    using AsyncInferCallback = std::function<void(Result& result, std::exception_ptr error)>;
+
     // 模型封装
 #pragma warning(push)
 #pragma warning(disable: 4251)
@@ -238,6 +262,82 @@ namespace dlcv_infer {
 
         json InferOneOutJson(const cv::Mat& image, const json& params_json = nullptr);
 
+        /// <summary>
+        /// 流程归档模型的自动调优：以样例图扫描各 model/* 节点的 batch_size 与 parallel_threads，
+        /// 结果写入归档旁的 <归档>.tune.json，之后加载同一归档时自动应用。参数与返回见 FlowGraphModel::AutoTune。
+        /// 调优会改写流程节点属性，不能与推理并发：有同步或异步推理在途时抛出异常，调优期间发起的推理也抛出异常。
+        /// </summary>
+        json AutoTune(const cv::Mat& sampleImage, const json& options = nullptr);
+
+        /// <summary>
+        /// 预生成执行代码：读取流程归档中的 pipeline.json（不解包模型），生成专用于该流程结构的 C++ 源文件内容。
+        /// 生成的文件编入本 DLL 或宿主程序后，加载结构相同的流程归档时推理自动改用生成代码。见 FlowGraphModel::GenerateSource。
+        /// </summary>
+        static std::string GenerateFlowSource(const std::wstring& archivePath, const std::string& functionName = std::string());
+
+        /// <summary>
+        /// 预生成执行代码校验：同一图像分别以通用执行与生成代码推理并比较结果。参数与返回见 FlowGraphModel::VerifyGeneratedExecutor。
+        /// </summary>
+        json VerifyGeneratedFlow(const cv::Mat& image, const json& params_json = nullptr);
+
+        /// <summary>
+        /// 异步推理配置。模型在首次异步提交时创建自有的工作线程与有界请求队列；
+        /// 已创建时先执行完在途请求再按新配置重建。
+        /// </summary>
+        void SetAsyncOptions(const AsyncInferOptions& options);
+        AsyncInferOptions GetAsyncOptions() const { return _asyncOptions; }
+
+        /// <summary>
+        /// 异步推理：与 Infer/InferBatch 结果一致（普通模型与流程归档均支持），在模型自有的工作线程上执行。
+        /// 被拒绝或丢弃的请求，其 future 以 std::runtime_error 结束（回调版本在提交线程上以 error 回调）。
+        /// 图像若不持有引用计数（包装外部缓冲区）在提交时复制，否则只在完成前保持引用。
+        /// </summary>
+        std::future<Result> InferAsync(const cv::Mat& image, const json& params_json = nullptr);
+        std::future<Result> InferBatchAsync(const std::vector<cv::Mat>& image_list, const json& params_json = nullptr);
+        void InferAsync(const cv::Mat& image, const json& params_json, AsyncInferCallback onDone);
+        void InferBatchAsync(const std::vector<cv::Mat>& image_list, const json& params_json, AsyncInferCallback onDone);
+
+        /// <summary>
+        /// 等待全部异步请求结束；GetAsyncInFlight 返回当前在途（排队 + 执行中）请求数
+        /// </summary>
+        void WaitAsyncIdle();
+        int GetAsyncInFlight() const;
+
+        /// <summary>
+        /// 单图推理合批（默认关闭）：多线程并发调用 Infer 时，图像尺寸/类型与推理参数都相同的请求在 maxWaitMs 内
+        /// 合并为一次 InferBatch，凑满 maxBatch 张立即执行，再把各自的结果返回给调用方。
+        /// maxWaitMs <= 0 关闭；maxBatch <= 0 时取模型支持的最大 batch。可在推理进行中调用：新配置对之后的调用生效，
+        /// 在途请求按原配置完成。
+        /// 合批推理时 GetLastInferTiming 的 SDK 耗时按图像数分摊，GetLastFlowNodeTimings 为空。
+        /// </summary>
+        void SetMicroBatching(double maxWaitMs, int maxBatch = 0);
+
+        /// <summary>
+        /// 合批统计（自开启或上次重置起）：{requests,batches,images,avg_batch_size,max_batch_size,avg_wait_ms,max_wait_ms}，
+        /// 等待为请求从到达到所在批开始执行的时间。
+        /// </summary>
+        json GetMicroBatchingStats() const;
+        void ResetMicroBatchingStats();
+
+        /// <summary>
+        /// 推理统计（自加载或上次重置起，各线程的 Infer/InferBatch/InferOneOutJson 与异步推理都计入，可在任意线程读取）：
+        /// 请求数、图像数、失败数、吞吐，以及总耗时/SDK 推理/预处理/结果解析/各流程节点耗时的 mean/p50/p90/p99/max。
+        /// 返回字段见 InferStatistics::Snapshot。
+        /// </summary>
+        json GetInferStatistics() const;
+        void ResetInferStatistics();
+
+        /// <summary>
+        /// 推理输入缓冲池容量（默认 256MB）：位深/通道转换与非连续图像紧凑化产生的输入缓冲区在推理完成后回到池中，
+        /// 供后续同尺寸级别的输入复用，池中空闲缓冲区总量不超过该容量。0 表示不保留（每次直接分配）。
+        /// </summary>
+        void SetInputArenaCapacity(size_t capacityBytes);
+
+        /// <summary>
+        /// 输入缓冲池统计：{capacity_bytes,retained_bytes,outstanding_bytes,hits,misses}
+        /// </summary>
+        json GetInputArenaStats() const;
+
         static void GetLastInferTiming(double& dlcvInferMs, double& totalInferMs);
         static std::vector<FlowNodeTiming> GetLastFlowNodeTimings();
 
@@ -250,9 +350,34 @@ namespace dlcv_infer {
         json _cachedModelInfo;
         // DVS 模式：持有临时目录路径，确保在 Model 对象存活期间文件不被删除
         std::string _tempDir;
+        // 异步推理：首次提交时创建，FreeModel 时取消排队请求并等待执行中的请求；
+        // _asyncMu 保护队列的创建与销毁及合批配置的替换（每个对象各自持有，移动时不转移）
+        AsyncInferOptions _asyncOptions;
+        std::unique_ptr<InferRequestQueue> _asyncQueue;
+        mutable std::mutex _asyncMu;
+        // 单图推理合批：开启后创建，FreeModel 时释放；移动时为新对象重建（统计清零）。
+        // 配置整体替换后以 std::atomic_store 发布，Infer 以 std::atomic_load 取得，在途请求继续持有旧配置
+        struct MicroBatchConfig;
+        std::shared_ptr<const MicroBatchConfig> _microBatch;
+        // 进行中的推理调用数与调优标志：AutoTune 独占流程，与推理互斥（移动时不转移）
+        std::atomic<int> _activeCalls{ 0 };
+        std::atomic<bool> _tuning{ false };
+        // 推理统计：随模型对象创建，移动时转移，FreeModel 后保留
+        std::unique_ptr<InferStatistics> _stats;
+        // 推理输入缓冲池：随模型对象创建，移动时转移，FreeModel 时释放空闲缓冲区
+        std::unique_ptr<InferInputArena> _inputArena;
 
         int resolveEffectiveInputCh();
         std::vector<cv::Mat> prepareInferInputBatch(const std::vector<cv::Mat>& images);
+        InferRequestQueue& ensureAsyncQueue();
+        void stopAsyncQueue(bool cancelPending);
+        void moveMicroBatching(Model& other) noexcept;
+        Result inferMicroBatched(const MicroBatchConfig& config, const cv::Mat& image, const json& params_json);
+        void submitAsync(std::vector<cv::Mat> images, const json& params_json, bool batch,
+            std::shared_ptr<std::promise<Result>> promise, AsyncInferCallback onDone);
+
+        // 流程快照恢复时由模型池预置模型信息（_cachedModelInfo），省去逐模型查询
+        friend class flow::ModelPool;
     protected:
         DllLoader* _dllLoader = nullptr;
         sntl_admin::DogProvider _loadedDogProvider = sntl_admin::DogProvider::Unknown;
@@ -1,11 +1,17 @@
 ﻿#pragma once
 
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "flow/ExecutionContext.h"
+#include "flow/FlowParallelFor.h"
 #include "flow/FlowTypes.h"
+#include "flow/ModuleProperties.h"
 
 namespace dlcv_infer {
 namespace flow {
@@ -32,11 +38,21 @@ public:
     // 主对模版输入（JSON 数组）
     Json MainTemplateList = Json::array();
 
+    // 主对列式结果输入：仅当 AcceptsDetectionBatch() 为 true 且上游产出列式结果时非空（此时 result_list 为空）
+    std::shared_ptr<const DetectionBatch> MainDetections;
+
     // 标量输入/输出（按索引与名称）
     std::map<int, Json> ScalarInputsByIndex;
     std::map<std::string, Json> ScalarInputsByName;
     std::map<std::string, Json> ScalarOutputsByName;
 
+    // 当前节点输出端口的连接掩码（bit i 表示 outputs[i] 有下游），由 GraphExecutor 在执行前写入；
+    // 全 1 表示未知，模块应视为全部连接。
+    std::uint64_t CurrentOutputMask = std::numeric_limits<std::uint64_t>::max();
+
+    // 门控：Process 中置 true 表示本次关闭门控，GraphExecutor 跳过只经由本节点通道输出可达的下游节点
+    bool GateClosed = false;
+
     BaseModule(int nodeId,
                std::string title = std::string(),
                Json properties = Json::object(),
@@ -44,7 +60,8 @@ public:
         : NodeId(nodeId),
           Title(std::move(title)),
           Properties(std::move(properties)),
-          Context(context) {}
+          Context(context),
+          _parallelThreads(BindProperties<ParallelProps>().Threads) {}
 
     virtual ~BaseModule() = default;
 
@@ -53,6 +70,59 @@ public:
     /// </summary>
     virtual void LoadModel() {}
 
+    /// <summary>
+    /// 是否直接处理列式结果（DetectionBatch）。默认 false：GraphExecutor 在调用前把主对与额外对的
+    /// 列式结果物化为 result_list；返回 true 的模块需自行处理 MainDetections 与 ExtraInputsIn[*].Detections。
+    /// </summary>
+    virtual bool AcceptsDetectionBatch() const { return false; }
+
+    /// <summary>
+    /// 节点输出缓存：输出是否只由属性与输入决定。返回 false（读取上下文图像、文件等外部状态）时
+    /// 该节点每次执行，GraphExecutor 以其实际输出内容作为下游缓存指纹的来源。
+    /// </summary>
+    virtual bool IsOutputCacheable() const { return true; }
+
+    /// <summary>
+    /// 节点输出缓存：属性之外影响输出的标识（如已加载模型的实例序号），参与节点指纹；默认 0。
+    /// </summary>
+    virtual std::uint64_t OutputCacheIdentity() { return 0; }
+
+    /// <summary>
+    /// 结果处理链融合：chain 为编译期识别的一串只以主对相连的节点模块（chain[0] 为本模块），
+    /// 一次遍历输入条目完成整条链，output 为链尾主输出，各模块的 ScalarOutputsByName 同时写入，
+    /// stageElapsedMs 按链上节点拆分耗时。输入不满足融合前提时返回 false，由 GraphExecutor 逐节点执行。
+    /// </summary>
+    virtual bool ProcessFusedChain(const std::vector<BaseModule*>& /*chain*/,
+                                   const std::vector<ModuleImage>& /*imageList*/,
+                                   const Json& /*resultList*/,
+                                   ModuleIO& /*output*/,
+                                   std::vector<double>& /*stageElapsedMs*/) {
+        return false;
+    }
+
+    /// <summary>
+    /// 持久实例复用时，每次 Run 执行该节点前调用：重新绑定本次上下文并清空上一帧的端口数据。
+    /// 派生模块可覆写以清理自身的逐帧状态（需调用基类实现）；跨帧缓存与模型句柄可保留。
+    /// </summary>
+    virtual void ResetForRun(ExecutionContext* context) {
+        Context = context;
+        ExtraInputsIn.clear();
+        ExtraOutputs.clear();
+        MainTemplateList = Json::array();
+        MainDetections.reset();
+        ScalarInputsByIndex.clear();
+        ScalarInputsByName.clear();
+        ScalarOutputsByName.clear();
+        CurrentOutputMask = std::numeric_limits<std::uint64_t>::max();
+        GateClosed = false;
+    }
+
+    /// <summary>
+    /// 是否需要可写的 result_list（覆写了 ProcessOwned）。默认 false：GraphExecutor 以只读引用调用 Process，
+    /// 扇出的结果与其他消费者共享；返回 true 时调用 ProcessOwned，上游输出仍被共享则先复制（写时复制）。
+    /// </summary>
+    virtual bool TakesOwnedResultList() const { return false; }
+
     /// <summary>
     /// 默认透传：不修改图像与结果，模板输出为空数组。
     /// </summary>
@@ -61,7 +131,7 @@ public:
     }
 
     /// <summary>
-    /// 可选：接收可移动的 result_list，热点模块可覆写以减少 JSON 深拷贝。
+    /// 可选：接收可移动的 result_list，热点模块可覆写以减少 JSON 深拷贝（需同时让 TakesOwnedResultList 返回 true）。
     /// 默认回落到只读 Process。
     /// </summary>
     virtual ModuleIO ProcessOwned(const std::vector<ModuleImage>& imageList, Json&& resultList) {
@@ -69,6 +139,23 @@ public:
     }
 
 protected:
+    /// <summary>
+    /// 按 T::Schema() 把 Properties 绑定为结构体，供模块在成员初始化时调用（构造即加载期解析一次）。
+    /// 类型不符时抛出 std::invalid_argument。
+    /// </summary>
+    template <typename T>
+    T BindProperties() const {
+        return T::Schema().Bind(Properties);
+    }
+
+    /// <summary>
+    /// 节点内数据并行（见 FlowParallelFor）：线程预算取节点属性 parallel_threads（构造时绑定），未设置或 <= 0 时取全局预算。
+    /// body 只写入按下标预分配的槽位，不访问 Context、端口成员等共享状态。
+    /// </summary>
+    void ParallelFor(std::size_t count, std::size_t minGrain, const std::function<void(std::size_t)>& body) const {
+        FlowParallelFor(count, _parallelThreads, minGrain, body);
+    }
+
     // ---- Properties helpers (best-effort) ----
     std::string ReadString(const std::string& key, const std::string& dv) const {
         try {
@@ -122,6 +209,19 @@ protected:
         } catch (...) {}
         return dv;
     }
+
+private:
+    // 所有模块共有的节点内并行属性
+    struct ParallelProps {
+        int Threads = 0;
+
+        static const PropertySchema<ParallelProps>& Schema() {
+            static const PropertySchema<ParallelProps> schema = PropertySchema<ParallelProps>()
+                .Int("parallel_threads", &ParallelProps::Threads, 0);
+            return schema;
+        }
+    };
+    int _parallelThreads = 0;
 };
 
 /// <summary>
@@ -139,6 +239,9 @@ public:
     ModuleIO Process(const std::vector<ModuleImage>& /*imageList*/, const Json& /*resultList*/) override {
         return Generate();
     }
+
+    // 输出来自上下文中的前端图像或磁盘文件
+    bool IsOutputCacheable() const override { return false; }
 };
 
 } // namespace flow
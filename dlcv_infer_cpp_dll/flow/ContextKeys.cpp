@@ -0,0 +1,26 @@
+﻿#include "flow/ContextKeys.h"
+
+namespace dlcv_infer {
+namespace flow {
+namespace ContextKeys {
+
+const ContextKey<cv::Mat> FrontendImageMat("frontend_image_mat");
+const ContextKey<std::vector<cv::Mat>> FrontendImageMats("frontend_image_mats");
+const ContextKey<std::vector<cv::Mat>> FrontendImageMatList("frontend_image_mat_list");
+const ContextKey<std::string> FrontendImagePath("frontend_image_path");
+const ContextKey<int> DeviceId("device_id");
+const ContextKey<Json> InferParams("infer_params");
+const ContextKey<double> FlowDlcvInferMsAcc("flow_dlcv_infer_ms_acc");
+const ContextKey<std::uint64_t> GraphCurrentOutputMask("__graph_current_output_mask");
+const ContextKey<std::vector<FlowFrontendByNodePayload>> FrontendPayloadsByNode("frontend_payloads_by_node");
+const ContextKey<FlowFrontendPayload> FrontendPayloadLast("frontend_payload_last");
+const ContextKey<std::string> FrontendSelectedImagePath("frontend_selected_image_path");
+const ContextKey<std::string> SelectedImagePath("selected_image_path");
+const ContextKey<std::string> ImgPath("img_path");
+const ContextKey<std::string> BarcodeText("barcode_text");
+const ContextKey<std::string> Face("face");
+const ContextKey<std::string> TemplatesDir("templates_dir");
+
+} // namespace ContextKeys
+} // namespace flow
+} // namespace dlcv_infer
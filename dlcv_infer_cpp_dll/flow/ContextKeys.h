@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "flow/ExecutionContext.h"
+#include "flow/FlowPayloadTypes.h"
+#include "flow/FlowTypes.h"
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 流程内置上下文键：名称与历史字符串键一致，旧代码按字符串读写仍能访问同一份数据。
+/// </summary>
+namespace ContextKeys {
+
+extern const ContextKey<cv::Mat> FrontendImageMat;                 // "frontend_image_mat"
+extern const ContextKey<std::vector<cv::Mat>> FrontendImageMats;   // "frontend_image_mats"
+extern const ContextKey<std::vector<cv::Mat>> FrontendImageMatList; // "frontend_image_mat_list"
+extern const ContextKey<std::string> FrontendImagePath;            // "frontend_image_path"
+extern const ContextKey<int> DeviceId;                             // "device_id"
+extern const ContextKey<Json> InferParams;                         // "infer_params"
+extern const ContextKey<double> FlowDlcvInferMsAcc;                // "flow_dlcv_infer_ms_acc"
+extern const ContextKey<std::uint64_t> GraphCurrentOutputMask;     // "__graph_current_output_mask"
+extern const ContextKey<std::vector<FlowFrontendByNodePayload>> FrontendPayloadsByNode; // "frontend_payloads_by_node"
+extern const ContextKey<FlowFrontendPayload> FrontendPayloadLast;  // "frontend_payload_last"
+extern const ContextKey<std::string> FrontendSelectedImagePath;    // "frontend_selected_image_path"
+extern const ContextKey<std::string> SelectedImagePath;            // "selected_image_path"
+extern const ContextKey<std::string> ImgPath;                      // "img_path"
+extern const ContextKey<std::string> BarcodeText;                  // "barcode_text"
+extern const ContextKey<std::string> Face;                         // "face"
+extern const ContextKey<std::string> TemplatesDir;                 // "templates_dir"
+
+} // namespace ContextKeys
+
+} // namespace flow
+} // namespace dlcv_infer
@@ -0,0 +1,213 @@
+﻿#include "flow/DetectionBatch.h"
+
+#include <limits>
+
+namespace dlcv_infer {
+namespace flow {
+
+static bool IsIntegerInRange(const Json& v) {
+    if (v.is_number_integer()) {
+        const std::int64_t x = v.get<std::int64_t>();
+        return x >= std::numeric_limits<int>::min() && x <= std::numeric_limits<int>::max();
+    }
+    return false;
+}
+
+static int ReadEntryInt(const Json& fields, const char* key, int dv) {
+    try {
+        if (fields.contains(key) && fields.at(key).is_number_integer()) return fields.at(key).get<int>();
+    } catch (...) {}
+    return dv;
+}
+
+std::uint32_t DetectionBatch::InternName(const std::string& name) {
+    auto it = _nameIndex.find(name);
+    if (it != _nameIndex.end()) return it->second;
+    const std::uint32_t id = static_cast<std::uint32_t>(Names.size());
+    Names.push_back(name);
+    _nameIndex.emplace(name, id);
+    return id;
+}
+
+const std::string& DetectionBatch::NameOf(size_t det) const {
+    static const std::string empty;
+    if (det >= Size() || (Bits[det] & HasCategoryName) == 0) return empty;
+    const std::uint32_t id = CategoryNameId[det];
+    return id < Names.size() ? Names[id] : empty;
+}
+
+void DetectionBatch::AddEntry(Entry entry) {
+    EntryBegin.push_back(static_cast<std::uint32_t>(Size()));
+    Entries.push_back(std::move(entry));
+}
+
+size_t DetectionBatch::AppendDetection() {
+    Bits.push_back(0);
+    CategoryId.push_back(0);
+    CategoryNameId.push_back(0);
+    Score.push_back(0.0);
+    Area.push_back(0.0);
+    BboxLen.push_back(0);
+    X.push_back(0.0);
+    Y.push_back(0.0);
+    W.push_back(0.0);
+    H.push_back(0.0);
+    R.push_back(0.0);
+    Angle.push_back(0.0);
+    MaskRle.push_back(nullptr);
+    Extras.push_back(Json());
+    return Bits.size() - 1;
+}
+
+void DetectionBatch::AppendDetectionFrom(const DetectionBatch& src, size_t i) {
+    const size_t d = AppendDetection();
+    Bits[d] = src.Bits[i];
+    CategoryId[d] = src.CategoryId[i];
+    if ((src.Bits[i] & HasCategoryName) != 0) CategoryNameId[d] = InternName(src.NameOf(i));
+    Score[d] = src.Score[i];
+    Area[d] = src.Area[i];
+    BboxLen[d] = src.BboxLen[i];
+    X[d] = src.X[i];
+    Y[d] = src.Y[i];
+    W[d] = src.W[i];
+    H[d] = src.H[i];
+    R[d] = src.R[i];
+    Angle[d] = src.Angle[i];
+    MaskRle[d] = src.MaskRle[i];
+    Extras[d] = src.Extras[i];
+}
+
+bool DetectionBatch::ParseDetection(const Json& det) {
+    if (!det.is_object()) return false;
+    const size_t d = AppendDetection();
+    std::uint32_t bits = 0;
+    Json extras;
+
+    for (auto it = det.begin(); it != det.end(); ++it) {
+        const std::string& k = it.key();
+        const Json& v = it.value();
+        bool taken = false;
+
+        if (k == "category_id") {
+            if (IsIntegerInRange(v)) { CategoryId[d] = v.get<int>(); bits |= HasCategoryId; taken = true; }
+        } else if (k == "category_name") {
+            if (v.is_string()) { CategoryNameId[d] = InternName(v.get_ref<const std::string&>()); bits |= HasCategoryName; taken = true; }
+        } else if (k == "score") {
+            if (v.is_number_float()) { Score[d] = v.get<double>(); bits |= HasScore; taken = true; }
+        } else if (k == "area") {
+            if (v.is_number_float()) { Area[d] = v.get<double>(); bits |= HasArea; taken = true; }
+        } else if (k == "angle") {
+            if (v.is_number_float()) { Angle[d] = v.get<double>(); bits |= HasAngle; taken = true; }
+        } else if (k == "bbox") {
+            if (v.is_array() && (v.size() == 4 || v.size() == 5)) {
+                bool allFloat = true;
+                for (const auto& x : v) {
+                    if (!x.is_number_float()) { allFloat = false; break; }
+                }
+                if (allFloat) {
+                    BboxLen[d] = static_cast<std::uint8_t>(v.size());
+                    X[d] = v[0].get<double>();
+                    Y[d] = v[1].get<double>();
+                    W[d] = v[2].get<double>();
+                    H[d] = v[3].get<double>();
+                    if (v.size() == 5) R[d] = v[4].get<double>();
+                    bits |= HasBbox;
+                    taken = true;
+                }
+            }
+        } else if (k == "with_bbox") {
+            if (v.is_boolean()) { bits |= HasWithBbox | (v.get<bool>() ? WithBboxValue : 0u); taken = true; }
+        } else if (k == "with_mask") {
+            if (v.is_boolean()) { bits |= HasWithMask | (v.get<bool>() ? WithMaskValue : 0u); taken = true; }
+        } else if (k == "with_angle") {
+            if (v.is_boolean()) { bits |= HasWithAngle | (v.get<bool>() ? WithAngleValue : 0u); taken = true; }
+        } else if (k == "mask_rle") {
+            if (v.is_object()) { MaskRle[d] = std::make_shared<const Json>(v); bits |= HasMaskRle; taken = true; }
+        }
+
+        if (!taken) {
+            if (!extras.is_object()) extras = Json::object();
+            extras[k] = v;
+        }
+    }
+
+    Bits[d] = bits;
+    Extras[d] = std::move(extras);
+    return true;
+}
+
+std::shared_ptr<DetectionBatch> DetectionBatch::FromResultList(const Json& resultList) {
+    if (!resultList.is_array()) return nullptr;
+    std::shared_ptr<DetectionBatch> batch = std::make_shared<DetectionBatch>();
+    for (const auto& token : resultList) {
+        if (!token.is_object()) return nullptr;
+
+        Entry entry;
+        entry.HasSamples = false;
+        const Json* samples = nullptr;
+        for (auto it = token.begin(); it != token.end(); ++it) {
+            if (it.key() == "sample_results") {
+                samples = &it.value();
+                continue;
+            }
+            entry.Fields[it.key()] = it.value();
+        }
+        if (samples != nullptr) {
+            if (!samples->is_array()) return nullptr;
+            entry.HasSamples = true;
+        }
+        entry.Index = ReadEntryInt(entry.Fields, "index", -1);
+        entry.OriginIndex = ReadEntryInt(entry.Fields, "origin_index", entry.Index);
+        auto itTransform = entry.Fields.find("transform");
+        entry.TransformId = itTransform != entry.Fields.end() ? TransformationState::IdFromJson(*itTransform) : 0;
+        batch->AddEntry(std::move(entry));
+
+        if (samples != nullptr) {
+            for (const auto& det : *samples) {
+                if (!batch->ParseDetection(det)) return nullptr;
+            }
+        }
+    }
+    return batch;
+}
+
+Json DetectionBatch::DetectionToJson(size_t i) const {
+    Json o = Extras[i].is_object() ? Extras[i] : Json::object();
+    const std::uint32_t bits = Bits[i];
+    if (bits & HasCategoryId) o["category_id"] = CategoryId[i];
+    if (bits & HasCategoryName) o["category_name"] = Names[CategoryNameId[i]];
+    if (bits & HasScore) o["score"] = Score[i];
+    if (bits & HasArea) o["area"] = Area[i];
+    if (bits & HasBbox) {
+        Json bbox = Json::array({ X[i], Y[i], W[i], H[i] });
+        if (BboxLen[i] == 5) bbox.push_back(R[i]);
+        o["bbox"] = std::move(bbox);
+    }
+    if (bits & HasWithBbox) o["with_bbox"] = (bits & WithBboxValue) != 0;
+    if (bits & HasWithMask) o["with_mask"] = (bits & WithMaskValue) != 0;
+    if (bits & HasWithAngle) o["with_angle"] = (bits & WithAngleValue) != 0;
+    if (bits & HasAngle) o["angle"] = Angle[i];
+    if ((bits & HasMaskRle) && MaskRle[i]) o["mask_rle"] = *MaskRle[i];
+    return o;
+}
+
+Json DetectionBatch::ToResultList() const {
+    Json out = Json::array();
+    for (size_t e = 0; e < Entries.size(); e++) {
+        const Entry& entry = Entries[e];
+        Json obj = entry.Fields.is_object() ? entry.Fields : Json::object();
+        if (entry.HasSamples) {
+            Json samples = Json::array();
+            const size_t end = EntryEnd(e);
+            for (size_t i = EntryBegin[e]; i < end; i++) {
+                samples.push_back(DetectionToJson(i));
+            }
+            obj["sample_results"] = std::move(samples);
+        }
+        out.push_back(std::move(obj));
+    }
+    return out;
+}
+
+} // namespace flow
+} // namespace dlcv_infer
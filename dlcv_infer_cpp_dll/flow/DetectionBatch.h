@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flow/FlowTypes.h"
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 列式检测结果表（struct-of-arrays），模块间传递检测结果的原生格式。
+/// - 条目对应 result_list 中的每个元素（通常每张图一个 local 条目），检测按条目连续存放；
+/// - 识别的检测字段按 JSON 原类型存入列（类别名做字符串驻留，mask_rle 以共享句柄保存）；
+///   类型不符或未识别的字段原样存入 Extras，保证与 JSON 往返结果完全一致；
+/// - 只有需要 JSON 的模块入口（含 output/return_json）才由 GraphExecutor 物化为 result_list。
+/// </summary>
+class DetectionBatch final {
+public:
+    enum FieldBits : std::uint32_t {
+        HasCategoryId = 1u << 0,
+        HasCategoryName = 1u << 1,
+        HasScore = 1u << 2,
+        HasArea = 1u << 3,
+        HasBbox = 1u << 4,
+        HasAngle = 1u << 5,
+        HasWithBbox = 1u << 6,
+        WithBboxValue = 1u << 7,
+        HasWithMask = 1u << 8,
+        WithMaskValue = 1u << 9,
+        HasWithAngle = 1u << 10,
+        WithAngleValue = 1u << 11,
+        HasMaskRle = 1u << 12
+    };
+
+    struct Entry final {
+        Json Fields = Json::object();  // 条目中除 sample_results 外的字段（原样）
+        bool HasSamples = true;        // 原条目是否带 sample_results
+        int Index = -1;
+        int OriginIndex = -1;
+        std::uint64_t TransformId = 0; // transform 对应的 TransformationState::TransformId（非对象时为 0）
+    };
+
+    // ---- 条目 ----
+    std::vector<Entry> Entries;
+    std::vector<std::uint32_t> EntryBegin; // 条目 e 的检测区间为 [EntryBegin[e], EntryEnd(e))
+
+    // ---- 检测列 ----
+    std::vector<std::uint32_t> Bits;
+    std::vector<int> CategoryId;
+    std::vector<std::uint32_t> CategoryNameId; // -> Names
+    std::vector<double> Score;
+    std::vector<double> Area;
+    std::vector<std::uint8_t> BboxLen;         // 4: [x,y,w,h]；5: [cx,cy,w,h,angle]
+    std::vector<double> X;
+    std::vector<double> Y;
+    std::vector<double> W;
+    std::vector<double> H;
+    std::vector<double> R;                     // BboxLen==5 时的第 5 个分量
+    std::vector<double> Angle;
+    std::vector<std::shared_ptr<const Json>> MaskRle;
+    std::vector<Json> Extras;                  // 其余字段（object），无则为 null
+
+    // ---- 类别名驻留表 ----
+    std::vector<std::string> Names;
+
+    size_t Size() const { return Bits.size(); }
+    size_t EntryCount() const { return Entries.size(); }
+    size_t EntryEnd(size_t e) const {
+        return e + 1 < EntryBegin.size() ? EntryBegin[e + 1] : Size();
+    }
+
+    std::uint32_t InternName(const std::string& name);
+    const std::string& NameOf(size_t det) const;
+
+    /// <summary>
+    /// 新建条目：之后追加的检测都属于该条目，直到下一次 AddEntry。
+    /// </summary>
+    void AddEntry(Entry entry);
+
+    /// <summary>
+    /// 追加一条空检测（全部字段缺失），返回其下标；调用方随后填写列并设置 Bits。
+    /// </summary>
+    size_t AppendDetection();
+
+    /// <summary>
+    /// 复制另一张表的第 i 条检测到当前条目（类别名按需重新驻留）。
+    /// </summary>
+    void AppendDetectionFrom(const DetectionBatch& src, size_t i);
+
+    /// <summary>
+    /// 从 result_list 解析；含非对象条目/检测时返回 nullptr（调用方继续使用 JSON）。
+    /// </summary>
+    static std::shared_ptr<DetectionBatch> FromResultList(const Json& resultList);
+
+    Json DetectionToJson(size_t i) const;
+    Json ToResultList() const;
+
+private:
+    std::unordered_map<std::string, std::uint32_t> _nameIndex;
+
+    bool ParseDetection(const Json& det);
+};
+
+} // namespace flow
+} // namespace dlcv_infer
@@ -1,19 +1,44 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <typeinfo>
+#include <utility>
+#include <vector>
 
 namespace dlcv_infer {
 namespace flow {
 
+/// <summary>
+/// 预注册的上下文键：构造时在进程级注册表中解析出槽位下标，之后按下标直接访问，不再做字符串哈希。
+/// 同名键共享同一槽位，字符串接口访问已注册的名字时同样落到该槽位，新旧写法可以混用。
+/// </summary>
+template <typename T>
+class ContextKey final {
+public:
+    explicit ContextKey(const char* name);
+
+    const std::string& Name() const { return _name; }
+    size_t Index() const { return _index; }
+
+private:
+    std::string _name;
+    size_t _index = 0;
+};
+
 /// <summary>
 /// 轻量执行上下文：用于在流程执行期间传递共享参数与中间结果。
 /// 设计目标：
 /// - C++14 可用（不依赖 std::any/std::variant）
 /// - 支持存放常用标量、nlohmann::json、cv::Mat 以及自定义类型
 /// - Get<T> 在类型不匹配时返回默认值（不抛异常），便于流程容错
+/// - 各操作内部加锁，支持并行执行的节点同时读写；读改写请使用 Update<T>
+/// - 热路径使用 ContextKey<T>：槽位下标寻址，Find 返回指针避免拷贝，Set 同类型时原地赋值
 /// </summary>
 class ExecutionContext final {
 private:
@@ -32,59 +57,249 @@ private:
         std::shared_ptr<IValue> Clone() const override { return std::make_shared<Value<T>>(V); }
     };
 
+    using SlotIndexMap = std::unordered_map<std::string, size_t>;
+
+    // 注册在锁内进行并发布新的只读快照；查找只读快照，不加锁。旧快照保留到进程退出，读者无需回收同步
+    struct SlotRegistry final {
+        std::mutex Mu;
+        std::vector<std::unique_ptr<const SlotIndexMap>> Snapshots;
+        std::atomic<const SlotIndexMap*> Current{ nullptr };
+    };
+
+    static SlotRegistry& Registry() {
+        static SlotRegistry* registry = new SlotRegistry(); // 不析构，避免退出期静态对象析构顺序问题
+        return *registry;
+    }
+
+    // 未注册时返回 -1
+    static long long FindSlot(const std::string& key) {
+        const SlotIndexMap* indices = Registry().Current.load(std::memory_order_acquire);
+        if (indices == nullptr) return -1;
+        auto it = indices->find(key);
+        return it == indices->end() ? -1 : static_cast<long long>(it->second);
+    }
+
+    template <typename T>
+    static Value<T>* As(const std::shared_ptr<IValue>& holder) {
+        if (!holder || holder->Type() != typeid(T)) return nullptr;
+        return static_cast<Value<T>*>(holder.get());
+    }
+
     std::unordered_map<std::string, std::shared_ptr<IValue>> _map;
+    std::vector<std::shared_ptr<IValue>> _slots; // 槽位下标 -> 值（已注册键）
+    mutable std::mutex _mu;
 
-public:
-    ExecutionContext() = default;
-    ~ExecutionContext() = default;
+    // 调用方持锁；key 已注册时返回槽位引用（按需扩容），否则返回 _map 中的引用
+    std::shared_ptr<IValue>& HolderLocked(const std::string& key) {
+        const long long slot = FindSlot(key);
+        if (slot < 0) return _map[key];
+        return SlotLocked(static_cast<size_t>(slot));
+    }
 
-    ExecutionContext(const ExecutionContext& other) {
+    std::shared_ptr<IValue>& SlotLocked(size_t index) {
+        if (index >= _slots.size()) _slots.resize(index + 1);
+        return _slots[index];
+    }
+
+    const std::shared_ptr<IValue>* FindHolderLocked(const std::string& key) const {
+        const long long slot = FindSlot(key);
+        if (slot >= 0) {
+            const size_t index = static_cast<size_t>(slot);
+            if (index >= _slots.size() || !_slots[index]) return nullptr;
+            return &_slots[index];
+        }
+        auto it = _map.find(key);
+        if (it == _map.end() || !it->second) return nullptr;
+        return &it->second;
+    }
+
+    const std::shared_ptr<IValue>* FindSlotLocked(size_t index) const {
+        if (index >= _slots.size() || !_slots[index]) return nullptr;
+        return &_slots[index];
+    }
+
+    template <typename T>
+    static void AssignLocked(std::shared_ptr<IValue>& holder, T&& value) {
+        using U = typename std::decay<T>::type;
+        Value<U>* pv = As<U>(holder);
+        if (pv != nullptr) {
+            pv->V = std::forward<T>(value); // 同类型原地赋值，不重新分配
+        } else {
+            holder = std::make_shared<Value<U>>(std::forward<T>(value));
+        }
+    }
+
+    void CopyFrom(const ExecutionContext& other) {
         _map.reserve(other._map.size());
         for (const auto& kv : other._map) {
             _map.emplace(kv.first, kv.second ? kv.second->Clone() : nullptr);
         }
+        _slots.resize(other._slots.size());
+        for (size_t i = 0; i < other._slots.size(); i++) {
+            _slots[i] = other._slots[i] ? other._slots[i]->Clone() : nullptr;
+        }
+    }
+
+public:
+    /// <summary>
+    /// 注册键名并返回槽位下标（同名重复注册返回同一下标）。通常由 ContextKey 构造函数调用。
+    /// </summary>
+    static size_t RegisterSlot(const std::string& key) {
+        SlotRegistry& reg = Registry();
+        std::lock_guard<std::mutex> lk(reg.Mu);
+        const SlotIndexMap* current = reg.Current.load(std::memory_order_relaxed);
+        if (current != nullptr) {
+            auto it = current->find(key);
+            if (it != current->end()) return it->second;
+        }
+        std::unique_ptr<SlotIndexMap> next(current != nullptr ? new SlotIndexMap(*current) : new SlotIndexMap());
+        const size_t index = next->size();
+        next->emplace(key, index);
+        reg.Current.store(next.get(), std::memory_order_release);
+        reg.Snapshots.push_back(std::move(next));
+        return index;
+    }
+
+    ExecutionContext() = default;
+    ~ExecutionContext() = default;
+
+    ExecutionContext(const ExecutionContext& other) {
+        std::lock_guard<std::mutex> lk(other._mu);
+        CopyFrom(other);
     }
 
     ExecutionContext& operator=(const ExecutionContext& other) {
         if (this == &other) return *this;
-        _map.clear();
-        _map.reserve(other._map.size());
-        for (const auto& kv : other._map) {
-            _map.emplace(kv.first, kv.second ? kv.second->Clone() : nullptr);
-        }
+        ExecutionContext copied(other);
+        std::lock_guard<std::mutex> lk(_mu);
+        _map.swap(copied._map);
+        _slots.swap(copied._slots);
         return *this;
     }
 
-    ExecutionContext(ExecutionContext&&) noexcept = default;
-    ExecutionContext& operator=(ExecutionContext&&) noexcept = default;
+    ExecutionContext(ExecutionContext&& other) noexcept {
+        std::lock_guard<std::mutex> lk(other._mu);
+        _map = std::move(other._map);
+        _slots = std::move(other._slots);
+    }
+
+    ExecutionContext& operator=(ExecutionContext&& other) noexcept {
+        if (this == &other) return *this;
+        std::unique_lock<std::mutex> lkThis(_mu, std::defer_lock);
+        std::unique_lock<std::mutex> lkOther(other._mu, std::defer_lock);
+        std::lock(lkThis, lkOther);
+        _map = std::move(other._map);
+        _slots = std::move(other._slots);
+        return *this;
+    }
 
     bool Has(const std::string& key) const {
-        return _map.find(key) != _map.end();
+        std::lock_guard<std::mutex> lk(_mu);
+        return FindHolderLocked(key) != nullptr;
+    }
+
+    template <typename T>
+    bool Has(const ContextKey<T>& key) const {
+        std::lock_guard<std::mutex> lk(_mu);
+        return FindSlotLocked(key.Index()) != nullptr;
     }
 
     void Remove(const std::string& key) {
-        _map.erase(key);
+        std::lock_guard<std::mutex> lk(_mu);
+        const long long slot = FindSlot(key);
+        if (slot < 0) {
+            _map.erase(key);
+        } else if (static_cast<size_t>(slot) < _slots.size()) {
+            _slots[static_cast<size_t>(slot)].reset();
+        }
     }
 
     void Clear() {
+        std::lock_guard<std::mutex> lk(_mu);
         _map.clear();
+        _slots.clear();
     }
 
     template <typename T>
     void Set(const std::string& key, T value) {
-        _map[key] = std::make_shared<Value<T>>(std::move(value));
+        std::lock_guard<std::mutex> lk(_mu);
+        AssignLocked(HolderLocked(key), std::move(value));
+    }
+
+    template <typename T>
+    void Set(const ContextKey<T>& key, T value) {
+        std::lock_guard<std::mutex> lk(_mu);
+        AssignLocked(SlotLocked(key.Index()), std::move(value));
     }
 
     template <typename T>
     T Get(const std::string& key, const T& defaultValue = T()) const {
-        auto it = _map.find(key);
-        if (it == _map.end() || !it->second) return defaultValue;
-        auto pv = std::dynamic_pointer_cast<Value<T>>(it->second);
-        if (!pv) return defaultValue;
-        return pv->V;
+        std::lock_guard<std::mutex> lk(_mu);
+        const std::shared_ptr<IValue>* holder = FindHolderLocked(key);
+        Value<T>* pv = holder != nullptr ? As<T>(*holder) : nullptr;
+        return pv != nullptr ? pv->V : defaultValue;
+    }
+
+    template <typename T>
+    T Get(const ContextKey<T>& key, const T& defaultValue = T()) const {
+        std::lock_guard<std::mutex> lk(_mu);
+        const std::shared_ptr<IValue>* holder = FindSlotLocked(key.Index());
+        Value<T>* pv = holder != nullptr ? As<T>(*holder) : nullptr;
+        return pv != nullptr ? pv->V : defaultValue;
+    }
+
+    /// <summary>
+    /// 按引用访问：键不存在或类型不匹配时返回 nullptr。
+    /// 指针在该键被 Remove/Clear 或以其他类型 Set 之前有效；并行执行期间只应用于 Run 前写入、运行中只读的键
+    /// （前端图像、infer_params、device_id 等），运行中会被改写的键请用 Update。
+    /// </summary>
+    template <typename T>
+    const T* Find(const ContextKey<T>& key) const {
+        std::lock_guard<std::mutex> lk(_mu);
+        const std::shared_ptr<IValue>* holder = FindSlotLocked(key.Index());
+        Value<T>* pv = holder != nullptr ? As<T>(*holder) : nullptr;
+        return pv != nullptr ? &pv->V : nullptr;
+    }
+
+    template <typename T>
+    T* Find(const ContextKey<T>& key) {
+        std::lock_guard<std::mutex> lk(_mu);
+        const std::shared_ptr<IValue>* holder = FindSlotLocked(key.Index());
+        Value<T>* pv = holder != nullptr ? As<T>(*holder) : nullptr;
+        return pv != nullptr ? &pv->V : nullptr;
+    }
+
+    /// <summary>
+    /// 原子读改写：在锁内对 key 的值原地调用 fn(T&)；key 不存在或类型不匹配时先以 initialValue 创建。
+    /// </summary>
+    template <typename T, typename Fn>
+    void Update(const std::string& key, Fn fn, const T& initialValue = T()) {
+        std::lock_guard<std::mutex> lk(_mu);
+        std::shared_ptr<IValue>& holder = HolderLocked(key);
+        Value<T>* pv = As<T>(holder);
+        if (pv == nullptr) {
+            holder = std::make_shared<Value<T>>(initialValue);
+            pv = static_cast<Value<T>*>(holder.get());
+        }
+        fn(pv->V);
+    }
+
+    template <typename T, typename Fn>
+    void Update(const ContextKey<T>& key, Fn fn, const T& initialValue = T()) {
+        std::lock_guard<std::mutex> lk(_mu);
+        std::shared_ptr<IValue>& holder = SlotLocked(key.Index());
+        Value<T>* pv = As<T>(holder);
+        if (pv == nullptr) {
+            holder = std::make_shared<Value<T>>(initialValue);
+            pv = static_cast<Value<T>*>(holder.get());
+        }
+        fn(pv->V);
     }
 };
 
+template <typename T>
+ContextKey<T>::ContextKey(const char* name)
+    : _name(name != nullptr ? name : ""), _index(ExecutionContext::RegisterSlot(_name)) {}
+
 } // namespace flow
 } // namespace dlcv_infer
-
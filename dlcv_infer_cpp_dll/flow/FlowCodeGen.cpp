@@ -0,0 +1,273 @@
+﻿#include "flow/FlowCodeGen.h"
+#include "flow/ContextKeys.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace dlcv_infer {
+namespace flow {
+
+bool GeneratedFlowFrame::GatedOff(size_t nodeIndex) {
+    if (!_exec.IsGatedOff(nodeIndex)) return false;
+    _exec.MarkGatedOff(nodeIndex);
+    return true;
+}
+
+bool GeneratedFlowFrame::Alias(size_t nodeIndex) {
+    const int canonical = _exec._plan->Nodes[nodeIndex].DedupOf;
+    if (canonical < 0 || !_exec._nodeExecuted[static_cast<size_t>(canonical)]) return false;
+    // 等价节点的通道已交给生成代码，这里只同步标量、门控与执行标记
+    _exec.ExecuteDeduplicated(nodeIndex, nullptr);
+    return true;
+}
+
+GeneratedNodeOutput GeneratedFlowFrame::Invoke(size_t nodeIndex, SharedChannel main, std::vector<SharedChannel> extra) {
+    GeneratedNodeOutput out;
+    std::unique_ptr<BaseModule> transientModule;
+    BaseModule* module = _exec.AcquireModule(nodeIndex, _exec._runOverrides, transientModule);
+    if (module == nullptr) return out;
+
+    GraphExecutor::NodeInputs inputs;
+    inputs.Main = std::move(main);
+    inputs.Extra = std::move(extra);
+    _exec.GatherScalarInputs(nodeIndex, inputs);
+    try {
+        _exec._context->Set(ContextKeys::GraphCurrentOutputMask, _exec._runOutputMasks[nodeIndex]);
+    } catch (...) {}
+    _exec.ExecuteNode(nodeIndex, module, std::move(inputs));
+
+    // 通道输出交给生成代码的局部变量，执行器不再保留
+    GraphExecutor::NodeExecOutput& produced = _exec._nodeExecs[nodeIndex];
+    out.Main = std::move(produced.Main);
+    out.Extra = std::move(produced.Extra);
+    produced.Extra.clear();
+    return out;
+}
+
+static std::mutex& GeneratedRegistryMutex() {
+    static std::mutex s_mu;
+    return s_mu;
+}
+
+static std::unordered_map<std::uint64_t, GeneratedFlowRunner>& GeneratedRegistryMap() {
+    static std::unordered_map<std::uint64_t, GeneratedFlowRunner> s_map;
+    return s_map;
+}
+
+void GeneratedFlowRegistry::Register(std::uint64_t structureHash, GeneratedFlowRunner runner) {
+    if (runner == nullptr) return;
+    std::lock_guard<std::mutex> lk(GeneratedRegistryMutex());
+    GeneratedRegistryMap()[structureHash] = runner;
+}
+
+GeneratedFlowRunner GeneratedFlowRegistry::Find(std::uint64_t structureHash) {
+    std::lock_guard<std::mutex> lk(GeneratedRegistryMutex());
+    auto& map = GeneratedRegistryMap();
+    auto it = map.find(structureHash);
+    return it == map.end() ? nullptr : it->second;
+}
+
+// 通道读取单元：(源节点, 源输出对, 通道类型)，结果通道连同列式结果一起读取
+using ChannelPiece = std::pair<std::pair<int, int>, int>;
+
+static const char* PieceFields(CompiledFlowPlan::ChannelKind kind) {
+    switch (kind) {
+    case CompiledFlowPlan::ChannelKind::Image: return "ImageList";
+    case CompiledFlowPlan::ChannelKind::Result: return "ResultList";
+    case CompiledFlowPlan::ChannelKind::Template: return "TemplateList";
+    default: return nullptr;
+    }
+}
+
+static std::string OutputVar(int nodeIndex, int pairIndex) {
+    return "n" + std::to_string(nodeIndex) + "_" + std::to_string(pairIndex);
+}
+
+static std::string SanitizeIdentifier(const std::string& name) {
+    std::string out;
+    for (char ch : name) {
+        const unsigned char u = static_cast<unsigned char>(ch);
+        out.push_back((std::isalnum(u) && u < 0x80) || ch == '_' ? ch : '_');
+    }
+    if (!out.empty() && std::isdigit(static_cast<unsigned char>(out[0]))) out.insert(out.begin(), '_');
+    return out;
+}
+
+// 生成的通道赋值：dst.<字段> = [std::move(]src.<字段>[)]，结果通道同时带上 Detections
+static void EmitPieceAssign(std::ostringstream& os, const std::string& indent, const std::string& dst,
+    const std::string& src, CompiledFlowPlan::ChannelKind kind, bool move) {
+    const char* field = PieceFields(kind);
+    if (field == nullptr) return;
+    const auto emit = [&](const char* f) {
+        os << indent << dst << "." << f << " = ";
+        if (move) os << "std::move(" << src << "." << f << ");\n";
+        else os << src << "." << f << ";\n";
+    };
+    emit(field);
+    if (kind == CompiledFlowPlan::ChannelKind::Result) emit("Detections");
+}
+
+std::string GenerateFlowSource(const CompiledFlowPlan& plan, const std::string& functionName) {
+    const size_t nodeCount = plan.Nodes.size();
+    const std::uint64_t structureHash = GraphExecutor::ComputeStructureHash(plan);
+    char hashHex[32] = { 0 };
+    std::snprintf(hashHex, sizeof(hashHex), "0x%016llxULL", static_cast<unsigned long long>(structureHash));
+    std::string fn = SanitizeIdentifier(functionName);
+    if (fn.empty()) {
+        char name[32] = { 0 };
+        std::snprintf(name, sizeof(name), "RunFlow_%016llx", static_cast<unsigned long long>(structureHash));
+        fn = name;
+    }
+
+    // 与通用执行相同：未注册或不存活的节点不执行
+    std::vector<char> emitted(nodeCount, 0);
+    for (size_t i = 0; i < nodeCount; i++) {
+        emitted[i] = (plan.Nodes[i].Factory && plan.Nodes[i].Live) ? 1 : 0;
+    }
+    static const CompiledFlowPlan::ChannelKind kAllKinds[] = {
+        CompiledFlowPlan::ChannelKind::Image, CompiledFlowPlan::ChannelKind::Result, CompiledFlowPlan::ChannelKind::Template };
+
+    // 第一遍：按计划顺序登记每次通道读取，确定各读取单元的最后一个读取者（取走数据）与需要保存的输出对
+    std::map<ChannelPiece, int> readCount;
+    std::vector<std::vector<int>> neededPairs(nodeCount);
+    const auto markNeeded = [&neededPairs](int node, int pair) {
+        std::vector<int>& v = neededPairs[static_cast<size_t>(node)];
+        if (std::find(v.begin(), v.end(), pair) == v.end()) v.push_back(pair);
+    };
+    const auto aliasPairs = [&plan](size_t i) {
+        std::vector<int> pairs;
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        for (int port = 0; port < node.OutputCount; port++) {
+            const size_t slot = static_cast<size_t>(node.OutputSlotBase + port);
+            if (slot < plan.OutputConsumerCounts.size() && plan.OutputConsumerCounts[slot] > 0 &&
+                std::find(pairs.begin(), pairs.end(), port / 2) == pairs.end()) {
+                pairs.push_back(port / 2);
+            }
+        }
+        return pairs;
+    };
+    for (size_t i = 0; i < nodeCount; i++) {
+        if (!emitted[i]) continue;
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        if (node.DedupOf >= 0) {
+            for (int pair : aliasPairs(i)) {
+                markNeeded(node.DedupOf, pair);
+                for (auto kind : kAllKinds) readCount[{{node.DedupOf, pair}, static_cast<int>(kind)}]++;
+            }
+            continue;
+        }
+        for (const auto& slot : node.ChannelInputs) {
+            if (slot.SrcNodeIndex < 0 || static_cast<size_t>(slot.SrcNodeIndex) >= i) continue;
+            if (!emitted[static_cast<size_t>(slot.SrcNodeIndex)] || PieceFields(slot.Channel) == nullptr) continue;
+            markNeeded(slot.SrcNodeIndex, slot.SrcOutIdx / 2);
+            readCount[{{slot.SrcNodeIndex, slot.SrcOutIdx / 2}, static_cast<int>(slot.Channel)}]++;
+        }
+    }
+    // 读取单元剩余读取次数归零时取走
+    const auto takeRead = [&readCount](int node, int pair, CompiledFlowPlan::ChannelKind kind) {
+        int& remain = readCount[{{node, pair}, static_cast<int>(kind)}];
+        remain -= 1;
+        return remain <= 0;
+    };
+
+    std::ostringstream os;
+    os << "// 由 dlcv_infer::flow::GenerateFlowSource 生成，请勿手工修改。\n";
+    os << "// 加载的流程编译出的结构哈希与本文件一致时，GraphExecutor 改用本文件的代码执行；\n";
+    os << "// 节点类型、连线或输出掩码变化后不再匹配，自动回落为通用执行。\n";
+    os << "#include \"flow/FlowCodeGen.h\"\n\n";
+    os << "namespace {\n\n";
+    os << "using ::dlcv_infer::flow::GeneratedFlowFrame;\n";
+    os << "using ::dlcv_infer::flow::GeneratedNodeOutput;\n";
+    os << "using ::dlcv_infer::flow::SharedChannel;\n\n";
+    os << "void " << fn << "(GeneratedFlowFrame& f) {\n";
+
+    bool needBlank = false;
+    for (size_t i = 0; i < nodeCount; i++) {
+        std::sort(neededPairs[i].begin(), neededPairs[i].end());
+        for (int pair : neededPairs[i]) {
+            os << "    SharedChannel " << OutputVar(static_cast<int>(i), pair) << ";\n";
+            needBlank = true;
+        }
+    }
+
+    for (size_t i = 0; i < nodeCount; i++) {
+        if (!emitted[i]) continue;
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        const int ni = static_cast<int>(i);
+        if (needBlank) os << "\n";
+        needBlank = true;
+        os << "    // [" << i << "] id=" << node.NodeId << " " << node.Type << "\n";
+
+        bool hasInputs = false;
+        for (const auto& slot : node.ChannelInputs) hasInputs = hasInputs || (slot.SrcNodeIndex >= 0 && slot.SrcNodeIndex < ni);
+        for (const auto& slot : node.ScalarInputs) hasInputs = hasInputs || (slot.SrcNodeIndex >= 0 && slot.SrcNodeIndex < ni);
+        if (hasInputs) {
+            os << "    if (!f.GatedOff(" << i << ")) {\n";
+        } else {
+            os << "    {\n";
+        }
+        const std::string indent = "        ";
+        const std::vector<int>& outPairs = neededPairs[i];
+        if (node.DedupOf >= 0) {
+            os << indent << "if (f.Alias(" << i << ")) {\n";
+            for (int pair : aliasPairs(i)) {
+                const bool keep = std::find(outPairs.begin(), outPairs.end(), pair) != outPairs.end();
+                for (auto kind : kAllKinds) {
+                    const bool move = takeRead(node.DedupOf, pair, kind);
+                    if (!keep) continue;
+                    EmitPieceAssign(os, indent + "    ", OutputVar(ni, pair), OutputVar(node.DedupOf, pair), kind, move);
+                }
+            }
+            os << indent << "}\n";
+            os << "    }\n";
+            continue;
+        }
+
+        // 输入对：与通用执行一致，额外对按对序号升序，连到未执行源节点的对保留为空
+        std::vector<int> extraPairs;
+        bool hasMain = false;
+        for (const auto& slot : node.ChannelInputs) {
+            if (slot.PairIndex == 0) { hasMain = true; continue; }
+            if (std::find(extraPairs.begin(), extraPairs.end(), slot.PairIndex) == extraPairs.end()) extraPairs.push_back(slot.PairIndex);
+        }
+        std::sort(extraPairs.begin(), extraPairs.end());
+        if (hasMain) os << indent << "SharedChannel in;\n";
+        if (!extraPairs.empty()) os << indent << "std::vector<SharedChannel> extra(" << extraPairs.size() << ");\n";
+        for (const auto& slot : node.ChannelInputs) {
+            if (slot.SrcNodeIndex < 0 || slot.SrcNodeIndex >= ni) continue;
+            if (!emitted[static_cast<size_t>(slot.SrcNodeIndex)] || PieceFields(slot.Channel) == nullptr) continue;
+            std::string dst = "in";
+            if (slot.PairIndex != 0) {
+                const size_t k = static_cast<size_t>(std::find(extraPairs.begin(), extraPairs.end(), slot.PairIndex) - extraPairs.begin());
+                dst = "extra[" + std::to_string(k) + "]";
+            }
+            const int srcPair = slot.SrcOutIdx / 2;
+            EmitPieceAssign(os, indent, dst, OutputVar(slot.SrcNodeIndex, srcPair), slot.Channel,
+                takeRead(slot.SrcNodeIndex, srcPair, slot.Channel));
+        }
+
+        const std::string call = "f.Invoke(" + std::to_string(i) + ", " + (hasMain ? "std::move(in)" : "SharedChannel()") + ", " +
+            (extraPairs.empty() ? "std::vector<SharedChannel>()" : "std::move(extra)") + ")";
+        if (outPairs.empty()) {
+            os << indent << "(void)" << call << ";\n";
+        } else {
+            os << indent << "GeneratedNodeOutput out = " << call << ";\n";
+            for (int pair : outPairs) {
+                os << indent << OutputVar(ni, pair) << " = out.TakePair(" << pair << ");\n";
+            }
+        }
+        os << "    }\n";
+    }
+    os << "}\n\n";
+    os << "} // namespace\n\n";
+    os << "DLCV_FLOW_REGISTER_GENERATED(" << hashHex << ", " << fn << ")\n";
+    return os.str();
+}
+
+} // namespace flow
+} // namespace dlcv_infer
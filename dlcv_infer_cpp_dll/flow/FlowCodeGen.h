@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "dlcv_infer.h"
+#include "flow/GraphExecutor.h"
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 预生成执行代码中单个节点的通道输出：按对序号取出后由生成代码保存为局部变量。
+/// </summary>
+struct GeneratedNodeOutput final {
+    SharedChannel Main;
+    std::vector<SharedChannel> Extra;
+
+    SharedChannel TakePair(int pairIndex) {
+        if (pairIndex == 0) return std::move(Main);
+        const size_t k = static_cast<size_t>(pairIndex - 1);
+        return k < Extra.size() ? std::move(Extra[k]) : SharedChannel();
+    }
+};
+
+/// <summary>
+/// 预生成执行代码的运行帧：包装一次 GraphExecutor::Run，只开放生成代码需要的操作。
+/// 节点通道输出由生成代码以局部变量保存，按生成时确定的消费顺序取走或共享；
+/// 模块实例、标量、门控、节点耗时与对外输出仍由执行器管理，与通用执行一致。
+/// </summary>
+class GeneratedFlowFrame final {
+public:
+    explicit GeneratedFlowFrame(GraphExecutor& exec) : _exec(exec) {}
+
+    /// <summary>
+    /// 门控截断判定（同通用执行）：本节点被截断时记录并返回 true。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API bool GatedOff(size_t nodeIndex);
+
+    /// <summary>
+    /// 合并节点（DedupOf）：等价节点已产出时共用其标量与门控状态并返回 true，通道由生成代码直接共享。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API bool Alias(size_t nodeIndex);
+
+    /// <summary>
+    /// 执行节点：main/extra 为已按连线组装的主对与额外对（按对序号升序），标量输入由执行器按连线读取。
+    /// 模块未能创建时返回空输出。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API GeneratedNodeOutput Invoke(size_t nodeIndex, SharedChannel main, std::vector<SharedChannel> extra);
+
+private:
+    GraphExecutor& _exec;
+};
+
+/// <summary>
+/// 预生成执行代码注册表：按计划结构哈希（GraphExecutor::ComputeStructureHash）登记，编译或恢复执行计划时查找。
+/// 生成的源文件可编入本 DLL 或宿主程序，由 DLCV_FLOW_REGISTER_GENERATED 在静态初始化阶段注册。
+/// </summary>
+class GeneratedFlowRegistry final {
+public:
+    DLCV_INFER_CPP_DLL_API static void Register(std::uint64_t structureHash, GeneratedFlowRunner runner);
+    DLCV_INFER_CPP_DLL_API static GeneratedFlowRunner Find(std::uint64_t structureHash);
+};
+
+/// <summary>
+/// 为执行计划生成 C++ 源文件内容：按计划顺序展开全部存活节点，节点间的通道路由写为局部变量间的赋值，
+/// 最后一个读取者直接取走数据；模块仍经注册表按节点属性创建（属性在模块构造时绑定）。
+/// 生成代码只依赖计划结构，节点属性（含模型路径、调优参数）变化后仍然适用。
+/// functionName 中的非法字符替换为下划线，为空时按结构哈希命名。
+/// </summary>
+DLCV_INFER_CPP_DLL_API std::string GenerateFlowSource(const CompiledFlowPlan& plan, const std::string& functionName = std::string());
+
+/// <summary>
+/// 注册宏：生成的源文件末尾使用，在静态初始化阶段登记生成函数。
+/// </summary>
+#define DLCV_FLOW_REGISTER_GENERATED(STRUCTURE_HASH, RUNNER)                                       \
+    namespace {                                                                                   \
+        struct DLCV_FLOW_CONCAT(DlcvFlowGen_, __LINE__) {                                         \
+            DLCV_FLOW_CONCAT(DlcvFlowGen_, __LINE__)() {                                          \
+                ::dlcv_infer::flow::GeneratedFlowRegistry::Register((STRUCTURE_HASH), (RUNNER));  \
+            }                                                                                     \
+        };                                                                                        \
+        static DLCV_FLOW_CONCAT(DlcvFlowGen_, __LINE__) DLCV_FLOW_CONCAT(g_DlcvFlowGen_, __LINE__); \
+    }
+
+} // namespace flow
+} // namespace dlcv_infer
@@ -1,11 +1,23 @@
 ﻿#include "flow/FlowGraphModel.h"
+#include "flow/ContextKeys.h"
+#include "flow/FlowCodeGen.h"
+#include "flow/FlowParallelFor.h"
 #include "flow/FlowPayloadTypes.h"
+#include "flow/FlowThreadPool.h"
+#include "flow/FlowTuningProfile.h"
 #include "flow/modules/ModelModules.h"
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <cstdio>
+#include <deque>
 #include <fstream>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_map>
 #include <unordered_set>
 
 #if defined(_MSC_VER) && defined(_DEBUG)
@@ -46,15 +58,6 @@ static int ResolvePerImageTargetIndex(const FlowByImageEntry& item, int position
     return position >= 0 ? (position % imageCount) : -1;
 }
 
-static std::string BuildResultSignature(const FlowResultItem& item) {
-    Json j = item.ToJson();
-    try {
-        return j.dump();
-    } catch (...) {
-        return std::string();
-    }
-}
-
 static std::string GetFileNameOnlyLocal(const std::string& path) {
     if (path.empty()) return std::string();
     const size_t pos = path.find_last_of("/\\");
@@ -71,6 +74,26 @@ static std::string ReadStringField(const Json& obj, const char* key) {
     return std::string();
 }
 
+// model/* 节点的模型路径与设备（节点 device_id 属性优先）；非模型节点或缺少 model_path 时返回 false
+static bool ReadModelNodeTarget(const Json& node, int defaultDeviceId, std::string& modelPath, int& deviceId) {
+    modelPath.clear();
+    deviceId = defaultDeviceId;
+    std::string type;
+    try { if (node.contains("type") && node.at("type").is_string()) type = node.at("type"); } catch (...) {}
+    if (type.rfind("model/", 0) != 0) return false;
+
+    try {
+        if (node.contains("properties") && node.at("properties").is_object()) {
+            const auto& props = node.at("properties");
+            if (props.contains("model_path") && props.at("model_path").is_string())
+                modelPath = props.at("model_path");
+            if (props.contains("device_id"))
+                deviceId = props.at("device_id").get<int>();
+        }
+    } catch (...) {}
+    return !modelPath.empty();
+}
+
 static std::string ResolveModelInfoKey(const Json& item) {
     std::string name = ReadStringField(item, "model_name");
     if (name.empty()) name = ReadStringField(item, "model_path_original");
@@ -82,41 +105,47 @@ static std::string ResolveModelInfoKey(const Json& item) {
     return fileName.empty() ? name : fileName;
 }
 
-static void AppendResultsDedup(std::vector<FlowResultItem>& target, const std::vector<FlowResultItem>& source) {
-    if (source.empty()) return;
-    std::unordered_set<std::string> seen;
-    seen.reserve(target.size() + source.size());
-
-    for (const auto& item : target) {
-        const std::string sig = BuildResultSignature(item);
-        if (!sig.empty()) seen.insert(sig);
-    }
-
-    for (const auto& item : source) {
-        const std::string sig = BuildResultSignature(item);
-        if (!sig.empty()) {
-            if (seen.find(sig) != seen.end()) {
-                continue;
+// 单张图的结果去重索引：结构哈希 -> 结果下标，哈希相同时再精确比较；每个结果只计算一次哈希
+class ResultDedupIndex final {
+public:
+    void Append(std::vector<FlowResultItem>& target, std::vector<FlowResultItem>&& source) {
+        if (source.empty()) return;
+        target.reserve(target.size() + source.size());
+        _indices.reserve(target.size() + source.size());
+        for (auto& item : source) {
+            const std::uint64_t hash = item.StructuralHash();
+            bool duplicated = false;
+            auto range = _indices.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (target[it->second].StructurallyEquals(item)) {
+                    duplicated = true;
+                    break;
+                }
             }
-            seen.insert(sig);
+            if (duplicated) continue;
+            _indices.emplace(hash, target.size());
+            target.push_back(std::move(item));
         }
-        target.push_back(item);
     }
-}
+
+private:
+    std::unordered_multimap<std::uint64_t, size_t> _indices;
+};
 
 static std::vector<FlowFrontendByNodePayload> CollectFrontendPayloads(ExecutionContext& ctx) {
     std::vector<FlowFrontendByNodePayload> payloads;
 
-    // 优先原生 payload（由 output/return_json 直接写入）
+    // 优先原生 payload（由 output/return_json 直接写入）；聚合是上下文的最后一步，直接移出避免拷贝
     try {
-        std::vector<FlowFrontendByNodePayload> typed = ctx.Get<std::vector<FlowFrontendByNodePayload>>(
-            "frontend_payloads_by_node", std::vector<FlowFrontendByNodePayload>());
-        if (!typed.empty()) {
-            std::sort(typed.begin(), typed.end(), [](const FlowFrontendByNodePayload& a, const FlowFrontendByNodePayload& b) {
+        std::vector<FlowFrontendByNodePayload>* typed = ctx.Find(ContextKeys::FrontendPayloadsByNode);
+        if (typed != nullptr && !typed->empty()) {
+            payloads = std::move(*typed);
+            typed->clear();
+            std::sort(payloads.begin(), payloads.end(), [](const FlowFrontendByNodePayload& a, const FlowFrontendByNodePayload& b) {
                 if (a.NodeOrder != b.NodeOrder) return a.NodeOrder < b.NodeOrder;
                 return a.FallbackOrder < b.FallbackOrder;
             });
-            return typed;
+            return payloads;
         }
     } catch (...) {}
 
@@ -166,7 +195,7 @@ static std::vector<FlowFrontendByNodePayload> CollectFrontendPayloads(ExecutionC
     } catch (...) {}
 
     try {
-        FlowFrontendPayload lastTyped = ctx.Get<FlowFrontendPayload>("frontend_payload_last", FlowFrontendPayload());
+        FlowFrontendPayload lastTyped = ctx.Get(ContextKeys::FrontendPayloadLast, FlowFrontendPayload());
         if (!lastTyped.ByImage.empty()) {
             FlowFrontendByNodePayload one;
             one.NodeOrder = INT_MAX;
@@ -183,21 +212,42 @@ static FlowBatchResult AggregateFrontendResults(ExecutionContext& ctx, int image
     FlowBatchResult batch;
     if (imageCount <= 0) return batch;
     batch.PerImageResults.assign(static_cast<size_t>(imageCount), std::vector<FlowResultItem>());
+    std::vector<ResultDedupIndex> dedup(static_cast<size_t>(imageCount));
 
-    const std::vector<FlowFrontendByNodePayload> payloads = CollectFrontendPayloads(ctx);
-    for (const auto& payload : payloads) {
-        const auto& byImage = payload.Payload.ByImage;
+    std::vector<FlowFrontendByNodePayload> payloads = CollectFrontendPayloads(ctx);
+    for (auto& payload : payloads) {
+        auto& byImage = payload.Payload.ByImage;
         for (int i = 0; i < static_cast<int>(byImage.size()); i++) {
-            const FlowByImageEntry& item = byImage[static_cast<size_t>(i)];
+            FlowByImageEntry& item = byImage[static_cast<size_t>(i)];
             const int targetIndex = ResolvePerImageTargetIndex(item, i, imageCount);
             if (targetIndex < 0 || targetIndex >= imageCount) continue;
-            AppendResultsDedup(batch.PerImageResults[static_cast<size_t>(targetIndex)], item.Results);
+            dedup[static_cast<size_t>(targetIndex)].Append(
+                batch.PerImageResults[static_cast<size_t>(targetIndex)], std::move(item.Results));
         }
     }
 
     return batch;
 }
 
+// 借出的模块实例集在作用域结束时归还（异常路径同样归还）
+class ModuleInstanceLease final {
+public:
+    explicit ModuleInstanceLease(ModuleInstancePool* pool) : _pool(pool) {
+        if (_pool != nullptr) _set = _pool->Checkout();
+    }
+    ~ModuleInstanceLease() {
+        if (_pool != nullptr) _pool->Return(std::move(_set));
+    }
+    ModuleInstanceLease(const ModuleInstanceLease&) = delete;
+    ModuleInstanceLease& operator=(const ModuleInstanceLease&) = delete;
+
+    ModuleInstanceSet* Get() const { return _set.get(); }
+
+private:
+    ModuleInstancePool* _pool = nullptr;
+    std::unique_ptr<ModuleInstanceSet> _set;
+};
+
 void FlowGraphModel::ReleaseOwnedModelsNoexcept() {
     try {
         for (const auto& key : _acquiredModelKeys) {
@@ -208,8 +258,10 @@ void FlowGraphModel::ReleaseOwnedModelsNoexcept() {
 }
 
 FlowGraphModel::~FlowGraphModel() {
+    _modulePool.reset();
     ReleaseOwnedModelsNoexcept();
     _nodes.clear();
+    _plan.reset();
     _root = Json::object();
     _loadedModelMeta = Json::array();
     _loaded = false;
@@ -220,15 +272,24 @@ FlowGraphModel::~FlowGraphModel() {
 
 FlowGraphModel::FlowGraphModel(FlowGraphModel&& other) noexcept {
     _nodes = std::move(other._nodes);
+    _plan = std::move(other._plan);
     _root = std::move(other._root);
     _loadedModelMeta = std::move(other._loadedModelMeta);
     _loaded = other._loaded;
     _deviceId = other._deviceId;
     _flowJsonPath = std::move(other._flowJsonPath);
     _acquiredModelKeys = std::move(other._acquiredModelKeys);
+    _persistentModules = other._persistentModules;
+    _parallelExecution = other._parallelExecution;
+    _streamInFlightDepth = other._streamInFlightDepth;
+    _modulePool = std::move(other._modulePool);
+    _nodeCache = std::move(other._nodeCache);
+    _tuningProfilePath = std::move(other._tuningProfilePath);
+    _planFromRoot = other._planFromRoot;
 
     // moved-from：不再负责释放
     other._nodes.clear();
+    other._plan.reset();
     other._root = Json::object();
     other._loadedModelMeta = Json::array();
     other._loaded = false;
@@ -240,18 +301,28 @@ FlowGraphModel::FlowGraphModel(FlowGraphModel&& other) noexcept {
 FlowGraphModel& FlowGraphModel::operator=(FlowGraphModel&& other) noexcept {
     if (this == &other) return *this;
 
-    // 先释放当前对象持有的模型引用
+    // 先释放当前对象持有的模块实例与模型引用
+    _modulePool.reset();
     ReleaseOwnedModelsNoexcept();
 
     _nodes = std::move(other._nodes);
+    _plan = std::move(other._plan);
     _root = std::move(other._root);
     _loadedModelMeta = std::move(other._loadedModelMeta);
     _loaded = other._loaded;
     _deviceId = other._deviceId;
     _flowJsonPath = std::move(other._flowJsonPath);
     _acquiredModelKeys = std::move(other._acquiredModelKeys);
+    _persistentModules = other._persistentModules;
+    _parallelExecution = other._parallelExecution;
+    _streamInFlightDepth = other._streamInFlightDepth;
+    _modulePool = std::move(other._modulePool);
+    _nodeCache = std::move(other._nodeCache);
+    _tuningProfilePath = std::move(other._tuningProfilePath);
+    _planFromRoot = other._planFromRoot;
 
     other._nodes.clear();
+    other._plan.reset();
     other._root = Json::object();
     other._loadedModelMeta = Json::array();
     other._loaded = false;
@@ -262,6 +333,41 @@ FlowGraphModel& FlowGraphModel::operator=(FlowGraphModel&& other) noexcept {
     return *this;
 }
 
+void FlowGraphModel::SetPersistentModules(bool enabled) {
+    _persistentModules = enabled;
+    if (!enabled) {
+        _modulePool.reset();
+    } else if (!_modulePool) {
+        _modulePool.reset(new ModuleInstancePool());
+    }
+}
+
+void FlowGraphModel::SetNodeOutputCacheCapacity(size_t capacity) {
+    if (capacity == 0) {
+        _nodeCache.reset();
+    } else if (_nodeCache) {
+        _nodeCache->SetCapacity(capacity);
+    } else {
+        _nodeCache.reset(new FlowNodeCache(capacity));
+    }
+}
+
+FlowNodeCache::Stats FlowGraphModel::GetNodeOutputCacheStats() const {
+    return _nodeCache ? _nodeCache->GetStats() : FlowNodeCache::Stats();
+}
+
+void FlowGraphModel::ClearNodeOutputCache() {
+    if (_nodeCache) _nodeCache->Clear();
+}
+
+void FlowGraphModel::SetDynamicBatching(double maxWaitMs, int maxBatch) {
+    ModelPool::Instance().SetDynamicBatching(maxWaitMs, maxBatch);
+}
+
+void FlowGraphModel::SetIntraNodeParallelism(int maxThreads) {
+    SetFlowParallelThreads(maxThreads);
+}
+
 Json FlowGraphModel::Load(const std::string& flowJsonPath, int deviceId) {
     if (flowJsonPath.empty()) throw std::invalid_argument("flowJsonPath is empty");
     const std::string text = ReadAllTextUtf8(flowJsonPath);
@@ -282,12 +388,28 @@ Json FlowGraphModel::LoadFromRoot(const Json& root, int deviceId) {
     }
     _root = root;
     _deviceId = deviceId;
+    const bool tuned = !_tuningProfilePath.empty() && ApplyTuningProfile(deviceId);
 
-    ExecutionContext ctx;
-    ctx.Set<int>("device_id", deviceId);
-    GraphExecutor exec(_nodes, &ctx);
-    Json report = exec.LoadModels();
-    _loadedModelMeta = ctx.Get<Json>("loaded_model_meta", Json::array());
+    _plan = GraphExecutor::Compile(_nodes);
+    _planFromRoot = !tuned;
+    return LoadCompiled(deviceId);
+}
+
+Json FlowGraphModel::LoadCompiled(int deviceId) {
+    _modulePool.reset(_persistentModules ? new ModuleInstancePool() : nullptr);
+
+    Json report = Json::object();
+    {
+        // 持久实例在实例集自带的长期上下文中构造（加载后仍有效），否则使用临时上下文
+        ExecutionContext localCtx;
+        ModuleInstanceLease lease(_modulePool.get());
+        ExecutionContext& ctx = lease.Get() != nullptr ? lease.Get()->Context : localCtx;
+        ctx.Set(ContextKeys::DeviceId, deviceId);
+        GraphExecutor exec(_plan, &ctx);
+        exec.SetModuleInstances(lease.Get());
+        report = exec.LoadModels();
+        _loadedModelMeta = ctx.Get<Json>("loaded_model_meta", Json::array());
+    }
     if (!_loadedModelMeta.is_array()) {
         _loadedModelMeta = Json::array();
     }
@@ -338,23 +460,9 @@ Json FlowGraphModel::LoadFromRoot(const Json& root, int deviceId) {
     // 收集本流程涉及的所有模型 key，并增加引用
     _acquiredModelKeys.clear();
     for (const auto& n : _nodes) {
-        if (!n.is_object()) continue;
-        std::string type;
-        try { if (n.contains("type") && n.at("type").is_string()) type = n.at("type"); } catch (...) {}
-        if (type.rfind("model/", 0) != 0) continue;
-
         std::string modelPath;
         int nodeDeviceId = deviceId;
-        try {
-            if (n.contains("properties") && n.at("properties").is_object()) {
-                const auto& props = n.at("properties");
-                if (props.contains("model_path") && props.at("model_path").is_string())
-                    modelPath = props.at("model_path");
-                if (props.contains("device_id"))
-                    nodeDeviceId = props.at("device_id").get<int>();
-            }
-        } catch (...) {}
-        if (modelPath.empty()) continue;
+        if (!ReadModelNodeTarget(n, deviceId, modelPath, nodeDeviceId)) continue;
 
         const std::string key = ModelPool::MakeKey(modelPath, nodeDeviceId);
         // 去重：同一流程可能多个节点引用同一模型
@@ -369,6 +477,177 @@ Json FlowGraphModel::LoadFromRoot(const Json& root, int deviceId) {
     return report;
 }
 
+bool FlowGraphModel::ApplyTuningProfile(int deviceId) {
+    FlowTuningProfile profile;
+    if (!profile.Load(_tuningProfilePath) || profile.Empty()) return false;
+
+    // 同一模型被多个节点引用时只计算一次内容哈希
+    std::unordered_map<std::string, std::string> profileKeyByModel;
+    bool applied = false;
+    for (auto& n : _nodes) {
+        std::string modelPath;
+        int nodeDeviceId = deviceId;
+        if (!ReadModelNodeTarget(n, deviceId, modelPath, nodeDeviceId)) continue;
+
+        const std::string modelKey = ModelPool::MakeKey(modelPath, nodeDeviceId);
+        auto it = profileKeyByModel.find(modelKey);
+        if (it == profileKeyByModel.end()) {
+            it = profileKeyByModel.emplace(modelKey, FlowTuningProfile::MakeKey(modelPath, nodeDeviceId)).first;
+        }
+        FlowNodeTuning tuning;
+        if (!profile.Find(it->second, tuning)) continue;
+
+        Json& props = n["properties"];
+        props["batch_size"] = tuning.BatchSize;
+        props["parallel_threads"] = tuning.ParallelThreads;
+        applied = true;
+    }
+    return applied;
+}
+
+void FlowGraphModel::RebuildPlan() {
+    _plan = GraphExecutor::Compile(_nodes);
+    _planFromRoot = false;
+    _modulePool.reset(_persistentModules ? new ModuleInstancePool() : nullptr);
+}
+
+static std::mutex s_snapshotDirMu;
+static std::string s_snapshotDir;
+static const int kFlowSnapshotVersion = 1;
+
+void FlowGraphModel::SetSnapshotDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(s_snapshotDirMu);
+    s_snapshotDir = dir;
+}
+
+std::string FlowGraphModel::GetSnapshotDirectory() {
+    std::lock_guard<std::mutex> lock(s_snapshotDirMu);
+    return s_snapshotDir;
+}
+
+void FlowGraphModel::SaveSnapshot(const std::string& snapshotPath) const {
+    if (!_loaded) throw std::runtime_error("flow graph not loaded");
+    if (snapshotPath.empty()) throw std::invalid_argument("snapshotPath is empty");
+
+    std::vector<Json> rootNodes;
+    for (const auto& n : _root.at("nodes")) {
+        if (n.is_object()) rootNodes.push_back(n);
+    }
+    // 快照保存未经调优覆盖的计划：调优配置在恢复时按当前配置文件重新应用
+    const std::shared_ptr<const CompiledFlowPlan> plan = _planFromRoot ? _plan : GraphExecutor::Compile(rootNodes);
+
+    // 模型信息与设备无关，按模型路径去重；取不到时恢复阶段按原流程查询
+    Json models = Json::array();
+    std::unordered_set<std::string> seen;
+    for (const auto& n : rootNodes) {
+        std::string modelPath;
+        int nodeDeviceId = _deviceId;
+        if (!ReadModelNodeTarget(n, _deviceId, modelPath, nodeDeviceId)) continue;
+        if (!seen.insert(modelPath).second) continue;
+        try {
+            std::shared_ptr<dlcv_infer::Model> model = ModelPool::Instance().Acquire(modelPath, nodeDeviceId);
+            Json item;
+            try {
+                if (model) {
+                    item = Json::object({
+                        {"model_path", modelPath},
+                        {"model_info", model->GetModelInfo()},
+                        {"batch_limit", GetModelBatchLimit(model)}
+                    });
+                }
+            } catch (...) {
+                item = Json();
+            }
+            ModelPool::Instance().Release(modelPath, nodeDeviceId);
+            if (item.is_object()) models.push_back(std::move(item));
+        } catch (...) {}
+    }
+
+    const Json snapshot = Json::object({
+        {"version", kFlowSnapshotVersion},
+        {"root", _root},
+        {"plan", GraphExecutor::SerializePlan(*plan)},
+        {"models", models}
+    });
+    const std::vector<std::uint8_t> bytes = Json::to_msgpack(snapshot);
+
+    const std::string tmpPath = snapshotPath + ".tmp";
+    {
+        std::ofstream ofs(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!ofs) throw std::runtime_error("failed to write flow snapshot: " + tmpPath);
+        ofs.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!ofs) throw std::runtime_error("failed to write flow snapshot: " + tmpPath);
+    }
+    std::remove(snapshotPath.c_str());
+    if (std::rename(tmpPath.c_str(), snapshotPath.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+        throw std::runtime_error("failed to write flow snapshot: " + snapshotPath);
+    }
+}
+
+bool FlowGraphModel::LoadSnapshot(const std::string& snapshotPath, int deviceId, Json& report) {
+    if (snapshotPath.empty()) return false;
+
+    Json root;
+    Json models;
+    std::shared_ptr<const CompiledFlowPlan> plan;
+    try {
+        std::ifstream probe(snapshotPath, std::ios::binary);
+        if (!probe) return false;
+        probe.close();
+        const std::string text = ReadAllTextUtf8(snapshotPath);
+        const Json snapshot = Json::from_msgpack(std::vector<std::uint8_t>(text.begin(), text.end()));
+        if (!snapshot.is_object() || snapshot.value("version", 0) != kFlowSnapshotVersion) return false;
+
+        root = snapshot.at("root");
+        if (!root.is_object() || !root.contains("nodes") || !root.at("nodes").is_array()) return false;
+        plan = GraphExecutor::DeserializePlan(snapshot.at("plan"));
+        models = snapshot.value("models", Json::array());
+
+        // 快照只引用解包目录中的模型文件：目录被清理过则视为未命中
+        for (const auto& n : root.at("nodes")) {
+            std::string modelPath;
+            int nodeDeviceId = deviceId;
+            if (!n.is_object() || !ReadModelNodeTarget(n, deviceId, modelPath, nodeDeviceId)) continue;
+            std::ifstream modelFile(modelPath, std::ios::binary);
+            if (!modelFile) return false;
+        }
+    } catch (...) {
+        return false;
+    }
+
+    _nodes.clear();
+    for (const auto& n : root.at("nodes")) {
+        if (n.is_object()) _nodes.push_back(n);
+    }
+    _root = std::move(root);
+    _deviceId = deviceId;
+    _flowJsonPath.clear();
+    const bool tuned = !_tuningProfilePath.empty() && ApplyTuningProfile(deviceId);
+    _plan = tuned ? GraphExecutor::Compile(_nodes) : plan;
+    _planFromRoot = !tuned;
+
+    std::unordered_map<std::string, const Json*> modelByPath;
+    if (models.is_array()) {
+        for (const auto& m : models) {
+            if (m.is_object()) modelByPath[ReadStringField(m, "model_path")] = &m;
+        }
+    }
+    for (const auto& n : _nodes) {
+        std::string modelPath;
+        int nodeDeviceId = deviceId;
+        if (!ReadModelNodeTarget(n, deviceId, modelPath, nodeDeviceId)) continue;
+        auto it = modelByPath.find(modelPath);
+        if (it == modelByPath.end()) continue;
+        int batchLimit = 0;
+        try { batchLimit = it->second->value("batch_limit", 0); } catch (...) { batchLimit = 0; }
+        ModelPool::Instance().SeedModelInfo(modelPath, nodeDeviceId, it->second->value("model_info", Json()), batchLimit);
+    }
+
+    report = LoadCompiled(deviceId);
+    return true;
+}
+
 Json FlowGraphModel::GetModelInfo() const {
     if (!_loaded) throw std::runtime_error("flow graph not loaded");
     Json root = _root.is_object() ? _root : Json::object();
@@ -392,10 +671,7 @@ Json FlowGraphModel::GetModelInfo() const {
     return root;
 }
 
-Json FlowGraphModel::InferInternal(const std::vector<cv::Mat>& images, const Json& paramsJson) {
-    if (!_loaded) throw std::runtime_error("flow graph not loaded");
-    if (images.empty()) throw std::invalid_argument("images is empty");
-
+static void PrepareInferContext(ExecutionContext& ctx, const std::vector<cv::Mat>& images, int deviceId, const Json& paramsJson) {
     // 入口与 C# 对齐：前端输入语义为 RGB。
     // 调用方负责准备通道顺序；FlowGraph 入口仅透传。
     std::vector<cv::Mat> rgbBatch;
@@ -404,21 +680,17 @@ Json FlowGraphModel::InferInternal(const std::vector<cv::Mat>& images, const Jso
         rgbBatch.push_back(img);
     }
 
-    ExecutionContext ctx;
-    ctx.Set<cv::Mat>("frontend_image_mat", rgbBatch.empty() ? cv::Mat() : rgbBatch[0]); // 兼容旧单图入口
-    ctx.Set<std::vector<cv::Mat>>("frontend_image_mats", rgbBatch);
-    ctx.Set<std::vector<cv::Mat>>("frontend_image_mat_list", rgbBatch);
-    ctx.Set<std::string>("frontend_image_path", std::string());
-    ctx.Set<int>("device_id", _deviceId);
-    ctx.Set<Json>("infer_params", paramsJson.is_object() ? paramsJson : Json::object());
-    ctx.Set<double>("flow_dlcv_infer_ms_acc", 0.0);
-
-    GraphExecutor exec(_nodes, &ctx);
-    const auto runStart = std::chrono::steady_clock::now();
-    (void)exec.Run();
-    const auto runEnd = std::chrono::steady_clock::now();
+    ctx.Set(ContextKeys::FrontendImageMat, rgbBatch.empty() ? cv::Mat() : rgbBatch[0]); // 兼容旧单图入口
+    ctx.Set(ContextKeys::FrontendImageMats, rgbBatch);
+    ctx.Set(ContextKeys::FrontendImageMatList, std::move(rgbBatch));
+    ctx.Set(ContextKeys::FrontendImagePath, std::string());
+    ctx.Set(ContextKeys::DeviceId, deviceId);
+    ctx.Set(ContextKeys::InferParams, paramsJson.is_object() ? paramsJson : Json::object());
+    ctx.Set(ContextKeys::FlowDlcvInferMsAcc, 0.0);
+}
 
-    const FlowBatchResult batch = AggregateFrontendResults(ctx, static_cast<int>(images.size()));
+static Json BuildInferResultJson(const GraphExecutor& exec, ExecutionContext& ctx, int imageCount, double flowInferMs) {
+    const FlowBatchResult batch = AggregateFrontendResults(ctx, imageCount);
     Json root = batch.ToFlowRootJson();
 
     const std::vector<GraphExecutor::UnregisteredNodeInfo> unregistered = exec.GetLastUnregisteredNodes();
@@ -447,7 +719,7 @@ Json FlowGraphModel::InferInternal(const std::vector<cv::Mat>& images, const Jso
 
     const std::vector<GraphExecutor::NodeTiming> nodeTimings = exec.GetLastNodeTimings();
     Json timing = Json::object();
-    timing["flow_infer_ms"] = std::chrono::duration<double, std::milli>(runEnd - runStart).count();
+    timing["flow_infer_ms"] = flowInferMs;
 
     double dlcvInferMs = 0.0;
     Json timingItems = Json::array();
@@ -457,12 +729,15 @@ Json FlowGraphModel::InferInternal(const std::vector<cv::Mat>& images, const Jso
         one["node_type"] = item.NodeType;
         one["node_title"] = item.NodeTitle;
         one["elapsed_ms"] = item.ElapsedMs;
+        if (item.FromCache) one["from_cache"] = true;
+        if (item.Skipped) one["skipped"] = true;
+        if (item.DeduplicatedFrom >= 0) one["deduplicated_from"] = item.DeduplicatedFrom;
         timingItems.push_back(std::move(one));
         if (item.NodeType.rfind("model/", 0) == 0) {
             dlcvInferMs += item.ElapsedMs;
         }
     }
-    const double inferMsAcc = ctx.Get<double>("flow_dlcv_infer_ms_acc", 0.0);
+    const double inferMsAcc = ctx.Get(ContextKeys::FlowDlcvInferMsAcc, 0.0);
     if (inferMsAcc > 0.0) {
         dlcvInferMs = inferMsAcc;
     }
@@ -472,6 +747,202 @@ Json FlowGraphModel::InferInternal(const std::vector<cv::Mat>& images, const Jso
     return root;
 }
 
+Json FlowGraphModel::InferInternal(const std::vector<cv::Mat>& images, const Json& paramsJson) {
+    if (!_loaded) throw std::runtime_error("flow graph not loaded");
+    if (images.empty()) throw std::invalid_argument("images is empty");
+
+    ExecutionContext ctx;
+    PrepareInferContext(ctx, images, _deviceId, paramsJson);
+
+    ModuleInstanceLease lease(_modulePool.get());
+    GraphExecutor exec(_plan, &ctx);
+    exec.SetModuleInstances(lease.Get());
+    exec.SetParallel(_parallelExecution);
+    exec.SetNodeCache(_nodeCache.get());
+    const auto runStart = std::chrono::steady_clock::now();
+    (void)exec.Run();
+    const auto runEnd = std::chrono::steady_clock::now();
+
+    return BuildInferResultJson(exec, ctx, static_cast<int>(images.size()),
+        std::chrono::duration<double, std::milli>(runEnd - runStart).count());
+}
+
+// 流式推理中的一帧：上下文、实例集与执行器随帧在各阶段线程间传递，同一时刻只被一个线程访问
+struct StreamFrame final {
+    ExecutionContext Ctx;
+    std::unique_ptr<ModuleInstanceLease> Lease;
+    std::unique_ptr<GraphExecutor> Exec;
+    std::chrono::steady_clock::time_point Start;
+    std::exception_ptr Error;
+    Json Result;
+};
+
+// 流水线分段在共享线程池上执行：每段一个待处理帧队列，同一时刻至多一个线程池任务处理该段，
+// 段内按帧顺序执行、同一段不并发；处理完的帧转入下一段，末段完成的帧进入完成队列由调用线程取出。
+// 析构时停止派发并等待正在处理的任务退出，未处理的帧在调用线程上释放。
+class StreamPipeline final {
+public:
+    StreamPipeline(const CompiledFlowPlan& plan, FlowThreadPool& pool) : _state(std::make_shared<State>()) {
+        _state->Pool = &pool;
+        _state->Stages = plan.Stages;
+        if (_state->Stages.empty()) _state->Stages.push_back(CompiledFlowPlan::Stage());
+        _state->Pending.resize(_state->Stages.size());
+        _state->Busy.assign(_state->Stages.size(), 0);
+    }
+
+    ~StreamPipeline() {
+        std::vector<std::deque<std::unique_ptr<StreamFrame>>> pending;
+        std::deque<std::unique_ptr<StreamFrame>> done;
+        {
+            std::unique_lock<std::mutex> lk(_state->Mu);
+            _state->Stopped = true;
+            _state->Cv.wait(lk, [this]() { return _state->Active == 0; });
+            pending.swap(_state->Pending);
+            done.swap(_state->Done);
+        }
+    }
+
+    StreamPipeline(const StreamPipeline&) = delete;
+    StreamPipeline& operator=(const StreamPipeline&) = delete;
+
+    void Push(std::unique_ptr<StreamFrame> frame) { Forward(_state, 0, std::move(frame)); }
+
+    // 等待下一帧完成（按输入顺序）
+    std::unique_ptr<StreamFrame> Pop() {
+        std::unique_lock<std::mutex> lk(_state->Mu);
+        _state->Cv.wait(lk, [this]() { return !_state->Done.empty(); });
+        std::unique_ptr<StreamFrame> frame = std::move(_state->Done.front());
+        _state->Done.pop_front();
+        return frame;
+    }
+
+private:
+    // 线程池任务可能在析构等待结束后才释放引用，状态以 shared_ptr 持有
+    struct State final {
+        FlowThreadPool* Pool = nullptr;
+        std::vector<CompiledFlowPlan::Stage> Stages;
+        std::mutex Mu;
+        std::condition_variable Cv;
+        std::vector<std::deque<std::unique_ptr<StreamFrame>>> Pending; // 段下标 -> 待处理帧
+        std::vector<char> Busy;                                        // 段下标 -> 已有任务在处理
+        std::deque<std::unique_ptr<StreamFrame>> Done;
+        size_t Active = 0;
+        bool Stopped = false;
+    };
+    std::shared_ptr<State> _state;
+
+    static void Forward(const std::shared_ptr<State>& state, size_t stageIndex, std::unique_ptr<StreamFrame> frame) {
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lk(state->Mu);
+            if (stageIndex >= state->Stages.size()) {
+                state->Done.push_back(std::move(frame));
+                state->Cv.notify_all();
+                return;
+            }
+            state->Pending[stageIndex].push_back(std::move(frame));
+            if (!state->Busy[stageIndex] && !state->Stopped) {
+                state->Busy[stageIndex] = 1;
+                state->Active++;
+                schedule = true;
+            }
+        }
+        if (schedule) {
+            state->Pool->Submit([state, stageIndex]() { DrainStage(state, stageIndex); });
+        }
+    }
+
+    static void DrainStage(const std::shared_ptr<State>& state, size_t stageIndex) {
+        const CompiledFlowPlan::Stage stage = state->Stages[stageIndex];
+        const bool last = (stageIndex + 1 == state->Stages.size());
+        while (true) {
+            std::unique_ptr<StreamFrame> frame;
+            {
+                std::lock_guard<std::mutex> lk(state->Mu);
+                if (state->Stopped || state->Pending[stageIndex].empty()) {
+                    state->Busy[stageIndex] = 0;
+                    state->Active--;
+                    state->Cv.notify_all();
+                    return;
+                }
+                frame = std::move(state->Pending[stageIndex].front());
+                state->Pending[stageIndex].pop_front();
+            }
+            if (!frame->Error) {
+                try {
+                    frame->Exec->RunRange(static_cast<size_t>(stage.Begin), static_cast<size_t>(stage.End));
+                    if (last) {
+                        (void)frame->Exec->EndRun();
+                        const auto runEnd = std::chrono::steady_clock::now();
+                        frame->Result = BuildInferResultJson(*frame->Exec, frame->Ctx, 1,
+                            std::chrono::duration<double, std::milli>(runEnd - frame->Start).count());
+                    }
+                } catch (...) {
+                    frame->Error = std::current_exception();
+                }
+            }
+            Forward(state, stageIndex + 1, std::move(frame));
+        }
+    }
+};
+
+void FlowGraphModel::InferStream(const std::function<bool(cv::Mat&)>& nextFrame,
+    const std::function<void(const Json&)>& onResult, const Json& paramsJson) {
+    if (!_loaded) throw std::runtime_error("flow graph not loaded");
+    if (!nextFrame) throw std::invalid_argument("nextFrame is empty");
+
+    const size_t depth = static_cast<size_t>(_streamInFlightDepth > 0 ? _streamInFlightDepth : 1);
+    StreamPipeline pipeline(*_plan, FlowThreadPool::Shared());
+
+    // 在途帧数不超过 depth：各段待处理队列的总长度以此为界
+    size_t inFlight = 0;
+    bool sourceDone = false;
+    while (true) {
+        if (!sourceDone && inFlight < depth) {
+            cv::Mat image;
+            if (!nextFrame(image)) {
+                sourceDone = true;
+                continue;
+            }
+            if (image.empty()) throw std::invalid_argument("image is empty");
+
+            std::unique_ptr<StreamFrame> frame(new StreamFrame());
+            PrepareInferContext(frame->Ctx, std::vector<cv::Mat>{ image }, _deviceId, paramsJson);
+            frame->Lease.reset(new ModuleInstanceLease(_modulePool.get()));
+            frame->Exec.reset(new GraphExecutor(_plan, &frame->Ctx));
+            frame->Exec->SetModuleInstances(frame->Lease->Get());
+            frame->Exec->SetParallel(_parallelExecution);
+            frame->Exec->SetNodeCache(_nodeCache.get());
+            frame->Start = std::chrono::steady_clock::now();
+            frame->Exec->BeginRun();
+            pipeline.Push(std::move(frame));
+            inFlight++;
+            continue;
+        }
+        if (inFlight == 0) break;
+
+        std::unique_ptr<StreamFrame> done = pipeline.Pop();
+        inFlight--;
+        if (done->Error) std::rethrow_exception(done->Error);
+        if (onResult) onResult(done->Result);
+    }
+}
+
+std::vector<Json> FlowGraphModel::InferStream(const std::vector<cv::Mat>& images, const Json& paramsJson) {
+    std::vector<Json> results;
+    results.reserve(images.size());
+    size_t next = 0;
+    InferStream(
+        [&images, &next](cv::Mat& out) {
+            if (next >= images.size()) return false;
+            out = images[next++];
+            return true;
+        },
+        [&results](const Json& root) { results.push_back(root); },
+        paramsJson);
+    return results;
+}
+
 Json FlowGraphModel::InferOneOutJson(const cv::Mat& image, const Json& paramsJson) {
     if (image.empty()) throw std::invalid_argument("image is empty");
     Json root = InferInternal(std::vector<cv::Mat>{ image }, paramsJson);
@@ -502,6 +973,270 @@ double FlowGraphModel::Benchmark(const cv::Mat& image, int warmup, int runs) {
     return ms / static_cast<double>(runs);
 }
 
+std::string FlowGraphModel::GenerateSource(const Json& root, const std::string& functionName) {
+    if (!root.is_object() || !root.contains("nodes") || !root.at("nodes").is_array()) {
+        throw std::runtime_error("flow json missing nodes array");
+    }
+    std::vector<Json> nodes;
+    for (const auto& n : root.at("nodes")) {
+        if (n.is_object()) nodes.push_back(n);
+    }
+    return GenerateFlowSource(*GraphExecutor::Compile(nodes), functionName);
+}
+
+Json FlowGraphModel::VerifyGeneratedExecutor(const std::vector<cv::Mat>& images, const Json& paramsJson) {
+    if (!_loaded) throw std::runtime_error("flow graph not loaded");
+    if (images.empty()) throw std::invalid_argument("images is empty");
+
+    char hashHex[17] = { 0 };
+    std::snprintf(hashHex, sizeof(hashHex), "%016llx", static_cast<unsigned long long>(_plan->StructureHash));
+    Json report = Json::object();
+    report["structure_hash"] = std::string(hashHex);
+    if (!HasGeneratedExecutor()) {
+        report["code"] = 1;
+        report["message"] = "no generated executor registered for this flow";
+        return report;
+    }
+
+    // 两次推理只有执行方式不同：顺序执行、不使用节点输出缓存
+    Json results[2];
+    for (int generated = 0; generated < 2; generated++) {
+        ExecutionContext ctx;
+        PrepareInferContext(ctx, images, _deviceId, paramsJson);
+        ModuleInstanceLease lease(_modulePool.get());
+        GraphExecutor exec(_plan, &ctx);
+        exec.SetModuleInstances(lease.Get());
+        exec.SetGeneratedExecution(generated != 0);
+        (void)exec.Run();
+        if (generated != 0 && !exec.LastRunGenerated()) {
+            report["code"] = 1;
+            report["message"] = "generated executor is not applicable to this request (disabled_branches)";
+            return report;
+        }
+        results[generated] = BuildInferResultJson(exec, ctx, static_cast<int>(images.size()), 0.0);
+        results[generated].erase("timing");
+    }
+
+    const bool equal = results[0] == results[1];
+    report["code"] = 0;
+    report["message"] = equal ? "ok" : "generated executor output differs from interpreted execution";
+    report["equal"] = equal;
+    if (!equal) {
+        report["interpreted"] = std::move(results[0]);
+        report["generated"] = std::move(results[1]);
+    }
+    return report;
+}
+
+static int ReadOptionInt(const Json& options, const char* key, int dv) {
+    try {
+        if (options.contains(key) && options.at(key).is_number()) return options.at(key).get<int>();
+    } catch (...) {}
+    return dv;
+}
+
+static double ReadOptionDouble(const Json& options, const char* key, double dv) {
+    try {
+        if (options.contains(key) && options.at(key).is_number()) return options.at(key).get<double>();
+    } catch (...) {}
+    return dv;
+}
+
+static bool ReadOptionBool(const Json& options, const char* key, bool dv) {
+    try {
+        if (options.contains(key) && options.at(key).is_boolean()) return options.at(key).get<bool>();
+    } catch (...) {}
+    return dv;
+}
+
+// 候选值：options[key] 中位于 [1, limit] 的整数（升序去重）；未提供时为 1, 2, 4, ... 直至 limit（含 limit）
+static std::vector<int> ResolveTuneCandidates(const Json& options, const char* key, int limit) {
+    limit = std::max(1, limit);
+    std::vector<int> out;
+    try {
+        if (options.contains(key) && options.at(key).is_array()) {
+            for (const auto& v : options.at(key)) {
+                if (!v.is_number()) continue;
+                const int x = v.get<int>();
+                if (x >= 1 && x <= limit) out.push_back(x);
+            }
+        }
+    } catch (...) {
+        out.clear();
+    }
+    if (out.empty()) {
+        for (int x = 1; x < limit; x *= 2) out.push_back(x);
+        out.push_back(limit);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+// 自动扫描的 batch 上限：超过后单次请求的图像数过多，调优耗时过长；更大的 batch 可通过 batch_sizes 显式给出
+static const int kAutoTuneMaxBatch = 32;
+
+Json FlowGraphModel::AutoTune(const cv::Mat& sampleImage, const Json& options) {
+    if (!_loaded) throw std::runtime_error("flow graph not loaded");
+    if (sampleImage.empty()) throw std::invalid_argument("sample image is empty");
+
+    const Json opts = options.is_object() ? options : Json::object();
+    const int warmup = std::max(0, ReadOptionInt(opts, "warmup", 1));
+    const int runs = std::max(1, ReadOptionInt(opts, "runs", 5));
+    const double tolerance = std::max(0.0, ReadOptionDouble(opts, "tolerance", 0.02));
+    const bool save = ReadOptionBool(opts, "save", true);
+    const Json inferParams = opts.contains("infer_params") ? opts.at("infer_params") : Json();
+    std::string profilePath = ReadStringField(opts, "profile_path");
+    if (profilePath.empty()) profilePath = _tuningProfilePath;
+
+    // 1) 按模型（路径 + 设备）归并 model/* 节点：同一模型的节点共用一组调优结果
+    struct TuneTarget {
+        std::string ModelName;
+        std::string ProfileKey;
+        std::vector<size_t> NodeIndices;
+        int BatchLimit = 1;
+        std::vector<int> BatchCandidates;
+        FlowNodeTuning Best;
+        Json Trials = Json::array();
+    };
+    std::vector<TuneTarget> targets;
+    std::unordered_map<std::string, size_t> targetByModel;
+    for (size_t i = 0; i < _nodes.size(); i++) {
+        std::string modelPath;
+        int nodeDeviceId = _deviceId;
+        if (!ReadModelNodeTarget(_nodes[i], _deviceId, modelPath, nodeDeviceId)) continue;
+
+        const std::string modelKey = ModelPool::MakeKey(modelPath, nodeDeviceId);
+        auto it = targetByModel.find(modelKey);
+        if (it == targetByModel.end()) {
+            TuneTarget t;
+            t.ModelName = ReadStringField(_nodes[i].at("properties"), "model_name");
+            if (t.ModelName.empty()) t.ModelName = GetFileNameOnlyLocal(modelPath);
+            t.ProfileKey = FlowTuningProfile::MakeKey(modelPath, nodeDeviceId);
+            {
+                std::shared_ptr<dlcv_infer::Model> model = ModelPool::Instance().Acquire(modelPath, nodeDeviceId);
+                t.BatchLimit = GetModelBatchLimit(model);
+                ModelPool::Instance().Release(modelPath, nodeDeviceId);
+            }
+            t.BatchCandidates = ResolveTuneCandidates(opts, "batch_sizes",
+                opts.contains("batch_sizes") ? t.BatchLimit : std::min(t.BatchLimit, kAutoTuneMaxBatch));
+            it = targetByModel.emplace(modelKey, targets.size()).first;
+            targets.push_back(std::move(t));
+        }
+        targets[it->second].NodeIndices.push_back(i);
+    }
+
+    Json report = Json::object();
+    report["code"] = 0;
+    report["profile_path"] = profilePath;
+    report["models"] = Json::array();
+    if (targets.empty()) {
+        report["message"] = "no model nodes";
+        report["saved"] = false;
+        return report;
+    }
+
+    const std::vector<int> threadCandidates = ResolveTuneCandidates(opts, "parallel_threads",
+        std::max(1, FlowThreadPool::Shared().WorkerCount()));
+    int maxBatch = 1;
+    for (const auto& t : targets) maxBatch = std::max(maxBatch, t.BatchCandidates.back());
+    const int imagesPerRun = std::max(1, ReadOptionInt(opts, "images", maxBatch));
+    const std::vector<cv::Mat> images(static_cast<size_t>(imagesPerRun), sampleImage);
+
+    auto applyToNodes = [this](const TuneTarget& t, int batchSize, int parallelThreads) {
+        for (size_t idx : t.NodeIndices) {
+            Json& props = _nodes[idx]["properties"];
+            props["batch_size"] = batchSize;
+            props["parallel_threads"] = parallelThreads;
+        }
+    };
+    auto measure = [&](FlowNodeTuning& trial) {
+        RebuildPlan();
+        for (int i = 0; i < warmup; i++) (void)InferInternal(images, inferParams);
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) (void)InferInternal(images, inferParams);
+        const auto t1 = std::chrono::steady_clock::now();
+        trial.LatencyMs = std::chrono::duration<double, std::milli>(t1 - t0).count() / static_cast<double>(runs);
+        trial.ImagesPerSecond = trial.LatencyMs > 0.0 ? imagesPerRun * 1000.0 / trial.LatencyMs : 0.0;
+    };
+    // 候选按升序测量：仅当吞吐提升超过 tolerance 时才更换，吞吐接近时保留较小的 batch/线程数
+    auto consider = [tolerance](TuneTarget& t, const FlowNodeTuning& trial, bool first) {
+        t.Trials.push_back(trial.ToJson());
+        if (first || trial.ImagesPerSecond > t.Best.ImagesPerSecond * (1.0 + tolerance)) t.Best = trial;
+    };
+
+    // 调优期间停用节点输出缓存，避免重复请求命中缓存导致测量失真
+    const std::vector<Json> originalNodes = _nodes;
+    std::unique_ptr<FlowNodeCache> nodeCache = std::move(_nodeCache);
+    try {
+        // 2) 逐个模型：先以当前线程数扫描 batch_size，再以选中的 batch_size 扫描 parallel_threads；
+        //    其余模型保持已选或原始配置
+        for (auto& t : targets) {
+            const Json& firstProps = _nodes[t.NodeIndices.front()].at("properties");
+            const int currentThreads = std::max(0, ReadOptionInt(firstProps, "parallel_threads", 0));
+
+            for (size_t k = 0; k < t.BatchCandidates.size(); k++) {
+                FlowNodeTuning trial;
+                trial.BatchSize = t.BatchCandidates[k];
+                trial.ParallelThreads = currentThreads;
+                applyToNodes(t, trial.BatchSize, trial.ParallelThreads);
+                measure(trial);
+                consider(t, trial, k == 0);
+            }
+            for (int threads : threadCandidates) {
+                if (threads == currentThreads) continue;
+                FlowNodeTuning trial;
+                trial.BatchSize = t.Best.BatchSize;
+                trial.ParallelThreads = threads;
+                applyToNodes(t, trial.BatchSize, trial.ParallelThreads);
+                measure(trial);
+                consider(t, trial, false);
+            }
+            applyToNodes(t, t.Best.BatchSize, t.Best.ParallelThreads);
+        }
+        RebuildPlan();
+    } catch (...) {
+        _nodes = originalNodes;
+        RebuildPlan();
+        _nodeCache = std::move(nodeCache);
+        throw;
+    }
+    _nodeCache = std::move(nodeCache);
+
+    // 3) 合并写入调优配置文件（保留文件中其他模型/设备的记录）
+    FlowTuningProfile profile;
+    (void)profile.Load(profilePath);
+    for (const auto& t : targets) {
+        profile.Put(t.ProfileKey, t.ModelName, t.Best);
+
+        Json one = t.Best.ToJson();
+        one["key"] = t.ProfileKey;
+        one["model_name"] = t.ModelName;
+        one["batch_limit"] = t.BatchLimit;
+        Json nodeIds = Json::array();
+        for (size_t idx : t.NodeIndices) {
+            try { nodeIds.push_back(_nodes[idx].at("id")); } catch (...) {}
+        }
+        one["node_ids"] = std::move(nodeIds);
+        one["trials"] = t.Trials;
+        report["models"].push_back(std::move(one));
+    }
+
+    bool saved = false;
+    std::string message = "ok";
+    if (save && !profilePath.empty()) {
+        try {
+            profile.Save(profilePath);
+            saved = true;
+        } catch (const std::exception& ex) {
+            message = ex.what();
+        }
+    }
+    report["message"] = message;
+    report["saved"] = saved;
+    report["images_per_run"] = imagesPerRun;
+    return report;
+}
+
 } // namespace flow
 } // namespace dlcv_infer
-
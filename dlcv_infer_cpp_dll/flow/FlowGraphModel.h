@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -27,12 +29,93 @@ public:
 
     bool IsLoaded() const { return _loaded; }
 
+    /// <summary>
+    /// 持久模块实例模式（默认开启）：模块在加载时构造一次并跨推理复用，
+    /// 每次推理前由 BaseModule::ResetForRun 清理逐帧状态。关闭后每次推理重新构造全部模块。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API void SetPersistentModules(bool enabled);
+    bool IsPersistentModules() const { return _persistentModules; }
+
+    /// <summary>
+    /// 并行执行模式（默认关闭）：互不依赖的分支在共享线程池上并发执行，
+    /// 整体耗时接近关键路径；结果与顺序执行一致。
+    /// </summary>
+    void SetParallelExecution(bool enabled) { _parallelExecution = enabled; }
+    bool IsParallelExecution() const { return _parallelExecution; }
+
+    /// <summary>
+    /// 节点输出缓存（默认关闭，capacity 为条目数，0 关闭）：输入内容、生效属性与模型均未变化的节点
+    /// 直接复用上次输出，调整后处理参数或 infer_params 后只重新执行受影响节点及其下游。
+    /// 缓存按内容寻址，重新 Load 流程后仍可复用。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API void SetNodeOutputCacheCapacity(size_t capacity);
+    size_t GetNodeOutputCacheCapacity() const { return _nodeCache ? _nodeCache->GetStats().Capacity : 0; }
+    DLCV_INFER_CPP_DLL_API FlowNodeCache::Stats GetNodeOutputCacheStats() const;
+    DLCV_INFER_CPP_DLL_API void ClearNodeOutputCache();
+
+    /// <summary>
+    /// 跨请求动态合批（进程级，默认关闭）：多个线程并发推理共享同一模型时，同尺寸、同参数的模型节点请求
+    /// 最多等待 maxWaitMs 合并为一次 InferBatch；maxBatch 为合并上限（<= 0 时取节点生效的 batch_size）。
+    /// maxWaitMs <= 0 关闭。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API static void SetDynamicBatching(double maxWaitMs, int maxBatch = 0);
+
+    /// <summary>
+    /// 节点内数据并行的全局线程预算（进程级）：逐条目/逐检测处理的模块（mask_to_rbox、result_filter_region、
+    /// image_generation、visualize、sliding_window 与模型结果转换）把独立的条目分到共享线程池。
+    /// 0 使用线程池全部线程（默认），1 关闭；节点属性 parallel_threads 优先。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API static void SetIntraNodeParallelism(int maxThreads);
+
+    /// <summary>
+    /// 调优配置文件路径（默认为空，不读取）：Load 时按“模型内容哈希@设备”查找每个 model/* 节点的调优结果，
+    /// 命中则覆盖节点的 batch_size 与 parallel_threads。须在 Load 之前设置；Model 加载流程归档时自动设为 <归档>.tune.json。
+    /// </summary>
+    void SetTuningProfilePath(const std::string& path) { _tuningProfilePath = path; }
+    const std::string& GetTuningProfilePath() const { return _tuningProfilePath; }
+
+    /// <summary>
+    /// 自动调优（需显式调用）：每次请求为 sampleImage 的 images 份拷贝，逐个模型扫描 batch_size 与 parallel_threads，
+    /// 测量平均延迟与吞吐，取吞吐最高者（提升不超过 tolerance 时保留较小值），应用到当前流程并写入调优配置文件。
+    /// options 均可选：batch_sizes、parallel_threads（候选数组）、images（默认取最大候选 batch）、warmup（默认 1）、
+    /// runs（默认 5）、tolerance（默认 0.02）、infer_params、profile_path（默认 GetTuningProfilePath()）、save（默认 true）。
+    /// 返回：{code,message,profile_path,saved,images_per_run,models:[{key,model_name,node_ids,batch_limit,batch_size,
+    /// parallel_threads,latency_ms,images_per_second,trials:[...]}]}
+    /// 调优期间改写节点属性并重建执行计划，不能与本对象的任何推理并发，由调用方保证（Model::AutoTune 会检查并拒绝）。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API Json AutoTune(const cv::Mat& sampleImage, const Json& options = Json());
+
     /// <summary>
     /// 从流程 JSON 文件加载流程图并预加载模型（model/*）。
     /// 返回：{code,message,models:[...]}（与 C# GraphExecutor.LoadModels 对齐）
     /// </summary>
     DLCV_INFER_CPP_DLL_API Json Load(const std::string& flowJsonPath, int deviceId = 0);
 
+    /// <summary>
+    /// 从已解析的流程 JSON 根对象加载（不经过文件），返回与 Load 相同。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API Json LoadFromRoot(const Json& root, int deviceId = 0);
+
+    /// <summary>
+    /// 流程快照目录（进程级，默认为空即关闭）：Model 加载流程归档时按归档标识（路径、大小、修改时间）在该目录查找快照，
+    /// 命中则跳过解包、解析与编译；未命中时把归档解包到该目录下按标识命名的固定子目录（已存在则复用）并在加载成功后写入快照。建议使用 ASCII 路径。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API static void SetSnapshotDirectory(const std::string& dir);
+    DLCV_INFER_CPP_DLL_API static std::string GetSnapshotDirectory();
+
+    /// <summary>
+    /// 从快照文件恢复：流程根对象、已编译的执行计划（不含调优覆盖）与各模型的模型信息/最大 batch，
+    /// 之后与 Load 一样预加载模型（模型信息直接预置，不再逐个查询）。
+    /// 快照不存在、版本不符、内容损坏或引用的模型文件缺失时返回 false 且不改变当前状态；否则返回 true，report 为加载报告。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API bool LoadSnapshot(const std::string& snapshotPath, int deviceId, Json& report);
+
+    /// <summary>
+    /// 把当前流程写为二进制快照（MessagePack，先写临时文件再替换）。快照中的模型路径为绝对路径，
+    /// 模型文件须在快照生命周期内保留。失败时抛出异常。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API void SaveSnapshot(const std::string& snapshotPath) const;
+
     /// <summary>
     /// 获取加载时保存的流程 JSON 根对象
     /// </summary>
@@ -54,22 +137,71 @@ public:
     /// </summary>
     DLCV_INFER_CPP_DLL_API Json InferInternal(const std::vector<cv::Mat>& images, const Json& paramsJson = Json());
 
+    /// <summary>
+    /// 流式推理的在途帧深度（默认 3）：同时处于流水线中的最大帧数，也是各阶段之间队列的容量。
+    /// 每个在途帧占用一套模块实例，内存随深度线性增长。
+    /// </summary>
+    void SetStreamInFlightDepth(int depth) { _streamInFlightDepth = depth > 0 ? depth : 1; }
+    int GetStreamInFlightDepth() const { return _streamInFlightDepth; }
+
+    /// <summary>
+    /// 流式推理（相机流）：按执行计划的分段（连续 model/* 节点与其余节点交替）建立流水线，
+    /// 各段在共享线程池上按帧顺序串行执行（同一段不并发、不新建线程），下一帧的输入/预处理与当前帧的
+    /// 模型推理、后处理重叠执行；SetParallelExecution(true) 时段内节点按依赖关系并发执行。
+    /// nextFrame 依次提供单帧图像，返回 false 表示结束；每帧结果与 InferInternal 单图格式一致，
+    /// 按输入顺序通过 onResult 回调。两个回调均在调用线程执行；任一帧出错时停止流水线并抛出异常。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API void InferStream(const std::function<bool(cv::Mat&)>& nextFrame,
+        const std::function<void(const Json&)>& onResult, const Json& paramsJson = Json());
+
+    /// <summary>
+    /// 流式推理（帧序列）：返回与 images 一一对应的结果数组。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API std::vector<Json> InferStream(const std::vector<cv::Mat>& images, const Json& paramsJson = Json());
+
     /// <summary>
     /// 性能测试：返回平均耗时(ms)
     /// </summary>
     DLCV_INFER_CPP_DLL_API double Benchmark(const cv::Mat& image, int warmup = 1, int runs = 10);
 
+    /// <summary>
+    /// 预生成执行代码：编译流程根对象（pipeline.json 内容）并生成专用于该流程结构的 C++ 源文件内容（见 flow/FlowCodeGen.h）。
+    /// 生成的文件编入本 DLL 或宿主程序后，加载结构相同的流程时推理自动改用生成代码（顺序执行、未启用节点输出缓存时）。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API static std::string GenerateSource(const Json& root, const std::string& functionName = std::string());
+
+    /// <summary>
+    /// 当前流程是否已注册预生成执行代码
+    /// </summary>
+    bool HasGeneratedExecutor() const { return _plan && _plan->Generated != nullptr; }
+
+    /// <summary>
+    /// 预生成执行代码校验：同一输入分别以通用执行与生成代码各推理一次（顺序执行、不使用节点输出缓存），比较去掉 timing 后的结果。
+    /// 返回：{code,message,structure_hash,equal}；未注册生成代码时 code 为 1。结果不一致时附带 interpreted 与 generated 两份结果。
+    /// </summary>
+    DLCV_INFER_CPP_DLL_API Json VerifyGeneratedExecutor(const std::vector<cv::Mat>& images, const Json& paramsJson = Json());
+
 private:
     std::vector<Json> _nodes;
+    std::shared_ptr<const CompiledFlowPlan> _plan; // 加载时编译，推理时复用
     Json _root = Json::object();
     Json _loadedModelMeta = Json::array();
     bool _loaded = false;
     int _deviceId = 0;
     std::string _flowJsonPath;
     std::vector<std::string> _acquiredModelKeys;
+    bool _persistentModules = true;
+    bool _parallelExecution = false;
+    int _streamInFlightDepth = 3;
+    std::unique_ptr<ModuleInstancePool> _modulePool;
+    std::unique_ptr<FlowNodeCache> _nodeCache;
+    std::string _tuningProfilePath;
+    bool _planFromRoot = false; // _plan 由 _root 中的节点原样编译（未经调优覆盖），可直接写入快照
 
     void ReleaseOwnedModelsNoexcept();
-    Json LoadFromRoot(const Json& root, int deviceId);
+    bool ApplyTuningProfile(int deviceId);
+    void RebuildPlan();
+    Json LoadCompiled(int deviceId);
 };
 
 } // namespace flow
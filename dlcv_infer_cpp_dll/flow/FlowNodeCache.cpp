@@ -0,0 +1,127 @@
+﻿#include "flow/FlowNodeCache.h"
+#include "flow/DetectionBatch.h"
+#include "flow/FlowPayloadTypes.h"
+
+#include <cstring>
+
+namespace dlcv_infer {
+namespace flow {
+
+std::shared_ptr<const FlowNodeCacheEntry> FlowNodeCache::Find(std::uint64_t key) {
+    std::lock_guard<std::mutex> lk(_mu);
+    auto it = _index.find(key);
+    if (it == _index.end()) {
+        _misses++;
+        return nullptr;
+    }
+    _hits++;
+    _lru.splice(_lru.begin(), _lru, it->second);
+    return it->second->second;
+}
+
+void FlowNodeCache::Put(std::uint64_t key, std::shared_ptr<const FlowNodeCacheEntry> entry) {
+    if (!entry) return;
+    std::lock_guard<std::mutex> lk(_mu);
+    if (_capacity == 0) return;
+    auto it = _index.find(key);
+    if (it != _index.end()) {
+        it->second->second = std::move(entry);
+        _lru.splice(_lru.begin(), _lru, it->second);
+        return;
+    }
+    _lru.emplace_front(key, std::move(entry));
+    _index[key] = _lru.begin();
+    EvictLocked();
+}
+
+void FlowNodeCache::SetCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> lk(_mu);
+    _capacity = capacity;
+    EvictLocked();
+}
+
+void FlowNodeCache::Clear() {
+    LruList dropped;
+    {
+        std::lock_guard<std::mutex> lk(_mu);
+        dropped.swap(_lru);
+        _index.clear();
+        _hits = 0;
+        _misses = 0;
+    }
+}
+
+FlowNodeCache::Stats FlowNodeCache::GetStats() const {
+    std::lock_guard<std::mutex> lk(_mu);
+    Stats s;
+    s.Hits = _hits;
+    s.Misses = _misses;
+    s.Entries = _index.size();
+    s.Capacity = _capacity;
+    return s;
+}
+
+void FlowNodeCache::EvictLocked() {
+    while (_index.size() > _capacity && !_lru.empty()) {
+        _index.erase(_lru.back().first);
+        _lru.pop_back();
+    }
+}
+
+std::uint64_t FlowHashBuffer(std::uint64_t h, const void* data, size_t size) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    // 4 路独立累加，避免逐字节 FNV 的串行依赖；尾部不足 8 字节的部分补零
+    std::uint64_t acc[4] = { h, h ^ 0x9E3779B97F4A7C15ULL, h ^ 0xC2B2AE3D27D4EB4FULL, h ^ 0x165667B19E3779F9ULL };
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int k = 0; k < 4; k++) {
+            std::uint64_t w = 0;
+            std::memcpy(&w, p + i + k * 8, 8);
+            acc[k] = (acc[k] ^ w) * 0x9FB21C651E98DF25ULL;
+            acc[k] ^= acc[k] >> 29;
+        }
+    }
+    for (; i < size; i += 8) {
+        std::uint64_t w = 0;
+        std::memcpy(&w, p + i, size - i < 8 ? size - i : 8);
+        acc[0] = (acc[0] ^ w) * 0x9FB21C651E98DF25ULL;
+        acc[0] ^= acc[0] >> 29;
+    }
+    for (int k = 0; k < 4; k++) h = FlowHashMix(h, acc[k]);
+    return FlowHashMix(h, size);
+}
+
+std::uint64_t FlowHashMat(std::uint64_t h, const cv::Mat& mat) {
+    h = FlowHashMix(h, static_cast<std::uint64_t>(static_cast<std::uint32_t>(mat.rows)));
+    h = FlowHashMix(h, static_cast<std::uint64_t>(static_cast<std::uint32_t>(mat.cols)));
+    h = FlowHashMix(h, static_cast<std::uint64_t>(static_cast<std::uint32_t>(mat.type())));
+    if (mat.empty() || mat.dims > 2) return h;
+
+    const size_t rowBytes = static_cast<size_t>(mat.cols) * mat.elemSize();
+    const int rows = mat.isContinuous() ? 1 : mat.rows;
+    const size_t spanBytes = mat.isContinuous() ? rowBytes * static_cast<size_t>(mat.rows) : rowBytes;
+    for (int r = 0; r < rows; r++) {
+        h = FlowHashBuffer(h, mat.ptr<unsigned char>(r), spanBytes);
+    }
+    return h;
+}
+
+std::uint64_t FlowHashChannel(std::uint64_t h, const SharedChannel& channel) {
+    const std::vector<ModuleImage>& images = channel.Images();
+    h = FlowHashMix(h, images.size());
+    for (const auto& im : images) {
+        h = FlowHashMat(h, im.ImageObject);
+        // 原图通常与当前图共享数据，仅在不同时额外哈希
+        if (im.OriginalImage.data != im.ImageObject.data) h = FlowHashMat(h, im.OriginalImage);
+        h = FlowHashMix(h, im.TransformState.TransformId);
+        h = FlowHashMix(h, static_cast<std::uint64_t>(static_cast<std::int64_t>(im.OriginalIndex)));
+        h = FlowHashBytes(h, im.UniqueId.data(), im.UniqueId.size());
+    }
+    h = FlowHashJson(h, channel.Results());
+    h = FlowHashJson(h, channel.Templates());
+    if (channel.Detections) h = FlowHashJson(FlowHashMix(h, 1), channel.Detections->ToResultList());
+    return h;
+}
+
+} // namespace flow
+} // namespace dlcv_infer
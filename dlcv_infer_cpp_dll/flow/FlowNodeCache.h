@@ -0,0 +1,91 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "flow/FlowTypes.h"
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 节点输出缓存条目：一个节点的全部输出通道（主对+额外对）与标量输出。
+/// 条目与节点输出共享同一份只读数据，存取均不复制；下游需可写时写时复制。
+/// </summary>
+struct FlowNodeCacheEntry final {
+    SharedChannel Main;
+    std::vector<SharedChannel> Extra;
+    std::map<int, Json> ScalarsByIndex;
+};
+
+/// <summary>
+/// 节点输出缓存：键为 GraphExecutor 计算的节点指纹（输入血缘 + 生效属性 + 模型标识），
+/// 按条目数做 LRU 淘汰。线程安全，可在多次推理、并发推理与流程重新加载之间共享。
+/// </summary>
+class FlowNodeCache final {
+public:
+    struct Stats final {
+        std::uint64_t Hits = 0;
+        std::uint64_t Misses = 0;
+        size_t Entries = 0;
+        size_t Capacity = 0;
+    };
+
+    explicit FlowNodeCache(size_t capacity) : _capacity(capacity) {}
+
+    /// <summary>
+    /// 查找并刷新 LRU 位置；未命中返回空指针。命中/未命中计入统计。
+    /// </summary>
+    std::shared_ptr<const FlowNodeCacheEntry> Find(std::uint64_t key);
+
+    /// <summary>
+    /// 写入（同键覆盖），超出容量时淘汰最久未使用的条目。
+    /// </summary>
+    void Put(std::uint64_t key, std::shared_ptr<const FlowNodeCacheEntry> entry);
+
+    /// <summary>
+    /// 调整容量（条目数）；缩小时立即淘汰多余条目。
+    /// </summary>
+    void SetCapacity(size_t capacity);
+
+    void Clear();
+    Stats GetStats() const;
+
+private:
+    using LruList = std::list<std::pair<std::uint64_t, std::shared_ptr<const FlowNodeCacheEntry>>>;
+
+    void EvictLocked();
+
+    mutable std::mutex _mu;
+    size_t _capacity = 0;
+    LruList _lru; // 头部为最近使用
+    std::unordered_map<std::uint64_t, LruList::iterator> _index;
+    std::uint64_t _hits = 0;
+    std::uint64_t _misses = 0;
+};
+
+/// <summary>
+/// 字节内容哈希（按 8 字节分块、4 路累加），用于图像内容与文件内容。
+/// </summary>
+std::uint64_t FlowHashBuffer(std::uint64_t h, const void* data, size_t size);
+
+/// <summary>
+/// 图像内容哈希：尺寸、类型与全部像素（按行，按 8 字节分块混合）。
+/// </summary>
+std::uint64_t FlowHashMat(std::uint64_t h, const cv::Mat& mat);
+
+/// <summary>
+/// 通道内容哈希：图像（内容、变换状态、原图索引）、结果、模板与列式结果。
+/// 用于输出依赖外部状态的节点：以其实际输出作为下游缓存指纹的来源。
+/// </summary>
+std::uint64_t FlowHashChannel(std::uint64_t h, const SharedChannel& channel);
+
+} // namespace flow
+} // namespace dlcv_infer
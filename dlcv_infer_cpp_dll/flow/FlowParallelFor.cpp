@@ -0,0 +1,105 @@
+﻿#include "flow/FlowParallelFor.h"
+
+#include "flow/FlowThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#pragma optimize("gt", on)
+#endif
+
+namespace dlcv_infer {
+namespace flow {
+
+static std::atomic<int> s_parallelThreads{0};
+
+void SetFlowParallelThreads(int maxThreads) {
+    s_parallelThreads.store(maxThreads > 0 ? maxThreads : 0);
+}
+
+int GetFlowParallelThreads() {
+    return s_parallelThreads.load();
+}
+
+namespace {
+
+// 一次 FlowParallelFor 的共享状态：辅助任务可能在调用返回后才被线程池取出，
+// 因此状态以 shared_ptr 持有；下标领取完毕后不再访问 body。
+struct ParallelForState final {
+    const std::function<void(std::size_t)>* Body = nullptr;
+    std::size_t Count = 0;
+    std::size_t Grain = 1;
+    std::atomic<std::size_t> Next{0};
+    std::atomic<bool> Failed{false};
+
+    std::mutex Mu;
+    std::condition_variable Cv;
+    std::size_t Done = 0;
+    std::exception_ptr Error;
+
+    // 循环领取下标块直至领完；返回后本线程不再访问 Body
+    void Drain() {
+        while (true) {
+            const std::size_t begin = Next.fetch_add(Grain);
+            if (begin >= Count) return;
+            const std::size_t end = std::min(Count, begin + Grain);
+            if (!Failed.load()) {
+                try {
+                    for (std::size_t i = begin; i < end; i++) (*Body)(i);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lk(Mu);
+                    if (!Error) Error = std::current_exception();
+                    Failed.store(true);
+                }
+            }
+            std::lock_guard<std::mutex> lk(Mu);
+            Done += end - begin;
+            if (Done >= Count) Cv.notify_all();
+        }
+    }
+};
+
+} // namespace
+
+void FlowParallelFor(std::size_t count, int maxThreads, std::size_t minGrain,
+                     const std::function<void(std::size_t)>& body) {
+    if (count == 0) return;
+    if (minGrain == 0) minGrain = 1;
+
+    FlowThreadPool& pool = FlowThreadPool::Shared();
+    int budget = maxThreads > 0 ? maxThreads : GetFlowParallelThreads();
+    if (budget <= 0) budget = pool.WorkerCount();
+    const std::size_t chunks = (count + minGrain - 1) / minGrain;
+    const std::size_t threads = std::min(static_cast<std::size_t>(budget), chunks);
+    if (threads <= 1) {
+        for (std::size_t i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    // 每个参与线程约领取 4 块，兼顾负载均衡与领取开销
+    auto state = std::make_shared<ParallelForState>();
+    state->Body = &body;
+    state->Count = count;
+    state->Grain = std::max(minGrain, count / (threads * 4));
+
+    for (std::size_t t = 1; t < threads; t++) {
+        pool.Submit([state]() { state->Drain(); });
+    }
+    state->Drain();
+
+    // 下标已全部领取：剩余的块都在其他线程上执行中，直接等待即可（不代跑线程池中无关的任务）
+    {
+        std::unique_lock<std::mutex> lk(state->Mu);
+        state->Cv.wait(lk, [&state, count]() { return state->Done >= count; });
+    }
+
+    if (state->Error) std::rethrow_exception(state->Error);
+}
+
+} // namespace flow
+} // namespace dlcv_infer
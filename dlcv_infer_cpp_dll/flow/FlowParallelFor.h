@@ -0,0 +1,27 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 节点内数据并行：在 FlowThreadPool::Shared() 上执行 body(0) ... body(count - 1)。
+/// - maxThreads 为本次最多参与的线程数（含调用线程）；<= 0 时取全局预算 GetFlowParallelThreads()；
+/// - 每个任务至少处理 minGrain 个下标，总量不足两个任务或预算为 1 时在调用线程串行执行；
+/// - 调用线程参与执行并在等待期间协助执行线程池任务，可在工作线程内（并行执行的节点中）调用；
+/// - body 按下标写入预先分配好的输出槽位，由调用方按下标顺序汇总，输出与串行执行一致；
+/// - body 抛出异常时不再开始新的下标，全部已开始的下标结束后在调用线程重新抛出第一个异常。
+/// </summary>
+void FlowParallelFor(std::size_t count, int maxThreads, std::size_t minGrain,
+                     const std::function<void(std::size_t)>& body);
+
+/// <summary>
+/// 节点内并行的全局线程预算（进程级）：0 表示使用共享线程池的全部线程（默认），1 表示关闭节点内并行。
+/// </summary>
+void SetFlowParallelThreads(int maxThreads);
+int GetFlowParallelThreads();
+
+} // namespace flow
+} // namespace dlcv_infer
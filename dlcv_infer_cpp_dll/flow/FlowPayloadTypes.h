@@ -1,6 +1,9 @@
 #pragma once
 
 #include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -9,6 +12,117 @@
 namespace dlcv_infer {
 namespace flow {
 
+inline std::uint64_t FlowHashBytes(std::uint64_t h, const char* data, size_t size) {
+    std::uint64_t x = 1469598103934665603ULL; // FNV-1a
+    for (size_t i = 0; i < size; i++) {
+        x ^= static_cast<unsigned char>(data[i]);
+        x *= 1099511628211ULL;
+    }
+    return FlowHashMix(h, x ^ size);
+}
+
+// 非有限值序列化为 null，与 null 同哈希；-0.0 与 0.0 序列化不同，但哈希可以相同（由相等比较区分）
+inline std::uint64_t FlowHashDouble(std::uint64_t h, double d) {
+    if (!std::isfinite(d)) return FlowHashMix(h, 1);
+    if (d == 0.0) d = 0.0;
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return FlowHashMix(h, bits);
+}
+
+/// <summary>
+/// 两个浮点数的 Json::dump() 文本是否相同：有限值按位比较（最短往返表示一一对应），非有限值都输出为 null。
+/// </summary>
+inline bool FlowSameDumpedDouble(double a, double b) {
+    const bool finiteA = std::isfinite(a);
+    const bool finiteB = std::isfinite(b);
+    if (!finiteA || !finiteB) return !finiteA && !finiteB;
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+/// <summary>
+/// JSON 结构哈希：与 FlowJsonSameDump 一致（整数与浮点分开，1 与 1.0 不同；对象按键有序遍历），
+/// 不做字符串序列化。
+/// </summary>
+inline std::uint64_t FlowHashJson(std::uint64_t h, const Json& v) {
+    switch (v.type()) {
+    case Json::value_t::null:
+        return FlowHashMix(h, 1);
+    case Json::value_t::boolean:
+        return FlowHashMix(h, v.get<bool>() ? 3 : 2);
+    case Json::value_t::number_integer:
+        return FlowHashMix(FlowHashMix(h, 4), static_cast<std::uint64_t>(v.get<std::int64_t>()));
+    case Json::value_t::number_unsigned:
+        return FlowHashMix(FlowHashMix(h, 4), v.get<std::uint64_t>());
+    case Json::value_t::number_float: {
+        const double d = v.get<double>();
+        if (!std::isfinite(d)) return FlowHashMix(h, 1);
+        return FlowHashDouble(FlowHashMix(h, 9), d);
+    }
+    case Json::value_t::string: {
+        const std::string& str = v.get_ref<const std::string&>();
+        return FlowHashBytes(FlowHashMix(h, 5), str.data(), str.size());
+    }
+    case Json::value_t::array: {
+        h = FlowHashMix(h, 6);
+        for (const auto& item : v) h = FlowHashJson(h, item);
+        return FlowHashMix(h, v.size());
+    }
+    case Json::value_t::object: {
+        h = FlowHashMix(h, 7);
+        for (auto it = v.begin(); it != v.end(); ++it) {
+            h = FlowHashBytes(h, it.key().data(), it.key().size());
+            h = FlowHashJson(h, it.value());
+        }
+        return FlowHashMix(h, v.size());
+    }
+    default:
+        return FlowHashMix(h, 8);
+    }
+}
+
+/// <summary>
+/// 按 Json::dump() 文本判等，但不做序列化：整数与浮点不相等（1 与 1.0 不同），有符号与无符号整数按值比较，
+/// 浮点见 FlowSameDumpedDouble（非有限浮点与 null 相等）。
+/// </summary>
+inline bool FlowJsonSameDump(const Json& a, const Json& b) {
+    const auto isNullLike = [](const Json& v) {
+        return v.is_null() || (v.is_number_float() && !std::isfinite(v.get<double>()));
+    };
+    if (isNullLike(a) || isNullLike(b)) return isNullLike(a) && isNullLike(b);
+    if (a.is_number_integer() && b.is_number_integer()) {
+        const bool unsignedA = a.is_number_unsigned();
+        const bool unsignedB = b.is_number_unsigned();
+        if (unsignedA == unsignedB) return a == b;
+        const Json& s = unsignedA ? b : a;
+        const Json& u = unsignedA ? a : b;
+        const std::int64_t sv = s.get<std::int64_t>();
+        return sv >= 0 && static_cast<std::uint64_t>(sv) == u.get<std::uint64_t>();
+    }
+    if (a.type() != b.type()) return false;
+    switch (a.type()) {
+    case Json::value_t::number_float:
+        return FlowSameDumpedDouble(a.get<double>(), b.get<double>());
+    case Json::value_t::array: {
+        if (a.size() != b.size()) return false;
+        for (size_t i = 0; i < a.size(); i++) {
+            if (!FlowJsonSameDump(a[i], b[i])) return false;
+        }
+        return true;
+    }
+    case Json::value_t::object: {
+        if (a.size() != b.size()) return false;
+        auto ib = b.begin();
+        for (auto ia = a.begin(); ia != a.end(); ++ia, ++ib) {
+            if (ia.key() != ib.key() || !FlowJsonSameDump(ia.value(), ib.value())) return false;
+        }
+        return true;
+    }
+    default:
+        return a == b;
+    }
+}
+
 struct FlowResultItem final {
     int CategoryId = 0;
     std::string CategoryName;
@@ -75,6 +189,46 @@ struct FlowResultItem final {
         }
         return out;
     }
+
+    /// <summary>
+    /// 结构哈希：覆盖 ToJson 会输出的全部字段（类别、分数、bbox、metadata、mask_rle、poly、扩展字段），
+    /// 用于结果去重；哈希相同时再用 StructurallyEquals 精确比较。
+    /// </summary>
+    std::uint64_t StructuralHash() const {
+        std::uint64_t h = FlowHashMix(0, static_cast<std::uint64_t>(static_cast<std::int64_t>(CategoryId)));
+        h = FlowHashBytes(h, CategoryName.data(), CategoryName.size());
+        h = FlowHashDouble(h, Score);
+        h = FlowHashJson(h, Bbox.is_array() ? Bbox : NullJson());
+        h = FlowHashJson(h, HasContent(Metadata) ? Metadata : NullJson());
+        h = FlowHashJson(h, HasContent(MaskRle) ? MaskRle : NullJson());
+        h = FlowHashJson(h, Poly.is_array() && !Poly.empty() ? Poly : NullJson());
+        h = FlowHashJson(h, Extra.is_object() ? Extra : NullJson());
+        return h;
+    }
+
+    /// <summary>
+    /// 与比较 ToJson().dump() 等价（数值按序列化文本比较，1 与 1.0 不同）。
+    /// </summary>
+    bool StructurallyEquals(const FlowResultItem& other) const {
+        if (CategoryId != other.CategoryId || !FlowSameDumpedDouble(Score, other.Score) || CategoryName != other.CategoryName) return false;
+        if (Bbox.is_array() != other.Bbox.is_array() || (Bbox.is_array() && !FlowJsonSameDump(Bbox, other.Bbox))) return false;
+        if (HasContent(Metadata) != HasContent(other.Metadata) || (HasContent(Metadata) && !FlowJsonSameDump(Metadata, other.Metadata))) return false;
+        if (HasContent(MaskRle) != HasContent(other.MaskRle) || (HasContent(MaskRle) && !FlowJsonSameDump(MaskRle, other.MaskRle))) return false;
+        const bool polyA = Poly.is_array() && !Poly.empty();
+        const bool polyB = other.Poly.is_array() && !other.Poly.empty();
+        if (polyA != polyB || (polyA && !FlowJsonSameDump(Poly, other.Poly))) return false;
+        const bool extraA = Extra.is_object();
+        const bool extraB = other.Extra.is_object();
+        if (extraA != extraB || (extraA && !FlowJsonSameDump(Extra, other.Extra))) return false;
+        return true;
+    }
+
+private:
+    static bool HasContent(const Json& obj) { return obj.is_object() && !obj.empty(); }
+    static const Json& NullJson() {
+        static const Json nullValue;
+        return nullValue;
+    }
 };
 
 inline Json FlowResultItemsToJsonArray(const std::vector<FlowResultItem>& items) {
@@ -0,0 +1,131 @@
+﻿#include "flow/FlowThreadPool.h"
+
+#include <algorithm>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#pragma optimize("gt", on)
+#endif
+
+namespace dlcv_infer {
+namespace flow {
+
+// 当前线程所属的线程池与工作线程下标（非工作线程为 nullptr / -1）
+static thread_local FlowThreadPool* t_ownerPool = nullptr;
+static thread_local int t_workerIndex = -1;
+
+FlowThreadPool& FlowThreadPool::Shared() {
+    // 有意不析构：DLL 卸载阶段在加载器锁内 join 线程可能死锁，进程退出时由系统回收线程
+    static FlowThreadPool* s_pool = []() {
+        const unsigned hc = std::thread::hardware_concurrency();
+        return new FlowThreadPool(static_cast<int>(std::max(2u, hc)));
+    }();
+    return *s_pool;
+}
+
+FlowThreadPool::FlowThreadPool(int workerCount) {
+    if (workerCount < 1) workerCount = 1;
+    _queues.reserve(static_cast<size_t>(workerCount));
+    for (int i = 0; i < workerCount; i++) {
+        _queues.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    _threads.reserve(static_cast<size_t>(workerCount));
+    for (int i = 0; i < workerCount; i++) {
+        _threads.emplace_back([this, i]() { WorkerLoop(i); });
+    }
+}
+
+FlowThreadPool::~FlowThreadPool() {
+    {
+        std::lock_guard<std::mutex> lk(_sleepMu);
+        _stop = true;
+    }
+    _sleepCv.notify_all();
+    for (auto& t : _threads) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void FlowThreadPool::Submit(Task task) {
+    if (!task) return;
+    if (t_ownerPool == this && t_workerIndex >= 0) {
+        WorkerQueue& q = *_queues[static_cast<size_t>(t_workerIndex)];
+        std::lock_guard<std::mutex> lk(q.Mu);
+        q.Tasks.push_back(std::move(task));
+    } else {
+        std::lock_guard<std::mutex> lk(_injectMu);
+        _inject.push_back(std::move(task));
+    }
+    _pending.fetch_add(1);
+    {
+        // 与等待方的谓词检查同步，避免丢失唤醒
+        std::lock_guard<std::mutex> lk(_sleepMu);
+    }
+    _sleepCv.notify_one();
+}
+
+bool FlowThreadPool::TryTake(int selfIndex, Task& out) {
+    const int n = static_cast<int>(_queues.size());
+
+    // 1) 本地队尾（LIFO，缓存友好）
+    if (selfIndex >= 0 && selfIndex < n) {
+        WorkerQueue& q = *_queues[static_cast<size_t>(selfIndex)];
+        std::lock_guard<std::mutex> lk(q.Mu);
+        if (!q.Tasks.empty()) {
+            out = std::move(q.Tasks.back());
+            q.Tasks.pop_back();
+            return true;
+        }
+    }
+
+    // 2) 全局注入队列（FIFO）
+    {
+        std::lock_guard<std::mutex> lk(_injectMu);
+        if (!_inject.empty()) {
+            out = std::move(_inject.front());
+            _inject.pop_front();
+            return true;
+        }
+    }
+
+    // 3) 从其他线程队首窃取
+    const int start = selfIndex >= 0 ? selfIndex + 1 : 0;
+    for (int k = 0; k < n; k++) {
+        const int victim = (start + k) % n;
+        if (victim == selfIndex) continue;
+        WorkerQueue& q = *_queues[static_cast<size_t>(victim)];
+        std::lock_guard<std::mutex> lk(q.Mu);
+        if (!q.Tasks.empty()) {
+            out = std::move(q.Tasks.front());
+            q.Tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void FlowThreadPool::RunTaskNoexcept(Task& task) {
+    try {
+        task();
+    } catch (...) {}
+}
+
+void FlowThreadPool::WorkerLoop(int index) {
+    t_ownerPool = this;
+    t_workerIndex = index;
+    while (true) {
+        Task task;
+        if (TryTake(index, task)) {
+            _pending.fetch_sub(1);
+            RunTaskNoexcept(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(_sleepMu);
+        _sleepCv.wait(lk, [this]() { return _stop.load() || _pending.load() > 0; });
+        if (_stop.load()) break;
+    }
+    t_ownerPool = nullptr;
+    t_workerIndex = -1;
+}
+
+} // namespace flow
+} // namespace dlcv_infer
@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 流程共享线程池（work-stealing）：
+/// - 每个工作线程持有本地双端队列；工作线程内提交的任务压入本地队尾，本线程按 LIFO 取出；
+/// - 本地队列为空时先取全局注入队列（外部线程提交的任务），再从其他线程队首窃取；
+/// - 在工作线程内等待任务完成的调用方只协助执行属于自己的工作（自行领取未开始的工作项），
+///   不代跑池中其他调用方的任务，避免优先级反转与栈深度无界增长；已开始的工作项直接等待。
+/// </summary>
+class FlowThreadPool final {
+public:
+    using Task = std::function<void()>;
+
+    /// <summary>
+    /// 进程级共享实例，线程数为硬件并发数（至少 2）。
+    /// </summary>
+    static FlowThreadPool& Shared();
+
+    explicit FlowThreadPool(int workerCount);
+    ~FlowThreadPool();
+
+    FlowThreadPool(const FlowThreadPool&) = delete;
+    FlowThreadPool& operator=(const FlowThreadPool&) = delete;
+
+    int WorkerCount() const { return static_cast<int>(_threads.size()); }
+
+    /// <summary>
+    /// 提交任务；任务内抛出的异常会被吞掉，调用方需在任务内自行捕获并回传。
+    /// </summary>
+    void Submit(Task task);
+
+private:
+    struct WorkerQueue final {
+        std::mutex Mu;
+        std::deque<Task> Tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> _queues;
+    std::mutex _injectMu;
+    std::deque<Task> _inject;
+
+    std::mutex _sleepMu;
+    std::condition_variable _sleepCv;
+    std::atomic<int> _pending{0};
+    std::atomic<bool> _stop{false};
+    std::vector<std::thread> _threads;
+
+    void WorkerLoop(int index);
+    bool TryTake(int selfIndex, Task& out);
+    static void RunTaskNoexcept(Task& task);
+};
+
+} // namespace flow
+} // namespace dlcv_infer
@@ -0,0 +1,161 @@
+﻿#include "flow/FlowTuningProfile.h"
+#include "flow/FlowNodeCache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "dlcv_infer.h"
+
+namespace dlcv_infer {
+namespace flow {
+
+static const char* kProfileEntries = "entries";
+
+static int ReadIntField(const Json& obj, const char* key, int dv) {
+    try {
+        if (obj.contains(key) && obj.at(key).is_number()) return obj.at(key).get<int>();
+    } catch (...) {}
+    return dv;
+}
+
+static double ReadDoubleField(const Json& obj, const char* key, double dv) {
+    try {
+        if (obj.contains(key) && obj.at(key).is_number()) return obj.at(key).get<double>();
+    } catch (...) {}
+    return dv;
+}
+
+Json FlowNodeTuning::ToJson() const {
+    Json j = Json::object();
+    j["batch_size"] = BatchSize;
+    j["parallel_threads"] = ParallelThreads;
+    j["latency_ms"] = LatencyMs;
+    j["images_per_second"] = ImagesPerSecond;
+    return j;
+}
+
+bool FlowNodeTuning::FromJson(const Json& j, FlowNodeTuning& out) {
+    if (!j.is_object() || !j.contains("batch_size")) return false;
+    FlowNodeTuning t;
+    t.BatchSize = ReadIntField(j, "batch_size", 0);
+    t.ParallelThreads = ReadIntField(j, "parallel_threads", 0);
+    t.LatencyMs = ReadDoubleField(j, "latency_ms", 0.0);
+    t.ImagesPerSecond = ReadDoubleField(j, "images_per_second", 0.0);
+    if (t.BatchSize <= 0 || t.ParallelThreads < 0) return false;
+    out = t;
+    return true;
+}
+
+bool FlowTuningProfile::Load(const std::string& path) {
+    _entries = Json::object();
+    if (path.empty()) return false;
+    try {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!ifs) return false;
+        const std::string text((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        const Json root = Json::parse(text);
+        if (!root.is_object() || !root.contains(kProfileEntries) || !root.at(kProfileEntries).is_object()) return false;
+        _entries = root.at(kProfileEntries);
+        return true;
+    } catch (...) {
+        _entries = Json::object();
+        return false;
+    }
+}
+
+void FlowTuningProfile::Save(const std::string& path) const {
+    if (path.empty()) throw std::invalid_argument("tuning profile path is empty");
+    Json root = Json::object();
+    root["version"] = 1;
+    root[kProfileEntries] = _entries;
+    const std::string text = root.dump(2);
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) throw std::runtime_error("failed to write tuning profile: " + path);
+    ofs.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!ofs) throw std::runtime_error("failed to write tuning profile: " + path);
+}
+
+bool FlowTuningProfile::Find(const std::string& key, FlowNodeTuning& out) const {
+    if (key.empty()) return false;
+    try {
+        auto it = _entries.find(key);
+        if (it == _entries.end()) return false;
+        return FlowNodeTuning::FromJson(*it, out);
+    } catch (...) {
+        return false;
+    }
+}
+
+void FlowTuningProfile::Put(const std::string& key, const std::string& modelName, const FlowNodeTuning& tuning) {
+    if (key.empty()) return;
+    Json j = tuning.ToJson();
+    if (!modelName.empty()) j["model_name"] = modelName;
+    _entries[key] = std::move(j);
+}
+
+// 模型文件内容哈希：按 1MB 分块读取
+static bool HashModelFile(const std::string& path, std::uint64_t& out) {
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) return false;
+    std::vector<char> buffer(1024 * 1024);
+    std::uint64_t h = 0x6A09E667F3BCC909ULL;
+    std::uint64_t total = 0;
+    while (ifs) {
+        ifs.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const std::streamsize n = ifs.gcount();
+        if (n <= 0) break;
+        h = FlowHashBuffer(h, buffer.data(), static_cast<size_t>(n));
+        total += static_cast<std::uint64_t>(n);
+    }
+    out = FlowHashMix(h, total);
+    return true;
+}
+
+// 设备名按 device_id 进程级缓存：dlcv_get_device_info 不可用或无对应设备时为空
+static std::string ResolveDeviceName(int deviceId) {
+    static std::mutex s_mu;
+    static std::unordered_map<int, std::string> s_names;
+    {
+        std::lock_guard<std::mutex> lk(s_mu);
+        auto it = s_names.find(deviceId);
+        if (it != s_names.end()) return it->second;
+    }
+
+    std::string name;
+    try {
+        const Json info = dlcv_infer::Utils::GetDeviceInfo();
+        if (info.is_object() && info.contains("devices") && info.at("devices").is_array()) {
+            for (const auto& d : info.at("devices")) {
+                if (!d.is_object() || ReadIntField(d, "device_id", -2) != deviceId) continue;
+                if (d.contains("device_name") && d.at("device_name").is_string()) name = d.at("device_name").get<std::string>();
+                break;
+            }
+        }
+    } catch (...) {
+        name.clear();
+    }
+
+    std::lock_guard<std::mutex> lk(s_mu);
+    s_names[deviceId] = name;
+    return name;
+}
+
+std::string FlowTuningProfile::MakeKey(const std::string& modelPathUtf8, int deviceId) {
+    std::uint64_t hash = 0;
+    if (modelPathUtf8.empty() || !HashModelFile(modelPathUtf8, hash)) return std::string();
+
+    char hex[17] = { 0 };
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    const std::string deviceName = ResolveDeviceName(deviceId);
+    return std::string(hex) + "@" + (deviceName.empty() ? std::string("device") : deviceName) + "#" + std::to_string(deviceId);
+}
+
+} // namespace flow
+} // namespace dlcv_infer
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <string>
+
+#include "flow/FlowTypes.h"
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 单个模型的调优结果：模型节点的 batch_size、节点内并行线程数 parallel_threads，以及选中配置的实测指标。
+/// </summary>
+struct FlowNodeTuning final {
+    int BatchSize = 0;
+    int ParallelThreads = 0;
+    double LatencyMs = 0.0;
+    double ImagesPerSecond = 0.0;
+
+    Json ToJson() const;
+    static bool FromJson(const Json& j, FlowNodeTuning& out);
+};
+
+/// <summary>
+/// 调优配置文件（JSON，流程归档旁的 <归档>.tune.json）：按“模型内容哈希@设备”记录每个模型的调优结果，
+/// 模型文件或设备变化后旧记录不再匹配。读取为尽力而为：文件缺失或损坏时视为空配置。
+/// </summary>
+class FlowTuningProfile final {
+public:
+    /// <summary>
+    /// 读取配置文件；文件不存在或格式不正确时返回 false，并保持为空配置。
+    /// </summary>
+    bool Load(const std::string& path);
+
+    /// <summary>
+    /// 写入配置文件（整体覆盖）；失败时抛出异常。
+    /// </summary>
+    void Save(const std::string& path) const;
+
+    bool Empty() const { return _entries.empty(); }
+    bool Find(const std::string& key, FlowNodeTuning& out) const;
+    void Put(const std::string& key, const std::string& modelName, const FlowNodeTuning& tuning);
+
+    /// <summary>
+    /// 配置键：模型文件内容哈希（16 位十六进制）@ 设备标识（设备名#device_id，取不到设备名时为 device#device_id）。
+    /// 模型文件不可读时返回空串。
+    /// </summary>
+    static std::string MakeKey(const std::string& modelPathUtf8, int deviceId);
+
+private:
+    Json _entries = Json::object();
+};
+
+} // namespace flow
+} // namespace dlcv_infer
@@ -1,19 +1,154 @@
 ﻿#pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
+#include <cstdio>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "json/json.hpp"
 #include "opencv2/core.hpp"
 
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 namespace dlcv_infer {
 namespace flow {
 
 using Json = nlohmann::json;
 
+class DetectionBatch;
+
+inline std::uint64_t FlowHashMix(std::uint64_t h, std::uint64_t v) {
+    // splitmix64 风格的混合，保证相邻数值也能充分扩散
+    h ^= v + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    return h;
+}
+
+/// <summary>
+/// 定长 2x3 仿射矩阵 [a,b,tx, c,d,ty]，映射 (x,y) -> (a*x+b*y+tx, c*x+d*y+ty)。
+/// 可平凡复制，复合与求逆为 constexpr，不做堆分配。
+/// </summary>
+struct Affine2x3 final {
+    double M[6];
+
+    constexpr Affine2x3() : M{ 1,0,0, 0,1,0 } {}
+    constexpr Affine2x3(double a, double b, double tx, double c, double d, double ty) : M{ a,b,tx, c,d,ty } {}
+
+    static constexpr Affine2x3 Identity() { return Affine2x3(); }
+
+    /// <summary>
+    /// 由 6 元数组构造；长度不为 6 时返回单位阵。
+    /// </summary>
+    static Affine2x3 FromVector(const std::vector<double>& a2x3) {
+        if (a2x3.size() != 6) return Affine2x3();
+        return Affine2x3(a2x3[0], a2x3[1], a2x3[2], a2x3[3], a2x3[4], a2x3[5]);
+    }
+
+    std::vector<double> ToVector() const { return std::vector<double>(M, M + 6); }
+
+    static constexpr size_t size() { return 6; }
+    const double* data() const { return M; }
+    constexpr double operator[](size_t i) const { return M[i]; }
+
+    /// <summary>
+    /// 复合：返回先应用 first、再应用 *this 的变换（即 3x3 意义下 this * first）。
+    /// 运算顺序与 3x3 齐次矩阵乘法逐项一致，保证结果逐位不变。
+    /// </summary>
+    constexpr Affine2x3 Compose(const Affine2x3& first) const {
+        return Affine2x3(
+            M[0] * first.M[0] + M[1] * first.M[3] + M[2] * 0.0,
+            M[0] * first.M[1] + M[1] * first.M[4] + M[2] * 0.0,
+            M[0] * first.M[2] + M[1] * first.M[5] + M[2] * 1.0,
+            M[3] * first.M[0] + M[4] * first.M[3] + M[5] * 0.0,
+            M[3] * first.M[1] + M[4] * first.M[4] + M[5] * 0.0,
+            M[3] * first.M[2] + M[4] * first.M[5] + M[5] * 1.0);
+    }
+
+    /// <summary>
+    /// 求逆；行列式绝对值小于 1e-12 时返回单位阵。
+    /// </summary>
+    constexpr Affine2x3 Inverse() const {
+        return InverseWithDet(M[0] * M[4] - M[1] * M[3]);
+    }
+
+    constexpr bool IsIdentity() const {
+        return M[0] == 1.0 && M[1] == 0.0 && M[2] == 0.0 && M[3] == 0.0 && M[4] == 1.0 && M[5] == 0.0;
+    }
+
+    cv::Point2f Map(const cv::Point2f& p) const {
+        const double x = p.x, y = p.y;
+        return cv::Point2f(static_cast<float>(M[0] * x + M[1] * y + M[2]),
+                           static_cast<float>(M[3] * x + M[4] * y + M[5]));
+    }
+
+private:
+    constexpr Affine2x3 InverseWithDet(double det) const {
+        return (det < 1e-12 && det > -1e-12)
+            ? Affine2x3()
+            : InverseWithScale(1.0 / det);
+    }
+
+    constexpr Affine2x3 InverseWithScale(double invDet) const {
+        return InverseFromLinear(M[4] * invDet, -M[1] * invDet, -M[3] * invDet, M[0] * invDet);
+    }
+
+    constexpr Affine2x3 InverseFromLinear(double ia, double ib, double ic, double id) const {
+        return Affine2x3(ia, ib, -(ia * M[2] + ib * M[5]), ic, id, -(ic * M[2] + id * M[5]));
+    }
+};
+
+/// <summary>
+/// 批量映射点：xy 为交错排列的 n 个点 [x0,y0,x1,y1,...]，结果写入 out（可与 xy 相同）。
+/// x64/SSE2 下两个坐标一次计算，逐项运算顺序与 Affine2x3::Map 相同。
+/// </summary>
+inline void MapPoints(const Affine2x3& A, const double* xy, double* out, size_t n) {
+#if defined(_M_X64) || defined(__SSE2__)
+    const __m128d colX = _mm_set_pd(A.M[3], A.M[0]);
+    const __m128d colY = _mm_set_pd(A.M[4], A.M[1]);
+    const __m128d trans = _mm_set_pd(A.M[5], A.M[2]);
+    for (size_t i = 0; i < n; i++) {
+        const __m128d x = _mm_set1_pd(xy[2 * i]);
+        const __m128d y = _mm_set1_pd(xy[2 * i + 1]);
+        const __m128d r = _mm_add_pd(_mm_add_pd(_mm_mul_pd(colX, x), _mm_mul_pd(colY, y)), trans);
+        _mm_storeu_pd(out + 2 * i, r);
+    }
+#else
+    for (size_t i = 0; i < n; i++) {
+        const double x = xy[2 * i], y = xy[2 * i + 1];
+        out[2 * i] = A.M[0] * x + A.M[1] * y + A.M[2];
+        out[2 * i + 1] = A.M[3] * x + A.M[4] * y + A.M[5];
+    }
+#endif
+}
+
+/// <summary>
+/// 批量映射 float 点（以 double 计算后截断为 float，与 Affine2x3::Map 一致）。
+/// </summary>
+inline void MapPoints(const Affine2x3& A, const cv::Point2f* pts, cv::Point2f* out, size_t n) {
+    double buf[16];
+    size_t done = 0;
+    while (done < n) {
+        const size_t cnt = std::min<size_t>(8, n - done);
+        for (size_t i = 0; i < cnt; i++) {
+            buf[2 * i] = pts[done + i].x;
+            buf[2 * i + 1] = pts[done + i].y;
+        }
+        MapPoints(A, buf, buf, cnt);
+        for (size_t i = 0; i < cnt; i++) {
+            out[done + i] = cv::Point2f(static_cast<float>(buf[2 * i]), static_cast<float>(buf[2 * i + 1]));
+        }
+        done += cnt;
+    }
+}
+
 /// <summary>
 /// 表示从 Original -> Current 的几何变换状态（仿射 2x3）以及尺寸信息。
 /// 对齐 OpenIVS/DlcvCsharpApi/Base.cs 中的 TransformationState。
@@ -22,96 +157,104 @@ struct TransformationState final {
     int OriginalWidth = 0;
     int OriginalHeight = 0;
     std::vector<int> CropBox;                 // [x,y,w,h] or empty
-    std::vector<double> AffineMatrix2x3;      // len=6, original -> current; empty means identity
+    Affine2x3 AffineMatrix2x3;                // original -> current; 仅 HasAffineMatrix 为 true 时有效
+    bool HasAffineMatrix = false;             // false 表示单位变换（JSON 中无 affine_2x3）
+    Affine2x3 InverseAffine;                  // 缓存的 current -> original，随 SetAffine 更新
     std::vector<int> OutputSize;              // [w,h] or empty
 
-    TransformationState() = default;
-    TransformationState(int originalW, int originalH)
-        : OriginalWidth(originalW), OriginalHeight(originalH) {}
+    /// <summary>
+    /// 变换标识：由原图尺寸、裁剪框、输出尺寸与仿射矩阵（按 1e-6 量化）计算的 64 位值，非 0。
+    /// 构造、DeriveChild、FromJson 时赋值，几何一致的状态标识相同；模块用它把结果条目整数匹配回图像。
+    /// ToJson 把它以 16 位十六进制写入 transform_id，结果条目随 transform 携带，匹配时不必重新解析计算。
+    /// 直接修改上述字段后需调用 UpdateTransformId()。
+    /// </summary>
+    std::uint64_t TransformId = 0;
 
-    TransformationState Clone() const { return *this; }
+    TransformationState() { UpdateTransformId(); }
+    TransformationState(int originalW, int originalH)
+        : OriginalWidth(originalW), OriginalHeight(originalH) {
+        UpdateTransformId();
+    }
 
-    static std::vector<double> To3x3(const std::vector<double>& a2x3) {
-        if (a2x3.size() != 6) {
-            return { 1,0,0, 0,1,0, 0,0,1 };
+    /// <summary>
+    /// 计算变换标识。crop4/output2/affine6 为空指针表示缺省（裁剪框、输出尺寸缺省按 0 计，与旧签名一致）。
+    /// </summary>
+    static std::uint64_t ComputeTransformId(int originalW, int originalH, const int* crop4, const int* output2, const double* affine6) {
+        std::uint64_t h = FlowHashMix(0x7F4A7C159E3779B9ULL, static_cast<std::uint32_t>(originalW));
+        h = FlowHashMix(h, static_cast<std::uint32_t>(originalH));
+        for (int i = 0; i < 4; i++) h = FlowHashMix(h, static_cast<std::uint32_t>(crop4 != nullptr ? crop4[i] : 0));
+        for (int i = 0; i < 2; i++) h = FlowHashMix(h, static_cast<std::uint32_t>(output2 != nullptr ? output2[i] : 0));
+        if (affine6 == nullptr) {
+            h = FlowHashMix(h, 0xA5A5A5A5ULL);
+        } else {
+            for (int i = 0; i < 6; i++) {
+                const double v = affine6[i];
+                const long long q = std::isfinite(v) ? std::llround(v * 1000000.0) : 0;
+                h = FlowHashMix(h, static_cast<std::uint64_t>(q));
+            }
         }
-        return { a2x3[0], a2x3[1], a2x3[2],
-                 a2x3[3], a2x3[4], a2x3[5],
-                 0, 0, 1 };
+        return h != 0 ? h : 1;
     }
 
-    static std::vector<double> To2x3(const std::vector<double>& a3x3) {
-        if (a3x3.size() != 9) {
-            return { 1,0,0, 0,1,0 };
-        }
-        return { a3x3[0], a3x3[1], a3x3[2],
-                 a3x3[3], a3x3[4], a3x3[5] };
+    void UpdateTransformId() {
+        TransformId = ComputeTransformId(
+            OriginalWidth,
+            OriginalHeight,
+            CropBox.size() >= 4 ? CropBox.data() : nullptr,
+            OutputSize.size() >= 2 ? OutputSize.data() : nullptr,
+            HasAffineMatrix ? AffineMatrix2x3.data() : nullptr);
     }
 
-    static std::vector<double> Mul3x3(const std::vector<double>& A, const std::vector<double>& B) {
-        // C = A * B
-        if (A.size() != 9 || B.size() != 9) {
-            return { 1,0,0, 0,1,0, 0,0,1 };
-        }
-        std::vector<double> C(9, 0.0);
-        for (int r = 0; r < 3; r++) {
-            for (int c = 0; c < 3; c++) {
-                C[r * 3 + c] =
-                    A[r * 3 + 0] * B[0 * 3 + c] +
-                    A[r * 3 + 1] * B[1 * 3 + c] +
-                    A[r * 3 + 2] * B[2 * 3 + c];
-            }
-        }
-        return C;
+    bool HasAffine() const { return HasAffineMatrix; }
+
+    /// <summary>
+    /// 设置 original -> current 仿射并同步缓存的逆矩阵（不更新 TransformId）。
+    /// </summary>
+    void SetAffine(const Affine2x3& originalToCurrent) {
+        AffineMatrix2x3 = originalToCurrent;
+        HasAffineMatrix = true;
+        InverseAffine = originalToCurrent.Inverse();
     }
 
-    static std::vector<double> Inverse2x3(const std::vector<double>& a2x3) {
-        if (a2x3.size() != 6) {
-            return { 1,0,0, 0,1,0 };
-        }
-        const double a = a2x3[0], b = a2x3[1], tx = a2x3[2];
-        const double c = a2x3[3], d = a2x3[4], ty = a2x3[5];
-        const double det = a * d - b * c;
-        if (std::abs(det) < 1e-12) {
-            return { 1,0,0, 0,1,0 };
-        }
-        const double invDet = 1.0 / det;
-        const double ia = d * invDet;
-        const double ib = -b * invDet;
-        const double ic = -c * invDet;
-        const double id = a * invDet;
-        const double itx = -(ia * tx + ib * ty);
-        const double ity = -(ic * tx + id * ty);
-        return { ia, ib, itx, ic, id, ity };
+    void ClearAffine() {
+        AffineMatrix2x3 = Affine2x3();
+        HasAffineMatrix = false;
+        InverseAffine = Affine2x3();
     }
 
+    TransformationState Clone() const { return *this; }
+
     /// <summary>
     /// 由当前状态派生子状态：current->new 的 2x3 与 original->current 复合为 original->new。
     /// </summary>
-    TransformationState DeriveChild(const std::vector<double>& currentToNew2x3, int newWidth, int newHeight) const {
-        std::vector<double> parent2x3 = (AffineMatrix2x3.size() == 6) ? AffineMatrix2x3 : std::vector<double>{ 1,0,0, 0,1,0 };
-        std::vector<double> child2x3 = (currentToNew2x3.size() == 6) ? currentToNew2x3 : std::vector<double>{ 1,0,0, 0,1,0 };
-
-        const std::vector<double> parent3x3 = To3x3(parent2x3);
-        const std::vector<double> child3x3 = To3x3(child2x3);
-        const std::vector<double> composed3x3 = Mul3x3(child3x3, parent3x3); // original -> new
-
+    TransformationState DeriveChild(const Affine2x3& currentToNew, int newWidth, int newHeight) const {
         TransformationState out;
         out.OriginalWidth = OriginalWidth;
         out.OriginalHeight = OriginalHeight;
         out.CropBox = CropBox;
-        out.AffineMatrix2x3 = To2x3(composed3x3);
+        out.SetAffine(currentToNew.Compose(AffineMatrix2x3)); // 无仿射时 AffineMatrix2x3 为单位阵
         out.OutputSize = { newWidth, newHeight };
+        out.UpdateTransformId();
         return out;
     }
 
+    /// <summary>
+    /// 兼容 6 元数组形式；长度不为 6 时按单位阵处理。
+    /// </summary>
+    TransformationState DeriveChild(const std::vector<double>& currentToNew2x3, int newWidth, int newHeight) const {
+        return DeriveChild(Affine2x3::FromVector(currentToNew2x3), newWidth, newHeight);
+    }
+
     Json ToJson() const {
         Json d = Json::object();
         d["original_width"] = OriginalWidth;
         d["original_height"] = OriginalHeight;
         if (CropBox.size() >= 4) d["crop_box"] = CropBox;
-        if (AffineMatrix2x3.size() == 6) d["affine_2x3"] = AffineMatrix2x3;
+        if (HasAffineMatrix) d["affine_2x3"] = AffineMatrix2x3.ToVector();
         if (OutputSize.size() >= 2) d["output_size"] = OutputSize;
+        char id[17] = {0};
+        std::snprintf(id, sizeof(id), "%016llx", static_cast<unsigned long long>(TransformId));
+        d["transform_id"] = id;
         return d;
     }
 
@@ -128,17 +271,88 @@ struct TransformationState final {
         } catch (...) { st.CropBox.clear(); }
         try {
             if (d.contains("affine_2x3") && d["affine_2x3"].is_array() && d["affine_2x3"].size() >= 6) {
-                st.AffineMatrix2x3.clear();
-                for (size_t i = 0; i < 6; i++) st.AffineMatrix2x3.push_back(d["affine_2x3"][i].get<double>());
+                const Json& a = d["affine_2x3"];
+                st.SetAffine(Affine2x3(a[0].get<double>(), a[1].get<double>(), a[2].get<double>(),
+                                       a[3].get<double>(), a[4].get<double>(), a[5].get<double>()));
             }
-        } catch (...) { st.AffineMatrix2x3.clear(); }
+        } catch (...) { st.ClearAffine(); }
         try {
             if (d.contains("output_size") && d["output_size"].is_array() && d["output_size"].size() >= 2) {
                 st.OutputSize = { d["output_size"][0].get<int>(), d["output_size"][1].get<int>() };
             }
         } catch (...) { st.OutputSize.clear(); }
+        st.UpdateTransformId();
         return st;
     }
+
+    /// <summary>
+    /// transform JSON 携带的变换标识（ToJson 写入的 transform_id）；缺失或格式不符（外部输入的 JSON）时返回 0。
+    /// </summary>
+    static std::uint64_t CarriedId(const Json& d) {
+        if (!d.is_object()) return 0;
+        auto it = d.find("transform_id");
+        if (it == d.end() || !it->is_string()) return 0;
+        const std::string& hex = it->get_ref<const std::string&>();
+        if (hex.size() != 16) return 0;
+        std::uint64_t id = 0;
+        for (char c : hex) {
+            int v = 0;
+            if (c >= '0' && c <= '9') v = c - '0';
+            else if (c >= 'a' && c <= 'f') v = c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') v = c - 'A' + 10;
+            else return 0;
+            id = (id << 4) | static_cast<std::uint64_t>(v);
+        }
+        return id;
+    }
+
+    /// <summary>
+    /// 结果条目 transform JSON 对应的变换标识（同 FromJson(d).TransformId）：优先取携带的 transform_id，
+    /// 没有时（外部输入的 JSON）按字段计算；非对象返回 0。
+    /// </summary>
+    static std::uint64_t IdFromJson(const Json& d) {
+        if (!d.is_object()) return 0;
+        const std::uint64_t carried = CarriedId(d);
+        return carried != 0 ? carried : FromJson(d).TransformId;
+    }
+
+    /// <summary>
+    /// 仿射兜底匹配键：只看仿射矩阵，按 "T:%.4f,%.4f,%.2f,%.4f,%.4f,%.2f" 格式化后取哈希（线性项 4 位、平移 2 位小数），非 0。
+    /// 与 TransformId 不同，不区分原图尺寸、裁剪框与输出尺寸，容差也更宽；仅用于按仿射把结果条目对回图像的兜底匹配。
+    /// </summary>
+    static std::uint64_t ComputeAffineMatchKey(const double* affine6) {
+        char buf[256] = {0};
+        const int n = std::snprintf(buf, sizeof(buf), "T:%.4f,%.4f,%.2f,%.4f,%.4f,%.2f",
+                                    affine6[0], affine6[1], affine6[2], affine6[3], affine6[4], affine6[5]);
+        std::uint64_t h = 1469598103934665603ULL; // FNV-1a
+        for (int i = 0; i < n && i < static_cast<int>(sizeof(buf)); i++) {
+            h ^= static_cast<unsigned char>(buf[i]);
+            h *= 1099511628211ULL;
+        }
+        return h != 0 ? h : 1;
+    }
+
+    /// <summary>
+    /// 本状态的仿射兜底匹配键；无仿射时返回 0（不参与匹配）。
+    /// </summary>
+    std::uint64_t AffineMatchKey() const {
+        return HasAffineMatrix ? ComputeAffineMatchKey(AffineMatrix2x3.M) : 0;
+    }
+
+    /// <summary>
+    /// 结果条目 transform JSON 的仿射兜底匹配键：需要 affine_2x3 为至少 6 元的数组，否则返回 0；
+    /// 单个元素读取失败按 0 计。
+    /// </summary>
+    static std::uint64_t AffineMatchKeyFromJson(const Json& d) {
+        if (!d.is_object()) return 0;
+        auto it = d.find("affine_2x3");
+        if (it == d.end() || !it->is_array() || it->size() < 6) return 0;
+        double a[6] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+        for (size_t i = 0; i < 6; i++) {
+            try { a[i] = it->at(i).get<double>(); } catch (...) { a[i] = 0.0; }
+        }
+        return ComputeAffineMatchKey(a);
+    }
 };
 
 /// <summary>
@@ -204,12 +418,75 @@ struct ModuleChannel final {
     std::vector<ModuleImage> ImageList;
     Json ResultList = Json::array();
     Json TemplateList = Json::array();
+    // 非空时为结果通道的权威数据（列式），ResultList 为空；只读共享，修改需复制
+    std::shared_ptr<const DetectionBatch> Detections;
 
     ModuleChannel() = default;
     ModuleChannel(std::vector<ModuleImage> images, Json results, Json templates = Json::array())
         : ImageList(std::move(images)), ResultList(std::move(results)), TemplateList(std::move(templates)) {}
 };
 
+/// <summary>
+/// 只读共享通道：GraphExecutor 保存节点输出与缓存条目用。扇出时各消费者共享同一份图像/结果/模板，
+/// 只读消费者直接引用；需要可写副本时经 Take* 取出（写时复制：唯一持有者直接移出，否则复制）。
+/// 空指针视为空序列。
+/// </summary>
+struct SharedChannel final {
+    std::shared_ptr<const std::vector<ModuleImage>> ImageList;
+    std::shared_ptr<const Json> ResultList;
+    std::shared_ptr<const Json> TemplateList;
+    std::shared_ptr<const DetectionBatch> Detections;
+
+    SharedChannel() = default;
+    explicit SharedChannel(ModuleChannel&& ch)
+        : ImageList(std::make_shared<std::vector<ModuleImage>>(std::move(ch.ImageList))),
+          ResultList(std::make_shared<Json>(std::move(ch.ResultList))),
+          TemplateList(std::make_shared<Json>(std::move(ch.TemplateList))),
+          Detections(std::move(ch.Detections)) {}
+
+    const std::vector<ModuleImage>& Images() const {
+        static const std::vector<ModuleImage> empty;
+        return ImageList ? *ImageList : empty;
+    }
+    const Json& Results() const { return ResultList ? *ResultList : EmptyArray(); }
+    const Json& Templates() const { return TemplateList ? *TemplateList : EmptyArray(); }
+
+    std::vector<ModuleImage> TakeImages() { return TakeOrCopy(ImageList, std::vector<ModuleImage>()); }
+    Json TakeResults() { return TakeOrCopy(ResultList, Json::array()); }
+    Json TakeTemplates() { return TakeOrCopy(TemplateList, Json::array()); }
+
+    /// <summary>
+    /// 取出可写的 ModuleChannel（列式结果仍只读共享）。
+    /// </summary>
+    ModuleChannel TakeChannel() {
+        ModuleChannel ch(TakeImages(), TakeResults(), TakeTemplates());
+        ch.Detections = std::move(Detections);
+        return ch;
+    }
+
+private:
+    static const Json& EmptyArray() {
+        static const Json empty = Json::array();
+        return empty;
+    }
+
+    // 只有本指针持有对象（均由 make_shared 创建为非 const 对象）时可安全移出
+    template <typename T>
+    static T TakeOrCopy(std::shared_ptr<const T>& p, T empty) {
+        if (!p) return empty;
+        if (p.use_count() == 1) {
+            // 与其他持有者释放时的引用计数递减配对，确保其读取先于本次移出
+            std::atomic_thread_fence(std::memory_order_acquire);
+            T out = std::move(const_cast<T&>(*p));
+            p.reset();
+            return out;
+        }
+        T out = *p;
+        p.reset();
+        return out;
+    }
+};
+
 /// <summary>
 /// 模块 I/O：统一强类型图像序列与 JSON 结果序列
 /// </summary>
@@ -217,6 +494,7 @@ struct ModuleIO final {
     std::vector<ModuleImage> ImageList;
     Json ResultList = Json::array();
     Json TemplateList = Json::array();
+    std::shared_ptr<const DetectionBatch> Detections; // 同 ModuleChannel::Detections
 
     ModuleIO() = default;
     ModuleIO(std::vector<ModuleImage> images, Json results, Json templates = Json::array())
@@ -1,13 +1,24 @@
 ﻿#include "flow/GraphExecutor.h"
+#include "flow/ContextKeys.h"
+#include "flow/DetectionBatch.h"
+#include "flow/FlowCodeGen.h"
+#include "flow/FlowPayloadTypes.h"
+#include "flow/FlowThreadPool.h"
 #include "dlcv_infer.h"
 
 #include <algorithm>
 #include <cctype>
 #include <chrono>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cstdio>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_set>
 
 #if defined(_MSC_VER) && defined(_DEBUG)
 #pragma optimize("gt", on)
@@ -86,7 +97,12 @@ static int ReadNodeOrder(const Json& node) {
 }
 
 GraphExecutor::GraphExecutor(std::vector<Json> nodes, ExecutionContext* context)
-    : _nodes(std::move(nodes)), _context(context) {
+    : GraphExecutor(Compile(nodes), context) {
+}
+
+GraphExecutor::GraphExecutor(std::shared_ptr<const CompiledFlowPlan> plan, ExecutionContext* context)
+    : _plan(std::move(plan)), _context(context) {
+    if (!_plan) _plan = std::make_shared<CompiledFlowPlan>();
     if (_context == nullptr) {
         // 注意：GraphExecutor 不拥有 context 生命周期；但为方便使用，允许传入 nullptr 代表“自带一个”
         static thread_local ExecutionContext s_ctx;
@@ -94,6 +110,10 @@ GraphExecutor::GraphExecutor(std::vector<Json> nodes, ExecutionContext* context)
     }
 }
 
+GraphExecutor::~GraphExecutor() {
+    ParkModuleInstances();
+}
+
 int GraphExecutor::SafeToInt(const Json& v, int dv) {
     try {
         if (v.is_number_integer()) return v.get<int>();
@@ -135,8 +155,10 @@ bool GraphExecutor::IsScalarPortType(const std::string& tLower) {
             tLower == "scalar");
 }
 
-static void ApplyInferParamOverrides(Json& props, const Json& inferParams) {
-    if (!props.is_object() || !inferParams.is_object()) return;
+// 从 infer_params 中筛出可覆盖到节点属性的键值（每次 Run 只筛一次）。
+static Json BuildInferParamOverrides(const Json& inferParams) {
+    Json overrides = Json::object();
+    if (!inferParams.is_object()) return overrides;
     for (auto it = inferParams.begin(); it != inferParams.end(); ++it) {
         // with_mask 仅用于控制最终返回格式，不应该全局覆盖流程节点属性。
         // 否则会导致依赖 mask_rle 的后处理节点（如 mask_to_rbox）在流程内部被意外打断。
@@ -147,13 +169,25 @@ static void ApplyInferParamOverrides(Json& props, const Json& inferParams) {
         if (keyLower == "with_mask") {
             continue;
         }
+        // disabled_branches 只控制本次执行哪些节点，不是节点属性。
+        if (keyLower == "disabled_branches") {
+            continue;
+        }
 
         const Json& value = it.value();
         // 推理参数只透传基础配置，避免把复杂结构误覆盖到节点属性。
         if (value.is_primitive() || value.is_null()) {
-            props[it.key()] = value;
+            overrides[it.key()] = value;
         }
     }
+    return overrides;
+}
+
+static void ApplyInferParamOverrides(Json& props, const Json& overrides) {
+    if (!props.is_object() || !overrides.is_object()) return;
+    for (auto it = overrides.begin(); it != overrides.end(); ++it) {
+        props[it.key()] = it.value();
+    }
 }
 
 void GraphExecutor::NormalizeBboxProperties(Json& props) {
@@ -178,8 +212,9 @@ void GraphExecutor::NormalizeBboxProperties(Json& props) {
 }
 
 std::unordered_map<int, std::pair<int, int>> GraphExecutor::BuildLinkSourceMap(const std::vector<Json>& nodesOrdered) {
-    std::unordered_map<int, std::pair<int, int>> map; // linkId -> (srcNodeId, srcOutIdx)
-    for (const auto& n : nodesOrdered) {
+    std::unordered_map<int, std::pair<int, int>> map; // linkId -> (srcNodeIndex, srcOutIdx)
+    for (int ni = 0; ni < static_cast<int>(nodesOrdered.size()); ni++) {
+        const Json& n = nodesOrdered[static_cast<size_t>(ni)];
         if (!n.is_object()) continue;
         const int nid = n.contains("id") ? SafeToInt(n.at("id"), -1) : -1;
         if (nid < 0) continue;
@@ -194,7 +229,7 @@ std::unordered_map<int, std::pair<int, int>> GraphExecutor::BuildLinkSourceMap(c
             for (const auto& lidObj : lv) {
                 const int lid = SafeToInt(lidObj, -1);
                 if (lid >= 0 && map.find(lid) == map.end()) {
-                    map[lid] = std::make_pair(nid, oi);
+                    map[lid] = std::make_pair(ni, oi);
                 }
             }
         }
@@ -202,104 +237,480 @@ std::unordered_map<int, std::pair<int, int>> GraphExecutor::BuildLinkSourceMap(c
     return map;
 }
 
-static long long BuildOutputPortKey(int nodeId, int outIdx) {
-    return (static_cast<long long>(nodeId) << 32) ^ static_cast<unsigned int>(outIdx);
+static CompiledFlowPlan::ChannelKind ParseChannelKind(const std::string& tLower) {
+    if (tLower == "image_chan") return CompiledFlowPlan::ChannelKind::Image;
+    if (tLower == "result_chan") return CompiledFlowPlan::ChannelKind::Result;
+    if (tLower == "template_chan" || tLower == "template") return CompiledFlowPlan::ChannelKind::Template;
+    return CompiledFlowPlan::ChannelKind::Unknown;
 }
 
-static std::unordered_map<long long, int> BuildOutputConsumerCount(
-    const std::vector<Json>& nodesOrdered,
-    const std::unordered_map<int, std::pair<int, int>>& linkToSource) {
+static CompiledFlowPlan::ScalarKind ParseScalarKind(const std::string& tLower) {
+    if (tLower == "bool" || tLower == "boolean") return CompiledFlowPlan::ScalarKind::Bool;
+    if (tLower == "int" || tLower == "integer") return CompiledFlowPlan::ScalarKind::Int;
+    return CompiledFlowPlan::ScalarKind::String;
+}
 
-    std::unordered_map<long long, int> counts;
-    for (const auto& node : nodesOrdered) {
-        if (!node.is_object() || !node.contains("inputs")) continue;
-        if (!node.at("inputs").is_array()) continue;
-        for (const auto& inp : node.at("inputs")) {
-            if (!inp.is_object()) continue;
-            std::string dtypeLower;
-            try {
-                if (inp.contains("type")) {
-                    if (inp.at("type").is_string()) {
-                        dtypeLower = inp.at("type").get<std::string>();
-                    } else if (!inp.at("type").is_null()) {
-                        dtypeLower = inp.at("type").dump();
-                    }
-                }
-            } catch (...) {
-                dtypeLower.clear();
+// 汇点：结果或副作用在节点自身产生（返回结果、可视化、保存），不依赖下游消费
+static bool IsSinkNodeType(const std::string& type) {
+    return type.rfind("output/", 0) == 0 || type == "features/template_save";
+}
+
+struct FlowLiveness final {
+    std::vector<char> Live;                 // 计划下标 -> 是否执行
+    std::vector<std::uint64_t> OutputMasks; // 计划下标 -> 生效的输出掩码
+    std::vector<int> ConsumerCounts;        // 全局槽位 -> 存活的非标量消费者数量
+};
+
+// 从未禁用的汇点沿输入链路反向标记存活节点。只计排在前面的源节点（后序节点的输出读不到），
+// 因此按计划逆序一遍即可。计划中没有汇点时除禁用节点外全部存活。
+// 输出掩码只去掉“有消费者且消费者全部不存活”的端口，其余与 outputs[*].links 一致。
+static FlowLiveness ComputeLiveness(const CompiledFlowPlan& plan, const std::vector<char>& disabled) {
+    const size_t nodeCount = plan.Nodes.size();
+    FlowLiveness out;
+    out.Live.assign(nodeCount, 0);
+    out.OutputMasks.assign(nodeCount, 0);
+    out.ConsumerCounts.assign(plan.OutputConsumerCounts.size(), 0);
+
+    const auto isDisabled = [&disabled](size_t i) { return i < disabled.size() && disabled[i] != 0; };
+
+    bool hasSink = false;
+    for (size_t i = 0; i < nodeCount; i++) {
+        if (plan.Nodes[i].IsSink) { hasSink = true; break; }
+    }
+    for (size_t i = nodeCount; i-- > 0;) {
+        if (isDisabled(i)) continue;
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        if (!hasSink || node.IsSink) out.Live[i] = 1;
+        if (!out.Live[i]) continue;
+        for (const auto& slot : node.ChannelInputs) {
+            if (slot.SrcNodeIndex >= 0 && static_cast<size_t>(slot.SrcNodeIndex) < i && !isDisabled(static_cast<size_t>(slot.SrcNodeIndex))) {
+                out.Live[static_cast<size_t>(slot.SrcNodeIndex)] = 1;
             }
-            std::transform(dtypeLower.begin(), dtypeLower.end(), dtypeLower.begin(), [](unsigned char ch) {
-                return static_cast<char>(std::tolower(ch));
-            });
-            const bool isScalar = (dtypeLower == "bool" || dtypeLower == "boolean" ||
-                                   dtypeLower == "int" || dtypeLower == "integer" ||
-                                   dtypeLower == "str" || dtypeLower == "string" ||
-                                   dtypeLower == "scalar");
-            if (isScalar) continue;
-
-            int linkId = -1;
-            try {
-                if (inp.contains("link")) {
-                    const auto& lv = inp.at("link");
-                    if (lv.is_number_integer()) linkId = lv.get<int>();
-                    else if (lv.is_number()) linkId = static_cast<int>(std::llround(lv.get<double>()));
-                    else if (lv.is_string()) linkId = std::stoi(lv.get<std::string>());
+        }
+        for (const auto& slot : node.ScalarInputs) {
+            if (slot.SrcNodeIndex >= 0 && static_cast<size_t>(slot.SrcNodeIndex) < i && !isDisabled(static_cast<size_t>(slot.SrcNodeIndex))) {
+                out.Live[static_cast<size_t>(slot.SrcNodeIndex)] = 1;
+            }
+        }
+    }
+
+    std::vector<std::uint64_t> liveBits(nodeCount, 0);
+    std::vector<std::uint64_t> deadBits(nodeCount, 0);
+    const auto markPort = [&](const CompiledFlowPlan::InputSlot& slot, bool consumerLive) {
+        if (slot.SrcNodeIndex < 0 || slot.SrcOutIdx < 0 || slot.SrcOutIdx >= 64) return;
+        const std::uint64_t bit = static_cast<std::uint64_t>(1) << slot.SrcOutIdx;
+        if (consumerLive) liveBits[static_cast<size_t>(slot.SrcNodeIndex)] |= bit;
+        else deadBits[static_cast<size_t>(slot.SrcNodeIndex)] |= bit;
+    };
+    for (size_t i = 0; i < nodeCount; i++) {
+        const bool consumerLive = out.Live[i] != 0;
+        for (const auto& slot : plan.Nodes[i].ChannelInputs) {
+            markPort(slot, consumerLive);
+            if (consumerLive && slot.SrcSlot >= 0 && slot.SrcSlot < static_cast<int>(out.ConsumerCounts.size())) {
+                out.ConsumerCounts[static_cast<size_t>(slot.SrcSlot)] += 1;
+            }
+        }
+        for (const auto& slot : plan.Nodes[i].ScalarInputs) markPort(slot, consumerLive);
+    }
+    for (size_t i = 0; i < nodeCount; i++) {
+        out.OutputMasks[i] = plan.Nodes[i].OutputMask & ~(deadBits[i] & ~liveBits[i]);
+    }
+    return out;
+}
+
+// infer_params.disabled_branches：数组或逗号分隔字符串，元素按节点 type、title 或 id 匹配
+static std::vector<char> ParseDisabledBranches(const CompiledFlowPlan& plan, const Json& inferParams) {
+    std::vector<char> disabled;
+    if (!inferParams.is_object()) return disabled;
+    auto it = inferParams.find("disabled_branches");
+    if (it == inferParams.end()) return disabled;
+
+    std::vector<std::string> names;
+    const auto addName = [&names](std::string s) {
+        const size_t b = s.find_first_not_of(" \t");
+        const size_t e = s.find_last_not_of(" \t");
+        if (b == std::string::npos) return;
+        names.push_back(s.substr(b, e - b + 1));
+    };
+    try {
+        if (it->is_string()) {
+            const std::string all = it->get<std::string>();
+            size_t start = 0;
+            while (start <= all.size()) {
+                const size_t comma = all.find(',', start);
+                const size_t stop = comma == std::string::npos ? all.size() : comma;
+                addName(all.substr(start, stop - start));
+                if (comma == std::string::npos) break;
+                start = comma + 1;
+            }
+        } else if (it->is_array()) {
+            for (const auto& v : *it) {
+                if (v.is_string()) addName(v.get<std::string>());
+                else if (v.is_number_integer()) names.push_back(std::to_string(v.get<long long>()));
+            }
+        }
+    } catch (...) {}
+    if (names.empty()) return disabled;
+
+    disabled.assign(plan.Nodes.size(), 0);
+    for (size_t i = 0; i < plan.Nodes.size(); i++) {
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        const std::string idText = std::to_string(node.NodeId);
+        for (const auto& name : names) {
+            if (name == node.Type || name == idText || (!node.Title.empty() && name == node.Title)) {
+                disabled[i] = 1;
+                break;
+            }
+        }
+    }
+    return disabled;
+}
+
+static bool SameInputSlots(const CompiledFlowPlan& plan,
+    const std::vector<CompiledFlowPlan::InputSlot>& a, const std::vector<CompiledFlowPlan::InputSlot>& b) {
+    if (a.size() != b.size()) return false;
+    const auto canonical = [&plan](int idx) {
+        const int d = plan.Nodes[static_cast<size_t>(idx)].DedupOf;
+        return d >= 0 ? d : idx;
+    };
+    for (size_t k = 0; k < a.size(); k++) {
+        const CompiledFlowPlan::InputSlot& x = a[k];
+        const CompiledFlowPlan::InputSlot& y = b[k];
+        if (x.PortIndex != y.PortIndex || x.SrcOutIdx != y.SrcOutIdx || x.Channel != y.Channel || x.Name != y.Name) return false;
+        if (canonical(x.SrcNodeIndex) != canonical(y.SrcNodeIndex)) return false;
+    }
+    return true;
+}
+
+static bool IsEquivalentNode(const CompiledFlowPlan& plan, int a, int b) {
+    const CompiledFlowPlan::Node& x = plan.Nodes[static_cast<size_t>(a)];
+    const CompiledFlowPlan::Node& y = plan.Nodes[static_cast<size_t>(b)];
+    // 输出掩码也须相同：部分模块按掩码决定是否产出分支，掩码不同时主输出不保证一致
+    if (x.Type != y.Type || x.OutputCount != y.OutputCount || x.LiveOutputMask != y.LiveOutputMask ||
+        x.ScalarOutputs.size() != y.ScalarOutputs.size()) return false;
+    for (size_t k = 0; k < x.ScalarOutputs.size(); k++) {
+        const CompiledFlowPlan::ScalarOutput& sx = x.ScalarOutputs[k];
+        const CompiledFlowPlan::ScalarOutput& sy = y.ScalarOutputs[k];
+        if (sx.PortIndex != sy.PortIndex || sx.Kind != sy.Kind || sx.Name != sy.Name) return false;
+    }
+    return SameInputSlots(plan, x.ChannelInputs, y.ChannelInputs) &&
+        SameInputSlots(plan, x.ScalarInputs, y.ScalarInputs) &&
+        FlowJsonSameDump(x.ResolvedProperties, y.ResolvedProperties);
+}
+
+// 等价节点合并（公共子表达式消除）：类型、生效属性、输出端口与输出掩码相同，且各输入来自相同上游端口
+// （已合并的节点视为其等价节点）的存活节点，只执行排在最前的一个，其余节点记 DedupOf 并在运行时共用其输出。
+// 汇点、没有输入或读取后序节点输出的节点不参与。合并后的节点不再读取自身输入，改为等价节点输出的一个消费者。
+static void MergeEquivalentNodes(CompiledFlowPlan& plan) {
+    const size_t nodeCount = plan.Nodes.size();
+    std::unordered_map<std::uint64_t, std::vector<int>> candidates;
+    bool merged = false;
+    for (size_t i = 0; i < nodeCount; i++) {
+        CompiledFlowPlan::Node& node = plan.Nodes[i];
+        if (!node.Factory || !node.Live || node.IsSink) continue;
+        if (node.ChannelInputs.empty() && node.ScalarInputs.empty()) continue;
+
+        bool eligible = true;
+        std::uint64_t h = FlowHashMix(node.TypeHash, node.PropertiesHash);
+        h = FlowHashMix(h, static_cast<std::uint64_t>(node.OutputCount));
+        const auto mixSlots = [&](const std::vector<CompiledFlowPlan::InputSlot>& slots) {
+            for (const auto& slot : slots) {
+                if (slot.SrcNodeIndex < 0 || static_cast<size_t>(slot.SrcNodeIndex) >= i) { eligible = false; return; }
+                const int d = plan.Nodes[static_cast<size_t>(slot.SrcNodeIndex)].DedupOf;
+                h = FlowHashMix(h, static_cast<std::uint64_t>(slot.PortIndex));
+                h = FlowHashMix(h, static_cast<std::uint64_t>(d >= 0 ? d : slot.SrcNodeIndex));
+                h = FlowHashMix(h, static_cast<std::uint64_t>(slot.SrcOutIdx));
+            }
+        };
+        mixSlots(node.ChannelInputs);
+        mixSlots(node.ScalarInputs);
+        if (!eligible) continue;
+
+        std::vector<int>& group = candidates[h];
+        for (int c : group) {
+            if (IsEquivalentNode(plan, c, static_cast<int>(i))) {
+                node.DedupOf = c;
+                merged = true;
+                break;
+            }
+        }
+        if (node.DedupOf < 0) group.push_back(static_cast<int>(i));
+    }
+    if (!merged) return;
+
+    // 逆序调整消费者计数：后面的合并节点先放弃对上游（可能也是合并节点）的读取，
+    // 上游合并节点的输出若因此无人读取，就不再占用等价节点的输出
+    std::vector<int>& counts = plan.OutputConsumerCounts;
+    for (size_t i = nodeCount; i-- > 0;) {
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        if (node.DedupOf < 0) continue;
+        for (const auto& slot : node.ChannelInputs) {
+            if (slot.SrcSlot >= 0 && slot.SrcSlot < static_cast<int>(counts.size()) && counts[static_cast<size_t>(slot.SrcSlot)] > 0) {
+                counts[static_cast<size_t>(slot.SrcSlot)] -= 1;
+            }
+        }
+        const CompiledFlowPlan::Node& target = plan.Nodes[static_cast<size_t>(node.DedupOf)];
+        for (int port = 0; port < node.OutputCount; port++) {
+            if (counts[static_cast<size_t>(node.OutputSlotBase + port)] > 0) {
+                counts[static_cast<size_t>(target.OutputSlotBase + port)] += 1;
+            }
+        }
+    }
+}
+
+// 可融合的结果处理节点：无状态、逐条目处理，模块实现了 BaseModule::ProcessFusedChain
+static bool IsFusibleResultNodeType(const std::string& type) {
+    static const std::unordered_set<std::string> kTypes = {
+        "post_process/result_filter", "features/result_filter",
+        "post_process/multi_category_filter", "features/multi_category_filter",
+        "post_process/result_filter_advanced", "features/result_filter_advanced",
+        "post_process/text_replacement", "features/text_replacement"
+    };
+    return kTypes.count(type) > 0;
+}
+
+// 链上节点：存活、已注册，除主对（端口 0/1）与标量端口外没有存活的输出
+static bool IsFusibleChainNode(const CompiledFlowPlan::Node& node) {
+    if (!node.Factory || !node.Live || node.IsSink || node.DedupOf >= 0 || !IsFusibleResultNodeType(node.Type)) return false;
+    std::uint64_t allowed = 0x3;
+    for (const auto& so : node.ScalarOutputs) {
+        if (so.PortIndex >= 0 && so.PortIndex < 64) allowed |= (static_cast<std::uint64_t>(1) << so.PortIndex);
+    }
+    return (node.LiveOutputMask & ~allowed) == 0;
+}
+
+// next 只有主对输入且分别来自 prev 的主对，prev 的主对也只流向 next
+static bool IsMainPairSuccessor(const CompiledFlowPlan& plan, int prev, int next) {
+    const CompiledFlowPlan::Node& pn = plan.Nodes[static_cast<size_t>(prev)];
+    const CompiledFlowPlan::Node& nn = plan.Nodes[static_cast<size_t>(next)];
+    if (!nn.ScalarInputs.empty() || nn.ChannelInputs.size() != 2 || pn.OutputCount < 2) return false;
+
+    bool hasImage = false;
+    bool hasResult = false;
+    for (const auto& slot : nn.ChannelInputs) {
+        if (slot.SrcNodeIndex != prev || slot.SrcOutIdx != slot.PortIndex) return false;
+        if (slot.PortIndex == 0 && slot.Channel == CompiledFlowPlan::ChannelKind::Image) hasImage = true;
+        else if (slot.PortIndex == 1 && slot.Channel == CompiledFlowPlan::ChannelKind::Result) hasResult = true;
+        else return false;
+    }
+    const size_t base = static_cast<size_t>(pn.OutputSlotBase);
+    return hasImage && hasResult &&
+        plan.OutputConsumerCounts[base] == 1 && plan.OutputConsumerCounts[base + 1] == 1;
+}
+
+// 把只以主对依次相连的可融合节点（至少两个）记为一条链：链首保存链上下标，其余节点指向链首
+static void FuseResultChains(CompiledFlowPlan& plan) {
+    const int nodeCount = static_cast<int>(plan.Nodes.size());
+    std::vector<int> successor(static_cast<size_t>(nodeCount), -1);
+    std::vector<char> hasPredecessor(static_cast<size_t>(nodeCount), 0);
+    for (int pi = 0; pi < nodeCount; pi++) {
+        const CompiledFlowPlan::Node& cn = plan.Nodes[static_cast<size_t>(pi)];
+        if (!IsFusibleChainNode(cn) || cn.ChannelInputs.empty()) continue;
+        const int prev = cn.ChannelInputs.front().SrcNodeIndex;
+        if (prev < 0 || prev >= pi || !IsFusibleChainNode(plan.Nodes[static_cast<size_t>(prev)])) continue;
+        if (!IsMainPairSuccessor(plan, prev, pi)) continue;
+        successor[static_cast<size_t>(prev)] = pi;
+        hasPredecessor[static_cast<size_t>(pi)] = 1;
+    }
+
+    for (int pi = 0; pi < nodeCount; pi++) {
+        if (hasPredecessor[static_cast<size_t>(pi)] || successor[static_cast<size_t>(pi)] < 0) continue;
+        std::vector<int> chain;
+        for (int cur = pi; cur >= 0; cur = successor[static_cast<size_t>(cur)]) chain.push_back(cur);
+        for (size_t k = 1; k < chain.size(); k++) plan.Nodes[static_cast<size_t>(chain[k])].FusedHead = pi;
+        plan.Nodes[static_cast<size_t>(pi)].FusedChain = std::move(chain);
+    }
+}
+
+std::shared_ptr<const CompiledFlowPlan> GraphExecutor::Compile(const std::vector<Json>& nodes) {
+    std::shared_ptr<CompiledFlowPlan> plan = std::make_shared<CompiledFlowPlan>();
+
+    // 1) 排序：按 order，其次按 id
+    std::vector<Json> ordered = nodes;
+    std::sort(ordered.begin(), ordered.end(), [](const Json& a, const Json& b) {
+        const int ao = ReadNodeOrder(a);
+        const int bo = ReadNodeOrder(b);
+        if (ao != bo) return ao < bo;
+        int aid = 0, bid = 0;
+        try { if (a.is_object() && a.contains("id")) aid = GraphExecutor::SafeToInt(a.at("id"), 0); } catch (...) {}
+        try { if (b.is_object() && b.contains("id")) bid = GraphExecutor::SafeToInt(b.at("id"), 0); } catch (...) {}
+        return aid < bid;
+    });
+
+    // 2) linkId -> (源节点在 ordered 中的下标, srcOutIdx)
+    const auto linkToSource = BuildLinkSourceMap(ordered);
+
+    // 3) 节点与输出端口：ordered 下标 -> plan 下标（非 object 节点不进入计划）
+    std::vector<int> planIndexOf(ordered.size(), -1);
+    plan->Nodes.reserve(ordered.size());
+    int slotCount = 0;
+
+    for (int i = 0; i < static_cast<int>(ordered.size()); i++) {
+        const Json& node = ordered[static_cast<size_t>(i)];
+        if (!node.is_object()) continue;
+
+        CompiledFlowPlan::Node cn;
+        cn.Type = node.contains("type") ? SafeToString(node.at("type"), "") : "";
+        cn.NodeId = node.contains("id") ? SafeToInt(node.at("id"), i) : i;
+        cn.Title = node.contains("title") ? SafeToString(node.at("title"), "") : "";
+
+        try {
+            if (node.contains("properties") && node.at("properties").is_object()) {
+                cn.Properties = node.at("properties");
+            }
+        } catch (...) { cn.Properties = Json::object(); }
+        cn.ResolvedProperties = cn.Properties;
+        try { NormalizeBboxProperties(cn.ResolvedProperties); } catch (...) {}
+        cn.TypeHash = FlowHashBytes(0, cn.Type.data(), cn.Type.size());
+        cn.PropertiesHash = FlowHashJson(0, cn.ResolvedProperties);
+
+        cn.Factory = ModuleRegistry::Get(cn.Type);
+        cn.IsSink = IsSinkNodeType(cn.Type);
+
+        try {
+            if (node.contains("outputs")) {
+                const auto outPorts = AsArrayOfObjects(node.at("outputs"));
+                cn.OutputCount = static_cast<int>(outPorts.size());
+                for (int oi = 0; oi < static_cast<int>(outPorts.size()); oi++) {
+                    const auto& meta = outPorts[static_cast<size_t>(oi)];
+                    if (oi < 64 && meta.contains("links")) {
+                        const Json& links = meta.at("links");
+                        if (links.is_array() && !links.empty()) {
+                            cn.OutputMask |= (static_cast<std::uint64_t>(1) << oi);
+                        }
+                    }
+
+                    const std::string otype = meta.contains("type") ? ToLower(SafeToString(meta.at("type"), "")) : "";
+                    if (!IsScalarPortType(otype)) continue;
+                    CompiledFlowPlan::ScalarOutput so;
+                    so.PortIndex = oi;
+                    so.Kind = ParseScalarKind(otype);
+                    if (meta.contains("name") && meta.at("name").is_string()) so.Name = meta.at("name").get<std::string>();
+                    so.IndexName = std::to_string(oi);
+                    cn.ScalarOutputs.push_back(std::move(so));
                 }
-            } catch (...) {
-                linkId = -1;
             }
+        } catch (...) {}
+        cn.OutputSlotBase = slotCount;
+        slotCount += cn.OutputCount;
+
+        planIndexOf[static_cast<size_t>(i)] = static_cast<int>(plan->Nodes.size());
+        plan->Nodes.push_back(std::move(cn));
+    }
+
+    plan->OutputConsumerCounts.assign(static_cast<size_t>(slotCount), 0);
+
+    // 4) 输入端口：源节点下标、全局槽位、通道类型与消费者计数
+    for (int i = 0; i < static_cast<int>(ordered.size()); i++) {
+        const int pi = planIndexOf[static_cast<size_t>(i)];
+        if (pi < 0) continue;
+        const Json& node = ordered[static_cast<size_t>(i)];
+        CompiledFlowPlan::Node& cn = plan->Nodes[static_cast<size_t>(pi)];
+        if (!node.contains("inputs")) continue;
+
+        const auto inMetaList = AsArrayOfObjects(node.at("inputs"));
+        for (int ii = 0; ii < static_cast<int>(inMetaList.size()); ii++) {
+            const auto& inp = inMetaList[static_cast<size_t>(ii)];
+            const int linkId = inp.contains("link") ? SafeToInt(inp.at("link"), -1) : -1;
+            const std::string dtypeLower = inp.contains("type") ? ToLower(SafeToString(inp.at("type"), "")) : "";
             if (linkId < 0) continue;
             auto itSrc = linkToSource.find(linkId);
             if (itSrc == linkToSource.end()) continue;
-            const int srcNodeId = itSrc->second.first;
-            const int srcOutIdx = itSrc->second.second;
-            counts[BuildOutputPortKey(srcNodeId, srcOutIdx)] += 1;
+
+            const int srcIndex = planIndexOf[static_cast<size_t>(itSrc->second.first)];
+            if (srcIndex < 0) continue;
+            const CompiledFlowPlan::Node& src = plan->Nodes[static_cast<size_t>(srcIndex)];
+
+            CompiledFlowPlan::InputSlot slot;
+            slot.PortIndex = ii;
+            slot.PairIndex = ii / 2;
+            slot.SrcNodeIndex = srcIndex;
+            slot.SrcOutIdx = itSrc->second.second;
+            slot.SrcSlot = src.OutputSlotBase + slot.SrcOutIdx;
+
+            if (IsScalarPortType(dtypeLower)) {
+                // 标量在 Run() 中单独注入
+                if (inp.contains("name") && inp.at("name").is_string()) slot.Name = inp.at("name").get<std::string>();
+                cn.ScalarInputs.push_back(std::move(slot));
+                continue;
+            }
+
+            slot.Channel = ParseChannelKind(dtypeLower);
+            cn.ChannelInputs.push_back(std::move(slot));
         }
     }
-    return counts;
-}
-
-std::map<int, ModuleChannel> GraphExecutor::CollectInputPairs(
-    const Json& node,
-    const std::unordered_map<int, std::pair<int, int>>& linkToSource,
-    std::unordered_map<long long, int>* remainingConsumers) {
 
-    std::map<int, ModuleChannel> pairs;
-    if (!node.is_object()) return pairs;
-    if (!node.contains("inputs")) return pairs;
+    // 5) 可达性裁剪：存活标记、存活输出掩码与存活消费者计数
+    {
+        FlowLiveness liveness = ComputeLiveness(*plan, std::vector<char>());
+        for (size_t pi = 0; pi < plan->Nodes.size(); pi++) {
+            plan->Nodes[pi].Live = liveness.Live[pi] != 0;
+            plan->Nodes[pi].LiveOutputMask = liveness.OutputMasks[pi];
+        }
+        plan->OutputConsumerCounts = std::move(liveness.ConsumerCounts);
+    }
 
-    const auto inMetaList = AsArrayOfObjects(node.at("inputs"));
-    if (inMetaList.empty()) return pairs;
+    // 6) 等价节点合并：重复的节点共用排在最前的等价节点的输出
+    MergeEquivalentNodes(*plan);
 
-    for (int ii = 0; ii < static_cast<int>(inMetaList.size()); ii++) {
-        const auto& inp = inMetaList[static_cast<size_t>(ii)];
-        if (!inp.is_object()) continue;
+    // 7) 结果处理链融合：相邻的逐条目结果处理节点只以主对相连时由链首一次执行
+    FuseResultChains(*plan);
 
-        const int linkId = inp.contains("link") ? SafeToInt(inp.at("link"), -1) : -1;
-        const std::string dtype = inp.contains("type") ? SafeToString(inp.at("type"), "") : "";
-        const std::string dtypeLower = ToLower(dtype);
+    // 8) 依赖关系：只有排在前面的源节点构成依赖（与顺序执行时“后序节点尚未产出”的语义一致）；
+    //    合并节点另依赖其等价节点
+    for (int pi = 0; pi < static_cast<int>(plan->Nodes.size()); pi++) {
+        CompiledFlowPlan::Node& cn = plan->Nodes[static_cast<size_t>(pi)];
+        std::vector<int> deps;
+        for (const auto& slot : cn.ChannelInputs) {
+            if (slot.SrcNodeIndex < pi) deps.push_back(slot.SrcNodeIndex);
+        }
+        for (const auto& slot : cn.ScalarInputs) {
+            if (slot.SrcNodeIndex < pi) deps.push_back(slot.SrcNodeIndex);
+        }
+        if (cn.DedupOf >= 0) deps.push_back(cn.DedupOf);
+        std::sort(deps.begin(), deps.end());
+        deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+        for (int d : deps) {
+            plan->Nodes[static_cast<size_t>(d)].Dependents.push_back(pi);
+        }
+        cn.Dependencies = std::move(deps);
+    }
 
-        if (IsScalarPortType(dtypeLower)) {
-            // 标量在 Run() 中单独注入
-            continue;
+    // 9) 流水线分段：model/* 与其余节点按计划顺序交替成段
+    for (int pi = 0; pi < static_cast<int>(plan->Nodes.size()); pi++) {
+        const bool isModel = plan->Nodes[static_cast<size_t>(pi)].Type.rfind("model/", 0) == 0;
+        if (plan->Stages.empty() || plan->Stages.back().IsModel != isModel) {
+            CompiledFlowPlan::Stage stage;
+            stage.Begin = pi;
+            stage.IsModel = isModel;
+            plan->Stages.push_back(stage);
         }
+        plan->Stages.back().End = pi + 1;
+    }
+
+    // 10) 预生成执行代码：按结构哈希查找（生成代码与属性无关，属性变化后仍可使用）
+    plan->StructureHash = ComputeStructureHash(*plan);
+    plan->Generated = GeneratedFlowRegistry::Find(plan->StructureHash);
+    return plan;
+}
 
-        if (linkId < 0) continue;
-        auto itSrc = linkToSource.find(linkId);
-        if (itSrc == linkToSource.end()) continue;
+std::map<int, SharedChannel> GraphExecutor::CollectInputPairs(
+    size_t nodeIndex,
+    std::vector<int>* remainingConsumers) {
 
-        const int pairIdx = ii / 2;
-        ModuleChannel& ch = pairs[pairIdx];
+    const CompiledFlowPlan::Node& node = _plan->Nodes[nodeIndex];
+    std::map<int, SharedChannel> pairs;
+    for (const auto& slot : node.ChannelInputs) {
+        SharedChannel& ch = pairs[slot.PairIndex];
 
-        const int srcNodeId = itSrc->second.first;
-        const int srcOutIdx = itSrc->second.second;
-        auto itOut = _nodeExecMap.find(srcNodeId);
-        if (itOut == _nodeExecMap.end()) continue;
+        // 只读取排在前面且已产出的源节点
+        const size_t srcIndex = static_cast<size_t>(slot.SrcNodeIndex);
+        if (srcIndex >= nodeIndex || !_nodeExecuted[srcIndex]) continue;
 
-        const int srcPairIdx = srcOutIdx / 2;
-        NodeExecOutput& srcOut = itOut->second;
+        const int srcPairIdx = slot.SrcOutIdx / 2;
+        NodeExecOutput& srcOut = _nodeExecs[srcIndex];
 
-        ModuleChannel* picked = nullptr;
+        SharedChannel* picked = nullptr;
         if (srcPairIdx == 0) {
             picked = &srcOut.Main;
         } else {
@@ -311,243 +722,794 @@ std::map<int, ModuleChannel> GraphExecutor::CollectInputPairs(
         if (picked == nullptr) continue;
 
         bool moveNow = false;
-        if (remainingConsumers != nullptr) {
-            const long long key = BuildOutputPortKey(srcNodeId, srcOutIdx);
-            auto itRemain = remainingConsumers->find(key);
-            if (itRemain != remainingConsumers->end()) {
-                if (itRemain->second <= 1) {
-                    moveNow = true;
-                    itRemain->second = 0;
-                } else {
-                    itRemain->second -= 1;
-                }
+        if (remainingConsumers != nullptr &&
+            slot.SrcSlot >= 0 && slot.SrcSlot < static_cast<int>(remainingConsumers->size())) {
+            int& remain = (*remainingConsumers)[static_cast<size_t>(slot.SrcSlot)];
+            if (remain <= 1) {
+                moveNow = true;
+                remain = 0;
+            } else {
+                remain -= 1;
             }
         }
 
-        if (dtypeLower == "image_chan") {
+        // 最后一个消费者取走槽位的引用，其余消费者共享同一份只读数据（不复制）
+        switch (slot.Channel) {
+        case CompiledFlowPlan::ChannelKind::Image:
             if (moveNow) {
                 ch.ImageList = std::move(picked->ImageList);
             } else {
                 ch.ImageList = picked->ImageList;
             }
-        } else if (dtypeLower == "result_chan") {
+            break;
+        case CompiledFlowPlan::ChannelKind::Result:
             if (moveNow) {
                 ch.ResultList = std::move(picked->ResultList);
+                ch.Detections = std::move(picked->Detections);
             } else {
                 ch.ResultList = picked->ResultList;
+                ch.Detections = picked->Detections;
             }
-        } else if (dtypeLower == "template_chan" || dtypeLower == "template") {
+            break;
+        case CompiledFlowPlan::ChannelKind::Template:
             if (moveNow) {
                 ch.TemplateList = std::move(picked->TemplateList);
             } else {
                 ch.TemplateList = picked->TemplateList;
             }
-        } else {
+            break;
+        default:
             // 未知通道类型：忽略
+            break;
         }
     }
 
     return pairs;
 }
 
-std::unordered_map<int, NodePublicOutput> GraphExecutor::Run() {
-    _nodeExecMap.clear();
-    _publicOutputs.clear();
-    _lastNodeTimings.clear();
-    _lastUnregisteredNodes.clear();
+GraphExecutor::NodeInputs GraphExecutor::GatherNodeInputs(size_t nodeIndex, std::vector<int>* remainingConsumers) {
+    NodeInputs inputs;
 
-    // 1) 排序：按 order，其次按 id
-    std::vector<Json> ordered = _nodes;
-    std::sort(ordered.begin(), ordered.end(), [](const Json& a, const Json& b) {
-        const int ao = ReadNodeOrder(a);
-        const int bo = ReadNodeOrder(b);
-        if (ao != bo) return ao < bo;
-        int aid = 0, bid = 0;
-        try { if (a.is_object() && a.contains("id")) aid = GraphExecutor::SafeToInt(a.at("id"), 0); } catch (...) {}
-        try { if (b.is_object() && b.contains("id")) bid = GraphExecutor::SafeToInt(b.at("id"), 0); } catch (...) {}
-        return aid < bid;
-    });
+    // 聚合输入（主对 + 额外对）
+    auto inputPairs = CollectInputPairs(nodeIndex, remainingConsumers);
+    auto itMain = inputPairs.find(0);
+    if (itMain != inputPairs.end()) inputs.Main = std::move(itMain->second);
+    for (auto& kv : inputPairs) {
+        if (kv.first <= 0) continue;
+        inputs.Extra.push_back(std::move(kv.second));
+    }
 
-    // 2) linkId -> (srcNodeId, srcOutIdx)
-    const auto linkToSource = BuildLinkSourceMap(ordered);
-    std::unordered_map<long long, int> remainingConsumers = BuildOutputConsumerCount(ordered, linkToSource);
+    GatherScalarInputs(nodeIndex, inputs);
+    return inputs;
+}
 
-    // 3) 遍历执行
-    for (int i = 0; i < static_cast<int>(ordered.size()); i++) {
-        const Json& node = ordered[static_cast<size_t>(i)];
-        if (!node.is_object()) continue;
+// 标量输入（按索引与名称）：只读取排在前面且已产出的源节点
+void GraphExecutor::GatherScalarInputs(size_t nodeIndex, NodeInputs& inputs) const {
+    const CompiledFlowPlan::Node& node = _plan->Nodes[nodeIndex];
+    for (const auto& slot : node.ScalarInputs) {
+        const size_t srcIndex = static_cast<size_t>(slot.SrcNodeIndex);
+        if (srcIndex >= nodeIndex || !_nodeExecuted[srcIndex]) continue;
+        const auto& scalars = _nodePublics[srcIndex].ScalarsByIndex;
+        auto itVal = scalars.find(slot.SrcOutIdx);
+        if (itVal == scalars.end()) continue;
+
+        inputs.ScalarsByIndex[slot.PortIndex] = itVal->second;
+        if (!slot.Name.empty()) inputs.ScalarsByName[slot.Name] = itVal->second;
+    }
+}
 
-        const std::string type = node.contains("type") ? SafeToString(node.at("type"), "") : "";
-        const int nodeId = node.contains("id") ? SafeToInt(node.at("id"), i) : i;
-        const std::string title = node.contains("title") ? SafeToString(node.at("title"), "") : "";
+std::unique_ptr<BaseModule> GraphExecutor::CreateModule(const CompiledFlowPlan::Node& node, const Json& overrides) const {
+    if (!node.Factory) return std::unique_ptr<BaseModule>();
+    if (overrides.is_object() && !overrides.empty()) {
+        Json props = node.Properties;
+        try { ApplyInferParamOverrides(props, overrides); } catch (...) {}
+        try { NormalizeBboxProperties(props); } catch (...) {}
+        return node.Factory(node.NodeId, node.Title, props, _context);
+    }
+    return node.Factory(node.NodeId, node.Title, node.ResolvedProperties, _context);
+}
 
-        Json props = Json::object();
-        try {
-            if (node.contains("properties") && node.at("properties").is_object()) {
-                props = node.at("properties");
-            }
-        } catch (...) { props = Json::object(); }
+// 每个节点保留的备用实例上限（按属性哈希区分，超出时丢弃最早换下的）
+static const size_t kMaxSpareModulesPerNode = 2;
+
+void GraphExecutor::PrepareModuleInstances() {
+    if (_instances == nullptr) return;
+    ModuleInstanceSet& set = *_instances;
+    const CompiledFlowPlan& plan = *_plan;
+    const size_t nodeCount = plan.Nodes.size();
+    if (set.Modules.size() != nodeCount) {
+        set.Modules.clear();
+        set.Modules.resize(nodeCount);
+        set.Spares.clear();
+        set.Spares.resize(nodeCount);
+        set.PropertiesHashes.resize(nodeCount);
+        for (size_t i = 0; i < nodeCount; i++) set.PropertiesHashes[i] = plan.Nodes[i].PropertiesHash;
+        set.OverrideSignature.clear();
+    }
+
+    // 覆盖项与上次运行相同：全部实例直接复用
+    const std::string signature = _runOverrides.empty() ? std::string() : _runOverrides.dump();
+    if (set.OverrideSignature == signature) return;
+    set.OverrideSignature = signature;
+
+    // 只替换生效属性变化的节点：当前实例换入备用，再按新属性哈希取回备用实例（没有则运行时构造）
+    for (size_t i = 0; i < nodeCount; i++) {
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        if (!node.Factory) continue;
+        std::uint64_t hash = node.PropertiesHash;
+        if (!_runOverrides.empty()) {
+            Json props = node.Properties;
+            try { ApplyInferParamOverrides(props, _runOverrides); } catch (...) {}
+            try { NormalizeBboxProperties(props); } catch (...) {}
+            hash = FlowHashJson(0, props);
+        }
+        if (hash == set.PropertiesHashes[i]) continue;
+
+        std::vector<std::pair<std::uint64_t, std::unique_ptr<BaseModule>>>& spares = set.Spares[i];
+        std::unique_ptr<BaseModule> current = std::move(set.Modules[i]);
+        for (auto it = spares.begin(); it != spares.end(); ++it) {
+            if (it->first != hash) continue;
+            set.Modules[i] = std::move(it->second);
+            spares.erase(it);
+            break;
+        }
+        if (current) {
+            current->Context = &set.Context;
+            spares.emplace_back(set.PropertiesHashes[i], std::move(current));
+            if (spares.size() > kMaxSpareModulesPerNode) spares.erase(spares.begin());
+        }
+        set.PropertiesHashes[i] = hash;
+    }
+}
+
+// 运行结束（或换用实例集）后模块改指向实例集的长期上下文，不再引用本次运行的上下文
+void GraphExecutor::ParkModuleInstances() {
+    if (_instances == nullptr) return;
+    for (auto& module : _instances->Modules) {
+        if (module) module->Context = &_instances->Context;
+    }
+}
+
+BaseModule* GraphExecutor::AcquireModule(size_t nodeIndex, const Json& overrides, std::unique_ptr<BaseModule>& transientModule) {
+    const CompiledFlowPlan::Node& node = _plan->Nodes[nodeIndex];
+    if (_instances != nullptr) {
+        std::unique_ptr<BaseModule>& persistent = _instances->Modules[nodeIndex];
+        if (persistent) {
+            persistent->ResetForRun(_context);
+        } else {
+            persistent = CreateModule(node, overrides);
+        }
+        return persistent.get();
+    }
+    transientModule = CreateModule(node, overrides);
+    return transientModule.get();
+}
 
+// 列式结果物化为 result_list（供只处理 JSON 的模块使用）
+static void MaterializeDetections(ModuleChannel& ch) {
+    if (!ch.Detections) return;
+    ch.ResultList = ch.Detections->ToResultList();
+    ch.Detections.reset();
+}
+
+void GraphExecutor::ExecuteFusedChain(size_t headIndex, BaseModule* head, NodeInputs&& inputs) {
+    const std::vector<int>& chain = _plan->Nodes[headIndex].FusedChain;
+    std::vector<std::unique_ptr<BaseModule>> transientModules(chain.size());
+    std::vector<BaseModule*> modules(chain.size(), nullptr);
+    modules[0] = head;
+    bool complete = true;
+    for (size_t k = 0; k < chain.size(); k++) {
+        const size_t idx = static_cast<size_t>(chain[k]);
+        if (k > 0) modules[k] = AcquireModule(idx, _runOverrides, transientModules[k]);
+        if (modules[k] == nullptr) { complete = false; break; }
+        modules[k]->CurrentOutputMask = _runOutputMasks[idx];
+    }
+
+    // 列式输入物化为只读副本；融合不适用时原输入交给逐节点执行
+    const Json* results = &inputs.Main.Results();
+    Json materialized;
+    if (inputs.Main.Detections) {
+        materialized = inputs.Main.Detections->ToResultList();
+        results = &materialized;
+    }
+
+    ModuleIO io;
+    std::vector<double> stageMs;
+    bool fused = false;
+    // 融合路径不向模块传递模板；链首有模板输入时逐节点执行，模板按原路径交给链首模块
+    if (complete && inputs.Main.Templates().empty()) {
         try {
-            const Json inferParams = _context->Get<Json>("infer_params", Json::object());
-            ApplyInferParamOverrides(props, inferParams);
-        } catch (...) {}
+            fused = head->ProcessFusedChain(modules, inputs.Main.Images(), *results, io, stageMs);
+        } catch (...) {
+            fused = false;
+        }
+    }
 
-        try { NormalizeBboxProperties(props); } catch (...) {}
+    if (!fused) {
+        // 输入不满足融合前提：按链顺序逐节点执行，主对直接移交给下一个节点
+        for (size_t k = 0; k < chain.size() && modules[k] != nullptr; k++) {
+            const size_t idx = static_cast<size_t>(chain[k]);
+            ExecuteNode(idx, modules[k], std::move(inputs));
+            if (k + 1 >= chain.size()) break;
+            SharedChannel& prevMain = _nodeExecs[idx].Main;
+            inputs = NodeInputs();
+            inputs.Main.ImageList = std::move(prevMain.ImageList);
+            inputs.Main.ResultList = std::move(prevMain.ResultList);
+            inputs.Main.Detections = std::move(prevMain.Detections);
+        }
+        return;
+    }
 
-        auto factory = ModuleRegistry::Get(type);
-        if (!factory) {
-            LogModuleNotRegistered("run", type, nodeId, title);
-            UnregisteredNodeInfo info;
-            info.NodeId = nodeId;
-            info.NodeType = type;
-            info.NodeTitle = title;
-            _lastUnregisteredNodes.push_back(std::move(info));
-            continue;
+    // 链尾输出进入链尾槽位供下游路由；耗时与标量输出仍按原节点记录
+    NodeExecOutput& tailOut = _nodeExecs[static_cast<size_t>(chain.back())];
+    tailOut.Main = SharedChannel(ModuleChannel(std::move(io.ImageList), std::move(io.ResultList), std::move(io.TemplateList)));
+    for (size_t k = 0; k < chain.size(); k++) {
+        const size_t idx = static_cast<size_t>(chain[k]);
+        PublishScalarOutputs(idx, modules[k]);
+        _nodeElapsedMs[idx] = k < stageMs.size() && stageMs[k] > 0.0 ? stageMs[k] : 0.0;
+        _nodeExecuted[idx] = 1;
+    }
+}
+
+void GraphExecutor::ExecuteDeduplicated(size_t nodeIndex, std::vector<int>* remainingConsumers) {
+    const CompiledFlowPlan::Node& node = _plan->Nodes[nodeIndex];
+    const size_t srcIndex = static_cast<size_t>(node.DedupOf);
+    const CompiledFlowPlan::Node& src = _plan->Nodes[srcIndex];
+    NodeExecOutput& from = _nodeExecs[srcIndex];
+    NodeExecOutput& to = _nodeExecs[nodeIndex];
+
+    // 编译期本节点有消费者的输出端口计为等价节点对应端口的一个消费者：
+    // 逐对递减，整对都没有剩余消费者时取走引用，否则共享
+    const auto takePair = [&](int pairIndex, SharedChannel& in, SharedChannel& out) {
+        bool last = true;
+        for (int port = pairIndex * 2; port < pairIndex * 2 + 2 && port < src.OutputCount; port++) {
+            const size_t slot = static_cast<size_t>(src.OutputSlotBase + port);
+            if (remainingConsumers == nullptr || slot >= remainingConsumers->size()) { last = false; continue; }
+            int& remain = (*remainingConsumers)[slot];
+            if (_plan->OutputConsumerCounts[static_cast<size_t>(node.OutputSlotBase + port)] > 0 && remain > 0) remain -= 1;
+            if (remain > 0) last = false;
+        }
+        if (last) {
+            out = std::move(in);
+        } else {
+            out = in;
         }
+    };
+    takePair(0, from.Main, to.Main);
+    to.Extra.resize(from.Extra.size());
+    for (size_t k = 0; k < from.Extra.size(); k++) {
+        takePair(static_cast<int>(k) + 1, from.Extra[k], to.Extra[k]);
+    }
+
+    _nodePublics[nodeIndex].ScalarsByIndex = _nodePublics[srcIndex].ScalarsByIndex;
+    _nodeGateClosed[nodeIndex] = _nodeGateClosed[srcIndex];
+    if (_nodeCache != nullptr) _nodeFingerprints[nodeIndex] = _nodeFingerprints[srcIndex];
+    _nodeElapsedMs[nodeIndex] = 0.0;
+    _nodeDeduplicated[nodeIndex] = 1;
+    _nodeExecuted[nodeIndex] = 1;
+}
 
-        std::unique_ptr<BaseModule> module = factory(nodeId, title, props, _context);
-        if (!module) continue;
+void GraphExecutor::ExecuteNode(size_t nodeIndex, BaseModule* module, NodeInputs&& inputs) {
+    // 节点输出缓存：命中时直接复用输出，不调用模块（输入已按消费者计数取走，直接丢弃）
+    bool cacheable = false;
+    if (_nodeCache != nullptr) {
+        cacheable = ComputeNodeFingerprint(nodeIndex, module);
+        if (cacheable && TryRestoreFromCache(nodeIndex)) return;
+    }
 
-        // 聚合输入（主对 + 额外对）
-        auto inputPairs = CollectInputPairs(node, linkToSource, &remainingConsumers);
-        ModuleChannel mainCh;
-        auto itMain = inputPairs.find(0);
-        if (itMain != inputPairs.end()) mainCh = std::move(itMain->second);
+    // 额外对与模板交给模块持有：仍被其他消费者共享时复制，否则直接取走
+    const bool acceptsBatch = module->AcceptsDetectionBatch();
+    module->ExtraInputsIn.clear();
+    module->ExtraInputsIn.reserve(inputs.Extra.size());
+    for (auto& extra : inputs.Extra) {
+        module->ExtraInputsIn.push_back(extra.TakeChannel());
+        if (!acceptsBatch) MaterializeDetections(module->ExtraInputsIn.back());
+    }
+    module->MainTemplateList = inputs.Main.TakeTemplates();
+    module->ScalarInputsByIndex = std::move(inputs.ScalarsByIndex);
+    module->ScalarInputsByName = std::move(inputs.ScalarsByName);
+    module->CurrentOutputMask = _runOutputMasks[nodeIndex];
+
+    // 主对结果：只读模块直接引用共享数据；需可写结果的模块（ProcessOwned）写时复制
+    Json ownedResults;
+    const Json* results = &inputs.Main.Results();
+    if (acceptsBatch) {
+        module->MainDetections = std::move(inputs.Main.Detections);
+    } else if (inputs.Main.Detections) {
+        ownedResults = inputs.Main.Detections->ToResultList();
+        inputs.Main.Detections.reset();
+        results = &ownedResults;
+    }
+    const bool owned = module->TakesOwnedResultList();
+    if (owned && results != &ownedResults) ownedResults = inputs.Main.TakeResults();
+
+    // 执行当前节点并记录节点耗时（用于压测模块耗时统计）
+    const auto nodeStart = std::chrono::steady_clock::now();
+    ModuleIO io = owned
+        ? module->ProcessOwned(inputs.Main.Images(), std::move(ownedResults))
+        : module->Process(inputs.Main.Images(), *results);
+    const auto nodeEnd = std::chrono::steady_clock::now();
+    const double elapsedMs = std::chrono::duration<double, std::milli>(nodeEnd - nodeStart).count();
+    _nodeElapsedMs[nodeIndex] = elapsedMs > 0.0 ? elapsedMs : 0.0;
+
+    // 保存该节点的全部输出通道（供后续路由）
+    NodeExecOutput& nodeOut = _nodeExecs[nodeIndex];
+    ModuleChannel mainOut(std::move(io.ImageList), std::move(io.ResultList), std::move(io.TemplateList));
+    mainOut.Detections = std::move(io.Detections);
+    nodeOut.Main = SharedChannel(std::move(mainOut));
+    module->MainDetections.reset();
+    nodeOut.Extra.clear();
+    nodeOut.Extra.reserve(module->ExtraOutputs.size());
+    for (auto& extra : module->ExtraOutputs) nodeOut.Extra.emplace_back(std::move(extra));
+    module->ExtraOutputs.clear();
+
+    PublishScalarOutputs(nodeIndex, module);
+    _nodeGateClosed[nodeIndex] = module->GateClosed ? 1 : 0;
+
+    if (_nodeCache != nullptr) StoreToCache(nodeIndex, cacheable);
+    _nodeExecuted[nodeIndex] = 1;
+}
 
-        std::vector<ModuleChannel> extraChannels;
-        for (auto& kv : inputPairs) {
-            if (kv.first <= 0) continue;
-            extraChannels.push_back(std::move(kv.second));
+// 标量输出：依据编译期的输出端口元信息，从 module->ScalarOutputsByName 取值并按索引写入
+void GraphExecutor::PublishScalarOutputs(size_t nodeIndex, const BaseModule* module) {
+    const CompiledFlowPlan::Node& node = _plan->Nodes[nodeIndex];
+    NodePublicOutput& pub = _nodePublics[nodeIndex];
+    for (const auto& so : node.ScalarOutputs) {
+        Json val;
+        bool has = false;
+        if (!so.Name.empty()) {
+            auto it = module->ScalarOutputsByName.find(so.Name);
+            if (it != module->ScalarOutputsByName.end()) { val = it->second; has = true; }
+        }
+        if (!has) {
+            auto it2 = module->ScalarOutputsByName.find(so.IndexName);
+            if (it2 != module->ScalarOutputsByName.end()) { val = it2->second; has = true; }
         }
 
-        module->ExtraInputsIn = std::move(extraChannels);
-        module->MainTemplateList = std::move(mainCh.TemplateList);
+        // 类型规范化
+        if (so.Kind == CompiledFlowPlan::ScalarKind::Bool) {
+            bool b = false;
+            try { b = val.is_boolean() ? val.get<bool>() : (val.is_number_integer() ? (val.get<int>() != 0) : (val.is_string() ? (val.get<std::string>() == "true" || val.get<std::string>() == "1") : false)); } catch (...) { b = false; }
+            pub.ScalarsByIndex[so.PortIndex] = b;
+        } else if (so.Kind == CompiledFlowPlan::ScalarKind::Int) {
+            int x = 0;
+            try { x = val.is_number_integer() ? val.get<int>() : (val.is_number() ? static_cast<int>(std::llround(val.get<double>())) : (val.is_string() ? std::stoi(val.get<std::string>()) : 0)); } catch (...) { x = 0; }
+            pub.ScalarsByIndex[so.PortIndex] = x;
+        } else {
+            // str/string/scalar -> string
+            std::string s;
+            try { s = val.is_string() ? val.get<std::string>() : val.dump(); } catch (...) { s = ""; }
+            pub.ScalarsByIndex[so.PortIndex] = s;
+        }
+    }
+}
 
-        // 标量输入注入（按索引与名称）
-        std::map<int, Json> scalarInputsByIdx;
-        std::map<std::string, Json> scalarInputsByName;
-        try {
-            if (node.contains("inputs")) {
-                const auto inMetaList = AsArrayOfObjects(node.at("inputs"));
-                for (int ii = 0; ii < static_cast<int>(inMetaList.size()); ii++) {
-                    const auto& inp = inMetaList[static_cast<size_t>(ii)];
-                    if (!inp.is_object()) continue;
-                    const int linkId = inp.contains("link") ? SafeToInt(inp.at("link"), -1) : -1;
-                    const std::string dtype = inp.contains("type") ? SafeToString(inp.at("type"), "") : "";
-                    const std::string kind = ToLower(dtype);
-                    if (!IsScalarPortType(kind)) continue;
-                    if (linkId < 0) continue;
-                    auto itSrc = linkToSource.find(linkId);
-                    if (itSrc == linkToSource.end()) continue;
-                    const int srcNodeId2 = itSrc->second.first;
-                    const int srcOutIdx2 = itSrc->second.second;
-
-                    auto itPub = _publicOutputs.find(srcNodeId2);
-                    if (itPub == _publicOutputs.end()) continue;
-                    auto itVal = itPub->second.ScalarsByIndex.find(srcOutIdx2);
-                    if (itVal == itPub->second.ScalarsByIndex.end()) continue;
-
-                    scalarInputsByIdx[ii] = itVal->second;
-                    if (inp.contains("name") && inp.at("name").is_string()) {
-                        const std::string inName = inp.at("name").get<std::string>();
-                        if (!inName.empty()) scalarInputsByName[inName] = itVal->second;
-                    }
-                }
+bool GraphExecutor::ComputeNodeFingerprint(size_t nodeIndex, BaseModule* module) {
+    const CompiledFlowPlan::Node& node = _plan->Nodes[nodeIndex];
+
+    bool cacheable = !node.IsSink && module->IsOutputCacheable();
+    std::uint64_t identity = 0;
+    if (cacheable) {
+        try { identity = module->OutputCacheIdentity(); } catch (...) { cacheable = false; }
+    }
+
+    // 有 infer_params 覆盖项时按模块实际属性计算，只有被覆盖项影响的节点指纹变化
+    const std::uint64_t propsHash = _runOverrides.empty() ? node.PropertiesHash : FlowHashJson(0, module->Properties);
+    // 节点 id 参与指纹：模块可按 NodeId 区分输出，相同配置的不同节点不共享条目
+    std::uint64_t h = FlowHashMix(node.TypeHash, static_cast<std::uint64_t>(static_cast<std::int64_t>(node.NodeId)));
+    h = FlowHashMix(h, propsHash);
+    h = FlowHashMix(h, _runOutputMasks[nodeIndex]);
+    h = FlowHashMix(h, identity);
+
+    // 上游血缘：只有排在前面的源节点已产出（与输入收集语义一致）
+    const auto mixInput = [this, nodeIndex, &h](const CompiledFlowPlan::InputSlot& slot) {
+        if (slot.SrcNodeIndex < 0 || static_cast<size_t>(slot.SrcNodeIndex) >= nodeIndex) return;
+        h = FlowHashMix(h, static_cast<std::uint64_t>(slot.PortIndex));
+        h = FlowHashMix(h, _nodeFingerprints[static_cast<size_t>(slot.SrcNodeIndex)]);
+        h = FlowHashMix(h, static_cast<std::uint64_t>(slot.SrcOutIdx));
+    };
+    for (const auto& slot : node.ChannelInputs) mixInput(slot);
+    for (const auto& slot : node.ScalarInputs) mixInput(slot);
+
+    _nodeFingerprints[nodeIndex] = h;
+    return cacheable;
+}
+
+bool GraphExecutor::TryRestoreFromCache(size_t nodeIndex) {
+    std::shared_ptr<const FlowNodeCacheEntry> entry = _nodeCache->Find(_nodeFingerprints[nodeIndex]);
+    if (!entry) return false;
+
+    NodeExecOutput& nodeOut = _nodeExecs[nodeIndex];
+    nodeOut.Main = entry->Main;
+    nodeOut.Extra = entry->Extra;
+    _nodePublics[nodeIndex].ScalarsByIndex = entry->ScalarsByIndex;
+    _nodeElapsedMs[nodeIndex] = 0.0;
+    _nodeFromCache[nodeIndex] = 1;
+    _nodeExecuted[nodeIndex] = 1;
+    return true;
+}
+
+void GraphExecutor::StoreToCache(size_t nodeIndex, bool cacheable) {
+    const NodeExecOutput& nodeOut = _nodeExecs[nodeIndex];
+    if (!cacheable) {
+        // 输出依赖外部状态：以输出内容作为指纹，内容不变时下游仍可命中
+        if (!_plan->Nodes[nodeIndex].IsSink) {
+            std::uint64_t h = FlowHashChannel(_nodeFingerprints[nodeIndex], nodeOut.Main);
+            for (const auto& extra : nodeOut.Extra) h = FlowHashChannel(h, extra);
+            for (const auto& kv : _nodePublics[nodeIndex].ScalarsByIndex) {
+                h = FlowHashJson(FlowHashMix(h, static_cast<std::uint64_t>(kv.first)), kv.second);
             }
-        } catch (...) {
-            // 忽略标量注入失败
+            _nodeFingerprints[nodeIndex] = h;
         }
-        module->ScalarInputsByIndex = std::move(scalarInputsByIdx);
-        module->ScalarInputsByName = std::move(scalarInputsByName);
+        return;
+    }
 
+    std::shared_ptr<FlowNodeCacheEntry> entry = std::make_shared<FlowNodeCacheEntry>();
+    entry->Main = nodeOut.Main;
+    entry->Extra = nodeOut.Extra;
+    entry->ScalarsByIndex = _nodePublics[nodeIndex].ScalarsByIndex;
+    _nodeCache->Put(_nodeFingerprints[nodeIndex], std::move(entry));
+}
+
+// 门控截断：节点至少有一路上游输入，且每一路都来自已被截断的节点或已关闭门控的通道输出。
+// 关闭门控的标量输出（如 open）仍然有效，只经由标量相连的下游照常执行。
+bool GraphExecutor::IsGatedOff(size_t nodeIndex) const {
+    const CompiledFlowPlan::Node& node = _plan->Nodes[nodeIndex];
+    bool anyInput = false;
+    for (const auto& slot : node.ChannelInputs) {
+        const size_t srcIndex = static_cast<size_t>(slot.SrcNodeIndex);
+        if (slot.SrcNodeIndex < 0 || srcIndex >= nodeIndex) continue;
+        anyInput = true;
+        if (!_nodeGated[srcIndex] && !_nodeGateClosed[srcIndex]) return false;
+    }
+    for (const auto& slot : node.ScalarInputs) {
+        const size_t srcIndex = static_cast<size_t>(slot.SrcNodeIndex);
+        if (slot.SrcNodeIndex < 0 || srcIndex >= nodeIndex) continue;
+        anyInput = true;
+        if (!_nodeGated[srcIndex]) return false;
+    }
+    return anyInput;
+}
+
+void GraphExecutor::MarkGatedOff(size_t nodeIndex) {
+    _nodeGated[nodeIndex] = 1;
+    // 融合链首被截断时整条链都不执行
+    if (!_runFusion) return;
+    for (int member : _plan->Nodes[nodeIndex].FusedChain) _nodeGated[static_cast<size_t>(member)] = 1;
+}
+
+void GraphExecutor::RunRange(size_t begin, size_t end) {
+    const CompiledFlowPlan& plan = *_plan;
+    if (end > plan.Nodes.size()) end = plan.Nodes.size();
+    if (_parallel && begin < end && end - begin > 1) {
+        RunParallel(begin, end);
+        return;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        if (!node.Factory || _runSkip[i]) continue;
+        if (_runFusion && node.FusedHead >= 0) continue; // 已随链首执行
+        if (IsGatedOff(i)) {
+            MarkGatedOff(i);
+            continue;
+        }
+        if (_runDedup && node.DedupOf >= 0) {
+            // 等价节点未产出（未创建出模块）时本节点同样视为未执行
+            if (_nodeExecuted[static_cast<size_t>(node.DedupOf)]) ExecuteDeduplicated(i, &_remainingConsumers);
+            continue;
+        }
+
+        std::unique_ptr<BaseModule> transientModule;
+        BaseModule* module = AcquireModule(i, _runOverrides, transientModule);
+        if (module == nullptr) continue;
+
+        NodeInputs inputs = GatherNodeInputs(i, &_remainingConsumers);
         try {
-            std::uint64_t outputMask = 0;
-            if (node.contains("outputs")) {
-                const auto outPorts = AsArrayOfObjects(node.at("outputs"));
-                for (int oi = 0; oi < static_cast<int>(outPorts.size()) && oi < 64; oi++) {
-                    const auto& meta = outPorts[static_cast<size_t>(oi)];
-                    bool connected = false;
-                    if (meta.is_object() && meta.contains("links")) {
-                        const Json& links = meta.at("links");
-                        connected = links.is_array() && !links.empty();
-                    }
-                    if (connected) outputMask |= (static_cast<std::uint64_t>(1) << oi);
+            // 兼容仍从上下文读取掩码的外部模块（并行模式下不写入）
+            _context->Set(ContextKeys::GraphCurrentOutputMask, _runOutputMasks[i]);
+        } catch (...) {}
+        if (_runFusion && !node.FusedChain.empty()) {
+            ExecuteFusedChain(i, module, std::move(inputs));
+        } else {
+            ExecuteNode(i, module, std::move(inputs));
+        }
+    }
+}
+
+void GraphExecutor::RunParallel(size_t begin, size_t end) {
+    const CompiledFlowPlan& plan = *_plan;
+    const size_t nodeCount = plan.Nodes.size();
+    if (end > nodeCount) end = nodeCount;
+    if (begin >= end) return;
+    const size_t total = end - begin;
+    FlowThreadPool& pool = FlowThreadPool::Shared();
+
+    // 调度状态：输入收集（含“最后一个消费者移动”的计数）与依赖递减都在 Mu 内串行完成，
+    // 模块 Process 在锁外并发执行；节点输出只在其全部依赖完成后被读取。
+    // 就绪节点先进入本次运行自己的 Queued，线程池任务与等待中的调用方都从这里领取，
+    // 调用方因此只协助执行本次运行的节点。线程池任务可能在本函数返回后才被取出，状态以 shared_ptr 持有。
+    struct QueuedNode final {
+        size_t Index = 0;
+        std::shared_ptr<NodeInputs> Inputs;
+    };
+    struct SchedulerState final {
+        std::mutex Mu;
+        std::condition_variable Cv;
+        std::vector<int> PendingDeps;
+        std::vector<int> RemainingConsumers;
+        std::deque<QueuedNode> Queued;
+        size_t Finished = 0;
+        size_t InFlight = 0; // 已入队或执行中的节点
+        std::exception_ptr Error;
+    };
+    std::shared_ptr<SchedulerState> statePtr = std::make_shared<SchedulerState>();
+    SchedulerState& state = *statePtr;
+    // 只调度 [begin, end) 内的节点：排在 begin 之前的依赖已执行完毕，不计入；end 之后的下游不释放
+    state.PendingDeps.assign(nodeCount, 0);
+    for (size_t i = begin; i < end; i++) {
+        for (int d : plan.Nodes[i].Dependencies) {
+            if (static_cast<size_t>(d) >= begin) state.PendingDeps[i]++;
+        }
+    }
+    state.RemainingConsumers.swap(_remainingConsumers);
+    const auto releaseDependents = [&plan, &state, end](size_t idx, std::vector<size_t>& released) {
+        for (int d : plan.Nodes[idx].Dependents) {
+            if (static_cast<size_t>(d) >= end) continue;
+            if (--state.PendingDeps[static_cast<size_t>(d)] == 0) released.push_back(static_cast<size_t>(d));
+        }
+    };
+
+    // 在持锁状态下调用：收集 ready 中节点的输入并入队，返回入队数量；未注册节点直接视为完成并释放其下游。
+    // 融合链上的后续节点只依赖链内前一节点，就绪时链首已执行完整条链，同样直接视为完成。
+    const auto enqueueLocked = [&](std::vector<size_t>& ready) -> size_t {
+        size_t queued = 0;
+        while (!ready.empty()) {
+            std::sort(ready.begin(), ready.end());
+            std::vector<size_t> next;
+            for (size_t idx : ready) {
+                const CompiledFlowPlan::Node& node = plan.Nodes[idx];
+                if (!node.Factory || _runSkip[idx] || state.Error || (_runFusion && node.FusedHead >= 0)) {
+                    state.Finished++;
+                    releaseDependents(idx, next);
+                    continue;
                 }
+                if (IsGatedOff(idx)) {
+                    // 被关闭的门控截断：不执行，按已完成释放下游（下游随之判定截断）
+                    MarkGatedOff(idx);
+                    state.Finished++;
+                    releaseDependents(idx, next);
+                    continue;
+                }
+                if (_runDedup && node.DedupOf >= 0) {
+                    // 共用等价节点的输出：只复制引用，持锁完成，不派发
+                    if (_nodeExecuted[static_cast<size_t>(node.DedupOf)]) ExecuteDeduplicated(idx, &state.RemainingConsumers);
+                    state.Finished++;
+                    releaseDependents(idx, next);
+                    continue;
+                }
+
+                QueuedNode item;
+                item.Index = idx;
+                item.Inputs = std::make_shared<NodeInputs>(GatherNodeInputs(idx, &state.RemainingConsumers));
+                state.Queued.push_back(std::move(item));
+                state.InFlight++;
+                queued++;
             }
-            _context->Set<std::uint64_t>("__graph_current_output_mask", outputMask);
-        } catch (...) {}
+            ready.swap(next);
+        }
+        return queued;
+    };
+
+    // 线程池任务：领取一个本次运行入队的节点并执行；已被调用方领走时直接返回，不再访问本函数的局部状态
+    std::function<void(QueuedNode&)> runClaimed;
+    const auto submitClaimers = [&pool, &statePtr, &runClaimed](size_t n) {
+        for (size_t k = 0; k < n; k++) {
+            std::shared_ptr<SchedulerState> st = statePtr;
+            std::function<void(QueuedNode&)>* run = &runClaimed;
+            pool.Submit([st, run]() {
+                QueuedNode claimed;
+                {
+                    std::lock_guard<std::mutex> lk(st->Mu);
+                    if (st->Queued.empty()) return;
+                    claimed = std::move(st->Queued.front());
+                    st->Queued.pop_front();
+                }
+                (*run)(claimed);
+            });
+        }
+    };
 
-        // 执行当前节点并记录节点耗时（用于压测模块耗时统计）
-        const auto nodeStart = std::chrono::steady_clock::now();
-        ModuleIO io = module->ProcessOwned(mainCh.ImageList, std::move(mainCh.ResultList));
-        const auto nodeEnd = std::chrono::steady_clock::now();
-        const double elapsedMs = std::chrono::duration<double, std::milli>(nodeEnd - nodeStart).count();
-        NodeTiming timing;
-        timing.NodeId = nodeId;
-        timing.NodeType = type;
-        timing.NodeTitle = title;
-        timing.ElapsedMs = elapsedMs > 0.0 ? elapsedMs : 0.0;
-        _lastNodeTimings.push_back(std::move(timing));
+    // 执行一个已领取的节点（不持锁）并释放下游。领取的节点计入 InFlight，调用方在其完成前不会返回，
+    // 因此执行、锁外提交新入队节点期间都可以访问本函数的局部状态。
+    runClaimed = [&](QueuedNode& item) {
+        const size_t idx = item.Index;
+        try {
+            std::unique_ptr<BaseModule> transientModule;
+            BaseModule* module = AcquireModule(idx, _runOverrides, transientModule);
+            if (module == nullptr) {
+                // 未创建出模块：与顺序执行一致，视为未执行
+            } else if (_runFusion && !_plan->Nodes[idx].FusedChain.empty()) {
+                ExecuteFusedChain(idx, module, std::move(*item.Inputs));
+            } else {
+                ExecuteNode(idx, module, std::move(*item.Inputs));
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(state.Mu);
+            if (!state.Error) state.Error = std::current_exception();
+        }
 
-        // 保存该节点的全部输出通道（供后续路由）
-        NodeExecOutput nodeOut;
-        nodeOut.Main = ModuleChannel(std::move(io.ImageList), std::move(io.ResultList), std::move(io.TemplateList));
-        nodeOut.Extra = std::move(module->ExtraOutputs);
-        _nodeExecMap[nodeId] = std::move(nodeOut);
+        size_t queued = 0;
+        {
+            std::lock_guard<std::mutex> lk(state.Mu);
+            state.Finished++;
+            std::vector<size_t> released;
+            releaseDependents(idx, released);
+            queued = enqueueLocked(released);
+            if (queued > 0) state.Cv.notify_all();
+        }
+        submitClaimers(queued);
+
+        std::lock_guard<std::mutex> lk(state.Mu);
+        state.InFlight--;
+        state.Cv.notify_all();
+    };
+
+    size_t initial = 0;
+    {
+        std::lock_guard<std::mutex> lk(state.Mu);
+        std::vector<size_t> ready;
+        for (size_t i = begin; i < end; i++) {
+            if (state.PendingDeps[i] == 0) ready.push_back(i);
+        }
+        initial = enqueueLocked(ready);
+    }
+    submitClaimers(initial);
+
+    // 等待全部节点完成；等待期间只领取本次运行入队的节点，不执行线程池中其他调用方的任务
+    while (true) {
+        QueuedNode claimed;
+        {
+            std::unique_lock<std::mutex> lk(state.Mu);
+            state.Cv.wait(lk, [&state, total]() {
+                return !state.Queued.empty() || (state.InFlight == 0 && (state.Finished >= total || state.Error));
+            });
+            if (state.Queued.empty()) break;
+            claimed = std::move(state.Queued.front());
+            state.Queued.pop_front();
+        }
+        runClaimed(claimed);
+    }
 
-        // 对外暴露主通道（与 C# 一致）
-        NodePublicOutput pub;
+    // 已无在途节点：消费者计数交还执行器，供后续分段继续使用
+    _remainingConsumers.swap(state.RemainingConsumers);
+    if (state.Error) std::rethrow_exception(state.Error);
+}
 
-        // 标量输出：依据节点 outputs 元信息，从 module->ScalarOutputsByName 取值并按索引写入
-        try {
-            if (node.contains("outputs")) {
-                const auto outPorts = AsArrayOfObjects(node.at("outputs"));
-                for (int oi = 0; oi < static_cast<int>(outPorts.size()); oi++) {
-                    const auto& meta = outPorts[static_cast<size_t>(oi)];
-                    if (!meta.is_object()) continue;
-                    const std::string otype = meta.contains("type") ? ToLower(SafeToString(meta.at("type"), "")) : "";
-                    if (!IsScalarPortType(otype)) continue;
+void GraphExecutor::BeginRun() {
+    const CompiledFlowPlan& plan = *_plan;
+    const size_t nodeCount = plan.Nodes.size();
+
+    _nodeExecs.assign(nodeCount, NodeExecOutput());
+    _nodeExecuted.assign(nodeCount, 0);
+    _nodePublics.assign(nodeCount, NodePublicOutput());
+    _nodeElapsedMs.assign(nodeCount, 0.0);
+    _nodeFingerprints.assign(_nodeCache != nullptr ? nodeCount : 0, 0);
+    _nodeFromCache.assign(nodeCount, 0);
+    _nodeGateClosed.assign(nodeCount, 0);
+    _nodeGated.assign(nodeCount, 0);
+    _nodeDeduplicated.assign(nodeCount, 0);
+    _publicOutputs.clear();
+    _lastNodeTimings.clear();
+    _lastUnregisteredNodes.clear();
 
-                    std::string oname;
-                    if (meta.contains("name") && meta.at("name").is_string()) oname = meta.at("name").get<std::string>();
+    for (const auto& node : plan.Nodes) {
+        if (node.Factory) continue;
+        LogModuleNotRegistered("run", node.Type, node.NodeId, node.Title);
+        UnregisteredNodeInfo info;
+        info.NodeId = node.NodeId;
+        info.NodeType = node.Type;
+        info.NodeTitle = node.Title;
+        _lastUnregisteredNodes.push_back(std::move(info));
+    }
 
-                    Json val;
-                    bool has = false;
-                    if (!oname.empty()) {
-                        auto it = module->ScalarOutputsByName.find(oname);
-                        if (it != module->ScalarOutputsByName.end()) { val = it->second; has = true; }
-                    }
-                    if (!has) {
-                        auto it2 = module->ScalarOutputsByName.find(std::to_string(oi));
-                        if (it2 != module->ScalarOutputsByName.end()) { val = it2->second; has = true; }
-                    }
+    const Json* inferParams = nullptr;
+    try {
+        inferParams = _context->Find(ContextKeys::InferParams);
+        _runOverrides = inferParams != nullptr ? BuildInferParamOverrides(*inferParams) : Json::object();
+    } catch (...) {
+        _runOverrides = Json::object();
+    }
+    PrepareRunLiveness(inferParams);
+    // 节点输出缓存按单个节点复用输出，启用时不做链融合
+    if (_nodeCache != nullptr) _runFusion = false;
+    PrepareModuleInstances();
+}
 
-                    // 类型规范化
-                    if (otype == "bool" || otype == "boolean") {
-                        bool b = false;
-                        try { b = val.is_boolean() ? val.get<bool>() : (val.is_number_integer() ? (val.get<int>() != 0) : (val.is_string() ? (val.get<std::string>() == "true" || val.get<std::string>() == "1") : false)); } catch (...) { b = false; }
-                        pub.ScalarsByIndex[oi] = b;
-                    } else if (otype == "int" || otype == "integer") {
-                        int x = 0;
-                        try { x = val.is_number_integer() ? val.get<int>() : (val.is_number() ? static_cast<int>(std::llround(val.get<double>())) : (val.is_string() ? std::stoi(val.get<std::string>()) : 0)); } catch (...) { x = 0; }
-                        pub.ScalarsByIndex[oi] = x;
-                    } else {
-                        // str/string/scalar -> string
-                        std::string s;
-                        try { s = val.is_string() ? val.get<std::string>() : val.dump(); } catch (...) { s = ""; }
-                        pub.ScalarsByIndex[oi] = s;
-                    }
-                }
-            }
-        } catch (...) {}
+void GraphExecutor::PrepareRunLiveness(const Json* inferParams) {
+    const CompiledFlowPlan& plan = *_plan;
+    const size_t nodeCount = plan.Nodes.size();
 
-        _publicOutputs[nodeId] = std::move(pub);
+    std::vector<char> disabled;
+    try {
+        if (inferParams != nullptr) disabled = ParseDisabledBranches(plan, *inferParams);
+    } catch (...) { disabled.clear(); }
+
+    if (disabled.empty()) {
+        // 常规路径：直接使用编译期结果
+        _runSkip.assign(nodeCount, 0);
+        _runOutputMasks.resize(nodeCount);
+        for (size_t i = 0; i < nodeCount; i++) {
+            _runSkip[i] = plan.Nodes[i].Live ? 0 : 1;
+            _runOutputMasks[i] = plan.Nodes[i].LiveOutputMask;
+        }
+        _remainingConsumers = plan.OutputConsumerCounts;
+        _runFusion = true;
+        _runDedup = true;
+        return;
     }
 
+    // 禁用分支改变了存活掩码与消费者计数，编译期识别的融合链与等价节点合并本次不使用
+    _runFusion = false;
+    _runDedup = false;
+
+    FlowLiveness liveness = ComputeLiveness(plan, disabled);
+    _runSkip.assign(nodeCount, 0);
+    for (size_t i = 0; i < nodeCount; i++) _runSkip[i] = liveness.Live[i] ? 0 : 1;
+    _runOutputMasks = std::move(liveness.OutputMasks);
+    _remainingConsumers = std::move(liveness.ConsumerCounts);
+}
+
+std::unordered_map<int, NodePublicOutput> GraphExecutor::EndRun() {
+    const CompiledFlowPlan& plan = *_plan;
+    const size_t nodeCount = plan.Nodes.size();
+
+    // 节点耗时与对外输出按计划顺序整理，与执行先后无关
+    _lastNodeTimings.reserve(nodeCount);
+    for (size_t i = 0; i < nodeCount; i++) {
+        const CompiledFlowPlan::Node& node = plan.Nodes[i];
+        if (_nodeGated[i]) {
+            // 被门控截断的节点只报告跳过，不产生对外输出
+            NodeTiming skipped;
+            skipped.NodeId = node.NodeId;
+            skipped.NodeType = node.Type;
+            skipped.NodeTitle = node.Title;
+            skipped.Skipped = true;
+            _lastNodeTimings.push_back(std::move(skipped));
+            continue;
+        }
+        if (!_nodeExecuted[i]) continue;
+        NodeTiming timing;
+        timing.NodeId = node.NodeId;
+        timing.NodeType = node.Type;
+        timing.NodeTitle = node.Title;
+        timing.ElapsedMs = _nodeElapsedMs[i];
+        timing.FromCache = _nodeFromCache[i] != 0;
+        if (_nodeDeduplicated[i]) timing.DeduplicatedFrom = plan.Nodes[static_cast<size_t>(node.DedupOf)].NodeId;
+        _lastNodeTimings.push_back(std::move(timing));
+
+        // 对外暴露（与 C# 一致，按 nodeId 索引）
+        _publicOutputs[node.NodeId] = _nodePublics[i];
+    }
     return _publicOutputs;
 }
 
+std::unordered_map<int, NodePublicOutput> GraphExecutor::Run() {
+    BeginRun();
+    const size_t nodeCount = _plan->Nodes.size();
+    // 预生成执行代码按编译期的存活掩码与消费顺序生成，禁用分支（_runDedup 为 false）时不适用
+    _lastRunGenerated = _allowGenerated && _plan->Generated != nullptr && !_parallel &&
+        _nodeCache == nullptr && _runDedup;
+    if (_lastRunGenerated) {
+        _runFusion = false;
+        GeneratedFlowFrame frame(*this);
+        _plan->Generated(frame);
+    } else {
+        RunRange(0, nodeCount);
+    }
+    return EndRun();
+}
+
 std::vector<GraphExecutor::NodeTiming> GraphExecutor::GetLastNodeTimings() const {
     return _lastNodeTimings;
 }
@@ -556,40 +1518,196 @@ std::vector<GraphExecutor::UnregisteredNodeInfo> GraphExecutor::GetLastUnregiste
     return _lastUnregisteredNodes;
 }
 
+// 执行计划快照格式版本：CompiledFlowPlan 字段或编译规则变化时递增，旧快照随之失效
+static const int kPlanSnapshotVersion = 3;
+
+static Json SerializeInputSlots(const std::vector<CompiledFlowPlan::InputSlot>& slots) {
+    Json out = Json::array();
+    for (const auto& s : slots) {
+        out.push_back(Json::array({ s.PortIndex, s.PairIndex, s.SrcNodeIndex, s.SrcOutIdx, s.SrcSlot,
+            static_cast<int>(s.Channel), s.Name }));
+    }
+    return out;
+}
+
+static std::vector<CompiledFlowPlan::InputSlot> DeserializeInputSlots(const Json& arr, int nodeCount, int slotCount) {
+    std::vector<CompiledFlowPlan::InputSlot> out;
+    out.reserve(arr.size());
+    for (const auto& a : arr) {
+        CompiledFlowPlan::InputSlot s;
+        s.PortIndex = a.at(0).get<int>();
+        s.PairIndex = a.at(1).get<int>();
+        s.SrcNodeIndex = a.at(2).get<int>();
+        s.SrcOutIdx = a.at(3).get<int>();
+        s.SrcSlot = a.at(4).get<int>();
+        s.Channel = static_cast<CompiledFlowPlan::ChannelKind>(a.at(5).get<int>());
+        s.Name = a.at(6).get<std::string>();
+        if (s.SrcNodeIndex < 0 || s.SrcNodeIndex >= nodeCount || s.SrcSlot < 0 || s.SrcSlot >= slotCount) {
+            throw std::runtime_error("plan snapshot: input slot out of range");
+        }
+        out.push_back(std::move(s));
+    }
+    return out;
+}
+
+static std::vector<int> DeserializeIndexList(const Json& arr, int nodeCount) {
+    std::vector<int> out = arr.get<std::vector<int>>();
+    for (int v : out) {
+        if (v < 0 || v >= nodeCount) throw std::runtime_error("plan snapshot: node index out of range");
+    }
+    return out;
+}
+
+Json GraphExecutor::SerializePlan(const CompiledFlowPlan& plan) {
+    Json nodes = Json::array();
+    for (const auto& n : plan.Nodes) {
+        Json scalarOutputs = Json::array();
+        for (const auto& so : n.ScalarOutputs) {
+            scalarOutputs.push_back(Json::array({ so.PortIndex, static_cast<int>(so.Kind), so.Name }));
+        }
+        Json j = Json::object();
+        j["id"] = n.NodeId;
+        j["type"] = n.Type;
+        j["title"] = n.Title;
+        j["props"] = n.Properties;
+        j["resolved"] = n.ResolvedProperties;
+        j["type_hash"] = n.TypeHash;
+        j["props_hash"] = n.PropertiesHash;
+        j["channel_inputs"] = SerializeInputSlots(n.ChannelInputs);
+        j["scalar_inputs"] = SerializeInputSlots(n.ScalarInputs);
+        j["scalar_outputs"] = std::move(scalarOutputs);
+        j["output_mask"] = n.OutputMask;
+        j["live_output_mask"] = n.LiveOutputMask;
+        j["sink"] = n.IsSink;
+        j["live"] = n.Live;
+        j["slot_base"] = n.OutputSlotBase;
+        j["output_count"] = n.OutputCount;
+        j["deps"] = n.Dependencies;
+        j["dependents"] = n.Dependents;
+        j["fused_chain"] = n.FusedChain;
+        j["fused_head"] = n.FusedHead;
+        j["dedup_of"] = n.DedupOf;
+        nodes.push_back(std::move(j));
+    }
+
+    Json stages = Json::array();
+    for (const auto& st : plan.Stages) {
+        stages.push_back(Json::array({ st.Begin, st.End, st.IsModel }));
+    }
+
+    Json out = Json::object();
+    out["version"] = kPlanSnapshotVersion;
+    out["nodes"] = std::move(nodes);
+    out["consumer_counts"] = plan.OutputConsumerCounts;
+    out["stages"] = std::move(stages);
+    return out;
+}
+
+std::shared_ptr<const CompiledFlowPlan> GraphExecutor::DeserializePlan(const Json& snapshot) {
+    if (!snapshot.is_object() || snapshot.value("version", 0) != kPlanSnapshotVersion) {
+        throw std::runtime_error("plan snapshot: version mismatch");
+    }
+
+    std::shared_ptr<CompiledFlowPlan> plan = std::make_shared<CompiledFlowPlan>();
+    const Json& nodes = snapshot.at("nodes");
+    const int nodeCount = static_cast<int>(nodes.size());
+    plan->OutputConsumerCounts = snapshot.at("consumer_counts").get<std::vector<int>>();
+    const int slotCount = static_cast<int>(plan->OutputConsumerCounts.size());
+
+    plan->Nodes.reserve(nodes.size());
+    for (const auto& j : nodes) {
+        CompiledFlowPlan::Node n;
+        n.NodeId = j.at("id").get<int>();
+        n.Type = j.at("type").get<std::string>();
+        n.Title = j.at("title").get<std::string>();
+        n.Properties = j.at("props");
+        n.ResolvedProperties = j.at("resolved");
+        n.TypeHash = j.at("type_hash").get<std::uint64_t>();
+        n.PropertiesHash = j.at("props_hash").get<std::uint64_t>();
+        n.Factory = ModuleRegistry::Get(n.Type);
+        n.ChannelInputs = DeserializeInputSlots(j.at("channel_inputs"), nodeCount, slotCount);
+        n.ScalarInputs = DeserializeInputSlots(j.at("scalar_inputs"), nodeCount, slotCount);
+        for (const auto& a : j.at("scalar_outputs")) {
+            CompiledFlowPlan::ScalarOutput so;
+            so.PortIndex = a.at(0).get<int>();
+            so.Kind = static_cast<CompiledFlowPlan::ScalarKind>(a.at(1).get<int>());
+            so.Name = a.at(2).get<std::string>();
+            so.IndexName = std::to_string(so.PortIndex);
+            n.ScalarOutputs.push_back(std::move(so));
+        }
+        n.OutputMask = j.at("output_mask").get<std::uint64_t>();
+        n.LiveOutputMask = j.at("live_output_mask").get<std::uint64_t>();
+        n.IsSink = j.at("sink").get<bool>();
+        n.Live = j.at("live").get<bool>();
+        n.OutputSlotBase = j.at("slot_base").get<int>();
+        n.OutputCount = j.at("output_count").get<int>();
+        if (n.OutputSlotBase < 0 || n.OutputCount < 0 || n.OutputSlotBase + n.OutputCount > slotCount) {
+            throw std::runtime_error("plan snapshot: output slots out of range");
+        }
+        n.Dependencies = DeserializeIndexList(j.at("deps"), nodeCount);
+        n.Dependents = DeserializeIndexList(j.at("dependents"), nodeCount);
+        n.FusedChain = DeserializeIndexList(j.at("fused_chain"), nodeCount);
+        n.FusedHead = j.at("fused_head").get<int>();
+        n.DedupOf = j.at("dedup_of").get<int>();
+        if (n.FusedHead < -1 || n.FusedHead >= nodeCount || n.DedupOf < -1 || n.DedupOf >= static_cast<int>(plan->Nodes.size())) {
+            throw std::runtime_error("plan snapshot: node index out of range");
+        }
+        plan->Nodes.push_back(std::move(n));
+    }
+
+    for (const auto& a : snapshot.at("stages")) {
+        CompiledFlowPlan::Stage st;
+        st.Begin = a.at(0).get<int>();
+        st.End = a.at(1).get<int>();
+        st.IsModel = a.at(2).get<bool>();
+        if (st.Begin < 0 || st.End < st.Begin || st.End > nodeCount) {
+            throw std::runtime_error("plan snapshot: stage out of range");
+        }
+        plan->Stages.push_back(st);
+    }
+    plan->StructureHash = ComputeStructureHash(*plan);
+    plan->Generated = GeneratedFlowRegistry::Find(plan->StructureHash);
+    return plan;
+}
+
+std::uint64_t GraphExecutor::ComputeStructureHash(const CompiledFlowPlan& plan) {
+    Json structure = SerializePlan(plan);
+    Json& nodes = structure["nodes"];
+    for (size_t i = 0; i < nodes.size() && i < plan.Nodes.size(); i++) {
+        Json& j = nodes[i];
+        j.erase("title");
+        j.erase("props");
+        j.erase("resolved");
+        j.erase("props_hash");
+        j["registered"] = static_cast<bool>(plan.Nodes[i].Factory);
+    }
+    return FlowHashJson(0, structure);
+}
+
 Json GraphExecutor::LoadModels() {
     _lastUnregisteredNodes.clear();
 
-    // 排序与 Run 一致
-    std::vector<Json> ordered = _nodes;
-    std::sort(ordered.begin(), ordered.end(), [](const Json& a, const Json& b) {
-        const int ao = ReadNodeOrder(a);
-        const int bo = ReadNodeOrder(b);
-        if (ao != bo) return ao < bo;
-        int aid = 0, bid = 0;
-        try { if (a.is_object() && a.contains("id")) aid = GraphExecutor::SafeToInt(a.at("id"), 0); } catch (...) {}
-        try { if (b.is_object() && b.contains("id")) bid = GraphExecutor::SafeToInt(b.at("id"), 0); } catch (...) {}
-        return aid < bid;
-    });
-
     Json report = Json::object();
     Json items = Json::array();
     int failCount = 0;
 
-    for (int i = 0; i < static_cast<int>(ordered.size()); i++) {
-        const Json& node = ordered[static_cast<size_t>(i)];
-        if (!node.is_object()) continue;
+    // 加载期按原始属性构造模块
+    _runOverrides = Json::object();
+    PrepareModuleInstances();
 
-        const std::string type = node.contains("type") ? SafeToString(node.at("type"), "") : "";
-        const int nodeId = node.contains("id") ? SafeToInt(node.at("id"), i) : i;
-        const std::string title = node.contains("title") ? SafeToString(node.at("title"), "") : "";
+    // 顺序与 Run 一致（均来自执行计划）
+    for (size_t i = 0; i < _plan->Nodes.size(); i++) {
+        const CompiledFlowPlan::Node& node = _plan->Nodes[i];
+        const std::string& type = node.Type;
+        const int nodeId = node.NodeId;
+        const std::string& title = node.Title;
 
         const bool isModelNode = (type.rfind("model/", 0) == 0);
 
         // 非 model/* 不参与预加载，但仍校验注册表，提前暴露未注册问题
         if (!isModelNode) {
             if (type.empty()) continue;
-            auto factory = ModuleRegistry::Get(type);
-            if (!factory) {
+            if (!node.Factory) {
                 LogModuleNotRegistered("load", type, nodeId, title);
                 UnregisteredNodeInfo info;
                 info.NodeId = nodeId;
@@ -598,16 +1716,36 @@ Json GraphExecutor::LoadModels() {
                 _lastUnregisteredNodes.push_back(std::move(info));
             } else {
                 LogModuleDebug("load", type, nodeId, title);
+                if (node.Live) {
+                    // 构造即绑定属性：类型不符的属性在加载期报告。持久实例保留，否则构造后丢弃
+                    std::string error;
+                    try {
+                        if (_instances == nullptr) {
+                            CreateModule(node, Json::object());
+                        } else if (!_instances->Modules[i]) {
+                            _instances->Modules[i] = CreateModule(node, Json::object());
+                        }
+                    } catch (const std::exception& ex) {
+                        error = ex.what();
+                    } catch (...) {
+                        error = "unknown_exception";
+                    }
+                    if (!error.empty()) {
+                        Json item = Json::object();
+                        item["node_id"] = nodeId;
+                        item["type"] = type;
+                        item["title"] = title;
+                        item["status_code"] = 1;
+                        item["status_message"] = error;
+                        items.push_back(std::move(item));
+                        failCount++;
+                    }
+                }
             }
             continue;
         }
 
-        Json props = Json::object();
-        try {
-            if (node.contains("properties") && node.at("properties").is_object()) {
-                props = node.at("properties");
-            }
-        } catch (...) { props = Json::object(); }
+        const Json& props = node.Properties;
 
         std::string modelPath;
         try {
@@ -622,8 +1760,7 @@ Json GraphExecutor::LoadModels() {
         item["title"] = title;
         item["model_path"] = modelPath;
 
-        auto factory = ModuleRegistry::Get(type);
-        if (!factory) {
+        if (!node.Factory) {
             LogModuleNotRegistered("load", type, nodeId, title);
             UnregisteredNodeInfo info;
             info.NodeId = nodeId;
@@ -639,10 +1776,25 @@ Json GraphExecutor::LoadModels() {
         }
         LogModuleDebug("load", type, nodeId, title);
 
+        if (!node.Live) {
+            // 输出到不了任何汇点，推理时不会执行，不占用模型资源
+            item["status_code"] = 0;
+            item["status_message"] = "skipped_unreachable";
+            items.push_back(item);
+            continue;
+        }
+
         try {
-            std::unique_ptr<BaseModule> module = factory(nodeId, title, props, _context);
-            if (!module) throw std::runtime_error("module_factory_returned_null");
-            module->LoadModel();
+            if (_instances != nullptr) {
+                std::unique_ptr<BaseModule>& persistent = _instances->Modules[i];
+                if (!persistent) persistent = CreateModule(node, Json::object());
+                if (!persistent) throw std::runtime_error("module_factory_returned_null");
+                persistent->LoadModel();
+            } else {
+                std::unique_ptr<BaseModule> module = node.Factory(nodeId, title, props, _context);
+                if (!module) throw std::runtime_error("module_factory_returned_null");
+                module->LoadModel();
+            }
             item["status_code"] = 0;
             item["status_message"] = "ok";
         } catch (const std::exception& ex) {
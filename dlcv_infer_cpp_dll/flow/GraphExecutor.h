@@ -1,17 +1,28 @@
 ﻿#pragma once
 
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "flow/BaseModule.h"
+#include "flow/FlowNodeCache.h"
 #include "flow/ModuleRegistry.h"
 
 namespace dlcv_infer {
 namespace flow {
 
+class GeneratedFlowFrame;
+
+/// <summary>
+/// 预生成执行代码（FlowCodeGen 生成）的入口：按计划顺序直接执行全部节点。
+/// </summary>
+using GeneratedFlowRunner = void (*)(GeneratedFlowFrame& frame);
+
 struct NodePublicOutput final {
     std::vector<ModuleImage> ImageList;
     Json ResultList = Json::array();
@@ -19,6 +30,136 @@ struct NodePublicOutput final {
     std::map<int, Json> ScalarsByIndex; // outputPortIndex -> value
 };
 
+/// <summary>
+/// 编译后的执行计划：加载时由 GraphExecutor::Compile 一次性生成，推理时只读复用。
+/// 节点按 order/id 排序后以下标寻址；输入端口预先解析为 (源节点下标, 源输出端口)；
+/// 输出端口按 OutputSlotBase + 端口序号 映射到全局槽位，用于消费者计数。
+/// 编译时从汇点（output/* 等有副作用的节点）反向做可达性分析，输出到不了汇点的节点标记为不存活，
+/// 加载与推理时均跳过；计划中没有汇点时全部节点视为存活。
+/// 只以主对依次相连的逐条目结果处理节点（result_filter、multi_category_filter 等）编译为融合链，
+/// 推理时由链首一次遍历完成整条链，输出、标量与节点耗时仍按原节点记录。
+/// 类型、生效属性、输出端口（含掩码）与上游来源都相同的节点只执行排在最前的一个，其余节点（DedupOf）直接共用其输出。
+/// StructureHash 不含节点属性与标题，已按该哈希注册预生成执行代码（FlowCodeGen）时记入 Generated。
+/// </summary>
+struct CompiledFlowPlan final {
+    enum class ChannelKind : int {
+        Unknown = 0,
+        Image = 1,
+        Result = 2,
+        Template = 3
+    };
+
+    enum class ScalarKind : int {
+        Bool = 0,
+        Int = 1,
+        String = 2
+    };
+
+    struct InputSlot final {
+        int PortIndex = -1;     // 输入端口序号（inputs[*] 下标）
+        int PairIndex = 0;      // PortIndex / 2：0 为主对，其余为 ExtraInputsIn
+        int SrcNodeIndex = -1;  // 源节点在 Nodes 中的下标
+        int SrcOutIdx = -1;     // 源节点输出端口序号
+        int SrcSlot = -1;       // 源输出端口的全局槽位
+        ChannelKind Channel = ChannelKind::Unknown;
+        std::string Name;       // 标量端口名（仅标量输入使用）
+    };
+
+    struct ScalarOutput final {
+        int PortIndex = -1;
+        ScalarKind Kind = ScalarKind::String;
+        std::string Name;
+        std::string IndexName;  // std::to_string(PortIndex)，按序号回退查找时使用
+    };
+
+    struct Node final {
+        int NodeId = -1;
+        std::string Type;
+        std::string Title;
+        Json Properties = Json::object();         // 原始 properties
+        Json ResolvedProperties = Json::object(); // 已做 bbox 规范化，无 infer_params 时直接使用
+        std::uint64_t TypeHash = 0;               // 节点输出缓存指纹用
+        std::uint64_t PropertiesHash = 0;         // ResolvedProperties 的结构哈希
+        ModuleRegistry::Factory Factory;          // 未注册时为空
+        std::vector<InputSlot> ChannelInputs;
+        std::vector<InputSlot> ScalarInputs;
+        std::vector<ScalarOutput> ScalarOutputs;
+        std::uint64_t OutputMask = 0;     // outputs[*].links 非空的端口
+        std::uint64_t LiveOutputMask = 0; // 去掉只连到不存活节点的端口，执行时写入 CurrentOutputMask
+        bool IsSink = false;              // output/* 或 features/template_save
+        bool Live = true;                 // 可到达汇点
+        int OutputSlotBase = 0;
+        int OutputCount = 0;
+        std::vector<int> Dependencies; // 排在前面的上游节点下标（去重、升序）
+        std::vector<int> Dependents;   // 下游节点下标
+        std::vector<int> FusedChain;   // 融合链首：链上节点下标（含自身，按链顺序）
+        int FusedHead = -1;            // 融合链上的后续节点：链首下标
+        int DedupOf = -1;              // 与排在前面的等价节点共用输出时为其下标
+    };
+
+    /// <summary>
+    /// 流水线分段：按计划顺序把连续的 model/* 节点与连续的其余节点各自归为一段，
+    /// 流式推理时各段由独立线程处理，相邻帧的不同段可重叠执行。
+    /// </summary>
+    struct Stage final {
+        int Begin = 0; // 含
+        int End = 0;   // 不含
+        bool IsModel = false;
+    };
+
+    std::vector<Node> Nodes;
+    std::vector<int> OutputConsumerCounts; // 全局槽位 -> 存活的非标量消费者数量
+    std::vector<Stage> Stages;
+    std::uint64_t StructureHash = 0;
+    GeneratedFlowRunner Generated = nullptr; // 未注册时为空
+};
+
+/// <summary>
+/// 持久模块实例：按执行计划下标保存模块对象，跨 Run 复用（含模型句柄与模块自有缓存）。
+/// 同一实例集同一时刻只能被一个 Run 使用。infer_params 覆盖项变化时只替换生效属性变化的节点，
+/// 换下的实例按属性哈希留作备用，交替传入的覆盖项直接换回，不重新构造。
+/// 运行之外模块的 Context 指向实例集自带的长期上下文，不持有已销毁的运行上下文。
+/// </summary>
+struct ModuleInstanceSet final {
+    ExecutionContext Context; // 长期上下文：先于模块构造、后于模块析构
+    std::vector<std::unique_ptr<BaseModule>> Modules;
+    std::vector<std::uint64_t> PropertiesHashes; // 计划下标 -> Modules[i] 生效属性的结构哈希
+    std::vector<std::vector<std::pair<std::uint64_t, std::unique_ptr<BaseModule>>>> Spares; // 计划下标 -> 备用实例
+    std::string OverrideSignature; // 上次运行生效的 infer_params 覆盖项（dump 结果）
+};
+
+/// <summary>
+/// 实例集池：并发推理时每个请求借出一套实例集，用完归还。
+/// </summary>
+class ModuleInstancePool final {
+public:
+    std::unique_ptr<ModuleInstanceSet> Checkout() {
+        std::lock_guard<std::mutex> lk(_mu);
+        if (_idle.empty()) return std::unique_ptr<ModuleInstanceSet>(new ModuleInstanceSet());
+        std::unique_ptr<ModuleInstanceSet> set = std::move(_idle.back());
+        _idle.pop_back();
+        return set;
+    }
+
+    void Return(std::unique_ptr<ModuleInstanceSet> set) {
+        if (!set) return;
+        std::lock_guard<std::mutex> lk(_mu);
+        _idle.push_back(std::move(set));
+    }
+
+    void Clear() {
+        std::vector<std::unique_ptr<ModuleInstanceSet>> idle;
+        {
+            std::lock_guard<std::mutex> lk(_mu);
+            idle.swap(_idle);
+        }
+    }
+
+private:
+    std::mutex _mu;
+    std::vector<std::unique_ptr<ModuleInstanceSet>> _idle;
+};
+
 /// <summary>
 /// GraphExecutor：按 nodes[*].inputs/outputs 的 link 进行最小路由，
 /// 将多路输入聚合为主对+额外对（ExtraInputsIn），并将模块的 ExtraOutputs 与 outputs[*] 对齐。
@@ -31,6 +172,9 @@ public:
         std::string NodeType;
         std::string NodeTitle;
         double ElapsedMs = 0.0;
+        bool FromCache = false; // 输出取自节点输出缓存，模块未执行
+        bool Skipped = false;   // 被关闭的门控截断，模块未执行
+        int DeduplicatedFrom = -1; // 与等价节点共用输出（模块未执行）时为该节点 id
     };
 
     struct UnregisteredNodeInfo final {
@@ -40,8 +184,70 @@ public:
     };
 
     GraphExecutor(std::vector<Json> nodes, ExecutionContext* context = nullptr);
+    GraphExecutor(std::shared_ptr<const CompiledFlowPlan> plan, ExecutionContext* context = nullptr);
+    ~GraphExecutor();
+
+    /// <summary>
+    /// 将流程节点编译为执行计划：排序、link 解析、可达性裁剪、消费者计数、标量绑定、输出掩码、属性预处理、
+    /// 等价节点合并与结果处理链融合。
+    /// </summary>
+    static std::shared_ptr<const CompiledFlowPlan> Compile(const std::vector<Json>& nodes);
+
+    /// <summary>
+    /// 执行计划快照：SerializePlan 把计划的全部字段（不含模块工厂）写为紧凑 JSON，可再编码为二进制持久化；
+    /// DeserializePlan 按类型重新解析模块工厂并校验下标范围，格式版本不符或内容不完整时抛出异常。
+    /// </summary>
+    static Json SerializePlan(const CompiledFlowPlan& plan);
+    static std::shared_ptr<const CompiledFlowPlan> DeserializePlan(const Json& snapshot);
+
+    /// <summary>
+    /// 计划结构哈希：节点类型、注册状态、连线、标量端口、输出掩码、存活与等价节点合并结果，不含属性与标题。
+    /// </summary>
+    static std::uint64_t ComputeStructureHash(const CompiledFlowPlan& plan);
+
+    std::shared_ptr<const CompiledFlowPlan> GetPlan() const { return _plan; }
+
+    /// <summary>
+    /// 启用持久模块实例：LoadModels/Run 从 instances 取模块（缺失时创建并保存），
+    /// 复用前调用 BaseModule::ResetForRun。传 nullptr 则每次 Run 重新构造模块。
+    /// 换用其他实例集或执行器析构时，原实例集的模块改指向其长期上下文，因此实例集须比执行器存活更久。
+    /// </summary>
+    void SetModuleInstances(ModuleInstanceSet* instances) {
+        ParkModuleInstances();
+        _instances = instances;
+    }
+
+    /// <summary>
+    /// 并行执行：按依赖关系把就绪节点派发到 FlowThreadPool 并发执行。
+    /// 输出、节点耗时顺序与“最后一个消费者移动数据”的语义与顺序执行一致。
+    /// </summary>
+    void SetParallel(bool enabled) { _parallel = enabled; }
+
+    /// <summary>
+    /// 启用节点输出缓存：节点指纹由节点 id、类型、生效属性、输出掩码、模块标识（模型加载序号等）
+    /// 与各输入的上游指纹组成；可缓存节点命中时直接复用输出，只有变化点下游的节点重新执行。
+    /// 汇点（output/* 等）每次执行；IsOutputCacheable() 为 false 的节点每次执行并以输出内容作为指纹。
+    /// 传 nullptr 关闭。
+    /// </summary>
+    void SetNodeCache(FlowNodeCache* cache) { _nodeCache = cache; }
+
+    /// <summary>
+    /// 预生成执行代码（默认启用）：计划带有 Generated 且本次为顺序执行、未启用节点输出缓存、未带 disabled_branches 时，
+    /// Run() 改由生成代码执行全部节点，输出与耗时记录与通用执行一致。
+    /// </summary>
+    void SetGeneratedExecution(bool enabled) { _allowGenerated = enabled; }
+    bool LastRunGenerated() const { return _lastRunGenerated; }
 
     std::unordered_map<int, NodePublicOutput> Run();
+
+    /// <summary>
+    /// 分段执行：BeginRun 初始化本次运行，RunRange 按计划顺序执行 [begin, end) 内的节点（SetParallel(true) 时
+    /// 段内按依赖关系并发执行），EndRun 整理节点耗时与对外输出。依次覆盖全部节点时与 Run() 的结果一致。
+    /// </summary>
+    void BeginRun();
+    void RunRange(size_t begin, size_t end);
+    std::unordered_map<int, NodePublicOutput> EndRun();
+
     std::vector<NodeTiming> GetLastNodeTimings() const;
     std::vector<UnregisteredNodeInfo> GetLastUnregisteredNodes() const;
 
@@ -52,15 +258,42 @@ public:
     Json LoadModels();
 
 private:
+    // 节点输出只读共享：扇出时各消费者引用同一份数据，需可写时写时复制
     struct NodeExecOutput final {
-        ModuleChannel Main;
-        std::vector<ModuleChannel> Extra;
+        SharedChannel Main;
+        std::vector<SharedChannel> Extra;
+    };
+
+    std::shared_ptr<const CompiledFlowPlan> _plan;
+    struct NodeInputs final {
+        SharedChannel Main;
+        std::vector<SharedChannel> Extra;
+        std::map<int, Json> ScalarsByIndex;
+        std::map<std::string, Json> ScalarsByName;
     };
 
-    std::vector<Json> _nodes;
     ExecutionContext* _context = nullptr;
+    ModuleInstanceSet* _instances = nullptr;
+    bool _parallel = false;
+    bool _runFusion = false;                         // 本次运行是否按融合链执行
+    bool _runDedup = false;                          // 本次运行是否合并等价节点（消费者计数按合并后计算）
+    bool _allowGenerated = true;
+    bool _lastRunGenerated = false;
+    FlowNodeCache* _nodeCache = nullptr;
+    Json _runOverrides = Json::object();             // 本次运行生效的 infer_params 覆盖项
+    std::vector<int> _remainingConsumers;            // 全局槽位 -> 尚未读取的消费者数量
+    std::vector<char> _runSkip;                      // 计划下标 -> 本次不执行（不存活或被 disabled_branches 禁用）
+    std::vector<std::uint64_t> _runOutputMasks;      // 计划下标 -> 本次生效的输出掩码
 
-    std::unordered_map<int, NodeExecOutput> _nodeExecMap;     // nodeId -> exec outputs (main+extra)
+    std::vector<NodeExecOutput> _nodeExecs;          // 计划下标 -> exec outputs (main+extra)
+    std::vector<char> _nodeExecuted;                 // 计划下标 -> 是否已产出
+    std::vector<NodePublicOutput> _nodePublics;      // 计划下标 -> scalars
+    std::vector<double> _nodeElapsedMs;              // 计划下标 -> 节点耗时
+    std::vector<std::uint64_t> _nodeFingerprints;    // 计划下标 -> 节点输出缓存指纹（仅启用缓存时）
+    std::vector<char> _nodeFromCache;                // 计划下标 -> 输出取自缓存
+    std::vector<char> _nodeGateClosed;               // 计划下标 -> 本次执行后门控关闭（BaseModule::GateClosed）
+    std::vector<char> _nodeGated;                    // 计划下标 -> 本次被关闭的门控截断（未执行）
+    std::vector<char> _nodeDeduplicated;             // 计划下标 -> 本次共用等价节点的输出（未执行）
     std::unordered_map<int, NodePublicOutput> _publicOutputs; // nodeId -> image/result/template/scalars
     std::vector<NodeTiming> _lastNodeTimings;
     std::vector<UnregisteredNodeInfo> _lastUnregisteredNodes;
@@ -72,10 +305,27 @@ private:
     static void NormalizeBboxProperties(Json& props);
     static std::unordered_map<int, std::pair<int, int>> BuildLinkSourceMap(const std::vector<Json>& nodesOrdered);
 
-    std::map<int, ModuleChannel> CollectInputPairs(
-        const Json& node,
-        const std::unordered_map<int, std::pair<int, int>>& linkToSource,
-        std::unordered_map<long long, int>* remainingConsumers);
+    std::unique_ptr<BaseModule> CreateModule(const CompiledFlowPlan::Node& node, const Json& overrides) const;
+    void PrepareModuleInstances();
+    void ParkModuleInstances();
+    void PrepareRunLiveness(const Json* inferParams);
+    bool IsGatedOff(size_t nodeIndex) const;
+    void MarkGatedOff(size_t nodeIndex);
+    BaseModule* AcquireModule(size_t nodeIndex, const Json& overrides, std::unique_ptr<BaseModule>& transientModule);
+
+    std::map<int, SharedChannel> CollectInputPairs(size_t nodeIndex, std::vector<int>* remainingConsumers);
+    NodeInputs GatherNodeInputs(size_t nodeIndex, std::vector<int>* remainingConsumers);
+    void GatherScalarInputs(size_t nodeIndex, NodeInputs& inputs) const;
+    void ExecuteNode(size_t nodeIndex, BaseModule* module, NodeInputs&& inputs);
+    void ExecuteFusedChain(size_t headIndex, BaseModule* head, NodeInputs&& inputs);
+    void ExecuteDeduplicated(size_t nodeIndex, std::vector<int>* remainingConsumers);
+    void PublishScalarOutputs(size_t nodeIndex, const BaseModule* module);
+    bool ComputeNodeFingerprint(size_t nodeIndex, BaseModule* module);
+    bool TryRestoreFromCache(size_t nodeIndex);
+    void StoreToCache(size_t nodeIndex, bool cacheable);
+    void RunParallel(size_t begin, size_t end);
+
+    friend class GeneratedFlowFrame;
 
     static bool IsScalarPortType(const std::string& tLower);
     static std::string ToLower(std::string s);
@@ -0,0 +1,194 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "flow/FlowTypes.h"
+
+namespace dlcv_infer {
+namespace flow {
+
+/// <summary>
+/// 字符串属性的规范化方式。
+/// </summary>
+enum class PropertyText {
+    Raw,        // 原样保留
+    TrimLower   // 去除首尾空白并转为小写
+};
+
+/// <summary>
+/// 属性值解析：可接受的写法与 BaseModule::Read* 一致（数值可写成数字字符串，布尔可写成 0/1/"true"/"false"）。
+/// 缺省、null 与空字符串视为未设置（返回 false）；类型不符时抛出 std::invalid_argument。
+/// </summary>
+class PropertyParser final {
+public:
+    static const Json* Find(const Json& properties, const char* name) {
+        if (!properties.is_object()) return nullptr;
+        auto it = properties.find(name);
+        if (it == properties.end() || it->is_null()) return nullptr;
+        return &(*it);
+    }
+
+    [[noreturn]] static void Fail(const char* name, const char* expected, const Json& value) {
+        std::string got;
+        try { got = value.dump(); } catch (...) { got = "?"; }
+        throw std::invalid_argument(std::string("invalid_property: \"") + name + "\" expects " + expected + ", got " + got);
+    }
+
+    static bool ParseInt(const Json& v, const char* name, int& out) {
+        if (v.is_number_integer()) { out = v.get<int>(); return true; }
+        if (v.is_number()) { out = ClampToInt(v.get<double>()); return true; }
+        if (v.is_string()) {
+            const std::string s = v.get<std::string>();
+            if (IsBlank(s)) return false;
+            try { out = std::stoi(s); return true; } catch (...) {}
+        }
+        Fail(name, "int", v);
+    }
+
+    static bool ParseDouble(const Json& v, const char* name, double& out) {
+        if (v.is_number()) { out = v.get<double>(); return true; }
+        if (v.is_string()) {
+            const std::string s = v.get<std::string>();
+            if (IsBlank(s)) return false;
+            try { out = std::stod(s); return true; } catch (...) {}
+        }
+        Fail(name, "number", v);
+    }
+
+    static bool ParseBool(const Json& v, const char* name, bool& out) {
+        if (v.is_boolean()) { out = v.get<bool>(); return true; }
+        if (v.is_number_integer()) { out = v.get<int>() != 0; return true; }
+        if (v.is_string()) {
+            const std::string s = v.get<std::string>();
+            if (s.empty()) return false;
+            if (s == "1" || s == "true" || s == "True" || s == "TRUE") { out = true; return true; }
+            if (s == "0" || s == "false" || s == "False" || s == "FALSE") { out = false; return true; }
+        }
+        Fail(name, "bool", v);
+    }
+
+    static bool ParseString(const Json& v, const char* name, std::string& out) {
+        if (v.is_string()) {
+            out = v.get<std::string>();
+            return !out.empty();
+        }
+        if (v.is_object() || v.is_array()) Fail(name, "string", v);
+        out = v.dump();
+        return true;
+    }
+
+    static std::string TrimLower(std::string s) {
+        const auto notSpace = [](unsigned char c) { return !std::isspace(c); };
+        s.erase(s.begin(), std::find_if(s.begin(), s.end(), notSpace));
+        s.erase(std::find_if(s.rbegin(), s.rend(), notSpace).base(), s.end());
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return s;
+    }
+
+private:
+    static bool IsBlank(const std::string& s) {
+        return std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isspace(c) != 0; });
+    }
+};
+
+/// <summary>
+/// 模块属性描述表：逐项声明属性名、类型、默认值与取值范围，把 properties 绑定到普通结构体 T。
+/// 模块在构造（加载）时绑定一次，推理时直接读结构体字段，不再查找与解析 JSON。
+/// 未设置的属性取默认值，数值按范围截断；类型不符时 Bind 抛出 std::invalid_argument，
+/// GraphExecutor::LoadModels 将其记为该节点加载失败。
+/// 用法：结构体提供 static const PropertySchema<T>& Schema()，模块以 BindProperties<T>() 初始化成员。
+/// </summary>
+template <typename T>
+class PropertySchema final {
+public:
+    // 自定义字段：仅在属性已设置（非 null、非空字符串）时调用，value 不合法时应调用 PropertyParser::Fail
+    using CustomBinder = std::function<void(const Json& value, T& out)>;
+
+    PropertySchema& Int(const char* name, int T::*field, int dv,
+                        int minValue = std::numeric_limits<int>::min(),
+                        int maxValue = std::numeric_limits<int>::max()) {
+        _fields.push_back(Field{name, [=](const Json* v, T& out) {
+            int x = dv;
+            if (v == nullptr || !PropertyParser::ParseInt(*v, name, x)) x = dv;
+            out.*field = std::max(minValue, std::min(maxValue, x));
+        }});
+        return *this;
+    }
+
+    PropertySchema& Double(const char* name, double T::*field, double dv,
+                           double minValue = -std::numeric_limits<double>::infinity(),
+                           double maxValue = std::numeric_limits<double>::infinity()) {
+        _fields.push_back(Field{name, [=](const Json* v, T& out) {
+            double x = dv;
+            if (v == nullptr || !PropertyParser::ParseDouble(*v, name, x)) x = dv;
+            out.*field = std::max(minValue, std::min(maxValue, x));
+        }});
+        return *this;
+    }
+
+    // 可选数值：未设置时 *has 为 false（如不设上下限的阈值）
+    PropertySchema& OptionalDouble(const char* name, double T::*field, bool T::*has) {
+        _fields.push_back(Field{name, [=](const Json* v, T& out) {
+            double x = 0.0;
+            out.*has = v != nullptr && PropertyParser::ParseDouble(*v, name, x);
+            out.*field = out.*has ? x : 0.0;
+        }});
+        return *this;
+    }
+
+    PropertySchema& Bool(const char* name, bool T::*field, bool dv) {
+        _fields.push_back(Field{name, [=](const Json* v, T& out) {
+            bool x = dv;
+            if (v == nullptr || !PropertyParser::ParseBool(*v, name, x)) x = dv;
+            out.*field = x;
+        }});
+        return *this;
+    }
+
+    PropertySchema& String(const char* name, std::string T::*field, const std::string& dv,
+                           PropertyText text = PropertyText::Raw) {
+        _fields.push_back(Field{name, [=](const Json* v, T& out) {
+            std::string x;
+            if (v == nullptr || !PropertyParser::ParseString(*v, name, x)) x = dv;
+            out.*field = text == PropertyText::TrimLower ? PropertyParser::TrimLower(std::move(x)) : std::move(x);
+        }});
+        return *this;
+    }
+
+    PropertySchema& Custom(const char* name, CustomBinder binder) {
+        _fields.push_back(Field{name, [=](const Json* v, T& out) {
+            if (v == nullptr || (v->is_string() && v->get_ref<const std::string&>().empty())) return;
+            try {
+                binder(*v, out);
+            } catch (const std::invalid_argument&) {
+                throw;
+            } catch (const std::exception&) {
+                PropertyParser::Fail(name, "valid value", *v);
+            }
+        }});
+        return *this;
+    }
+
+    T Bind(const Json& properties) const {
+        T out;
+        for (const auto& f : _fields) f.Apply(PropertyParser::Find(properties, f.Name), out);
+        return out;
+    }
+
+private:
+    struct Field final {
+        const char* Name;
+        std::function<void(const Json*, T&)> Apply;
+    };
+    std::vector<Field> _fields;
+};
+
+} // namespace flow
+} // namespace dlcv_infer
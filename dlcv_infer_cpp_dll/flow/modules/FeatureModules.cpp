@@ -25,10 +25,10 @@ namespace flow {
 static constexpr double kPi = 3.14159265358979323846;
 
 static std::string GenerateUuidString() {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
-    static std::uniform_int_distribution<> dis(0, 15);
-    static std::uniform_int_distribution<> dis2(8, 11);
+    // 并行执行的节点可能同时生成 UUID，随机数状态按线程独立
+    static thread_local std::mt19937 gen(std::random_device{}());
+    std::uniform_int_distribution<> dis(0, 15);
+    std::uniform_int_distribution<> dis2(8, 11);
     std::stringstream ss;
     ss << std::hex;
     for (int i = 0; i < 8; i++) ss << dis(gen);
@@ -44,91 +44,6 @@ static std::string GenerateUuidString() {
     return ss.str();
 }
 
-static std::string FormatAffineKey(const std::vector<double>& a) {
-    if (a.size() < 6) return std::string();
-    char buf[256] = {0};
-    std::snprintf(buf, sizeof(buf), "T:%.4f,%.4f,%.2f,%.4f,%.4f,%.2f", a[0], a[1], a[2], a[3], a[4], a[5]);
-    return std::string(buf);
-}
-
-static std::string SerializeTransformSigFromJson(const Json& tObj) {
-    if (!tObj.is_object() || !tObj.contains("affine_2x3") || !tObj.at("affine_2x3").is_array()) return std::string();
-    const Json& a = tObj.at("affine_2x3");
-    if (a.size() < 6) return std::string();
-    std::vector<double> v(6, 0.0);
-    for (size_t i = 0; i < 6; i++) {
-        try { v[i] = a.at(i).get<double>(); } catch (...) { v[i] = 0.0; }
-    }
-    return FormatAffineKey(v);
-}
-
-static std::string SerializeTransform(const TransformationState* st, int index, int originIndex) {
-    if (st == nullptr || st->AffineMatrix2x3.size() < 6) {
-        return "idx:" + std::to_string(index) + "|org:" + std::to_string(originIndex) + "|T:null";
-    }
-    return "idx:" + std::to_string(index) + "|org:" + std::to_string(originIndex) + "|" + FormatAffineKey(st->AffineMatrix2x3);
-}
-
-static Json NormalizeTransformJson(const Json& token) {
-    if (token.is_object()) {
-        Json out = Json::object();
-        for (const auto& item : token.items()) {
-            out[item.key()] = NormalizeTransformJson(item.value());
-        }
-        return out;
-    }
-    if (token.is_array()) {
-        Json out = Json::array();
-        for (const auto& item : token) {
-            out.push_back(NormalizeTransformJson(item));
-        }
-        return out;
-    }
-    if (token.is_number_float()) {
-        return std::round(token.get<double>() * 1000000.0) / 1000000.0;
-    }
-    return token;
-}
-
-static std::string SerializeTransformKey(const TransformationState* st) {
-    if (st == nullptr) return std::string();
-    try {
-        return NormalizeTransformJson(st->ToJson()).dump();
-    } catch (...) {
-        return std::string();
-    }
-}
-
-static std::string SerializeTransformKey(const Json& stObj) {
-    if (!stObj.is_object()) return std::string();
-    try {
-        return NormalizeTransformJson(stObj).dump();
-    } catch (...) {
-        try { return stObj.dump(); } catch (...) { return std::string(); }
-    }
-}
-
-static double GetDoubleProp(const Json& props, const std::string& key, double dv) {
-    if (!props.is_object() || !props.contains(key)) return dv;
-    try {
-        const Json& v = props.at(key);
-        if (v.is_number()) return v.get<double>();
-        if (v.is_string()) return std::stod(v.get<std::string>());
-    } catch (...) {}
-    return dv;
-}
-
-static int GetIntProp(const Json& props, const std::string& key, int dv) {
-    if (!props.is_object() || !props.contains(key)) return dv;
-    try {
-        const Json& v = props.at(key);
-        if (v.is_number_integer()) return v.get<int>();
-        if (v.is_number()) return static_cast<int>(std::llround(v.get<double>()));
-        if (v.is_string()) return std::stoi(v.get<std::string>());
-    } catch (...) {}
-    return dv;
-}
-
 static std::unordered_set<std::string> ToLabelSet(const Json& v) {
     std::unordered_set<std::string> set;
     try {
@@ -147,36 +62,25 @@ static std::unordered_set<std::string> ToLabelSet(const Json& v) {
     return set;
 }
 
-static void GetRotationAffineCcwDeg(int angleCcw, int w, int h, std::vector<double>& A, int& newW, int& newH) {
+static void GetRotationAffineCcwDeg(int angleCcw, int w, int h, Affine2x3& A, int& newW, int& newH) {
     const int a = ((angleCcw % 360) + 360) % 360;
     if (a == 90) {
         // (x,y)->(y, W-1-x)
-        A = { 0, 1, 0, -1, 0, static_cast<double>(w - 1) };
+        A = Affine2x3(0, 1, 0, -1, 0, static_cast<double>(w - 1));
         newW = h; newH = w;
     } else if (a == 180) {
-        A = { -1, 0, static_cast<double>(w - 1), 0, -1, static_cast<double>(h - 1) };
+        A = Affine2x3(-1, 0, static_cast<double>(w - 1), 0, -1, static_cast<double>(h - 1));
         newW = w; newH = h;
     } else if (a == 270) {
         // (x,y)->(H-1-y, x)
-        A = { 0, -1, static_cast<double>(h - 1), 1, 0, 0 };
+        A = Affine2x3(0, -1, static_cast<double>(h - 1), 1, 0, 0);
         newW = h; newH = w;
     } else {
-        A = { 1,0,0, 0,1,0 };
+        A = Affine2x3();
         newW = w; newH = h;
     }
 }
 
-static cv::Point2f Apply2x3(const std::vector<double>& A, const cv::Point2f& p) {
-    const double a = A.size() >= 6 ? A[0] : 1.0;
-    const double b = A.size() >= 6 ? A[1] : 0.0;
-    const double tx = A.size() >= 6 ? A[2] : 0.0;
-    const double c = A.size() >= 6 ? A[3] : 0.0;
-    const double d = A.size() >= 6 ? A[4] : 1.0;
-    const double ty = A.size() >= 6 ? A[5] : 0.0;
-    return cv::Point2f(static_cast<float>(a * p.x + b * p.y + tx),
-                       static_cast<float>(c * p.x + d * p.y + ty));
-}
-
 static Json NormalizeAngleRad(Json angleVal) {
     double a = -100.0;
     try { if (angleVal.is_number()) a = angleVal.get<double>(); } catch (...) { a = -100.0; }
@@ -285,14 +189,8 @@ static double SafeScore(const Json& v) {
     return 0.0;
 }
 
-static std::string BuildImageSignature(const ModuleImage& im) {
-    std::string tSig;
-    try {
-        tSig = im.TransformState.ToJson().dump();
-    } catch (...) {
-        tSig.clear();
-    }
-    return "module|" + std::to_string(im.OriginalIndex) + "|" + tSig;
+static std::uint64_t BuildImageSignature(const ModuleImage& im) {
+    return FlowHashMix(im.TransformState.TransformId, static_cast<std::uint32_t>(im.OriginalIndex));
 }
 
 static std::string PickFirstLabel(const Json& sampleResults, bool useTop1) {
@@ -335,39 +233,19 @@ public:
         const std::vector<ModuleImage>& imagesIn = imageList;
         const Json resultsIn = resultList.is_array() ? resultList : Json::array();
 
-        const double cropExpand = std::max(0.0, GetDoubleProp(Properties, "crop_expand", 0.0));
-        std::string cropExpandMode = ReadString("crop_expand_mode", "pixel");
-        cropExpandMode.erase(cropExpandMode.begin(),
-                             std::find_if(cropExpandMode.begin(), cropExpandMode.end(),
-                                          [] (unsigned char c) { return !std::isspace(c); }));
-        cropExpandMode.erase(std::find_if(cropExpandMode.rbegin(), cropExpandMode.rend(),
-                                          [] (unsigned char c) { return !std::isspace(c); }).base(),
-                             cropExpandMode.end());
-        std::transform(cropExpandMode.begin(), cropExpandMode.end(), cropExpandMode.begin(),
-                       [] (unsigned char c) { return static_cast<char>(std::tolower(c)); });
-        double cropExpandPercent = GetDoubleProp(Properties, "crop_expand_percent", 0.0);
-        cropExpandPercent = std::max(0.0, cropExpandPercent);
-        const double cropExpandPercentLimit = std::max(0.0, GetDoubleProp(Properties, "crop_expand_percent_limit", 32.0));
-        if (cropExpandPercent > 0.0 && cropExpandMode != "pixel" && cropExpandMode != "px") {
-            cropExpandMode = "percent";
-        } else if (cropExpandPercent > 0.0 && cropExpand <= 0.0) {
-            cropExpandMode = "percent";
-        }
-        const int minSize = std::max(1, GetIntProp(Properties, "min_size", 1));
+        const double cropExpand = _props.CropExpand;
+        const double cropExpandPercent = _props.CropExpandPercent;
+        const double cropExpandPercentLimit = _props.CropExpandPercentLimit;
+        const std::string& cropExpandMode = _props.CropExpandMode;
+        const bool percentMode = cropExpandMode == "percent" ||
+            (cropExpandPercent > 0.0 && ((cropExpandMode != "pixel" && cropExpandMode != "px") || cropExpand <= 0.0));
+        const int minSize = _props.MinSize;
 
-        int cropW = -1, cropH = -1;
-        try {
-            if (Properties.is_object() && Properties.contains("crop_shape") && Properties.at("crop_shape").is_array()) {
-                const Json& cs = Properties.at("crop_shape");
-                if (cs.size() >= 2) {
-                    cropW = cs.at(0).get<int>();
-                    cropH = cs.at(1).get<int>();
-                }
-            }
-        } catch (...) { cropW = -1; cropH = -1; }
+        const int cropW = _props.CropW;
+        const int cropH = _props.CropH;
         const bool hasCropShape = cropW > 0 && cropH > 0;
         const auto resolveExpand = [&] (double baseW, double baseH) -> std::pair<double, double> {
-            if (cropExpandMode == "percent") {
+            if (percentMode) {
                 const double ratio = cropExpandPercent / 100.0;
                 double expandW = std::max(0.0, baseW) * ratio;
                 double expandH = std::max(0.0, baseH) * ratio;
@@ -382,8 +260,8 @@ public:
 
         // transform/index 映射。transform 仅在唯一时使用，避免多张整图恒等变换互相串图。
         using ImageBinding = std::tuple<ModuleImage, cv::Mat, int>;
-        std::unordered_map<std::string, ImageBinding> transformKeyToImage;
-        std::unordered_set<std::string> duplicateTransformKeys;
+        std::unordered_map<std::uint64_t, ImageBinding> transformKeyToImage;
+        std::unordered_set<std::uint64_t> duplicateTransformKeys;
         std::unordered_map<int, ImageBinding> indexToImage;
         std::unordered_map<int, ImageBinding> originToImage;
         for (int i = 0; i < static_cast<int>(imagesIn.size()); i++) {
@@ -395,20 +273,25 @@ public:
                 originToImage[wrap.OriginalIndex] = binding;
             }
 
-            const std::string key = SerializeTransformKey(&wrap.TransformState);
-            if (!key.empty()) {
-                if (transformKeyToImage.find(key) != transformKeyToImage.end()) {
-                    transformKeyToImage.erase(key);
-                    duplicateTransformKeys.insert(key);
-                } else if (duplicateTransformKeys.find(key) == duplicateTransformKeys.end()) {
-                    transformKeyToImage[key] = binding;
-                }
+            const std::uint64_t key = wrap.TransformState.TransformId;
+            if (transformKeyToImage.find(key) != transformKeyToImage.end()) {
+                transformKeyToImage.erase(key);
+                duplicateTransformKeys.insert(key);
+            } else if (duplicateTransformKeys.find(key) == duplicateTransformKeys.end()) {
+                transformKeyToImage[key] = binding;
             }
         }
 
-        std::vector<ModuleImage> imagesOut;
-        Json resultsOut = Json::array();
-        int outIndex = 0;
+        // 第一遍按条目绑定图像并展平检测；各检测的裁图（warpAffine/clone）相互独立，逐条并行生成后按原顺序编号输出
+        struct CropSlot {
+            const ImageBinding* Binding = nullptr;
+            const Json* Det = nullptr;
+            bool Ok = false;
+            ModuleImage Image;
+            Json OutDet;
+            Json Transform;
+        };
+        std::vector<CropSlot> slots;
 
         for (const auto& entryToken : resultsIn) {
             if (!entryToken.is_object()) continue;
@@ -418,8 +301,8 @@ public:
 
             const ImageBinding* binding = nullptr;
             if (entry.contains("transform") && entry.at("transform").is_object()) {
-                const std::string key = SerializeTransformKey(entry.at("transform"));
-                if (!key.empty() && duplicateTransformKeys.find(key) == duplicateTransformKeys.end()) {
+                const std::uint64_t key = TransformationState::IdFromJson(entry.at("transform"));
+                if (duplicateTransformKeys.find(key) == duplicateTransformKeys.end()) {
                     auto it = transformKeyToImage.find(key);
                     if (it != transformKeyToImage.end()) binding = &it->second;
                 }
@@ -437,213 +320,261 @@ public:
 
             if (binding == nullptr) continue;
 
-            const ModuleImage parentWrap = std::get<0>(*binding);
-            const cv::Mat src = std::get<1>(*binding);
-            if (src.empty()) continue;
-            const int W = src.cols;
-            const int H = src.rows;
+            if (std::get<1>(*binding).empty()) continue;
 
             if (!entry.contains("sample_results") || !entry.at("sample_results").is_array()) continue;
             const Json& sampleResults = entry.at("sample_results");
             if (sampleResults.empty()) continue;
 
             for (const auto& sr : sampleResults) {
-                if (!sr.is_object()) continue;
-                if (!sr.contains("bbox") || !sr.at("bbox").is_array() || sr.at("bbox").size() < 4) continue;
-
-                const Json& bbox = sr.at("bbox");
-                bool withAngle = false;
-                double angle = -100.0;
-                try { withAngle = sr.contains("with_angle") ? sr.at("with_angle").get<bool>() : false; } catch (...) { withAngle = false; }
-                try { angle = sr.contains("angle") ? sr.at("angle").get<double>() : -100.0; } catch (...) { angle = -100.0; }
-                if ((!withAngle || angle <= -99.0) && bbox.size() >= 5) {
-                    try { angle = bbox.at(4).get<double>(); withAngle = true; } catch (...) {}
-                }
-
-                cv::Mat cropped;
-                std::vector<double> childA2x3;
-                int cw = 0, ch = 0;
-                double rbx0 = 0.0, rbx1 = 0.0, rbx2 = 0.0, rbx3 = 0.0;
-                double rebuiltAngle = -100.0;
-                bool rebuiltWithAngle = false;
-                bool rebuiltWithBbox = false;
-
-                if (withAngle && angle > -99.0) {
-                    // rotated crop: bbox=[cx,cy,w,h], angle(rad)
-                    const double cx = bbox.at(0).get<double>();
-                    const double cy = bbox.at(1).get<double>();
-                    const double w = std::abs(bbox.at(2).get<double>());
-                    const double h = std::abs(bbox.at(3).get<double>());
-
-                    double w2 = 0.0;
-                    double h2 = 0.0;
-                    if (hasCropShape) {
-                        w2 = static_cast<double>(cropW);
-                        h2 = static_cast<double>(cropH);
-                    } else {
-                        const auto expand = resolveExpand(w, h);
-                        w2 = std::max<double>(minSize, w + 2.0 * expand.first);
-                        h2 = std::max<double>(minSize, h + 2.0 * expand.second);
-                    }
-                    const int iw = std::max(minSize, static_cast<int>(w2));
-                    const int ih = std::max(minSize, static_cast<int>(h2));
-
-                    const double angDeg = angle * 180.0 / kPi;
-                    cv::Mat rotMat = cv::getRotationMatrix2D(cv::Point2f(static_cast<float>(cx), static_cast<float>(cy)), angDeg, 1.0);
-                    rotMat.at<double>(0, 2) += (w2 / 2.0) - cx;
-                    rotMat.at<double>(1, 2) += (h2 / 2.0) - cy;
-
-                    cv::warpAffine(src, cropped, rotMat, cv::Size(iw, ih));
-                    cw = iw; ch = ih;
-                    childA2x3 = {
-                        rotMat.at<double>(0,0), rotMat.at<double>(0,1), rotMat.at<double>(0,2),
-                        rotMat.at<double>(1,0), rotMat.at<double>(1,1), rotMat.at<double>(1,2)
-                    };
+                CropSlot slot;
+                slot.Binding = binding;
+                slot.Det = &sr;
+                slots.push_back(std::move(slot));
+            }
+        }
 
-                    // 重建旋转框：把原始旋转框四点映射到裁剪坐标后重新拟合
-                    try {
-                        const double hw = std::max(0.5, w / 2.0);
-                        const double hh = std::max(0.5, h / 2.0);
-                        const double c = std::cos(angle);
-                        const double s = std::sin(angle);
-                        const double offs[4][2] = {
-                            { -hw, -hh },
-                            {  hw, -hh },
-                            {  hw,  hh },
-                            { -hw,  hh }
-                        };
-                        std::vector<cv::Point2f> ptsNew;
-                        ptsNew.reserve(4);
-                        for (int pi = 0; pi < 4; pi++) {
-                            const double dx = offs[pi][0];
-                            const double dy = offs[pi][1];
-                            const double ox = cx + c * dx - s * dy;
-                            const double oy = cy + s * dx + c * dy;
-                            ptsNew.push_back(Apply2x3(childA2x3, cv::Point2f(static_cast<float>(ox), static_cast<float>(oy))));
-                        }
+        ParallelFor(slots.size(), 2, [&](size_t k) {
+            CropSlot& slot = slots[k];
+            const ModuleImage& parentWrap = std::get<0>(*slot.Binding);
+            const cv::Mat& src = std::get<1>(*slot.Binding);
+            const int W = src.cols;
+            const int H = src.rows;
+            const Json& sr = *slot.Det;
+            if (!sr.is_object()) return;
+            if (!sr.contains("bbox") || !sr.at("bbox").is_array() || sr.at("bbox").size() < 4) return;
+
+            const Json& bbox = sr.at("bbox");
+            bool withAngle = false;
+            double angle = -100.0;
+            try { withAngle = sr.contains("with_angle") ? sr.at("with_angle").get<bool>() : false; } catch (...) { withAngle = false; }
+            try { angle = sr.contains("angle") ? sr.at("angle").get<double>() : -100.0; } catch (...) { angle = -100.0; }
+            if ((!withAngle || angle <= -99.0) && bbox.size() >= 5) {
+                try { angle = bbox.at(4).get<double>(); withAngle = true; } catch (...) {}
+            }
 
-                        const cv::RotatedRect rr = cv::minAreaRect(ptsNew);
-                        rbx0 = rr.center.x;
-                        rbx1 = rr.center.y;
-                        rbx2 = std::max(1.0, std::abs(static_cast<double>(rr.size.width)));
-                        rbx3 = std::max(1.0, std::abs(static_cast<double>(rr.size.height)));
-                        rebuiltAngle = static_cast<double>(rr.angle) * kPi / 180.0;
-                    } catch (...) {
-                        // 兜底：避免旋转框拟合失败时丢失结果
-                        rbx0 = w2 / 2.0;
-                        rbx1 = h2 / 2.0;
-                        rbx2 = std::max(1.0, w);
-                        rbx3 = std::max(1.0, h);
-                        rebuiltAngle = angle;
-                    }
-                    rebuiltWithBbox = true;
-                    rebuiltWithAngle = true;
+            cv::Mat cropped;
+            Affine2x3 childA2x3;
+            int cw = 0, ch = 0;
+            double rbx0 = 0.0, rbx1 = 0.0, rbx2 = 0.0, rbx3 = 0.0;
+            double rebuiltAngle = -100.0;
+            bool rebuiltWithAngle = false;
+            bool rebuiltWithBbox = false;
+
+            if (withAngle && angle > -99.0) {
+                // rotated crop: bbox=[cx,cy,w,h], angle(rad)
+                const double cx = bbox.at(0).get<double>();
+                const double cy = bbox.at(1).get<double>();
+                const double w = std::abs(bbox.at(2).get<double>());
+                const double h = std::abs(bbox.at(3).get<double>());
+
+                double w2 = 0.0;
+                double h2 = 0.0;
+                if (hasCropShape) {
+                    w2 = static_cast<double>(cropW);
+                    h2 = static_cast<double>(cropH);
                 } else {
-                    // axis-aligned crop: bbox=[x,y,w,h]
-                    const double x = bbox.at(0).get<double>();
-                    const double y = bbox.at(1).get<double>();
-                    const double bw = std::abs(bbox.at(2).get<double>());
-                    const double bh = std::abs(bbox.at(3).get<double>());
-                    const double x1 = x;
-                    const double y1 = y;
-                    const double x2 = x + bw;
-                    const double y2 = y + bh;
-
-                    int nx1 = 0, ny1 = 0, nx2 = 0, ny2 = 0;
-                    if (hasCropShape) {
-                        const double cx = (x1 + x2) / 2.0;
-                        const double cy = (y1 + y2) / 2.0;
-                        const double tx1 = std::max(0.0, std::min(static_cast<double>(W), cx - static_cast<double>(cropW) / 2.0));
-                        const double ty1 = std::max(0.0, std::min(static_cast<double>(H), cy - static_cast<double>(cropH) / 2.0));
-                        nx1 = static_cast<int>(std::floor(tx1));
-                        ny1 = static_cast<int>(std::floor(ty1));
-                        nx2 = static_cast<int>(std::max(static_cast<double>(nx1 + 1),
-                                                        std::min(static_cast<double>(W), static_cast<double>(nx1 + cropW))));
-                        ny2 = static_cast<int>(std::max(static_cast<double>(ny1 + 1),
-                                                        std::min(static_cast<double>(H), static_cast<double>(ny1 + cropH))));
-                    } else {
-                        // 外扩：左上 floor，右下 int 截断（与 Python 一致）
-                        const auto expand = resolveExpand(bw, bh);
-                        const double tx1 = std::max(0.0, std::min(static_cast<double>(W), x1 - expand.first));
-                        const double ty1 = std::max(0.0, std::min(static_cast<double>(H), y1 - expand.second));
-                        nx1 = static_cast<int>(std::floor(tx1));
-                        ny1 = static_cast<int>(std::floor(ty1));
-                        const int rx2 = static_cast<int>(x2 + expand.first);
-                        const int ry2 = static_cast<int>(y2 + expand.second);
-                        nx2 = std::min(W, std::max(0, rx2));
-                        ny2 = std::min(H, std::max(0, ry2));
-                        nx2 = std::max(nx1 + minSize, nx2);
-                        ny2 = std::max(ny1 + minSize, ny2);
+                    const auto expand = resolveExpand(w, h);
+                    w2 = std::max<double>(minSize, w + 2.0 * expand.first);
+                    h2 = std::max<double>(minSize, h + 2.0 * expand.second);
+                }
+                const int iw = std::max(minSize, static_cast<int>(w2));
+                const int ih = std::max(minSize, static_cast<int>(h2));
+
+                const double angDeg = angle * 180.0 / kPi;
+                cv::Mat rotMat = cv::getRotationMatrix2D(cv::Point2f(static_cast<float>(cx), static_cast<float>(cy)), angDeg, 1.0);
+                rotMat.at<double>(0, 2) += (w2 / 2.0) - cx;
+                rotMat.at<double>(1, 2) += (h2 / 2.0) - cy;
+
+                cv::warpAffine(src, cropped, rotMat, cv::Size(iw, ih));
+                cw = iw; ch = ih;
+                childA2x3 = Affine2x3(
+                    rotMat.at<double>(0,0), rotMat.at<double>(0,1), rotMat.at<double>(0,2),
+                    rotMat.at<double>(1,0), rotMat.at<double>(1,1), rotMat.at<double>(1,2));
+
+                // 重建旋转框：把原始旋转框四点映射到裁剪坐标后重新拟合
+                try {
+                    const double hw = std::max(0.5, w / 2.0);
+                    const double hh = std::max(0.5, h / 2.0);
+                    const double c = std::cos(angle);
+                    const double s = std::sin(angle);
+                    const double offs[4][2] = {
+                        { -hw, -hh },
+                        {  hw, -hh },
+                        {  hw,  hh },
+                        { -hw,  hh }
+                    };
+                    std::vector<cv::Point2f> ptsNew;
+                    ptsNew.reserve(4);
+                    for (int pi = 0; pi < 4; pi++) {
+                        const double dx = offs[pi][0];
+                        const double dy = offs[pi][1];
+                        const double ox = cx + c * dx - s * dy;
+                        const double oy = cy + s * dx + c * dy;
+                        ptsNew.push_back(cv::Point2f(static_cast<float>(ox), static_cast<float>(oy)));
                     }
-
-                    nx1 = std::max(0, std::min(W, nx1));
-                    ny1 = std::max(0, std::min(H, ny1));
-                    nx2 = std::max(nx1 + 1, std::min(W, nx2));
-                    ny2 = std::max(ny1 + 1, std::min(H, ny2));
-                    cw = nx2 - nx1;
-                    ch = ny2 - ny1;
-                    if (cw <= 0 || ch <= 0) continue;
-                    const cv::Rect rect(nx1, ny1, cw, ch);
-                    cropped = src(rect).clone();
-                    childA2x3 = { 1,0,-static_cast<double>(nx1), 0,1,-static_cast<double>(ny1) };
-
-                    // 普通框保持 xywh 语义，写回裁剪图局部坐标
-                    rbx0 = x - nx1;
-                    rbx1 = y - ny1;
-                    rbx2 = bw;
-                    rbx3 = bh;
-                    rebuiltAngle = -100.0;
-                    rebuiltWithBbox = true;
-                    rebuiltWithAngle = false;
+                    MapPoints(childA2x3, ptsNew.data(), ptsNew.data(), ptsNew.size());
+
+                    const cv::RotatedRect rr = cv::minAreaRect(ptsNew);
+                    rbx0 = rr.center.x;
+                    rbx1 = rr.center.y;
+                    rbx2 = std::max(1.0, std::abs(static_cast<double>(rr.size.width)));
+                    rbx3 = std::max(1.0, std::abs(static_cast<double>(rr.size.height)));
+                    rebuiltAngle = static_cast<double>(rr.angle) * kPi / 180.0;
+                } catch (...) {
+                    // 兜底：避免旋转框拟合失败时丢失结果
+                    rbx0 = w2 / 2.0;
+                    rbx1 = h2 / 2.0;
+                    rbx2 = std::max(1.0, w);
+                    rbx3 = std::max(1.0, h);
+                    rebuiltAngle = angle;
+                }
+                rebuiltWithBbox = true;
+                rebuiltWithAngle = true;
+            } else {
+                // axis-aligned crop: bbox=[x,y,w,h]
+                const double x = bbox.at(0).get<double>();
+                const double y = bbox.at(1).get<double>();
+                const double bw = std::abs(bbox.at(2).get<double>());
+                const double bh = std::abs(bbox.at(3).get<double>());
+                const double x1 = x;
+                const double y1 = y;
+                const double x2 = x + bw;
+                const double y2 = y + bh;
+
+                int nx1 = 0, ny1 = 0, nx2 = 0, ny2 = 0;
+                if (hasCropShape) {
+                    const double cx = (x1 + x2) / 2.0;
+                    const double cy = (y1 + y2) / 2.0;
+                    const double tx1 = std::max(0.0, std::min(static_cast<double>(W), cx - static_cast<double>(cropW) / 2.0));
+                    const double ty1 = std::max(0.0, std::min(static_cast<double>(H), cy - static_cast<double>(cropH) / 2.0));
+                    nx1 = static_cast<int>(std::floor(tx1));
+                    ny1 = static_cast<int>(std::floor(ty1));
+                    nx2 = static_cast<int>(std::max(static_cast<double>(nx1 + 1),
+                                                    std::min(static_cast<double>(W), static_cast<double>(nx1 + cropW))));
+                    ny2 = static_cast<int>(std::max(static_cast<double>(ny1 + 1),
+                                                    std::min(static_cast<double>(H), static_cast<double>(ny1 + cropH))));
+                } else {
+                    // 外扩：左上 floor，右下 int 截断（与 Python 一致）
+                    const auto expand = resolveExpand(bw, bh);
+                    const double tx1 = std::max(0.0, std::min(static_cast<double>(W), x1 - expand.first));
+                    const double ty1 = std::max(0.0, std::min(static_cast<double>(H), y1 - expand.second));
+                    nx1 = static_cast<int>(std::floor(tx1));
+                    ny1 = static_cast<int>(std::floor(ty1));
+                    const int rx2 = static_cast<int>(x2 + expand.first);
+                    const int ry2 = static_cast<int>(y2 + expand.second);
+                    nx2 = std::min(W, std::max(0, rx2));
+                    ny2 = std::min(H, std::max(0, ry2));
+                    nx2 = std::max(nx1 + minSize, nx2);
+                    ny2 = std::max(ny1 + minSize, ny2);
                 }
 
-                if (cropped.empty()) continue;
-
-                const TransformationState parentState = (parentWrap.TransformState.OriginalWidth > 0 && parentWrap.TransformState.OriginalHeight > 0)
-                    ? parentWrap.TransformState
-                    : TransformationState(src.cols, src.rows);
-                const TransformationState childState = parentState.DeriveChild(childA2x3, cw, ch);
-                ModuleImage childWrap(cropped,
-                                      parentWrap.OriginalImage.empty() ? src : parentWrap.OriginalImage,
-                                      childState,
-                                      parentWrap.OriginalIndex);
-                childWrap.UniqueId = GenerateUuidString();
-                imagesOut.push_back(childWrap);
-
-                Json outDet = sr;
-                outDet.erase("mask_array");
-                outDet.erase("mask_rle");
-                outDet.erase("mask");
-                outDet.erase("polygon");
-                outDet.erase("poly");
-                outDet["with_mask"] = false;
-                if (rebuiltWithBbox) {
-                    if (rebuiltWithAngle) {
-                        outDet["bbox"] = Json::array({ rbx0, rbx1, rbx2, rbx3, rebuiltAngle });
-                    } else {
-                        outDet["bbox"] = Json::array({ rbx0, rbx1, rbx2, rbx3 });
-                    }
+                nx1 = std::max(0, std::min(W, nx1));
+                ny1 = std::max(0, std::min(H, ny1));
+                nx2 = std::max(nx1 + 1, std::min(W, nx2));
+                ny2 = std::max(ny1 + 1, std::min(H, ny2));
+                cw = nx2 - nx1;
+                ch = ny2 - ny1;
+                if (cw <= 0 || ch <= 0) return;
+                const cv::Rect rect(nx1, ny1, cw, ch);
+                cropped = src(rect).clone();
+                childA2x3 = Affine2x3(1, 0, -static_cast<double>(nx1), 0, 1, -static_cast<double>(ny1));
+
+                // 普通框保持 xywh 语义，写回裁剪图局部坐标
+                rbx0 = x - nx1;
+                rbx1 = y - ny1;
+                rbx2 = bw;
+                rbx3 = bh;
+                rebuiltAngle = -100.0;
+                rebuiltWithBbox = true;
+                rebuiltWithAngle = false;
+            }
+
+            if (cropped.empty()) return;
+
+            const TransformationState parentState = (parentWrap.TransformState.OriginalWidth > 0 && parentWrap.TransformState.OriginalHeight > 0)
+                ? parentWrap.TransformState
+                : TransformationState(src.cols, src.rows);
+            const TransformationState childState = parentState.DeriveChild(childA2x3, cw, ch);
+            ModuleImage childWrap(cropped,
+                                  parentWrap.OriginalImage.empty() ? src : parentWrap.OriginalImage,
+                                  childState,
+                                  parentWrap.OriginalIndex);
+            childWrap.UniqueId = GenerateUuidString();
+            slot.Image = std::move(childWrap);
+
+            Json outDet = sr;
+            outDet.erase("mask_array");
+            outDet.erase("mask_rle");
+            outDet.erase("mask");
+            outDet.erase("polygon");
+            outDet.erase("poly");
+            outDet["with_mask"] = false;
+            if (rebuiltWithBbox) {
+                if (rebuiltWithAngle) {
+                    outDet["bbox"] = Json::array({ rbx0, rbx1, rbx2, rbx3, rebuiltAngle });
+                } else {
+                    outDet["bbox"] = Json::array({ rbx0, rbx1, rbx2, rbx3 });
                 }
-                outDet["with_bbox"] = rebuiltWithBbox;
-                outDet["with_angle"] = rebuiltWithAngle;
-                outDet["angle"] = rebuiltWithAngle ? rebuiltAngle : -100.0;
-
-                Json outEntry = Json::object();
-                outEntry["type"] = "local";
-                outEntry["originating_module"] = "pre_process/image_generation";
-                outEntry["index"] = outIndex;
-                outEntry["origin_index"] = parentWrap.OriginalIndex;
-                outEntry["transform"] = childState.ToJson();
-                Json outSampleResults = Json::array();
-                outSampleResults.push_back(outDet);
-                outEntry["sample_results"] = outSampleResults;
-                resultsOut.push_back(outEntry);
-                outIndex += 1;
             }
+            outDet["with_bbox"] = rebuiltWithBbox;
+            outDet["with_angle"] = rebuiltWithAngle;
+            outDet["angle"] = rebuiltWithAngle ? rebuiltAngle : -100.0;
+            slot.OutDet = std::move(outDet);
+            slot.Transform = childState.ToJson();
+            slot.Ok = true;
+        });
+
+        std::vector<ModuleImage> imagesOut;
+        Json resultsOut = Json::array();
+        int outIndex = 0;
+        for (auto& slot : slots) {
+            if (!slot.Ok) continue;
+            Json outEntry = Json::object();
+            outEntry["type"] = "local";
+            outEntry["originating_module"] = "pre_process/image_generation";
+            outEntry["index"] = outIndex;
+            outEntry["origin_index"] = slot.Image.OriginalIndex;
+            outEntry["transform"] = std::move(slot.Transform);
+            Json outSampleResults = Json::array();
+            outSampleResults.push_back(std::move(slot.OutDet));
+            outEntry["sample_results"] = std::move(outSampleResults);
+            resultsOut.push_back(std::move(outEntry));
+            imagesOut.push_back(std::move(slot.Image));
+            outIndex += 1;
         }
 
         return ModuleIO(std::move(imagesOut), std::move(resultsOut), Json::array());
     }
+
+private:
+    struct Props {
+        double CropExpand = 0.0;
+        std::string CropExpandMode;
+        double CropExpandPercent = 0.0;
+        double CropExpandPercentLimit = 32.0;
+        int MinSize = 1;
+        int CropW = -1;
+        int CropH = -1;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Double("crop_expand", &Props::CropExpand, 0.0, 0.0)
+                .String("crop_expand_mode", &Props::CropExpandMode, "pixel", PropertyText::TrimLower)
+                .Double("crop_expand_percent", &Props::CropExpandPercent, 0.0, 0.0)
+                .Double("crop_expand_percent_limit", &Props::CropExpandPercentLimit, 32.0, 0.0)
+                .Int("min_size", &Props::MinSize, 1, 1)
+                .Custom("crop_shape", [](const Json& v, Props& out) {
+                    if (!v.is_array()) PropertyParser::Fail("crop_shape", "[w, h]", v);
+                    if (v.size() < 2) return;
+                    if (!v.at(0).is_number() || !v.at(1).is_number()) PropertyParser::Fail("crop_shape", "[w, h]", v);
+                    out.CropW = v.at(0).get<int>();
+                    out.CropH = v.at(1).get<int>();
+                });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// features/image_flip
@@ -655,8 +586,7 @@ public:
         const std::vector<ModuleImage>& images = imageList;
         if (images.empty()) return ModuleIO(std::vector<ModuleImage>(), Json::array(), Json::array());
 
-        std::string dirStr = ReadString("direction", std::string("水平"));
-        const bool vertical = (dirStr.find("竖直") != std::string::npos) || (dirStr.find("vertical") != std::string::npos);
+        const bool vertical = _props.Vertical;
 
         std::vector<ModuleImage> outImages;
         for (const auto& wrap : images) {
@@ -699,6 +629,22 @@ public:
 
         return ModuleIO(std::move(outImages), Json::array(), Json::array());
     }
+
+private:
+    struct Props {
+        bool Vertical = false;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Custom("direction", [](const Json& v, Props& out) {
+                    std::string dir;
+                    if (!PropertyParser::ParseString(v, "direction", dir)) return;
+                    out.Vertical = dir.find("竖直") != std::string::npos || dir.find("vertical") != std::string::npos;
+                });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// pre_process/rect_image_correction
@@ -712,7 +658,7 @@ public:
             return ModuleIO(std::vector<ModuleImage>(), Json::array(), Json::array());
         }
 
-        const std::string direction = NormalizeRectRotateDirection(ReadString("rotate_direction", "clockwise"));
+        const std::string& direction = _props.Direction;
         std::vector<ModuleImage> outImages;
         outImages.reserve(images.size());
 
@@ -757,6 +703,22 @@ public:
 
         return ModuleIO(std::move(outImages), Json::array(), Json::array());
     }
+
+private:
+    struct Props {
+        std::string Direction = "clockwise";
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Custom("rotate_direction", [](const Json& v, Props& out) {
+                    std::string dir;
+                    PropertyParser::ParseString(v, "rotate_direction", dir);
+                    out.Direction = NormalizeRectRotateDirection(dir);
+                });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// pre_process/coordinate_crop, features/coordinate_crop
@@ -768,10 +730,10 @@ public:
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
 
-        const int x = GetIntProp(Properties, "x", 0);
-        const int y = GetIntProp(Properties, "y", 0);
-        const int w0 = std::max(1, GetIntProp(Properties, "w", 100));
-        const int h0 = std::max(1, GetIntProp(Properties, "h", 100));
+        const int x = _props.X;
+        const int y = _props.Y;
+        const int w0 = _props.W;
+        const int h0 = _props.H;
 
         std::vector<ModuleImage> outImages;
         for (const auto& wrap : images) {
@@ -795,7 +757,7 @@ public:
             if (rect.width <= 0 || rect.height <= 0) continue;
 
             cv::Mat crop = baseMat(rect).clone();
-            const std::vector<double> trans = { 1,0,-static_cast<double>(x0), 0,1,-static_cast<double>(y0) };
+            const Affine2x3 trans(1, 0, -static_cast<double>(x0), 0, 1, -static_cast<double>(y0));
             const TransformationState parentState = (wrap.TransformState.OriginalWidth > 0 && wrap.TransformState.OriginalHeight > 0)
                 ? wrap.TransformState
                 : TransformationState(W, H);
@@ -811,6 +773,24 @@ public:
 
         return ModuleIO(std::move(outImages), results, Json::array());
     }
+
+private:
+    struct Props {
+        int X = 0;
+        int Y = 0;
+        int W = 100;
+        int H = 100;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Int("x", &Props::X, 0)
+                .Int("y", &Props::Y, 0)
+                .Int("w", &Props::W, 100, 1)
+                .Int("h", &Props::H, 100, 1);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// pre_process/image_rescale, features/image_rescale
@@ -821,8 +801,7 @@ public:
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
-        double scale = GetDoubleProp(Properties, "scale", 1.0);
-        scale = std::max(0.01, std::min(10.0, scale));
+        const double scale = _props.Scale;
 
         std::vector<ModuleImage> outImages;
         for (const auto& wrap : images) {
@@ -853,6 +832,18 @@ public:
         }
         return ModuleIO(std::move(outImages), results, Json::array());
     }
+
+private:
+    struct Props {
+        double Scale = 1.0;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Double("scale", &Props::Scale, 1.0, 0.01, 10.0);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// features/image_rotate_by_cls
@@ -878,7 +869,7 @@ public:
         }
 
         // Build label maps (transform/index/origin)
-        std::unordered_map<std::string, std::string> tmap;
+        std::unordered_map<std::uint64_t, std::string> tmap;
         std::unordered_map<int, std::string> imap;
         std::unordered_map<int, std::string> omap;
 
@@ -898,8 +889,8 @@ public:
 
             try {
                 if (entry.contains("transform") && entry.at("transform").is_object()) {
-                    const std::string sig = SerializeTransformSigFromJson(entry.at("transform"));
-                    if (!sig.empty()) tmap[sig] = label;
+                    const std::uint64_t sig = TransformationState::AffineMatchKeyFromJson(entry.at("transform"));
+                    if (sig != 0) tmap[sig] = label;
                 }
             } catch (...) {}
 
@@ -911,18 +902,18 @@ public:
         for (const auto& e : resultsDet) ConsumeEntry(e);
 
         std::unordered_map<int, int> originIndexToImgIdx;
-        std::unordered_map<std::string, int> sigToImgIdx;
+        std::unordered_map<std::uint64_t, int> sigToImgIdx;
         for (int i = 0; i < static_cast<int>(images.size()); i++) {
             originIndexToImgIdx[images[i].OriginalIndex] = i;
-            if (images[i].TransformState.AffineMatrix2x3.size() >= 6) {
-                sigToImgIdx[FormatAffineKey(images[i].TransformState.AffineMatrix2x3)] = i;
+            if (images[i].TransformState.HasAffine()) {
+                sigToImgIdx[images[i].TransformState.AffineMatchKey()] = i;
             }
         }
 
         std::vector<ModuleImage> outImages;
         outImages.reserve(images.size());
         std::unordered_map<int, TransformationState> imgNewStates;
-        std::unordered_map<int, std::vector<double>> imgAffine; // current->new
+        std::unordered_map<int, Affine2x3> imgAffine; // current->new
         std::unordered_map<int, int> imgAngleDeg;
 
         for (int i = 0; i < static_cast<int>(images.size()); i++) {
@@ -932,9 +923,9 @@ public:
             const int w = baseImg.cols;
             const int h = baseImg.rows;
 
-            std::string sig = FormatAffineKey(wrap.TransformState.AffineMatrix2x3);
+            const std::uint64_t sig = wrap.TransformState.AffineMatchKey();
             std::string label;
-            if (!sig.empty() && tmap.count(sig)) label = tmap[sig];
+            if (sig != 0 && tmap.count(sig)) label = tmap[sig];
             else if (imap.count(i)) label = imap[i];
             else if (omap.count(wrap.OriginalIndex)) label = omap[wrap.OriginalIndex];
 
@@ -946,7 +937,7 @@ public:
                 else if (set270.count(key)) angleCcw = 270;
             }
 
-            std::vector<double> A;
+            Affine2x3 A;
             int newW = w, newH = h;
             GetRotationAffineCcwDeg(angleCcw, w, h, A, newW, newH);
             imgAffine[i] = A;
@@ -991,8 +982,8 @@ public:
                 try { if (entry.contains("origin_index")) oidx = entry.at("origin_index").get<int>(); } catch (...) { oidx = -1; }
                 if (oidx >= 0 && originIndexToImgIdx.count(oidx)) idx = originIndexToImgIdx[oidx];
                 if (idx < 0 && entry.contains("transform") && entry.at("transform").is_object()) {
-                    const std::string esig = SerializeTransformSigFromJson(entry.at("transform"));
-                    if (!esig.empty() && sigToImgIdx.count(esig)) idx = sigToImgIdx[esig];
+                    const std::uint64_t esig = TransformationState::AffineMatchKeyFromJson(entry.at("transform"));
+                    if (esig != 0 && sigToImgIdx.count(esig)) idx = sigToImgIdx[esig];
                 }
             }
 
@@ -1001,7 +992,7 @@ public:
                 continue;
             }
 
-            const std::vector<double>& A = imgAffine[idx];
+            const Affine2x3& A = imgAffine[idx];
             entry["transform"] = imgNewStates[idx].ToJson();
 
             if (entry.contains("sample_results") && entry.at("sample_results").is_array()) {
@@ -1024,7 +1015,7 @@ public:
                         double cy = bbox.at(1).get<double>();
                         double ww = bbox.at(2).get<double>();
                         double hh = bbox.at(3).get<double>();
-                        const cv::Point2f nc = Apply2x3(A, cv::Point2f(static_cast<float>(cx), static_cast<float>(cy)));
+                        const cv::Point2f nc = A.Map(cv::Point2f(static_cast<float>(cx), static_cast<float>(cy)));
                         const double rotRad = (static_cast<double>(imgAngleDeg[idx]) * kPi / 180.0);
                         const double newAng = std::fmod(ang + rotRad + kPi, 2.0 * kPi) - kPi;
                         if (bbox.size() >= 5) {
@@ -1042,11 +1033,12 @@ public:
                         const double ww = bbox.at(2).get<double>();
                         const double hh = bbox.at(3).get<double>();
                         std::vector<cv::Point2f> pts = {
-                            Apply2x3(A, cv::Point2f(static_cast<float>(x), static_cast<float>(y))),
-                            Apply2x3(A, cv::Point2f(static_cast<float>(x+ww), static_cast<float>(y))),
-                            Apply2x3(A, cv::Point2f(static_cast<float>(x+ww), static_cast<float>(y+hh))),
-                            Apply2x3(A, cv::Point2f(static_cast<float>(x), static_cast<float>(y+hh))),
+                            cv::Point2f(static_cast<float>(x), static_cast<float>(y)),
+                            cv::Point2f(static_cast<float>(x+ww), static_cast<float>(y)),
+                            cv::Point2f(static_cast<float>(x+ww), static_cast<float>(y+hh)),
+                            cv::Point2f(static_cast<float>(x), static_cast<float>(y+hh)),
                         };
+                        MapPoints(A, pts.data(), pts.data(), pts.size());
                         float minx = pts[0].x, miny = pts[0].y, maxx = pts[0].x, maxy = pts[0].y;
                         for (const auto& p : pts) {
                             minx = std::min(minx, p.x); miny = std::min(miny, p.y);
@@ -1102,8 +1094,8 @@ public:
             }
         }
 
-        const std::string fixedText = ReadString("fixed_text", std::string());
-        const bool useTop1 = ReadBool("use_first_score_top1", true);
+        const std::string& fixedText = _props.FixedText;
+        const bool useTop1 = _props.UseTop1;
 
         // 第一路标签映射：entry.index -> top1 category_name
         std::unordered_map<int, std::string> labelMap;
@@ -1158,6 +1150,125 @@ public:
 
         return ModuleIO(imagesB, outResults, Json::array());
     }
+
+private:
+    struct Props {
+        std::string FixedText;
+        bool UseTop1 = true;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .String("fixed_text", &Props::FixedText, std::string())
+                .Bool("use_first_score_top1", &Props::UseTop1, true);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
+};
+
+/// <summary>
+/// features/gate：条件门控，用于级联流程的提前退出。
+/// 条件：连接了标量输入（优先名为 condition）时取其真值；否则统计结果中类别属于 categories（为空不限）
+/// 且 score 不低于 min_score 的检测数，达到 min_count 为真。invert 取反。
+/// 条件为真时原样透传图像与结果；为假时输出为空并关闭门控，GraphExecutor 跳过只依赖本节点通道输出的下游子图。
+/// 标量输出 open 始终发布判定结果。
+/// </summary>
+class GateModule final : public BaseModule {
+public:
+    using BaseModule::BaseModule;
+
+    // 门控状态不进入节点输出缓存，每次执行
+    bool IsOutputCacheable() const override { return false; }
+
+    bool TakesOwnedResultList() const override { return true; }
+
+    ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
+        return ProcessOwned(imageList, Json(resultList));
+    }
+
+    ModuleIO ProcessOwned(const std::vector<ModuleImage>& imageList, Json&& resultList) override {
+        bool open = false;
+        const Json* condition = FindCondition();
+        if (condition != nullptr) {
+            open = IsTruthy(*condition);
+        } else {
+            open = CountMatches(resultList) >= _props.MinCount;
+        }
+        if (_props.Invert) open = !open;
+
+        ScalarOutputsByName["open"] = open;
+        GateClosed = !open;
+        if (!open) return ModuleIO(std::vector<ModuleImage>(), Json::array(), Json::array());
+        return ModuleIO(imageList, resultList.is_array() ? std::move(resultList) : Json::array(), Json::array());
+    }
+
+private:
+    struct Props {
+        std::unordered_set<std::string> Categories;
+        double MinScore = 0.0;
+        int MinCount = 1;
+        bool Invert = false;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Custom("categories", [](const Json& v, Props& out) {
+                    if (!v.is_array() && !v.is_string()) PropertyParser::Fail("categories", "array of strings", v);
+                    out.Categories = ToLabelSet(v);
+                })
+                .Double("min_score", &Props::MinScore, 0.0)
+                .Int("min_count", &Props::MinCount, 1, 0)
+                .Bool("invert", &Props::Invert, false);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
+
+    const Json* FindCondition() const {
+        auto itName = ScalarInputsByName.find("condition");
+        if (itName != ScalarInputsByName.end()) return &itName->second;
+        if (!ScalarInputsByIndex.empty()) return &ScalarInputsByIndex.begin()->second;
+        return nullptr;
+    }
+
+    static bool IsTruthy(const Json& v) {
+        try {
+            if (v.is_boolean()) return v.get<bool>();
+            if (v.is_number()) return v.get<double>() != 0.0;
+            if (v.is_string()) {
+                const std::string s = ToLowerAsciiCopy(TrimCopy(v.get<std::string>()));
+                return !(s.empty() || s == "false" || s == "0");
+            }
+            if (v.is_array() || v.is_object()) return !v.empty();
+        } catch (...) {}
+        return false;
+    }
+
+    int CountMatches(const Json& resultList) const {
+        if (_props.MinCount <= 0) return 0;
+        int count = 0;
+        if (!resultList.is_array()) return count;
+        for (const auto& entry : resultList) {
+            if (!entry.is_object()) continue;
+            auto itDets = entry.find("sample_results");
+            if (itDets == entry.end() || !itDets->is_array()) continue;
+            for (const auto& det : *itDets) {
+                if (!det.is_object()) continue;
+                if (!_props.Categories.empty()) {
+                    auto itCat = det.find("category_name");
+                    if (itCat == det.end() || !itCat->is_string()) continue;
+                    if (!_props.Categories.count(itCat->get_ref<const std::string&>())) continue;
+                }
+                if (_props.MinScore > 0.0) {
+                    auto itScore = det.find("score");
+                    if (itScore == det.end() || !itScore->is_number()) continue;
+                    if (itScore->get<double>() < _props.MinScore) continue;
+                }
+                // 达到阈值即可判定，不再继续遍历
+                if (++count >= _props.MinCount) return count;
+            }
+        }
+        return count;
+    }
 };
 
 // 注册
@@ -1174,6 +1285,7 @@ DLCV_FLOW_REGISTER_MODULE("pre_process/image_rotate_by_cls", ImageRotateByClsMod
 DLCV_FLOW_REGISTER_MODULE("features/image_rotate_by_cls", ImageRotateByClsModule)
 DLCV_FLOW_REGISTER_MODULE("post_process/result_label_merge", ResultLabelMergeModule)
 DLCV_FLOW_REGISTER_MODULE("features/result_label_merge", ResultLabelMergeModule)
+DLCV_FLOW_REGISTER_MODULE("features/gate", GateModule)
 
 } // namespace flow
 } // namespace dlcv_infer
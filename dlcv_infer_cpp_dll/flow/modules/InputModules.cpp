@@ -1,4 +1,5 @@
 ﻿#include "flow/BaseModule.h"
+#include "flow/ContextKeys.h"
 #include "flow/ModuleRegistry.h"
 #include "flow/utils/MaskRleUtils.h"
 
@@ -113,16 +114,21 @@ static cv::Mat ReadFromPathForFlow(const std::string& path) {
     return PrepareDecodedImageForFlow(decoded);
 }
 
+// 前端选中图像路径的上下文键，按优先级排列
+static const ContextKey<std::string>* const kSelectedImagePathKeys[] = {
+    &ContextKeys::FrontendSelectedImagePath, &ContextKeys::SelectedImagePath,
+    &ContextKeys::ImgPath, &ContextKeys::FrontendImagePath
+};
+
 static std::vector<std::string> ResolveFileList(const Json& props, ExecutionContext* ctx) {
     std::vector<std::string> files;
 
     // 1) 上下文优先
     if (ctx != nullptr) {
-        const char* keys[] = { "frontend_selected_image_path", "selected_image_path", "img_path", "frontend_image_path" };
-        for (const char* k : keys) {
+        for (const ContextKey<std::string>* k : kSelectedImagePathKeys) {
             try {
-                const std::string v = ctx->Get<std::string>(k, std::string());
-                if (!v.empty()) { files.push_back(v); break; }
+                const std::string* v = ctx->Find(*k);
+                if (v != nullptr && !v->empty()) { files.push_back(*v); break; }
             } catch (...) {}
         }
     }
@@ -155,23 +161,15 @@ static bool TryBuildContextBatchImages(
     bool includeFilepathField) {
     if (ctx == nullptr) return false;
 
-    std::vector<cv::Mat> matsFromContext;
-    try {
-        matsFromContext = ctx->Get<std::vector<cv::Mat>>("frontend_image_mats", std::vector<cv::Mat>());
-    } catch (...) {
-        matsFromContext.clear();
+    // 前端图像列表在 Run 前写入、运行中只读，按引用访问
+    const std::vector<cv::Mat>* matsFromContext = ctx->Find(ContextKeys::FrontendImageMats);
+    if (matsFromContext == nullptr || matsFromContext->empty()) {
+        matsFromContext = ctx->Find(ContextKeys::FrontendImageMatList);
     }
-    if (matsFromContext.empty()) {
-        try {
-            matsFromContext = ctx->Get<std::vector<cv::Mat>>("frontend_image_mat_list", std::vector<cv::Mat>());
-        } catch (...) {
-            matsFromContext.clear();
-        }
-    }
-    if (matsFromContext.empty()) return false;
+    if (matsFromContext == nullptr || matsFromContext->empty()) return false;
 
     int ctxIndex = 0;
-    for (const auto& mat : matsFromContext) {
+    for (const auto& mat : *matsFromContext) {
         if (mat.empty()) {
             ctxIndex += 1;
             continue;
@@ -217,10 +215,10 @@ public:
 
         // 优先从 ExecutionContext 注入的前端 Mat 读取（接口约定为 RGB）
         try {
-            if (Context != nullptr && Context->Has("frontend_image_mat")) {
-                cv::Mat matFromContext = Context->Get<cv::Mat>("frontend_image_mat", cv::Mat());
-                if (!matFromContext.empty()) {
-                    cv::Mat frontendMat = matFromContext;
+            const cv::Mat* matFromContext = Context != nullptr ? Context->Find(ContextKeys::FrontendImageMat) : nullptr;
+            if (matFromContext != nullptr) {
+                if (!matFromContext->empty()) {
+                    cv::Mat frontendMat = *matFromContext;
                     TransformationState st(frontendMat.cols, frontendMat.rows);
                     ModuleImage wrap(frontendMat, frontendMat, st, 0);
                     images.push_back(wrap);
@@ -297,10 +295,10 @@ public:
 
         // 优先从 ExecutionContext 注入前端图像 Mat（接口约定为 RGB）
         try {
-            if (Context != nullptr && Context->Has("frontend_image_mat")) {
-                cv::Mat matFromContext = Context->Get<cv::Mat>("frontend_image_mat", cv::Mat());
-                if (!matFromContext.empty()) {
-                    cv::Mat frontendMat = matFromContext;
+            const cv::Mat* matFromContext = Context != nullptr ? Context->Find(ContextKeys::FrontendImageMat) : nullptr;
+            if (matFromContext != nullptr) {
+                if (!matFromContext->empty()) {
+                    cv::Mat frontendMat = *matFromContext;
                     TransformationState st(frontendMat.cols, frontendMat.rows);
                     ModuleImage wrap(frontendMat, frontendMat, st, 0);
                     images.push_back(wrap);
@@ -326,7 +324,7 @@ public:
             }
         } catch (...) {}
         if (path.empty()) {
-            try { if (Context) path = Context->Get<std::string>("frontend_image_path", std::string()); } catch (...) {}
+            try { if (Context) path = Context->Get(ContextKeys::FrontendImagePath, std::string()); } catch (...) {}
         }
         if (path.empty() || !FileExists(path)) {
             return ModuleIO(std::move(images), std::move(results), Json::array());
@@ -359,6 +357,9 @@ class InputBuildResultsModule final : public BaseModule {
 public:
     using BaseModule::BaseModule;
 
+    // 图像路径可能取自上下文
+    bool IsOutputCacheable() const override { return false; }
+
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& /*resultList*/) override {
         std::vector<ModuleImage> outImages;
         Json outResults = Json::array();
@@ -376,10 +377,9 @@ public:
             std::string imagePath;
             try { if (Properties.is_object() && Properties.contains("image_path")) imagePath = Properties.at("image_path").get<std::string>(); } catch (...) {}
             if (imagePath.empty() && Context != nullptr) {
-                const char* keys[] = { "frontend_selected_image_path", "selected_image_path", "img_path", "frontend_image_path" };
-                for (const char* k : keys) {
+                for (const ContextKey<std::string>* k : kSelectedImagePathKeys) {
                     try {
-                        imagePath = Context->Get<std::string>(k, std::string());
+                        imagePath = Context->Get(*k, std::string());
                         if (!imagePath.empty()) break;
                     } catch (...) {}
                 }
@@ -1,7 +1,12 @@
 #include "flow/modules/ModelModules.h"
+#include "flow/ContextKeys.h"
+#include "flow/DetectionBatch.h"
+#include "flow/FlowPayloadTypes.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <exception>
 #include <mutex>
 #include <stdexcept>
 #include <unordered_map>
@@ -15,6 +20,10 @@
 namespace dlcv_infer {
 namespace flow {
 
+// 模型最大 batch 缓存：按 modelIndex 保存，模型池可由快照预置
+static std::mutex s_batchLimitMu;
+static std::unordered_map<int, int> s_batchLimitByModel;
+
 std::string ModelPool::MakeKey(const std::string& modelPathUtf8, int deviceId) {
     return modelPathUtf8 + "|dev:" + std::to_string(deviceId);
 }
@@ -24,7 +33,7 @@ ModelPool& ModelPool::Instance() {
     return s;
 }
 
-std::shared_ptr<dlcv_infer::Model> ModelPool::Acquire(const std::string& modelPathUtf8, int deviceId) {
+std::shared_ptr<dlcv_infer::Model> ModelPool::Acquire(const std::string& modelPathUtf8, int deviceId, std::uint64_t* serial) {
     if (modelPathUtf8.empty()) {
         throw std::invalid_argument("model_path is empty");
     }
@@ -33,15 +42,31 @@ std::shared_ptr<dlcv_infer::Model> ModelPool::Acquire(const std::string& modelPa
     auto it = _cache.find(key);
     if (it != _cache.end() && it->second.model) {
         it->second.refCount++;
+        if (serial != nullptr) *serial = it->second.serial;
         return it->second.model;
     }
 
     // FlowGraph 内部按 UTF-8 存储；现有 dlcv_infer::Model 构造函数按“输入为 GBK”处理
     const std::string gbkPath = dlcv_infer::convertUtf8ToGbk(modelPathUtf8);
     auto model = std::make_shared<dlcv_infer::Model>(gbkPath, deviceId);
+    auto seed = _seeds.find(key);
+    if (seed != _seeds.end()) {
+        if (!seed->second.modelInfo.is_null()) {
+            model->_cachedModelInfo = std::move(seed->second.modelInfo);
+            model->_hasCachedModelInfo = true;
+        }
+        if (seed->second.batchLimit > 0) {
+            std::lock_guard<std::mutex> limitLk(s_batchLimitMu);
+            s_batchLimitByModel[model->modelIndex] = seed->second.batchLimit;
+        }
+        _seeds.erase(seed);
+    }
     Entry entry;
     entry.model = model;
+    entry.batcher = std::make_shared<ModelBatcher>(model);
     entry.refCount = 1;
+    entry.serial = _nextSerial++;
+    if (serial != nullptr) *serial = entry.serial;
     _cache[key] = std::move(entry);
     return model;
 }
@@ -68,6 +93,202 @@ void ModelPool::Clear() {
     _cache.clear();
 }
 
+std::shared_ptr<ModelBatcher> ModelPool::GetBatcher(const std::string& modelPathUtf8, int deviceId) {
+    const std::string key = ModelPool::MakeKey(modelPathUtf8, deviceId);
+    std::lock_guard<std::mutex> lk(_mu);
+    auto it = _cache.find(key);
+    if (it == _cache.end()) return std::shared_ptr<ModelBatcher>();
+    return it->second.batcher;
+}
+
+void ModelPool::SeedModelInfo(const std::string& modelPathUtf8, int deviceId, const Json& modelInfo, int batchLimit) {
+    if (modelPathUtf8.empty()) return;
+    const std::string key = ModelPool::MakeKey(modelPathUtf8, deviceId);
+    std::lock_guard<std::mutex> lk(_mu);
+    if (_cache.find(key) != _cache.end()) return;
+    Seed seed;
+    seed.modelInfo = modelInfo;
+    seed.batchLimit = batchLimit;
+    _seeds[key] = std::move(seed);
+}
+
+void ModelPool::SetDynamicBatching(double maxWaitMs, int maxBatch) {
+    const double us = maxWaitMs > 0.0 ? std::min(maxWaitMs * 1000.0, 1000000.0) : 0.0;
+    _batchWaitUs.store(static_cast<int>(std::llround(us)));
+    _batchMax.store(maxBatch > 0 ? maxBatch : 0);
+}
+
+void ModelPool::GetDynamicBatching(double& maxWaitMs, int& maxBatch) const {
+    maxWaitMs = _batchWaitUs.load() / 1000.0;
+    maxBatch = _batchMax.load();
+}
+
+// 当前线程最近一次 InferBatch 的 SDK 推理耗时（SDK 未提供时取总耗时）
+static double ReadLastSdkMs() {
+    double sdkMs = 0.0;
+    double totalMs = 0.0;
+    dlcv_infer::Model::GetLastInferTiming(sdkMs, totalMs);
+    return sdkMs > 0.0 ? sdkMs : totalMs;
+}
+
+struct ModelBatcher::Request final {
+    const std::vector<cv::Mat>* Mats = nullptr;
+    std::string Key;
+    std::chrono::steady_clock::time_point Arrival;
+    std::vector<dlcv_infer::SampleResult> Results;
+    double SdkMs = 0.0;
+    bool Taken = false; // 已被某一批取走，等待其结果
+    bool Done = false;
+    std::exception_ptr Error;
+};
+
+std::vector<dlcv_infer::SampleResult> ModelBatcher::InferBatch(const std::vector<cv::Mat>& mats, const Json& params,
+    int maxBatch, double maxWaitMs, double& sdkMs) {
+    sdkMs = 0.0;
+    if (maxWaitMs <= 0.0 || mats.empty() || static_cast<int>(mats.size()) >= maxBatch) {
+        {
+            std::lock_guard<std::mutex> lk(_mu);
+            _stats.Requests++;
+            _stats.Batches++;
+            _stats.Images += mats.size();
+            _stats.MaxBatchImages = std::max(_stats.MaxBatchImages, static_cast<int>(mats.size()));
+        }
+        dlcv_infer::Result res = _model->InferBatch(mats, params);
+        sdkMs = ReadLastSdkMs();
+        return std::move(res.sampleResults);
+    }
+
+    const cv::Mat& first = mats.front();
+    Request req;
+    req.Mats = &mats;
+    req.Arrival = std::chrono::steady_clock::now();
+    req.Key = std::to_string(first.rows) + "x" + std::to_string(first.cols) + "x" + std::to_string(first.type()) +
+        "|" + params.dump();
+
+    std::unique_lock<std::mutex> lk(_mu);
+    _pending.push_back(&req);
+    _cv.notify_all();
+    while (!req.Done) {
+        // 同键没有请求在收集时由当前请求接手（首个到达者，或上一批装不下的剩余请求）
+        if (!req.Taken && _gathering.count(req.Key) == 0) {
+            RunAsLeader(lk, req, params, maxBatch, maxWaitMs);
+            break;
+        }
+        _cv.wait(lk);
+    }
+
+    if (req.Error) std::rethrow_exception(req.Error);
+    sdkMs = req.SdkMs;
+    return std::move(req.Results);
+}
+
+void ModelBatcher::RunAsLeader(std::unique_lock<std::mutex>& lk, Request& leader, const Json& params,
+    int maxBatch, double maxWaitMs) {
+    const std::string key = leader.Key;
+    _gathering.insert(key);
+
+    const auto pendingImages = [this, &key]() {
+        size_t n = 0;
+        for (const Request* r : _pending) {
+            if (r->Key == key) n += r->Mats->size();
+        }
+        return n;
+    };
+    // 没有其它同键请求排队、也没有批次正在执行时直接执行，单个调用方不承担固定的合批等待
+    if (_executingBatches > 0 || pendingImages() > leader.Mats->size()) {
+        const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::microseconds(static_cast<long long>(maxWaitMs * 1000.0));
+        _cv.wait_until(lk, deadline, [&]() { return pendingImages() >= static_cast<size_t>(maxBatch); });
+    }
+
+    // 取出本批：自身优先，其余同键请求按到达顺序装入，不超过 maxBatch
+    std::vector<Request*> batch;
+    leader.Taken = true;
+    batch.push_back(&leader);
+    size_t total = leader.Mats->size();
+    for (auto it = _pending.begin(); it != _pending.end();) {
+        Request* r = *it;
+        if (r == &leader) {
+            it = _pending.erase(it);
+            continue;
+        }
+        if (r->Key == key && total + r->Mats->size() <= static_cast<size_t>(maxBatch)) {
+            r->Taken = true;
+            batch.push_back(r);
+            total += r->Mats->size();
+            it = _pending.erase(it);
+            continue;
+        }
+        ++it;
+    }
+    _gathering.erase(key);
+    _executingBatches++;
+    RecordBatch(batch, total);
+    lk.unlock();
+    _cv.notify_all();
+
+    std::vector<cv::Mat> merged;
+    merged.reserve(total);
+    for (const Request* r : batch) merged.insert(merged.end(), r->Mats->begin(), r->Mats->end());
+
+    std::vector<dlcv_infer::SampleResult> results;
+    std::exception_ptr error;
+    double batchMs = 0.0;
+    try {
+        dlcv_infer::Result res = _model->InferBatch(merged, params);
+        results = std::move(res.sampleResults);
+        batchMs = ReadLastSdkMs();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    lk.lock();
+    _executingBatches--;
+    size_t offset = 0;
+    for (Request* r : batch) {
+        const size_t n = r->Mats->size();
+        if (error) {
+            r->Error = error;
+        } else {
+            r->Results.reserve(n);
+            for (size_t k = 0; k < n; k++) {
+                if (offset + k < results.size()) {
+                    r->Results.push_back(std::move(results[offset + k]));
+                } else {
+                    r->Results.push_back(dlcv_infer::SampleResult(std::vector<dlcv_infer::ObjectResult>()));
+                }
+            }
+        }
+        r->SdkMs = total > 0 ? batchMs * static_cast<double>(n) / static_cast<double>(total) : 0.0;
+        r->Done = true;
+        offset += n;
+    }
+    _cv.notify_all();
+}
+
+void ModelBatcher::RecordBatch(const std::vector<Request*>& batch, size_t images) {
+    const auto now = std::chrono::steady_clock::now();
+    for (const Request* r : batch) {
+        const double waitMs = std::chrono::duration<double, std::milli>(now - r->Arrival).count();
+        _stats.TotalWaitMs += waitMs;
+        _stats.MaxWaitMs = std::max(_stats.MaxWaitMs, waitMs);
+    }
+    _stats.Requests += batch.size();
+    _stats.Batches++;
+    _stats.Images += images;
+    _stats.MaxBatchImages = std::max(_stats.MaxBatchImages, static_cast<int>(images));
+}
+
+ModelBatcher::Stats ModelBatcher::GetStats() const {
+    std::lock_guard<std::mutex> lk(_mu);
+    return _stats;
+}
+
+void ModelBatcher::ResetStats() {
+    std::lock_guard<std::mutex> lk(_mu);
+    _stats = Stats();
+}
+
 static std::string GetFileNameOnlyLocal(const std::string& path) {
     if (path.empty()) return std::string();
     const size_t pos = path.find_last_of("/\\");
@@ -81,12 +302,20 @@ void BaseModelModule::LoadModel() {
     int deviceId = _deviceId;
     try {
         if (Context != nullptr) {
-            deviceId = Context->Get<int>("device_id", deviceId);
+            deviceId = Context->Get(ContextKeys::DeviceId, deviceId);
         }
     } catch (...) {}
 
     _resolvedDeviceId = deviceId;
-    _model = ModelPool::Instance().Acquire(_modelPathUtf8, deviceId);
+    _model = ModelPool::Instance().Acquire(_modelPathUtf8, deviceId, &_modelSerial);
+    _batcher = ModelPool::Instance().GetBatcher(_modelPathUtf8, deviceId);
+}
+
+std::uint64_t BaseModelModule::OutputCacheIdentity() {
+    LoadModel();
+    std::uint64_t h = FlowHashBytes(0, _modelPathUtf8.data(), _modelPathUtf8.size());
+    h = FlowHashMix(h, static_cast<std::uint64_t>(static_cast<std::int64_t>(_resolvedDeviceId)));
+    return FlowHashMix(h, _modelSerial);
 }
 
 static void TryAddParam(Json& p, const Json& props, const std::string& key) {
@@ -249,6 +478,92 @@ static Json ConvertSampleResultToLocalSamples(
     return list;
 }
 
+// 与 ConvertSampleResultToLocalSamples 产出的 JSON 逐字段一致，直接写入列式结果表
+static void AppendObjectsToBatch(
+    DetectionBatch& batch,
+    const std::vector<dlcv_infer::ObjectResult>& objects,
+    bool includeMask,
+    bool emitMaskRle,
+    bool emitMaskDerivedMeta,
+    std::unordered_map<std::string, std::uint32_t>& nameIdCache) {
+    for (const auto& obj : objects) {
+        const size_t d = batch.AppendDetection();
+        std::uint32_t bits = DetectionBatch::HasCategoryId | DetectionBatch::HasCategoryName |
+            DetectionBatch::HasScore | DetectionBatch::HasArea | DetectionBatch::HasWithBbox |
+            DetectionBatch::HasWithMask | DetectionBatch::HasWithAngle | DetectionBatch::HasAngle;
+        Json extras;
+
+        batch.CategoryId[d] = obj.categoryId;
+        // dlcv_infer::Model 侧把 categoryName 从 UTF-8 转为 GBK 了；FlowGraph 内统一使用 UTF-8
+        auto itCachedName = nameIdCache.find(obj.categoryName);
+        if (itCachedName == nameIdCache.end()) {
+            const std::string utf8Name = dlcv_infer::convertGbkToUtf8(obj.categoryName);
+            itCachedName = nameIdCache.emplace(obj.categoryName, batch.InternName(utf8Name)).first;
+        }
+        batch.CategoryNameId[d] = itCachedName->second;
+        batch.Score[d] = obj.score;
+        batch.Area[d] = obj.area;
+        if (obj.bbox.size() == 4 || obj.bbox.size() == 5) {
+            bits |= DetectionBatch::HasBbox;
+            batch.BboxLen[d] = static_cast<std::uint8_t>(obj.bbox.size());
+            batch.X[d] = obj.bbox[0];
+            batch.Y[d] = obj.bbox[1];
+            batch.W[d] = obj.bbox[2];
+            batch.H[d] = obj.bbox[3];
+            if (obj.bbox.size() == 5) batch.R[d] = obj.bbox[4];
+        } else {
+            extras = Json::object();
+            extras["bbox"] = obj.bbox;
+        }
+        if (obj.withBbox) bits |= DetectionBatch::WithBboxValue;
+        const bool withMask = includeMask && obj.withMask;
+        if (withMask) bits |= DetectionBatch::WithMaskValue;
+        if (obj.withAngle) bits |= DetectionBatch::WithAngleValue;
+        batch.Angle[d] = obj.withAngle ? obj.angle : -100.0;
+
+        if (withMask && !obj.mask.empty()) {
+            if (emitMaskDerivedMeta) {
+                double maskArea = static_cast<double>(obj.area);
+                if (maskArea <= 0.0) {
+                    try {
+                        if (obj.mask.channels() == 1) {
+                            maskArea = static_cast<double>(cv::countNonZero(obj.mask));
+                        } else {
+                            cv::Mat gray;
+                            cv::cvtColor(obj.mask, gray, cv::COLOR_BGR2GRAY);
+                            maskArea = static_cast<double>(cv::countNonZero(gray));
+                        }
+                    } catch (...) {
+                        maskArea = 0.0;
+                    }
+                }
+                if (!extras.is_object()) extras = Json::object();
+                extras["mask_area"] = maskArea;
+                cv::RotatedRect rr;
+                if (TryComputeMinAreaRect(obj.mask, rr)) {
+                    extras["mask_min_area_rect"] = Json::array({
+                        rr.center.x,
+                        rr.center.y,
+                        rr.size.width,
+                        rr.size.height,
+                        rr.angle
+                    });
+                }
+            }
+            if (emitMaskRle) {
+                try {
+                    batch.MaskRle[d] = std::make_shared<const Json>(MatToMaskInfo(obj.mask));
+                    bits |= DetectionBatch::HasMaskRle;
+                } catch (...) {
+                    // ignore
+                }
+            }
+        }
+        batch.Bits[d] = bits;
+        batch.Extras[d] = std::move(extras);
+    }
+}
+
 static int ReadIntLike(const Json& v, int dv) {
     try {
         if (v.is_number_integer()) return v.get<int>();
@@ -289,30 +604,32 @@ static int FindMaxBatchSizeRecursively(const Json& token, int current) {
     return std::max(1, best);
 }
 
-static int GetCachedModelBatchLimit(const std::shared_ptr<dlcv_infer::Model>& model) {
+int GetModelBatchLimit(const std::shared_ptr<dlcv_infer::Model>& model) {
     if (!model) return 1;
-    static std::mutex s_mu;
-    static std::unordered_map<int, int> s_modelLimit;
-
-    const int modelIndex = model->modelIndex;
-    {
-        std::lock_guard<std::mutex> lk(s_mu);
-        auto it = s_modelLimit.find(modelIndex);
-        if (it != s_modelLimit.end()) return std::max(1, it->second);
+    return GetModelBatchLimit(*model);
+}
+
+int GetModelBatchLimit(dlcv_infer::Model& model) {
+    // 流程归档模型没有 modelIndex，不进缓存（模型信息中取各模型的最大值）
+    const int modelIndex = model.modelIndex;
+    if (modelIndex >= 0) {
+        std::lock_guard<std::mutex> lk(s_batchLimitMu);
+        auto it = s_batchLimitByModel.find(modelIndex);
+        if (it != s_batchLimitByModel.end()) return std::max(1, it->second);
     }
 
     int limit = 1;
     try {
-        const Json info = model->GetModelInfo();
+        const Json info = model.GetModelInfo();
         limit = FindMaxBatchSizeRecursively(info, 1);
     } catch (...) {
         limit = 1;
     }
     limit = std::max(1, limit);
 
-    {
-        std::lock_guard<std::mutex> lk(s_mu);
-        s_modelLimit[modelIndex] = limit;
+    if (modelIndex >= 0) {
+        std::lock_guard<std::mutex> lk(s_batchLimitMu);
+        s_batchLimitByModel[modelIndex] = limit;
     }
     return limit;
 }
@@ -326,7 +643,7 @@ static int ResolveEffectiveBatchLimit(const std::shared_ptr<dlcv_infer::Model>&
     } catch (...) {
         cfg = 0;
     }
-    const int modelLimit = GetCachedModelBatchLimit(model);
+    const int modelLimit = GetModelBatchLimit(model);
     if (cfg <= 0) return modelLimit;
     return std::max(1, std::min(modelLimit, cfg));
 }
@@ -342,27 +659,11 @@ static double ReadScoreForSort(const Json& token) {
     return 0.0;
 }
 
-static void KeepTopKByScore(Json& samples, int topK) {
-    if (!samples.is_array() || topK <= 0 || static_cast<int>(samples.size()) <= topK) return;
-
-    std::vector<Json> ordered;
-    ordered.reserve(samples.size());
-    for (const auto& sample : samples) {
-        ordered.push_back(sample);
-    }
-
-    std::stable_sort(ordered.begin(), ordered.end(), [](const Json& a, const Json& b) {
-        return ReadScoreForSort(a) > ReadScoreForSort(b);
-    });
-
-    Json trimmed = Json::array();
-    for (int i = 0; i < topK && i < static_cast<int>(ordered.size()); i++) {
-        trimmed.push_back(ordered[static_cast<size_t>(i)]);
-    }
-    samples = std::move(trimmed);
+ModuleIO DetModelModule::Process(const std::vector<ModuleImage>& imageList, const Json& /*resultList*/) {
+    return RunModel(imageList, true);
 }
 
-ModuleIO DetModelModule::Process(const std::vector<ModuleImage>& imageList, const Json& /*resultList*/) {
+ModuleIO DetModelModule::RunModel(const std::vector<ModuleImage>& imageList, bool columnarResults) {
     const std::vector<ModuleImage>& images = imageList;
     std::vector<ModuleImage> outImages;
     Json outResults = Json::array();
@@ -387,6 +688,12 @@ ModuleIO DetModelModule::Process(const std::vector<ModuleImage>& imageList, cons
     const int effectiveBatch = ResolveEffectiveBatchLimit(_model, this->Properties);
     p["batch_size"] = effectiveBatch;
 
+    // 跨请求动态合批：合并后的图像数不超过节点生效的 batch_size 与池配置上限
+    double batchWaitMs = 0.0;
+    int poolMaxBatch = 0;
+    ModelPool::Instance().GetDynamicBatching(batchWaitMs, poolMaxBatch);
+    const int mergeLimit = poolMaxBatch > 0 ? std::min(effectiveBatch, poolMaxBatch) : effectiveBatch;
+
     std::vector<cv::Mat> rgbInputs;
     std::vector<ModuleImage> wraps;
     std::vector<int> sourceIndices;
@@ -419,7 +726,8 @@ ModuleIO DetModelModule::Process(const std::vector<ModuleImage>& imageList, cons
         buckets[key].push_back(localIdx);
     }
 
-    std::vector<Json> sampleByLocal(rgbInputs.size(), Json::array());
+    std::vector<Json> sampleByLocal(columnarResults ? 0 : rgbInputs.size(), Json::array());
+    std::vector<std::vector<dlcv_infer::ObjectResult>> objectsByLocal(columnarResults ? rgbInputs.size() : 0);
     dlcv_infer::json paramsToPass = p.empty() ? dlcv_infer::json(nullptr) : dlcv_infer::json(p);
 
     // 2) 按桶面积从大到小执行 batch，并回填到 local 下标
@@ -447,37 +755,72 @@ ModuleIO DetModelModule::Process(const std::vector<ModuleImage>& imageList, cons
                 chunkMats.push_back(rgbInputs[static_cast<size_t>(localIdx)]);
             }
 
-            dlcv_infer::Result res = _model->InferBatch(chunkMats, paramsToPass);
+            double sdkMs = 0.0;
+            std::vector<dlcv_infer::SampleResult> batchSamples;
+            if (_batcher) {
+                batchSamples = _batcher->InferBatch(chunkMats, paramsToPass, mergeLimit, batchWaitMs, sdkMs);
+            } else {
+                dlcv_infer::Result res = _model->InferBatch(chunkMats, paramsToPass);
+                batchSamples = std::move(res.sampleResults);
+                sdkMs = ReadLastSdkMs();
+            }
             try {
-                if (Context != nullptr) {
-                    double prev = Context->Get<double>("flow_dlcv_infer_ms_acc", 0.0);
-                    double sdkMs = 0.0;
-                    double totalMs = 0.0;
-                    dlcv_infer::Model::GetLastInferTiming(sdkMs, totalMs);
-                    if (sdkMs <= 0.0) sdkMs = totalMs;
-                    if (sdkMs > 0.0) {
-                        Context->Set<double>("flow_dlcv_infer_ms_acc", prev + sdkMs);
-                    }
+                if (Context != nullptr && sdkMs > 0.0) {
+                    Context->Update(ContextKeys::FlowDlcvInferMsAcc, [sdkMs](double& acc) { acc += sdkMs; }, 0.0);
                 }
             } catch (...) {}
-            const auto& batchSamples = res.sampleResults;
-            for (int k = 0; k < static_cast<int>(chunkLocals.size()); k++) {
-                const int localIdx = chunkLocals[static_cast<size_t>(k)];
-                if (k < static_cast<int>(batchSamples.size())) {
+            if (columnarResults) {
+                for (int k = 0; k < static_cast<int>(chunkLocals.size()); k++) {
+                    const int localIdx = chunkLocals[static_cast<size_t>(k)];
+                    if (k < static_cast<int>(batchSamples.size())) {
+                        objectsByLocal[static_cast<size_t>(localIdx)] = std::move(batchSamples[static_cast<size_t>(k)].results);
+                    }
+                }
+                continue;
+            }
+            // 逐图转换为 JSON（mask 编码 RLE、最小外接矩形）相互独立，按图并行
+            ParallelFor(chunkLocals.size(), 1, [&](size_t k) {
+                const int localIdx = chunkLocals[k];
+                if (k < batchSamples.size()) {
                     sampleByLocal[static_cast<size_t>(localIdx)] =
                         ConvertSampleResultToLocalSamples(
-                            batchSamples[static_cast<size_t>(k)],
+                            batchSamples[k],
                             includeMask,
                             emitMaskRle,
                             emitMaskDerivedMeta);
                 } else {
                     sampleByLocal[static_cast<size_t>(localIdx)] = Json::array();
                 }
-            }
+            });
         }
     }
 
     // 3) 按原输入顺序回填结果
+    if (columnarResults) {
+        std::shared_ptr<DetectionBatch> batch = std::make_shared<DetectionBatch>();
+        std::unordered_map<std::string, std::uint32_t> nameIdCache;
+        for (int localIdx = 0; localIdx < static_cast<int>(rgbInputs.size()); localIdx++) {
+            const int srcIdx = sourceIndices[static_cast<size_t>(localIdx)];
+            const ModuleImage& wrap = wraps[static_cast<size_t>(localIdx)];
+            outImages.push_back(images[static_cast<size_t>(srcIdx)]);
+
+            DetectionBatch::Entry entry;
+            entry.Index = localIdx;
+            entry.OriginIndex = wrap.OriginalIndex;
+            entry.Fields["type"] = "local";
+            entry.Fields["index"] = localIdx;
+            entry.Fields["origin_index"] = wrap.OriginalIndex;
+            entry.Fields["transform"] = wrap.TransformState.ToJson();
+            entry.TransformId = wrap.TransformState.TransformId;
+            batch->AddEntry(std::move(entry));
+            AppendObjectsToBatch(*batch, objectsByLocal[static_cast<size_t>(localIdx)],
+                includeMask, emitMaskRle, emitMaskDerivedMeta, nameIdCache);
+        }
+        ModuleIO io(std::move(outImages), Json::array(), Json::array());
+        io.Detections = std::move(batch);
+        return io;
+    }
+
     int outIndex = 0;
     for (int localIdx = 0; localIdx < static_cast<int>(rgbInputs.size()); localIdx++) {
         const int srcIdx = sourceIndices[static_cast<size_t>(localIdx)];
@@ -497,61 +840,73 @@ ModuleIO DetModelModule::Process(const std::vector<ModuleImage>& imageList, cons
     return ModuleIO(std::move(outImages), std::move(outResults), Json::array());
 }
 
-static void EnsureBboxForAllSamples(std::vector<ModuleImage>& imagesOut, Json& resultsOut) {
-    if (!resultsOut.is_array()) return;
-    const size_t n = std::min(resultsOut.size(), imagesOut.size());
-    for (size_t i = 0; i < n; i++) {
-        if (!resultsOut.at(i).is_object()) continue;
-        Json& entry = resultsOut.at(i);
-        if (!entry.contains("sample_results") || !entry["sample_results"].is_array()) continue;
-        Json& samples = entry["sample_results"];
+// 分类/OCR 结果整理：逐条目按分数稳定降序保留前 topK 条（topK <= 0 不裁剪），
+// 并把没有有效 bbox 的检测补为整图框；物化后的 result_list 与 JSON 路径逐字段一致
+static std::shared_ptr<DetectionBatch> FinishWholeImageResults(
+    const std::vector<ModuleImage>& images, const DetectionBatch& in, int topK) {
+    std::shared_ptr<DetectionBatch> out = std::make_shared<DetectionBatch>();
+    std::vector<size_t> picked;
+    for (size_t e = 0; e < in.EntryCount(); e++) {
+        out->AddEntry(in.Entries[e]);
+        const size_t begin = in.EntryBegin[e];
+        const size_t end = in.EntryEnd(e);
+        picked.clear();
+        for (size_t d = begin; d < end; d++) picked.push_back(d);
+        if (topK > 0 && picked.size() > static_cast<size_t>(topK)) {
+            const auto scoreOf = [&in](size_t d) { return (in.Bits[d] & DetectionBatch::HasScore) ? in.Score[d] : ReadScoreForSort(in.DetectionToJson(d)); };
+            std::stable_sort(picked.begin(), picked.end(), [&](size_t a, size_t b) { return scoreOf(a) > scoreOf(b); });
+            picked.resize(static_cast<size_t>(topK));
+        }
 
-        const cv::Mat& imgMat = imagesOut[i].ImageObject;
+        const bool hasImage = e < images.size();
+        const cv::Mat& imgMat = hasImage ? images[e].ImageObject : cv::Mat();
         const int iw = imgMat.empty() ? 1 : std::max(1, imgMat.cols);
         const int ih = imgMat.empty() ? 1 : std::max(1, imgMat.rows);
-
-        for (auto& s : samples) {
-            if (!s.is_object()) continue;
-            Json& so = s;
-            bool withBbox = false;
-            try { withBbox = so.contains("with_bbox") ? so["with_bbox"].get<bool>() : false; } catch (...) { withBbox = false; }
+        for (size_t src : picked) {
+            out->AppendDetectionFrom(in, src);
+            const size_t d = out->Size() - 1;
+            if (!hasImage) continue;
+
+            std::uint32_t& bits = out->Bits[d];
+            Json& extras = out->Extras[d];
+            const bool withBbox = (bits & DetectionBatch::HasWithBbox) != 0 && (bits & DetectionBatch::WithBboxValue) != 0;
             bool validDims = false;
-            try {
-                if (so.contains("bbox") && so["bbox"].is_array() && so["bbox"].size() >= 4) {
-                    const double bw = std::abs(so["bbox"][2].get<double>());
-                    const double bh = std::abs(so["bbox"][3].get<double>());
-                    validDims = (bw > 0.0 && bh > 0.0);
-                }
-            } catch (...) { validDims = false; }
-
-            if (!withBbox || !validDims) {
-                so["bbox"] = Json::array({ 0, 0, iw, ih });
-                so["with_bbox"] = true;
-                so["with_angle"] = false;
-                so["angle"] = -100.0;
+            if (bits & DetectionBatch::HasBbox) {
+                validDims = std::abs(out->W[d]) > 0.0 && std::abs(out->H[d]) > 0.0;
+            } else if (extras.is_object() && extras.contains("bbox")) {
+                try {
+                    const Json& bbox = extras.at("bbox");
+                    if (bbox.is_array() && bbox.size() >= 4) {
+                        validDims = std::abs(bbox[2].get<double>()) > 0.0 && std::abs(bbox[3].get<double>()) > 0.0;
+                    }
+                } catch (...) { validDims = false; }
             }
+            if (withBbox && validDims) continue;
+
+            // 整图框为整数，与 JSON 路径一致，放在 Extras 中原样保存
+            if (!extras.is_object()) extras = Json::object();
+            extras.erase("with_bbox");
+            extras.erase("with_angle");
+            extras.erase("angle");
+            extras["bbox"] = Json::array({ 0, 0, iw, ih });
+            bits &= ~static_cast<std::uint32_t>(DetectionBatch::HasBbox | DetectionBatch::WithAngleValue);
+            bits |= DetectionBatch::HasWithBbox | DetectionBatch::WithBboxValue | DetectionBatch::HasWithAngle | DetectionBatch::HasAngle;
+            out->BboxLen[d] = 0;
+            out->Angle[d] = -100.0;
         }
     }
+    return out;
 }
 
-ModuleIO ClsModelModule::Process(const std::vector<ModuleImage>& imageList, const Json& resultList) {
-    ModuleIO baseIo = DetModelModule::Process(imageList, resultList);
-    const int topK = std::max(0, ReadInt("top_k", 1));
-    if (topK > 0 && baseIo.ResultList.is_array()) {
-        for (auto& token : baseIo.ResultList) {
-            if (!token.is_object()) continue;
-            Json& entry = token;
-            if (!entry.contains("sample_results") || !entry["sample_results"].is_array()) continue;
-            KeepTopKByScore(entry["sample_results"], topK);
-        }
-    }
-    EnsureBboxForAllSamples(baseIo.ImageList, baseIo.ResultList);
+ModuleIO ClsModelModule::Process(const std::vector<ModuleImage>& imageList, const Json& /*resultList*/) {
+    ModuleIO baseIo = RunModel(imageList, true);
+    if (baseIo.Detections) baseIo.Detections = FinishWholeImageResults(baseIo.ImageList, *baseIo.Detections, _props.TopK);
     return baseIo;
 }
 
-ModuleIO OcrModelModule::Process(const std::vector<ModuleImage>& imageList, const Json& resultList) {
-    ModuleIO baseIo = DetModelModule::Process(imageList, resultList);
-    EnsureBboxForAllSamples(baseIo.ImageList, baseIo.ResultList);
+ModuleIO OcrModelModule::Process(const std::vector<ModuleImage>& imageList, const Json& /*resultList*/) {
+    ModuleIO baseIo = RunModel(imageList, true);
+    if (baseIo.Detections) baseIo.Detections = FinishWholeImageResults(baseIo.ImageList, *baseIo.Detections, 0);
     return baseIo;
 }
 
@@ -1,9 +1,15 @@
 ﻿#pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "dlcv_infer.h"
 #include "flow/BaseModule.h"
@@ -13,6 +19,51 @@
 namespace dlcv_infer {
 namespace flow {
 
+/// <summary>
+/// 跨请求动态合批：同一模型上并发到达、图像尺寸/类型与推理参数都相同的请求，
+/// 在最大等待时间内合并为一次 InferBatch，再按请求拆回结果；没有其它请求排队或执行时不等待，直接执行。
+/// 不启动额外线程：首个到达的请求负责等待、合并与执行，其余请求等待结果。
+/// 模型池中的队列持有模型；Model 自身的单图合批（Model::SetMicroBatching）不持有，随模型释放。
+/// </summary>
+class ModelBatcher final {
+public:
+    struct Stats {
+        std::uint64_t Requests = 0;     // 请求数（含直接执行的请求）
+        std::uint64_t Batches = 0;      // 实际调用 InferBatch 的次数
+        std::uint64_t Images = 0;       // 各批图像数之和
+        int MaxBatchImages = 0;         // 单批最大图像数
+        double TotalWaitMs = 0.0;       // 各请求从到达到所在批开始执行的等待之和
+        double MaxWaitMs = 0.0;
+    };
+
+    explicit ModelBatcher(std::shared_ptr<dlcv_infer::Model> model) : _owner(std::move(model)), _model(_owner.get()) {}
+    explicit ModelBatcher(dlcv_infer::Model* model) : _model(model) {}
+
+    /// mats 须同尺寸同类型，返回与 mats 一一对应的结果；sdkMs 为按图像数分摊的 SDK 推理耗时。
+    /// maxBatch 为合并后的最大图像数；maxWaitMs <= 0 或单个请求已达 maxBatch 时直接调用 InferBatch。
+    std::vector<dlcv_infer::SampleResult> InferBatch(const std::vector<cv::Mat>& mats, const Json& params,
+        int maxBatch, double maxWaitMs, double& sdkMs);
+
+    Stats GetStats() const;
+    void ResetStats();
+
+private:
+    struct Request;
+
+    void RunAsLeader(std::unique_lock<std::mutex>& lk, Request& leader, const Json& params,
+        int maxBatch, double maxWaitMs);
+    void RecordBatch(const std::vector<Request*>& batch, size_t images);
+
+    std::shared_ptr<dlcv_infer::Model> _owner;
+    dlcv_infer::Model* _model = nullptr;
+    mutable std::mutex _mu;
+    std::condition_variable _cv;
+    std::deque<Request*> _pending;      // 等待合并的请求（按到达顺序）
+    std::set<std::string> _gathering;   // 已有请求在收集的合批键
+    int _executingBatches = 0;          // 正在执行的合并批次数
+    Stats _stats;
+};
+
 /// <summary>
 /// 模型池：按 model_path+device_id 缓存 dlcv_infer::Model，避免重复加载。
 /// 约定：FlowGraph 内部字符串使用 UTF-8；创建 Model 时会转换为 GBK 以兼容现有 Model 构造。
@@ -24,8 +75,9 @@ public:
     /// 获取模型，增加该 key 的引用计数。
     /// 若缓存中已存在且有效，直接返回并 +1。
     /// 若不存在，创建新的 Model 对象，refCount = 1。
+    /// serial 非空时写入该模型实例的加载序号（每次新建 Model 递增，重新加载后不同）。
     std::shared_ptr<dlcv_infer::Model> Acquire(
-        const std::string& modelPathUtf8, int deviceId);
+        const std::string& modelPathUtf8, int deviceId, std::uint64_t* serial = nullptr);
 
     /// 释放一个引用。refCount 减 1；归零时从缓存移除。
     /// 若 key 不存在，无操作。
@@ -39,17 +91,47 @@ public:
 
     static std::string MakeKey(const std::string& modelPathUtf8, int deviceId);
 
+    /// 模型的动态合批队列（随模型创建、与模型同生命周期）；模型不在池中时返回空。
+    std::shared_ptr<ModelBatcher> GetBatcher(const std::string& modelPathUtf8, int deviceId);
+
+    /// 跨请求动态合批（进程级，默认关闭）：maxWaitMs <= 0 关闭；
+    /// maxBatch <= 0 时合并上限取节点生效的 batch_size（默认为模型支持的最大 batch）。
+    void SetDynamicBatching(double maxWaitMs, int maxBatch);
+    void GetDynamicBatching(double& maxWaitMs, int& maxBatch) const;
+
+    /// 预置模型信息与最大 batch（来自流程快照）：该模型下次在池中创建时直接使用，不再查询底层模型信息。
+    /// 模型已在池中时忽略。
+    void SeedModelInfo(const std::string& modelPathUtf8, int deviceId, const Json& modelInfo, int batchLimit);
+
 private:
     struct Entry {
         std::shared_ptr<dlcv_infer::Model> model;
+        std::shared_ptr<ModelBatcher> batcher;
         int refCount = 0;
+        std::uint64_t serial = 0;
+    };
+
+    struct Seed {
+        Json modelInfo;
+        int batchLimit = 0;
     };
 
     ModelPool() = default;
     std::mutex _mu;
     std::unordered_map<std::string, Entry> _cache;
+    std::unordered_map<std::string, Seed> _seeds;
+    std::uint64_t _nextSerial = 1;
+    std::atomic<int> _batchWaitUs{ 0 };
+    std::atomic<int> _batchMax{ 0 };
 };
 
+/// <summary>
+/// 模型支持的最大 batch：取模型信息中 max_batch_size/max_batch/batch_size/max_shape[0] 的最大值，按模型缓存；
+/// 无法确定时为 1。节点 batch_size 属性不会超过该值。
+/// </summary>
+int GetModelBatchLimit(const std::shared_ptr<dlcv_infer::Model>& model);
+int GetModelBatchLimit(dlcv_infer::Model& model);
+
 /// <summary>
 /// 模型模块最小骨架：统一从输入 images 取 ModuleImage(Mat) 调用 dlcv_infer::Model。
 /// </summary>
@@ -59,6 +141,8 @@ protected:
     int _deviceId = 0;
     int _resolvedDeviceId = 0;
     std::shared_ptr<dlcv_infer::Model> _model;
+    std::uint64_t _modelSerial = 0;
+    std::shared_ptr<ModelBatcher> _batcher;
 
 public:
     BaseModelModule(int nodeId,
@@ -78,6 +162,11 @@ public:
     }
 
     void LoadModel() override;
+
+    /// <summary>
+    /// 模型路径、实际设备与模型加载序号：同一路径重新加载模型后缓存的节点输出失效。
+    /// </summary>
+    std::uint64_t OutputCacheIdentity() override;
 };
 
 /// <summary>
@@ -87,6 +176,12 @@ class DetModelModule : public BaseModelModule {
 public:
     using BaseModelModule::BaseModelModule;
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override;
+
+protected:
+    /// <summary>
+    /// 执行推理；columnarResults 为 true 时结果以 DetectionBatch 输出（ModuleIO::Detections），否则输出 result_list。
+    /// </summary>
+    ModuleIO RunModel(const std::vector<ModuleImage>& imageList, bool columnarResults);
 };
 
 class RotatedBBoxModelModule : public DetModelModule { public: using DetModelModule::DetModelModule; };
@@ -100,6 +195,18 @@ class ClsModelModule : public DetModelModule {
 public:
     using DetModelModule::DetModelModule;
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override;
+
+private:
+    struct Props {
+        int TopK = 1; // 每张图保留的类别数，0 表示全部保留
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Int("top_k", &Props::TopK, 1, 0);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// <summary>
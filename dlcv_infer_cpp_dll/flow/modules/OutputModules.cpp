@@ -1,4 +1,5 @@
 ﻿#include "flow/BaseModule.h"
+#include "flow/ContextKeys.h"
 #include "flow/FlowPayloadTypes.h"
 #include "flow/ModuleRegistry.h"
 #include "flow/utils/FlowPlatformUtils.h"
@@ -58,40 +59,19 @@ static std::string GetFileNameWithoutExt(const std::string& path) {
     return name.substr(0, dot);
 }
 
-static std::string SerializeTransformKeyFromAffine2x3(const std::vector<double>& a) {
-    if (a.size() < 6) return std::string();
-    char buf[256] = {0};
-    std::snprintf(buf, sizeof(buf), "T:%.4f,%.4f,%.2f,%.4f,%.4f,%.2f", a[0], a[1], a[2], a[3], a[4], a[5]);
-    return std::string(buf);
-}
-
-static std::string SerializeTransformKey(const TransformationState& st) {
-    if (st.AffineMatrix2x3.size() < 6) return std::string();
-    return SerializeTransformKeyFromAffine2x3(st.AffineMatrix2x3);
+// transform 兜底匹配键：仅看仿射（4/2 位小数容差），无仿射时为 0（不参与匹配）
+static std::uint64_t TransformMatchKey(const TransformationState& st) {
+    return st.AffineMatchKey();
 }
 
-static std::vector<double> BuildTC2O(const TransformationState& st) {
-    // T_c2o = Inverse(AffineMatrix2x3), where AffineMatrix2x3 is Original -> Current
-    if (st.AffineMatrix2x3.size() != 6) return {1,0,0, 0,1,0};
-    return TransformationState::Inverse2x3(st.AffineMatrix2x3);
+static const Affine2x3& BuildTC2O(const TransformationState& st) {
+    // T_c2o = Inverse(AffineMatrix2x3), where AffineMatrix2x3 is Original -> Current（状态内缓存，无仿射时为单位阵）
+    return st.InverseAffine;
 }
 
-static std::vector<cv::Point2f> TransformPoints2x3(const std::vector<double>& T, const std::vector<cv::Point2f>& pts) {
-    std::vector<cv::Point2f> out;
-    out.reserve(pts.size());
-    const double a = (T.size() >= 6) ? T[0] : 1.0;
-    const double b = (T.size() >= 6) ? T[1] : 0.0;
-    const double tx = (T.size() >= 6) ? T[2] : 0.0;
-    const double c = (T.size() >= 6) ? T[3] : 0.0;
-    const double d = (T.size() >= 6) ? T[4] : 1.0;
-    const double ty = (T.size() >= 6) ? T[5] : 0.0;
-    for (const auto& p : pts) {
-        const double x = p.x;
-        const double y = p.y;
-        const double nx = a * x + b * y + tx;
-        const double ny = c * x + d * y + ty;
-        out.emplace_back(static_cast<float>(nx), static_cast<float>(ny));
-    }
+static std::vector<cv::Point2f> TransformPoints2x3(const Affine2x3& T, const std::vector<cv::Point2f>& pts) {
+    std::vector<cv::Point2f> out(pts.size());
+    if (!pts.empty()) MapPoints(T, pts.data(), out.data(), pts.size());
     return out;
 }
 
@@ -111,7 +91,7 @@ static Json AABBFromPoly(const std::vector<cv::Point2f>& poly) {
     return Json::array({ x1, y1, x2, y2 });
 }
 
-static Json RBoxLocalToGlobal(const Json& rbox, const std::vector<double>& T) {
+static Json RBoxLocalToGlobal(const Json& rbox, const Affine2x3& T) {
     // rbox: [cx, cy, w, h, angle(rad)]
     if (!rbox.is_array() || rbox.size() < 5) return Json();
     const double cx = rbox[0].get<double>();
@@ -120,13 +100,13 @@ static Json RBoxLocalToGlobal(const Json& rbox, const std::vector<double>& T) {
     const double h = rbox[3].get<double>();
     const double ang = rbox[4].get<double>();
 
-    const double l00 = (T.size() >= 6) ? T[0] : 1.0;
-    const double l01 = (T.size() >= 6) ? T[1] : 0.0;
-    const double l10 = (T.size() >= 6) ? T[3] : 0.0;
-    const double l11 = (T.size() >= 6) ? T[4] : 1.0;
+    const double l00 = T[0];
+    const double l01 = T[1];
+    const double l10 = T[3];
+    const double l11 = T[4];
 
-    const double ncx = l00 * cx + l01 * cy + ((T.size() >= 6) ? T[2] : 0.0);
-    const double ncy = l10 * cx + l11 * cy + ((T.size() >= 6) ? T[5] : 0.0);
+    const double ncx = l00 * cx + l01 * cy + T[2];
+    const double ncy = l10 * cx + l11 * cy + T[5];
 
     // 常见场景：仅平移/等比缩放（无旋转剪切），直接走轻量路径。
     if (std::abs(l01) < 1e-9 && std::abs(l10) < 1e-9 && l00 > 0.0 && l11 > 0.0) {
@@ -152,19 +132,7 @@ static Json RBoxLocalToGlobal(const Json& rbox, const std::vector<double>& T) {
     return Json::array({ ncx, ncy, nw, nh, nang });
 }
 
-static std::uint64_t GetCurrentOutputMask(const ExecutionContext* ctx) {
-    if (ctx == nullptr) return std::numeric_limits<std::uint64_t>::max();
-    try {
-        return ctx->Get<std::uint64_t>(
-            "__graph_current_output_mask",
-            std::numeric_limits<std::uint64_t>::max());
-    } catch (...) {
-        return std::numeric_limits<std::uint64_t>::max();
-    }
-}
-
-static bool HasCurrentNodeOutputConsumer(const ExecutionContext* ctx) {
-    const std::uint64_t mask = GetCurrentOutputMask(ctx);
+static bool HasCurrentNodeOutputConsumer(std::uint64_t mask) {
     return mask != 0;
 }
 
@@ -255,13 +223,12 @@ static bool CanUseAlignedFastPath(const std::vector<ModuleImage>& images, const
     return true;
 }
 
-static bool IsAxisAlignedTransform(const std::vector<double>& T_c2o) {
-    if (T_c2o.size() < 6) return false;
+static bool IsAxisAlignedTransform(const Affine2x3& T_c2o) {
     return std::abs(T_c2o[1]) < 1e-9 && std::abs(T_c2o[3]) < 1e-9;
 }
 
-static Json AABBFromLocalBboxFast(const Json& bboxLocal, const std::vector<double>& T_c2o, bool isAxisAlignedTransform) {
-    if (!bboxLocal.is_array() || bboxLocal.size() < 4 || T_c2o.size() < 6) return Json();
+static Json AABBFromLocalBboxFast(const Json& bboxLocal, const Affine2x3& T_c2o, bool isAxisAlignedTransform) {
+    if (!bboxLocal.is_array() || bboxLocal.size() < 4) return Json();
     try {
         const double bx = bboxLocal[0].get<double>();
         const double by = bboxLocal[1].get<double>();
@@ -288,21 +255,13 @@ static Json AABBFromLocalBboxFast(const Json& bboxLocal, const std::vector<doubl
             minY = std::min(gy1, gy2);
             maxY = std::max(gy1, gy2);
         } else {
-            const auto tx = [&T_c2o](double x, double y) {
-                const double gx = T_c2o[0] * x + T_c2o[1] * y + T_c2o[2];
-                const double gy = T_c2o[3] * x + T_c2o[4] * y + T_c2o[5];
-                return std::pair<double, double>(gx, gy);
-            };
-
-            auto p0 = tx(x1, y1);
-            auto p1 = tx(x2, y1);
-            auto p2 = tx(x2, y2);
-            auto p3 = tx(x1, y2);
-
-            minX = std::min(std::min(p0.first, p1.first), std::min(p2.first, p3.first));
-            minY = std::min(std::min(p0.second, p1.second), std::min(p2.second, p3.second));
-            maxX = std::max(std::max(p0.first, p1.first), std::max(p2.first, p3.first));
-            maxY = std::max(std::max(p0.second, p1.second), std::max(p2.second, p3.second));
+            double p[8] = { x1, y1, x2, y1, x2, y2, x1, y2 };
+            MapPoints(T_c2o, p, p, 4);
+
+            minX = std::min(std::min(p[0], p[2]), std::min(p[4], p[6]));
+            minY = std::min(std::min(p[1], p[3]), std::min(p[5], p[7]));
+            maxX = std::max(std::max(p[0], p[2]), std::max(p[4], p[6]));
+            maxY = std::max(std::max(p[1], p[3]), std::max(p[5], p[7]));
         }
 
         return Json::array({
@@ -325,7 +284,7 @@ static void InitializeByImageEntry(const ModuleImage& wrap, FlowByImageEntry& ou
 
 static void AppendOutResultItemTyped(
     const Json& d,
-    const std::vector<double>& T_c2o,
+    const Affine2x3& T_c2o,
     bool isAxisAlignedTransform,
     std::vector<FlowResultItem>& outResults) {
     if (!d.is_object()) return;
@@ -368,7 +327,7 @@ static std::vector<FlowResultItem> BuildOutResultItemsTyped(const ModuleImage& w
     std::vector<FlowResultItem> outResults;
     if (!dets.is_array() || dets.empty()) return outResults;
 
-    const std::vector<double> T_c2o = BuildTC2O(wrap.TransformState);
+    const Affine2x3& T_c2o = BuildTC2O(wrap.TransformState);
     const bool isAxisAlignedTransform = IsAxisAlignedTransform(T_c2o);
     outResults.reserve(dets.size());
     for (const auto& d : dets) {
@@ -381,7 +340,7 @@ static std::vector<FlowResultItem> BuildOutResultItemsTyped(const ModuleImage& w
     std::vector<FlowResultItem> outResults;
     if (dets.empty()) return outResults;
 
-    const std::vector<double> T_c2o = BuildTC2O(wrap.TransformState);
+    const Affine2x3& T_c2o = BuildTC2O(wrap.TransformState);
     const bool isAxisAlignedTransform = IsAxisAlignedTransform(T_c2o);
     outResults.reserve(dets.size());
     for (const Json* d : dets) {
@@ -401,6 +360,8 @@ public:
         return ProcessCore(imageList, results, nullptr);
     }
 
+    bool TakesOwnedResultList() const override { return true; }
+
     ModuleIO ProcessOwned(const std::vector<ModuleImage>& imageList, Json&& resultList) override {
         const Json emptyResults = Json::array();
         const bool hasOwnedArray = resultList.is_array();
@@ -429,7 +390,7 @@ private:
             }
         } else {
             // 建立 index/origin_index/transform -> dets 映射
-            std::unordered_map<std::string, std::vector<const Json*>> transToDets;
+            std::unordered_map<std::uint64_t, std::vector<const Json*>> transToDets;
             std::unordered_map<int, std::vector<const Json*>> indexToDets;
             std::unordered_map<int, std::vector<const Json*>> originToDets;
 
@@ -462,8 +423,8 @@ private:
                 try {
                     if (entry.contains("transform") && entry.at("transform").is_object()) {
                         TransformationState st = TransformationState::FromJson(entry.at("transform"));
-                        const std::string sig = SerializeTransformKey(st);
-                        if (!sig.empty()) {
+                        const std::uint64_t sig = TransformMatchKey(st);
+                        if (sig != 0) {
                             auto& v = transToDets[sig];
                             v.insert(v.end(), detList.begin(), detList.end());
                         }
@@ -474,7 +435,7 @@ private:
             // 遍历图像，还原坐标
             for (size_t i = 0; i < images.size(); i++) {
                 const ModuleImage& wrap = images[i];
-                const std::string sig = SerializeTransformKey(wrap.TransformState);
+                const std::uint64_t sig = TransformMatchKey(wrap.TransformState);
 
                 const std::vector<const Json*>* dets = nullptr;
                 auto itIdx = indexToDets.find(static_cast<int>(i));
@@ -483,7 +444,7 @@ private:
                     auto itOrg = originToDets.find(wrap.OriginalIndex);
                     if (itOrg != originToDets.end()) dets = &itOrg->second;
                 }
-                if (dets == nullptr && !sig.empty()) {
+                if (dets == nullptr && sig != 0) {
                     auto itT = transToDets.find(sig);
                     if (itT != transToDets.end()) dets = &itT->second;
                 }
@@ -500,18 +461,18 @@ private:
         // 写入 Context
         if (Context != nullptr) {
             try {
-                std::vector<FlowFrontendByNodePayload> typedByNode = Context->Get<std::vector<FlowFrontendByNodePayload>>(
-                    "frontend_payloads_by_node",
-                    std::vector<FlowFrontendByNodePayload>());
                 FlowFrontendByNodePayload current;
                 current.NodeOrder = NodeId;
-                current.FallbackOrder = static_cast<int>(typedByNode.size());
                 current.Payload = std::move(payload);
-                typedByNode.push_back(std::move(current));
-                Context->Set<std::vector<FlowFrontendByNodePayload>>("frontend_payloads_by_node", std::move(typedByNode));
+                Context->Update(
+                    ContextKeys::FrontendPayloadsByNode,
+                    [&current](std::vector<FlowFrontendByNodePayload>& typedByNode) {
+                        current.FallbackOrder = static_cast<int>(typedByNode.size());
+                        typedByNode.push_back(std::move(current));
+                    });
             } catch (...) {}
         }
-        if (!HasCurrentNodeOutputConsumer(Context)) {
+        if (!HasCurrentNodeOutputConsumer(CurrentOutputMask)) {
             return ModuleIO(std::vector<ModuleImage>(), Json::array(), Json::array());
         }
         if (ownedResults != nullptr) {
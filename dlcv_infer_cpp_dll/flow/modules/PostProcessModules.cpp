@@ -1,14 +1,17 @@
 ﻿#include "flow/BaseModule.h"
 #include "flow/ModuleRegistry.h"
+#include "flow/DetectionBatch.h"
 #include "flow/utils/MaskRleUtils.h"
 
 #include <array>
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cstdint>
 #include <cmath>
 #include <cstdio>
 #include <limits>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -26,40 +29,22 @@ namespace flow {
 
 static constexpr double kPi = 3.14159265358979323846;
 
-static std::string FormatAffineKey(const std::vector<double>& a) {
-    if (a.size() < 6) return std::string();
-    char buf[256] = {0};
-    std::snprintf(buf, sizeof(buf), "T:%.4f,%.4f,%.2f,%.4f,%.4f,%.2f", a[0], a[1], a[2], a[3], a[4], a[5]);
-    return std::string(buf);
+// 结果条目与图像的匹配键：index/origin_index 与仿射兜底匹配键（无仿射时记 0）混合
+static std::uint64_t TransformMatchKey(const TransformationState& st, int index, int originIndex) {
+    const std::uint64_t id = st.AffineMatchKey();
+    return FlowHashMix(FlowHashMix(id, static_cast<std::uint32_t>(index)), static_cast<std::uint32_t>(originIndex));
 }
 
-static std::string SerializeTransform(const TransformationState* st, int index, int originIndex) {
-    if (st == nullptr || st->AffineMatrix2x3.size() < 6) {
-        return "idx:" + std::to_string(index) + "|org:" + std::to_string(originIndex) + "|T:null";
-    }
-    return "idx:" + std::to_string(index) + "|org:" + std::to_string(originIndex) + "|" + FormatAffineKey(st->AffineMatrix2x3);
-}
-
-static std::string SerializeTransformSigFromJson(const Json& tObj) {
-    if (!tObj.is_object() || !tObj.contains("affine_2x3") || !tObj.at("affine_2x3").is_array()) return std::string();
-    const Json& a = tObj.at("affine_2x3");
-    if (a.size() < 6) return std::string();
-    std::vector<double> v(6, 0.0);
-    for (size_t i = 0; i < 6; i++) { try { v[i] = a.at(i).get<double>(); } catch (...) { v[i] = 0.0; } }
-    return FormatAffineKey(v);
-}
-
-static std::vector<std::string> ReadStringList(const Json& props, const std::string& key) {
+// 字符串或字符串数组属性；其他类型在加载时报错，数组中的非字符串项忽略
+static std::vector<std::string> ReadStringList(const Json& v, const char* name) {
     std::vector<std::string> out;
-    if (!props.is_object() || !props.contains(key)) return out;
-    try {
-        const Json& v = props.at(key);
-        if (v.is_array()) {
-            for (const auto& it : v) if (it.is_string()) out.push_back(it.get<std::string>());
-        } else if (v.is_string()) {
-            out.push_back(v.get<std::string>());
-        }
-    } catch (...) {}
+    if (v.is_string()) {
+        out.push_back(v.get<std::string>());
+    } else if (v.is_array()) {
+        for (const auto& it : v) if (it.is_string()) out.push_back(it.get<std::string>());
+    } else {
+        PropertyParser::Fail(name, "string or array of strings", v);
+    }
     return out;
 }
 
@@ -233,10 +218,27 @@ static bool IsIdentityTransform(const Json& transform) {
     return hasAffine || hasCrop;
 }
 
-static std::string TransformGroupKey(const Json* token) {
-    if (token == nullptr || token->is_null()) return "__global__";
-    if (IsIdentityTransform(*token)) return "__global__";
-    return SerializeTokenCompact(*token);
+// 分组用变换标识：缺省与恒等变换归入全局组（0），其余按宽松读取的字段计算 TransformationState 标识
+static std::uint64_t TransformGroupKey(const Json* token) {
+    if (token == nullptr || token->is_null()) return 0;
+    if (IsIdentityTransform(*token)) return 0;
+    const std::uint64_t carried = TransformationState::CarriedId(*token);
+    if (carried != 0) return carried;
+
+    int originalW = 0, originalH = 0;
+    int crop[4] = {0, 0, 0, 0};
+    int output[2] = {0, 0};
+    std::array<double, 6> affine = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    TryReadOriginalSize(*token, originalW, originalH);
+    const bool hasCrop = TryReadCropBox(*token, crop[0], crop[1], crop[2], crop[3]);
+    const bool hasOutput = TryReadOutputSize(*token, output[0], output[1]);
+    const bool hasAffine = TryReadAffine(*token, affine);
+    return TransformationState::ComputeTransformId(
+        originalW,
+        originalH,
+        hasCrop ? crop : nullptr,
+        hasOutput ? output : nullptr,
+        hasAffine ? affine.data() : nullptr);
 }
 
 static bool TryReadDouble(const Json& token, double& outVal) {
@@ -253,20 +255,8 @@ static bool TryReadDouble(const Json& token, double& outVal) {
     return false;
 }
 
-static std::uint64_t ReadCurrentOutputMask(const ExecutionContext* ctx) {
-    if (ctx == nullptr) return std::numeric_limits<std::uint64_t>::max();
-    try {
-        return ctx->Get<std::uint64_t>(
-            "__graph_current_output_mask",
-            std::numeric_limits<std::uint64_t>::max());
-    } catch (...) {
-        return std::numeric_limits<std::uint64_t>::max();
-    }
-}
-
-static bool IsCurrentOutputConnected(const ExecutionContext* ctx, int outputIndex) {
+static bool IsCurrentOutputConnected(std::uint64_t mask, int outputIndex) {
     if (outputIndex < 0 || outputIndex >= 64) return true;
-    const std::uint64_t mask = ReadCurrentOutputMask(ctx);
     if (mask == std::numeric_limits<std::uint64_t>::max()) return true;
     return ((mask >> outputIndex) & static_cast<std::uint64_t>(1)) != 0;
 }
@@ -282,6 +272,8 @@ public:
         return ProcessCore(imageList, inResults, nullptr);
     }
 
+    bool TakesOwnedResultList() const override { return true; }
+
     ModuleIO ProcessOwned(const std::vector<ModuleImage>& imageList, Json&& resultList) override {
         const Json emptyResults = Json::array();
         const bool hasOwnedArray = resultList.is_array();
@@ -401,18 +393,218 @@ private:
     }
 };
 
-/// post_process/result_filter, features/result_filter
-class ResultFilterModule final : public BaseModule {
+/// <summary>
+/// 结果处理链融合的逐条目阶段：只处理规范对齐输入（见 IsCanonicalAlignedInput），
+/// 对每条结果的处理与对应模块在该输入上的行为一致；条目按链顺序依次流过各阶段。
+/// </summary>
+class FusedResultStage {
+public:
+    virtual ~FusedResultStage() = default;
+
+    // 处理一条结果条目（原地改写）；返回 false 表示该条目及其图像不进入本阶段的主输出
+    virtual bool Apply(Json& entry) = 0;
+
+    // 全部条目处理完后写入本阶段的标量输出
+    virtual void PublishScalars(std::map<std::string, Json>& /*scalars*/) const {}
+
+protected:
+    int _emitted = 0; // 本阶段主输出已产出的条目数（用于重排 index）
+};
+
+/// <summary>
+/// 可融合的结果处理模块：无状态、逐条目处理，只读主对输入。
+/// GraphExecutor 把只以主对相连的一串此类节点交给链首的 ProcessFusedChain 一次遍历执行。
+/// </summary>
+class FusibleResultModule : public BaseModule {
 public:
     using BaseModule::BaseModule;
 
+    bool ProcessFusedChain(const std::vector<BaseModule*>& chain,
+                           const std::vector<ModuleImage>& imageList,
+                           const Json& resultList,
+                           ModuleIO& output,
+                           std::vector<double>& stageElapsedMs) override;
+
+protected:
+    // 按当前属性与输出掩码构造本节点的融合阶段；返回空表示本次不能融合
+    virtual std::unique_ptr<FusedResultStage> CreateFusedStage() const = 0;
+};
+
+class ResultFilterStage final : public FusedResultStage {
+public:
+    // keepSet 为模块绑定的类别集合，阶段只在模块执行融合链期间存在
+    explicit ResultFilterStage(const std::unordered_set<std::string>& keepSet) : _keepSet(keepSet) {}
+
+    bool Apply(Json& entry) override {
+        TransformationState st;
+        try { st = TransformationState::FromJson(entry.at("transform")); } catch (...) {}
+
+        Json kept = Json::array();
+        for (auto& s : entry.at("sample_results").get_ref<Json::array_t&>()) {
+            if (!s.is_object()) continue;
+            const std::string cat = s.value("category_name", "");
+            if (_keepSet.empty() || _keepSet.count(cat)) kept.push_back(std::move(s));
+        }
+        if (kept.empty()) return false;
+
+        Json e = Json::object();
+        e["type"] = "local";
+        e["index"] = _emitted++;
+        e["origin_index"] = entry.at("origin_index").get<int>();
+        e["transform"] = st.ToJson();
+        e["sample_results"] = std::move(kept);
+        entry = std::move(e);
+        _hasPositive = true;
+        return true;
+    }
+
+    void PublishScalars(std::map<std::string, Json>& scalars) const override {
+        scalars["has_positive"] = _hasPositive;
+    }
+
+private:
+    const std::unordered_set<std::string>& _keepSet;
+    bool _hasPositive = false;
+};
+
+/// post_process/result_filter, features/result_filter
+class ResultFilterModule final : public FusibleResultModule {
+public:
+    using FusibleResultModule::FusibleResultModule;
+
+    bool AcceptsDetectionBatch() const override { return true; }
+
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
+        if (MainDetections) {
+            if (CanFilterColumnar(*MainDetections)) return ProcessColumnar(imageList, *MainDetections);
+            return ProcessJson(imageList, MainDetections->ToResultList());
+        }
+        return ProcessJson(imageList, resultList);
+    }
+
+protected:
+    std::unique_ptr<FusedResultStage> CreateFusedStage() const override {
+        return std::unique_ptr<FusedResultStage>(new ResultFilterStage(_props.Categories));
+    }
+
+private:
+    struct Props {
+        std::unordered_set<std::string> Categories; // 为空时全部保留
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Custom("categories", [](const Json& v, Props& out) {
+                    const auto cats = ReadStringList(v, "categories");
+                    out.Categories.insert(cats.begin(), cats.end());
+                });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
+
+    // 列式路径只覆盖与 JSON 路径行为完全一致的输入；index/origin_index 非整数或类别名非字符串时回退 JSON 路径
+    static bool CanFilterColumnar(const DetectionBatch& batch) {
+        for (const auto& entry : batch.Entries) {
+            auto itIndex = entry.Fields.find("index");
+            if (itIndex != entry.Fields.end() && !itIndex->is_number_integer()) return false;
+            auto itOrigin = entry.Fields.find("origin_index");
+            if (itOrigin != entry.Fields.end() && !itOrigin->is_number_integer()) return false;
+        }
+        for (const auto& extras : batch.Extras) {
+            if (extras.is_object() && extras.contains("category_name")) return false;
+        }
+        return true;
+    }
+
+    ModuleIO ProcessColumnar(const std::vector<ModuleImage>& inImages, const DetectionBatch& in) {
+        const std::unordered_set<std::string>& keepSet = _props.Categories;
+
+        // 按驻留类别名缓存判定结果，每个类别名只查一次集合
+        std::vector<std::int8_t> keepByName(in.Names.size(), -1);
+        auto keepDetection = [&](size_t d) -> bool {
+            if (keepSet.empty()) return true;
+            if ((in.Bits[d] & DetectionBatch::HasCategoryName) == 0) return keepSet.count(std::string()) > 0;
+            std::int8_t& cached = keepByName[in.CategoryNameId[d]];
+            if (cached < 0) cached = keepSet.count(in.Names[in.CategoryNameId[d]]) ? 1 : 0;
+            return cached != 0;
+        };
+
+        std::unordered_map<std::uint64_t, const ModuleImage*> keyToImage;
+        for (int i = 0; i < static_cast<int>(inImages.size()); i++) {
+            const ModuleImage& wrap = inImages[static_cast<size_t>(i)];
+            if (wrap.ImageObject.empty()) continue;
+            keyToImage[TransformMatchKey(wrap.TransformState, i, wrap.OriginalIndex)] = &wrap;
+        }
+
+        std::vector<ModuleImage> mainImages;
+        std::vector<ModuleImage> altImages;
+        std::shared_ptr<DetectionBatch> mainBatch = std::make_shared<DetectionBatch>();
+        std::shared_ptr<DetectionBatch> altBatch = std::make_shared<DetectionBatch>();
+        std::vector<size_t> sKeep;
+        std::vector<size_t> sAlt;
+        bool hasPositive = false;
+
+        auto emit = [](DetectionBatch& out, std::vector<ModuleImage>& outImages, const ModuleImage& imgObj,
+                       int originIndex, const Json& transformJson, const DetectionBatch& src, const std::vector<size_t>& dets) {
+            outImages.push_back(imgObj);
+            DetectionBatch::Entry e;
+            e.Index = static_cast<int>(out.EntryCount());
+            e.OriginIndex = originIndex;
+            e.Fields["type"] = "local";
+            e.Fields["index"] = e.Index;
+            e.Fields["origin_index"] = originIndex;
+            e.Fields["transform"] = transformJson;
+            e.TransformId = TransformationState::IdFromJson(transformJson);
+            out.AddEntry(std::move(e));
+            for (size_t d : dets) out.AppendDetectionFrom(src, d);
+        };
+
+        for (size_t e = 0; e < in.EntryCount(); e++) {
+            const DetectionBatch::Entry& r = in.Entries[e];
+            const int idx = r.Index;
+            const int originIndex = r.OriginIndex;
+            TransformationState st;
+            auto itTransform = r.Fields.find("transform");
+            try { if (itTransform != r.Fields.end() && itTransform->is_object()) st = TransformationState::FromJson(*itTransform); } catch (...) {}
+            const std::uint64_t key = TransformMatchKey(st, idx, originIndex);
+
+            sKeep.clear();
+            sAlt.clear();
+            const size_t end = in.EntryEnd(e);
+            for (size_t d = in.EntryBegin[e]; d < end; d++) {
+                if (keepDetection(d)) sKeep.push_back(d);
+                else sAlt.push_back(d);
+            }
+
+            auto itImg = keyToImage.find(key);
+            if (itImg == keyToImage.end()) continue;
+            const ModuleImage& imgObj = *itImg->second;
+
+            if (!sKeep.empty() || !r.HasSamples) {
+                const Json transformJson = st.ToJson();
+                emit(*mainBatch, mainImages, imgObj, originIndex, transformJson, in, sKeep);
+                if (!sKeep.empty()) hasPositive = true;
+                if (!sAlt.empty()) emit(*altBatch, altImages, imgObj, originIndex, transformJson, in, sAlt);
+            } else if (!sAlt.empty()) {
+                emit(*altBatch, altImages, imgObj, originIndex, st.ToJson(), in, sAlt);
+            }
+        }
+
+        ModuleChannel alt(std::move(altImages), Json::array());
+        alt.Detections = std::move(altBatch);
+        this->ExtraOutputs.push_back(std::move(alt));
+
+        this->ScalarOutputsByName["has_positive"] = hasPositive;
+        ModuleIO io(std::move(mainImages), Json::array(), Json::array());
+        io.Detections = std::move(mainBatch);
+        return io;
+    }
+
+    ModuleIO ProcessJson(const std::vector<ModuleImage>& imageList, const Json& resultList) {
         const std::vector<ModuleImage>& inImages = imageList;
         const Json emptyResults = Json::array();
         const Json& inResults = resultList.is_array() ? resultList : emptyResults;
-
-        const auto cats = ReadStringList(Properties, "categories");
-        std::unordered_set<std::string> keepSet(cats.begin(), cats.end());
+        const std::unordered_set<std::string>& keepSet = _props.Categories;
 
         std::vector<ModuleImage> mainImages;
         Json mainResults = Json::array();
@@ -420,12 +612,11 @@ public:
         Json altResults = Json::array();
 
         // image key map
-        std::unordered_map<std::string, ModuleImage> keyToImage;
+        std::unordered_map<std::uint64_t, const ModuleImage*> keyToImage;
         for (int i = 0; i < static_cast<int>(inImages.size()); i++) {
             const ModuleImage& wrap = inImages[static_cast<size_t>(i)];
             if (wrap.ImageObject.empty()) continue;
-            const std::string key = SerializeTransform(&wrap.TransformState, i, wrap.OriginalIndex);
-            keyToImage[key] = wrap;
+            keyToImage[TransformMatchKey(wrap.TransformState, i, wrap.OriginalIndex)] = &wrap;
         }
 
         for (const auto& t : inResults) {
@@ -435,7 +626,7 @@ public:
             const int originIndex = r.contains("origin_index") ? r.at("origin_index").get<int>() : idx;
             TransformationState st;
             try { if (r.contains("transform") && r.at("transform").is_object()) st = TransformationState::FromJson(r.at("transform")); } catch (...) {}
-            const std::string key = SerializeTransform(&st, idx, originIndex);
+            const std::uint64_t key = TransformMatchKey(st, idx, originIndex);
 
             std::vector<Json> sKeep;
             std::vector<Json> sAlt;
@@ -450,7 +641,7 @@ public:
 
             auto itImg = keyToImage.find(key);
             if (itImg == keyToImage.end()) continue;
-            const ModuleImage imgObj = itImg->second;
+            const ModuleImage& imgObj = *itImg->second;
 
             if (!sKeep.empty() || !r.contains("sample_results")) {
                 mainImages.push_back(imgObj);
@@ -493,17 +684,59 @@ public:
     }
 };
 
+// 融合执行只产出主输出（第一个类别）；无类别时透传
+class MultiCategoryFilterStage final : public FusedResultStage {
+public:
+    // catLowerMap 为模块绑定的“小写类别名 -> 输出序号”，阶段只在模块执行融合链期间存在
+    explicit MultiCategoryFilterStage(const std::unordered_map<std::string, int>& catLowerMap)
+        : _passthrough(catLowerMap.empty()), _catLowerMap(catLowerMap) {}
+
+    bool Apply(Json& entry) override {
+        if (_passthrough) return true;
+
+        std::vector<Json> mainDets;
+        for (const auto& d : entry.at("sample_results")) {
+            if (!d.is_object()) continue;
+            std::string cn;
+            if (d.contains("category_name") && d.at("category_name").is_string()) {
+                cn = d.at("category_name").get<std::string>();
+            }
+            if (cn.empty()) continue;
+            for (auto& c : cn) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            auto it = _catLowerMap.find(cn);
+            if (it != _catLowerMap.end() && it->second == 0) mainDets.push_back(d);
+        }
+        if (mainDets.empty()) return false;
+
+        entry["sample_results"] = Json(mainDets);
+        entry["index"] = _emitted++;
+        _hasPositive = true;
+        return true;
+    }
+
+    // 与模块一致：其余类别的输出在判定前已移入 ExtraOutputs，has_positive 只反映主输出
+    void PublishScalars(std::map<std::string, Json>& scalars) const override {
+        scalars["has_positive"] = _hasPositive;
+    }
+
+private:
+    bool _passthrough = false;
+    bool _hasPositive = false;
+    const std::unordered_map<std::string, int>& _catLowerMap;
+};
+
 /// post_process/multi_category_filter, features/multi_category_filter
 /// 多类别筛选：按多个类别名将结果分流到多路输出，每路对应一个类别，最后一路输出“其他”。
 /// 与 Python 侧 backend/multi_tasks/NewModules/multi_category_filter.py 行为保持一致。
-class MultiCategoryFilterModule final : public BaseModule {
+class MultiCategoryFilterModule final : public FusibleResultModule {
 public:
-    using BaseModule::BaseModule;
+    using FusibleResultModule::FusibleResultModule;
 
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
         const Json emptyResults = Json::array();
         const Json& inResults = resultList.is_array() ? resultList : emptyResults;
-        const auto categories = ReadCategories(Properties);
+        const std::vector<std::string>& categories = _props.Categories;
+        const std::unordered_map<std::string, int>& catLowerMap = _props.CatLowerMap;
 
         if (categories.empty()) {
             ScalarOutputsByName["has_positive"] = false;
@@ -516,7 +749,7 @@ public:
         // 构建图像索引映射（与 Python 侧 _pick_wrapper_index 一致）
         std::unordered_map<int, int> indexToWrapperIndex;  // folded index -> wrapper index
         std::unordered_map<int, int> originToWrapperIndex; // folded origin -> wrapper index
-        std::unordered_map<std::string, std::vector<int>> sigToIndices;
+        std::unordered_map<std::uint64_t, std::vector<int>> sigToIndices;
         for (int i = 0; i < imageCount; i++) {
             const auto& wrap = imageList[static_cast<size_t>(i)];
             const int idxFolded = FoldAliasIndex(i, imageCount);
@@ -524,10 +757,7 @@ public:
             indexToWrapperIndex[idxFolded] = i;
             originToWrapperIndex[originFolded] = i;
 
-            const std::string sig = SerializeTransformKey(wrap.TransformState);
-            if (!sig.empty()) {
-                sigToIndices[sig].push_back(i);
-            }
+            sigToIndices[wrap.TransformState.TransformId].push_back(i);
         }
 
         // 为每个类别和 others 准备桶
@@ -535,13 +765,6 @@ public:
         std::vector<std::pair<Json, int>> othersBucket;
         std::vector<Json> nonLocalOthers;
 
-        std::unordered_map<std::string, int> catLowerMap;
-        for (int i = 0; i < static_cast<int>(categories.size()); i++) {
-            std::string lower = categories[static_cast<size_t>(i)];
-            for (auto& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-            catLowerMap[lower] = i;
-        }
-
         for (const auto& entry : inResults) {
             if (!entry.is_object()) continue;
             if (!entry.contains("type") || !entry.at("type").is_string() ||
@@ -622,29 +845,39 @@ public:
         return ModuleIO(std::move(mainOutput.first), std::move(mainOutput.second), Json::array());
     }
 
-private:
-    static std::vector<std::string> ReadCategories(const Json& props) {
-        std::vector<std::string> out;
-        if (!props.is_object() || !props.contains("categories")) return out;
-        try {
-            const Json& v = props.at("categories");
-            if (!v.is_array()) return out;
-            for (const auto& it : v) {
-                if (it.is_null()) continue;
-                std::string s;
-                if (it.is_string()) s = it.get<std::string>();
-                else s = it.dump();
-                // trim
-                size_t start = s.find_first_not_of(" \t\r\n");
-                if (start == std::string::npos) continue;
-                size_t end = s.find_last_not_of(" \t\r\n");
-                s = s.substr(start, end - start + 1);
-                if (!s.empty()) out.push_back(s);
-            }
-        } catch (...) {}
-        return out;
+protected:
+    std::unique_ptr<FusedResultStage> CreateFusedStage() const override {
+        return std::unique_ptr<FusedResultStage>(new MultiCategoryFilterStage(_props.CatLowerMap));
     }
 
+private:
+    struct Props {
+        std::vector<std::string> Categories;                // 去空白后的类别名，按输出顺序
+        std::unordered_map<std::string, int> CatLowerMap;   // 小写类别名 -> 输出序号（重名取后者）
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Custom("categories", [](const Json& v, Props& out) {
+                    if (!v.is_array()) PropertyParser::Fail("categories", "array", v);
+                    for (const auto& it : v) {
+                        if (it.is_null()) continue;
+                        std::string s = it.is_string() ? it.get<std::string>() : it.dump();
+                        size_t start = s.find_first_not_of(" \t\r\n");
+                        if (start == std::string::npos) continue;
+                        size_t end = s.find_last_not_of(" \t\r\n");
+                        out.Categories.push_back(s.substr(start, end - start + 1));
+                    }
+                    for (int i = 0; i < static_cast<int>(out.Categories.size()); i++) {
+                        std::string lower = out.Categories[static_cast<size_t>(i)];
+                        for (auto& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                        out.CatLowerMap[lower] = i;
+                    }
+                });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
+
     static int FoldAliasIndex(int rawIndex, int imageCount) {
         if (imageCount <= 0) return rawIndex >= 0 ? rawIndex : 0;
         if (rawIndex < 0) return 0;
@@ -664,50 +897,12 @@ private:
         } catch (...) { return -1; }
     }
 
-    static std::string SerializeTransformKey(const TransformationState& st) {
-        return SerializeTransformKey(st.ToJson());
-    }
-
-    static std::string SerializeTransformKey(const Json& tObj) {
-        if (!tObj.is_object()) return std::string();
-        try {
-            Json normalized = Json::object();
-            std::vector<std::string> keys;
-            for (auto it = tObj.begin(); it != tObj.end(); ++it) keys.push_back(it.key());
-            std::sort(keys.begin(), keys.end());
-            for (const auto& k : keys) normalized[k] = NormalizeTransformJson(tObj.at(k));
-            return normalized.dump();
-        } catch (...) {
-            return tObj.dump();
-        }
-    }
-
-    static Json NormalizeTransformJson(const Json& token) {
-        if (token.is_object()) {
-            Json normalized = Json::object();
-            std::vector<std::string> keys;
-            for (auto it = token.begin(); it != token.end(); ++it) keys.push_back(it.key());
-            std::sort(keys.begin(), keys.end());
-            for (const auto& k : keys) normalized[k] = NormalizeTransformJson(token.at(k));
-            return normalized;
-        }
-        if (token.is_array()) {
-            Json normalized = Json::array();
-            for (const auto& item : token) normalized.push_back(NormalizeTransformJson(item));
-            return normalized;
-        }
-        if (token.is_number_float()) {
-            return Json(std::round(token.get<double>() * 1e6) / 1e6);
-        }
-        return token;
-    }
-
     static int PickWrapperIndex(
         const Json& entry,
         int imageCount,
         const std::unordered_map<int, int>& indexToWrapperIndex,
         const std::unordered_map<int, int>& originToWrapperIndex,
-        const std::unordered_map<std::string, std::vector<int>>& sigToIndices) {
+        const std::unordered_map<std::uint64_t, std::vector<int>>& sigToIndices) {
         int idx = FoldIndex(entry.value("index", Json()), imageCount);
         if (idx >= 0 && indexToWrapperIndex.find(idx) != indexToWrapperIndex.end()) return idx;
 
@@ -718,11 +913,8 @@ private:
         }
 
         if (entry.contains("transform") && entry.at("transform").is_object()) {
-            const std::string sig = SerializeTransformKey(entry.at("transform"));
-            if (!sig.empty()) {
-                auto it = sigToIndices.find(sig);
-                if (it != sigToIndices.end() && it->second.size() == 1) return it->second[0];
-            }
+            auto it = sigToIndices.find(TransformationState::IdFromJson(entry.at("transform")));
+            if (it != sigToIndices.end() && it->second.size() == 1) return it->second[0];
         }
         return -1;
     }
@@ -734,7 +926,7 @@ private:
         const std::vector<Json>& nonLocalOthers) {
 
         std::vector<bool> flags(wrappers.size(), false);
-        std::unordered_set<std::string> transFlags;
+        std::unordered_set<std::uint64_t> transFlags;
         std::unordered_set<int> indexFlags;
         std::unordered_set<int> originFlags;
 
@@ -747,11 +939,8 @@ private:
             }
 
             if (e.contains("transform") && e.at("transform").is_object()) {
-                const std::string sig = SerializeTransformKey(e.at("transform"));
-                if (!sig.empty()) {
-                    transFlags.insert(sig);
-                    continue;
-                }
+                transFlags.insert(TransformationState::IdFromJson(e.at("transform")));
+                continue;
             }
 
             const int idx = FoldIndex(e.value("index", Json()), imageCount);
@@ -766,9 +955,8 @@ private:
         for (size_t i = 0; i < wrappers.size(); i++) {
             if (flags[i]) continue;
             const auto& wrap = wrappers[i];
-            const std::string sig = SerializeTransformKey(wrap.TransformState);
             const int wrappedOrigin = FoldAliasIndex(wrap.OriginalIndex, imageCount);
-            if (!sig.empty() && transFlags.count(sig)) flags[i] = true;
+            if (transFlags.count(wrap.TransformState.TransformId)) flags[i] = true;
             else if (indexFlags.count(static_cast<int>(i))) flags[i] = true;
             else if (originFlags.count(wrappedOrigin)) flags[i] = true;
         }
@@ -800,10 +988,145 @@ private:
     }
 };
 
+// result_filter_advanced 的逐检测判定条件（模块与融合执行共用）
+struct AdvancedFilterCriteria final {
+    bool EnableBBoxWh = false;
+    bool EnableRBoxWh = false;
+    bool EnableBBoxArea = false;
+    bool EnableMaskArea = false;
+
+    bool HasBBoxWMin = false, HasBBoxWMax = false, HasBBoxHMin = false, HasBBoxHMax = false;
+    bool HasRBoxWMin = false, HasRBoxWMax = false, HasRBoxHMin = false, HasRBoxHMax = false;
+    bool HasBBoxAreaMin = false, HasBBoxAreaMax = false, HasMaskAreaMin = false, HasMaskAreaMax = false;
+    double BBoxWMin = 0.0, BBoxWMax = 0.0, BBoxHMin = 0.0, BBoxHMax = 0.0;
+    double RBoxWMin = 0.0, RBoxWMax = 0.0, RBoxHMin = 0.0, RBoxHMax = 0.0;
+    double BBoxAreaMin = 0.0, BBoxAreaMax = 0.0, MaskAreaMin = 0.0, MaskAreaMax = 0.0;
+
+    static const PropertySchema<AdvancedFilterCriteria>& Schema() {
+        using C = AdvancedFilterCriteria;
+        static const PropertySchema<C> schema = PropertySchema<C>()
+            .Bool("enable_bbox_wh", &C::EnableBBoxWh, false)
+            .Bool("enable_rbox_wh", &C::EnableRBoxWh, false)
+            .Bool("enable_bbox_area", &C::EnableBBoxArea, false)
+            .Bool("enable_mask_area", &C::EnableMaskArea, false)
+            .OptionalDouble("bbox_w_min", &C::BBoxWMin, &C::HasBBoxWMin)
+            .OptionalDouble("bbox_w_max", &C::BBoxWMax, &C::HasBBoxWMax)
+            .OptionalDouble("bbox_h_min", &C::BBoxHMin, &C::HasBBoxHMin)
+            .OptionalDouble("bbox_h_max", &C::BBoxHMax, &C::HasBBoxHMax)
+            .OptionalDouble("rbox_w_min", &C::RBoxWMin, &C::HasRBoxWMin)
+            .OptionalDouble("rbox_w_max", &C::RBoxWMax, &C::HasRBoxWMax)
+            .OptionalDouble("rbox_h_min", &C::RBoxHMin, &C::HasRBoxHMin)
+            .OptionalDouble("rbox_h_max", &C::RBoxHMax, &C::HasRBoxHMax)
+            .OptionalDouble("bbox_area_min", &C::BBoxAreaMin, &C::HasBBoxAreaMin)
+            .OptionalDouble("bbox_area_max", &C::BBoxAreaMax, &C::HasBBoxAreaMax)
+            .OptionalDouble("mask_area_min", &C::MaskAreaMin, &C::HasMaskAreaMin)
+            .OptionalDouble("mask_area_max", &C::MaskAreaMax, &C::HasMaskAreaMax);
+        return schema;
+    }
+
+    bool NoFilter() const { return !EnableBBoxWh && !EnableRBoxWh && !EnableBBoxArea && !EnableMaskArea; }
+
+    bool Pass(const Json& so, std::unordered_map<const Json*, double>& maskAreaCache) const {
+        if (!so.is_object()) return false;
+        if (!so.contains("bbox") || !so.at("bbox").is_array() || so.at("bbox").size() < 4) return false;
+        const Json& bb = so.at("bbox");
+        const bool isRot = (bb.size() >= 5) || (so.value("with_angle", false) && (so.value("angle", -100.0) > -99.0));
+        const double w = std::abs(bb.at(2).get<double>());
+        const double h = std::abs(bb.at(3).get<double>());
+        const double area = w * h;
+
+        if (!isRot && EnableBBoxWh) {
+            if (HasBBoxWMin && w < BBoxWMin) return false;
+            if (HasBBoxWMax && w > BBoxWMax) return false;
+            if (HasBBoxHMin && h < BBoxHMin) return false;
+            if (HasBBoxHMax && h > BBoxHMax) return false;
+        }
+        if (isRot && EnableRBoxWh) {
+            if (HasRBoxWMin && w < RBoxWMin) return false;
+            if (HasRBoxWMax && w > RBoxWMax) return false;
+            if (HasRBoxHMin && h < RBoxHMin) return false;
+            if (HasRBoxHMax && h > RBoxHMax) return false;
+        }
+        if (EnableBBoxArea) {
+            if (HasBBoxAreaMin && area < BBoxAreaMin) return false;
+            if (HasBBoxAreaMax && area > BBoxAreaMax) return false;
+        }
+        if (EnableMaskArea) {
+            double marea = 0.0;
+            bool hasMaskArea = false;
+            if (so.contains("mask_area")) {
+                hasMaskArea = TryReadDouble(so.at("mask_area"), marea);
+            }
+            if (!hasMaskArea && so.contains("mask_rle") && so.at("mask_rle").is_object()) {
+                const Json& maskInfo = so.at("mask_rle");
+                const Json* maskKey = &maskInfo;
+                auto it = maskAreaCache.find(maskKey);
+                if (it != maskAreaCache.end()) {
+                    marea = it->second;
+                    hasMaskArea = true;
+                } else {
+                    marea = CalculateMaskArea(maskInfo);
+                    maskAreaCache.emplace(maskKey, marea);
+                    hasMaskArea = true;
+                }
+            }
+            if (!hasMaskArea) marea = 0.0;
+            if (HasMaskAreaMin && marea < MaskAreaMin) return false;
+            if (HasMaskAreaMax && marea > MaskAreaMax) return false;
+        }
+        return true;
+    }
+};
+
+// 融合执行对应模块的对齐快路径；失败分支未连接（链内节点只有主对存活）
+class ResultFilterAdvancedStage final : public FusedResultStage {
+public:
+    explicit ResultFilterAdvancedStage(const AdvancedFilterCriteria& criteria) : _criteria(criteria), _noFilter(criteria.NoFilter()) {}
+
+    bool Apply(Json& entry) override {
+        Json& samples = entry["sample_results"];
+        if (_noFilter) {
+            if (!samples.empty()) _hasPositive = true;
+            return true;
+        }
+
+        // 掩码面积缓存以检测对象地址为键，只在单条条目内有效
+        std::unordered_map<const Json*, double> maskAreaCache;
+        Json passArr = Json::array();
+        auto& passVec = passArr.get_ref<Json::array_t&>();
+        auto& sampleVec = samples.get_ref<Json::array_t&>();
+        passVec.reserve(sampleVec.size());
+        for (auto& s : sampleVec) {
+            if (!s.is_object()) continue;
+            if (_criteria.Pass(s, maskAreaCache)) passVec.push_back(std::move(s));
+        }
+        if (passArr.empty()) return false;
+
+        Json e = Json::object();
+        e["type"] = "local";
+        e["index"] = _emitted++;
+        e["origin_index"] = SafeIntFromJson(entry.at("origin_index"), 0);
+        e["transform"] = std::move(entry["transform"]);
+        e["sample_results"] = std::move(passArr);
+        entry = std::move(e);
+        _hasPositive = true;
+        return true;
+    }
+
+    void PublishScalars(std::map<std::string, Json>& scalars) const override {
+        scalars["has_positive"] = _hasPositive;
+    }
+
+private:
+    AdvancedFilterCriteria _criteria;
+    bool _noFilter = false;
+    bool _hasPositive = false;
+};
+
 /// post_process/result_filter_advanced, features/result_filter_advanced
-class ResultFilterAdvancedModule final : public BaseModule {
+class ResultFilterAdvancedModule final : public FusibleResultModule {
 public:
-    using BaseModule::BaseModule;
+    using FusibleResultModule::FusibleResultModule;
 
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
         const Json emptyResults = Json::array();
@@ -811,6 +1134,8 @@ public:
         return ProcessCore(imageList, inResults, nullptr);
     }
 
+    bool TakesOwnedResultList() const override { return true; }
+
     ModuleIO ProcessOwned(const std::vector<ModuleImage>& imageList, Json&& resultList) override {
         const Json emptyResults = Json::array();
         const bool hasOwnedArray = resultList.is_array();
@@ -818,48 +1143,24 @@ public:
         return ProcessCore(imageList, inResults, hasOwnedArray ? &resultList : nullptr);
     }
 
+protected:
+    std::unique_ptr<FusedResultStage> CreateFusedStage() const override {
+        // 失败分支有下游时输出结构不同，不参与融合
+        if (IsCurrentOutputConnected(CurrentOutputMask, 2) || IsCurrentOutputConnected(CurrentOutputMask, 3)) {
+            return std::unique_ptr<FusedResultStage>();
+        }
+        return std::unique_ptr<FusedResultStage>(new ResultFilterAdvancedStage(_criteria));
+    }
+
 private:
+    const AdvancedFilterCriteria _criteria = BindProperties<AdvancedFilterCriteria>();
+
     ModuleIO ProcessCore(const std::vector<ModuleImage>& imageList, const Json& inResults, Json* ownedResults) {
         const std::vector<ModuleImage>& inImages = imageList;
 
-        const bool enableBBoxWh = ReadBool("enable_bbox_wh", false);
-        const bool enableRBoxWh = ReadBool("enable_rbox_wh", false);
-        const bool enableBBoxArea = ReadBool("enable_bbox_area", false);
-        const bool enableMaskArea = ReadBool("enable_mask_area", false);
-
-        auto readOpt = [&](const std::string& key) -> Json {
-            if (Properties.is_object() && Properties.contains(key) && !Properties.at(key).is_null()) return Properties.at(key);
-            return Json();
-        };
-        auto optD = [&](const Json& v, bool& has) -> double {
-            has = false;
-            try {
-                if (v.is_number()) { has = true; return v.get<double>(); }
-                if (v.is_string()) { has = true; return std::stod(v.get<std::string>()); }
-            } catch (...) {}
-            return 0.0;
-        };
-
-        bool has_bbox_w_min=false, has_bbox_w_max=false, has_bbox_h_min=false, has_bbox_h_max=false;
-        bool has_rbox_w_min=false, has_rbox_w_max=false, has_rbox_h_min=false, has_rbox_h_max=false;
-        bool has_bbox_area_min=false, has_bbox_area_max=false, has_mask_area_min=false, has_mask_area_max=false;
-
-        const double bboxWMin = optD(readOpt("bbox_w_min"), has_bbox_w_min);
-        const double bboxWMax = optD(readOpt("bbox_w_max"), has_bbox_w_max);
-        const double bboxHMin = optD(readOpt("bbox_h_min"), has_bbox_h_min);
-        const double bboxHMax = optD(readOpt("bbox_h_max"), has_bbox_h_max);
-
-        const double rboxWMin = optD(readOpt("rbox_w_min"), has_rbox_w_min);
-        const double rboxWMax = optD(readOpt("rbox_w_max"), has_rbox_w_max);
-        const double rboxHMin = optD(readOpt("rbox_h_min"), has_rbox_h_min);
-        const double rboxHMax = optD(readOpt("rbox_h_max"), has_rbox_h_max);
-
-        const double bboxAreaMin = optD(readOpt("bbox_area_min"), has_bbox_area_min);
-        const double bboxAreaMax = optD(readOpt("bbox_area_max"), has_bbox_area_max);
-        const double maskAreaMin = optD(readOpt("mask_area_min"), has_mask_area_min);
-        const double maskAreaMax = optD(readOpt("mask_area_max"), has_mask_area_max);
-        const bool noFilter = !enableBBoxWh && !enableRBoxWh && !enableBBoxArea && !enableMaskArea;
-        const bool emitFailBranch = IsCurrentOutputConnected(Context, 2) || IsCurrentOutputConnected(Context, 3);
+        const AdvancedFilterCriteria& criteria = _criteria;
+        const bool noFilter = criteria.NoFilter();
+        const bool emitFailBranch = IsCurrentOutputConnected(CurrentOutputMask, 2) || IsCurrentOutputConnected(CurrentOutputMask, 3);
 
         if (noFilter && !emitFailBranch) {
             bool hasPositive = false;
@@ -886,64 +1187,14 @@ private:
 
         // map entry->image by (idx, origin, transform sig)
         std::unordered_map<int, int> originToIdx;
-        std::unordered_map<std::string, int> sigToIdx;
+        std::unordered_map<std::uint64_t, int> sigToIdx;
         for (int i = 0; i < static_cast<int>(inImages.size()); i++) {
+            const TransformationState& st = inImages[static_cast<size_t>(i)].TransformState;
             originToIdx[inImages[static_cast<size_t>(i)].OriginalIndex] = i;
-            if (inImages[static_cast<size_t>(i)].TransformState.AffineMatrix2x3.size() >= 6) {
-                sigToIdx[FormatAffineKey(inImages[static_cast<size_t>(i)].TransformState.AffineMatrix2x3)] = i;
-            }
-        }
-
-        auto passOne = [&](const Json& so) -> bool {
-            if (!so.is_object()) return false;
-            if (!so.contains("bbox") || !so.at("bbox").is_array() || so.at("bbox").size() < 4) return false;
-            const Json& bb = so.at("bbox");
-            const bool isRot = (bb.size() >= 5) || (so.value("with_angle", false) && (so.value("angle", -100.0) > -99.0));
-            const double w = std::abs(bb.at(2).get<double>());
-            const double h = std::abs(bb.at(3).get<double>());
-            const double area = w * h;
-
-            if (!isRot && enableBBoxWh) {
-                if (has_bbox_w_min && w < bboxWMin) return false;
-                if (has_bbox_w_max && w > bboxWMax) return false;
-                if (has_bbox_h_min && h < bboxHMin) return false;
-                if (has_bbox_h_max && h > bboxHMax) return false;
-            }
-            if (isRot && enableRBoxWh) {
-                if (has_rbox_w_min && w < rboxWMin) return false;
-                if (has_rbox_w_max && w > rboxWMax) return false;
-                if (has_rbox_h_min && h < rboxHMin) return false;
-                if (has_rbox_h_max && h > rboxHMax) return false;
-            }
-            if (enableBBoxArea) {
-                if (has_bbox_area_min && area < bboxAreaMin) return false;
-                if (has_bbox_area_max && area > bboxAreaMax) return false;
-            }
-            if (enableMaskArea) {
-                double marea = 0.0;
-                bool hasMaskArea = false;
-                if (so.contains("mask_area")) {
-                    hasMaskArea = TryReadDouble(so.at("mask_area"), marea);
-                }
-                if (!hasMaskArea && so.contains("mask_rle") && so.at("mask_rle").is_object()) {
-                    const Json& maskInfo = so.at("mask_rle");
-                    const Json* maskKey = &maskInfo;
-                    auto it = maskAreaCache.find(maskKey);
-                    if (it != maskAreaCache.end()) {
-                        marea = it->second;
-                        hasMaskArea = true;
-                    } else {
-                        marea = CalculateMaskArea(maskInfo);
-                        maskAreaCache.emplace(maskKey, marea);
-                        hasMaskArea = true;
-                    }
-                }
-                if (!hasMaskArea) marea = 0.0;
-                if (has_mask_area_min && marea < maskAreaMin) return false;
-                if (has_mask_area_max && marea > maskAreaMax) return false;
-            }
-            return true;
-        };
+            if (st.HasAffine()) sigToIdx[st.AffineMatchKey()] = i;
+        }
+
+        auto passOne = [&](const Json& so) -> bool { return criteria.Pass(so, maskAreaCache); };
 
         // 常见 batch 场景下 image_list 与 result_list 一一对应，优先走顺序快路径。
         bool alignedLocalFastPath = false;
@@ -1079,11 +1330,11 @@ private:
 
             int idx = entry.contains("index") ? entry.at("index").get<int>() : -1;
             int originIndex = entry.contains("origin_index") ? entry.at("origin_index").get<int>() : idx;
-            std::string sig;
-            try { if (entry.contains("transform") && entry.at("transform").is_object()) sig = SerializeTransformSigFromJson(entry.at("transform")); } catch (...) {}
+            std::uint64_t sig = 0;
+            try { if (entry.contains("transform")) sig = TransformationState::AffineMatchKeyFromJson(entry.at("transform")); } catch (...) {}
             int imgIdx = (idx >= 0 && idx < static_cast<int>(inImages.size())) ? idx : -1;
             if (imgIdx < 0 && originToIdx.count(originIndex)) imgIdx = originToIdx[originIndex];
-            if (imgIdx < 0 && !sig.empty() && sigToIdx.count(sig)) imgIdx = sigToIdx[sig];
+            if (imgIdx < 0 && sig != 0 && sigToIdx.count(sig)) imgIdx = sigToIdx[sig];
             if (imgIdx < 0 || imgIdx >= static_cast<int>(inImages.size())) continue;
 
             Json passArr = Json::array();
@@ -1185,38 +1436,40 @@ private:
     }
 };
 
+class TextReplacementStage final : public FusedResultStage {
+public:
+    explicit TextReplacementStage(std::unordered_map<std::string, std::string> mapping) : _mapping(std::move(mapping)) {}
+
+    bool Apply(Json& entry) override {
+        if (_mapping.empty()) return true;
+        for (auto& d : entry.at("sample_results").get_ref<Json::array_t&>()) {
+            if (!d.is_object()) continue;
+            auto it = d.find("category_name");
+            if (it == d.end() || !it->is_string()) continue;
+            std::string newCat = it->get<std::string>();
+            for (const auto& kv : _mapping) {
+                newCat = ReplaceAll(newCat, kv.first, kv.second);
+            }
+            *it = newCat;
+        }
+        return true;
+    }
+
+private:
+    std::unordered_map<std::string, std::string> _mapping;
+};
+
 /// post_process/text_replacement, features/text_replacement
-class TextReplacementModule final : public BaseModule {
+class TextReplacementModule final : public FusibleResultModule {
 public:
-    using BaseModule::BaseModule;
+    using FusibleResultModule::FusibleResultModule;
 
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
         const std::vector<ModuleImage>& images = imageList;
         const Json emptyResults = Json::array();
         const Json& results = resultList.is_array() ? resultList : emptyResults;
 
-        std::unordered_map<std::string, std::string> mapping;
-        try {
-            if (Properties.is_object() && Properties.contains("mapping")) {
-                const Json& m = Properties.at("mapping");
-                if (m.is_object()) {
-                    for (auto it = m.begin(); it != m.end(); ++it) {
-                        mapping[it.key()] = it.value().is_string() ? it.value().get<std::string>() : it.value().dump();
-                    }
-                } else if (m.is_string()) {
-                    const std::string s = m.get<std::string>();
-                    try {
-                        Json jo = Json::parse(s);
-                        if (jo.is_object()) {
-                            for (auto it = jo.begin(); it != jo.end(); ++it) {
-                                mapping[it.key()] = it.value().is_string() ? it.value().get<std::string>() : it.value().dump();
-                            }
-                        }
-                    } catch (...) {}
-                }
-            }
-        } catch (...) {}
-
+        const std::unordered_map<std::string, std::string> mapping = ReadMapping(Properties);
         if (mapping.empty()) {
             return ModuleIO(images, results, Json::array());
         }
@@ -1246,8 +1499,125 @@ public:
         }
         return ModuleIO(images, outResults, Json::array());
     }
+
+protected:
+    std::unique_ptr<FusedResultStage> CreateFusedStage() const override {
+        return std::unique_ptr<FusedResultStage>(new TextReplacementStage(ReadMapping(Properties)));
+    }
+
+private:
+    // 替换表的读取顺序决定 unordered_map 的遍历顺序，模块与融合阶段共用同一读取过程
+    static std::unordered_map<std::string, std::string> ReadMapping(const Json& props) {
+        std::unordered_map<std::string, std::string> mapping;
+        try {
+            if (props.is_object() && props.contains("mapping")) {
+                const Json& m = props.at("mapping");
+                if (m.is_object()) {
+                    for (auto it = m.begin(); it != m.end(); ++it) {
+                        mapping[it.key()] = it.value().is_string() ? it.value().get<std::string>() : it.value().dump();
+                    }
+                } else if (m.is_string()) {
+                    const std::string s = m.get<std::string>();
+                    try {
+                        Json jo = Json::parse(s);
+                        if (jo.is_object()) {
+                            for (auto it = jo.begin(); it != jo.end(); ++it) {
+                                mapping[it.key()] = it.value().is_string() ? it.value().get<std::string>() : it.value().dump();
+                            }
+                        }
+                    } catch (...) {}
+                }
+            }
+        } catch (...) {}
+        return mapping;
+    }
 };
 
+// 融合前提：图像与结果一一对齐（第 i 条为 local，index 为 i，origin_index 与变换标识与第 i 张图一致），
+// 图像非空，检测均为对象且类别名为字符串。此时各模块的条目-图像匹配都落在同一下标上，
+// 每一步的主输出仍满足该前提，条目可以逐条流过整条链。
+static bool IsCanonicalAlignedInput(const std::vector<ModuleImage>& images, const Json& results) {
+    if (!results.is_array() || images.empty() || images.size() != results.size()) return false;
+    for (size_t i = 0; i < images.size(); i++) {
+        const ModuleImage& img = images[i];
+        const Json& e = results[i];
+        if (!e.is_object() || img.ImageObject.empty()) return false;
+
+        auto itType = e.find("type");
+        if (itType == e.end() || !itType->is_string() || itType->get_ref<const std::string&>() != "local") return false;
+        auto itIndex = e.find("index");
+        if (itIndex == e.end() || !itIndex->is_number_integer() || itIndex->get<std::int64_t>() != static_cast<std::int64_t>(i)) return false;
+        auto itOrigin = e.find("origin_index");
+        if (itOrigin == e.end() || !itOrigin->is_number_integer() || itOrigin->get<std::int64_t>() != img.OriginalIndex) return false;
+
+        auto itTransform = e.find("transform");
+        if (itTransform == e.end() || !itTransform->is_object()) return false;
+        TransformationState st;
+        try { st = TransformationState::FromJson(*itTransform); } catch (...) { return false; }
+        const int index = static_cast<int>(i);
+        if (TransformMatchKey(st, index, img.OriginalIndex) != TransformMatchKey(img.TransformState, index, img.OriginalIndex)) return false;
+
+        auto itSamples = e.find("sample_results");
+        if (itSamples == e.end() || !itSamples->is_array()) return false;
+        for (const auto& d : *itSamples) {
+            if (!d.is_object()) return false;
+            auto itCat = d.find("category_name");
+            if (itCat != d.end() && !itCat->is_string()) return false;
+        }
+    }
+    return true;
+}
+
+bool FusibleResultModule::ProcessFusedChain(const std::vector<BaseModule*>& chain,
+                                            const std::vector<ModuleImage>& imageList,
+                                            const Json& resultList,
+                                            ModuleIO& output,
+                                            std::vector<double>& stageElapsedMs) {
+    using Clock = std::chrono::steady_clock;
+    if (chain.empty() || chain.front() != this) return false;
+
+    std::vector<std::unique_ptr<FusedResultStage>> stages;
+    stages.reserve(chain.size());
+    for (BaseModule* module : chain) {
+        const FusibleResultModule* fusible = dynamic_cast<const FusibleResultModule*>(module);
+        if (fusible == nullptr) return false;
+        stages.push_back(fusible->CreateFusedStage());
+        if (!stages.back()) return false;
+    }
+
+    const auto start = Clock::now();
+    if (!IsCanonicalAlignedInput(imageList, resultList)) return false;
+
+    stageElapsedMs.assign(chain.size(), 0.0);
+    std::vector<ModuleImage> outImages;
+    Json outResults = Json::array();
+    for (size_t i = 0; i < imageList.size(); i++) {
+        Json entry = resultList[i];
+        bool kept = true;
+        for (size_t k = 0; k < stages.size() && kept; k++) {
+            const auto t0 = Clock::now();
+            kept = stages[k]->Apply(entry);
+            stageElapsedMs[k] += std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+        }
+        if (!kept) continue;
+        outImages.push_back(imageList[i]);
+        outResults.push_back(std::move(entry));
+    }
+
+    for (size_t k = 0; k < stages.size(); k++) {
+        stages[k]->PublishScalars(chain[k]->ScalarOutputsByName);
+    }
+
+    // 前提检查与条目复制计入链首
+    double stagesMs = 0.0;
+    for (double ms : stageElapsedMs) stagesMs += ms;
+    const double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (totalMs > stagesMs) stageElapsedMs[0] += totalMs - stagesMs;
+
+    output = ModuleIO(std::move(outImages), std::move(outResults), Json::array());
+    return true;
+}
+
 /// post_process/result_category_override, features/result_category_override
 /// 行为：按图像索引将第二路结果的类别名一一对应覆盖主结果。
 /// 匹配优先级：index > origin_index > transform 签名。
@@ -1269,7 +1639,7 @@ public:
         // 构建替换标签映射
         std::map<int, std::string> indexMap;
         std::map<int, std::string> originMap;
-        std::map<std::string, std::string> transformMap;
+        std::map<std::uint64_t, std::string> transformMap;
         BuildOverrideMap(replaceResults, indexMap, originMap, transformMap);
         if (indexMap.empty() && originMap.empty() && transformMap.empty()) {
             return ModuleIO(images, results, Json::array());
@@ -1355,7 +1725,7 @@ private:
         const Json& replaceResults,
         std::map<int, std::string>& indexMap,
         std::map<int, std::string>& originMap,
-        std::map<std::string, std::string>& transformMap
+        std::map<std::uint64_t, std::string>& transformMap
     ) {
         if (!replaceResults.is_array()) return;
         for (const auto& token : replaceResults) {
@@ -1380,7 +1750,7 @@ private:
             }
             if (entry.contains("transform") && entry.at("transform").is_object()) {
                 try {
-                    transformMap[entry.at("transform").dump()] = label;
+                    transformMap[TransformationState::IdFromJson(entry.at("transform"))] = label;
                 } catch (...) {}
             }
         }
@@ -1390,7 +1760,7 @@ private:
         const Json& entry,
         const std::map<int, std::string>& indexMap,
         const std::map<int, std::string>& originMap,
-        const std::map<std::string, std::string>& transformMap
+        const std::map<std::uint64_t, std::string>& transformMap
     ) {
         if (!entry.is_object()) return std::string();
 
@@ -1419,7 +1789,7 @@ private:
         // 3) transform
         if (entry.contains("transform") && entry.at("transform").is_object()) {
             try {
-                auto it = transformMap.find(entry.at("transform").dump());
+                auto it = transformMap.find(TransformationState::IdFromJson(entry.at("transform")));
                 if (it != transformMap.end()) return it->second;
             } catch (...) {}
         }
@@ -1461,6 +1831,8 @@ public:
         return ProcessCore(imageList, std::move(outResults));
     }
 
+    bool TakesOwnedResultList() const override { return true; }
+
     ModuleIO ProcessOwned(const std::vector<ModuleImage>& imageList, Json&& resultList) override {
         Json outResults = resultList.is_array() ? std::move(resultList) : Json::array();
         return ProcessCore(imageList, std::move(outResults));
@@ -1471,16 +1843,15 @@ private:
         const std::vector<ModuleImage>& images = imageList;
         if (!outResults.is_array()) outResults = Json::array();
         auto& outEntries = outResults.get_ref<Json::array_t&>();
-        std::unordered_map<const Json*, cv::RotatedRect> rectCache;
-
-        auto NormalizeAngleLe90Rad = [](double aRad) -> double {
-            double x = aRad;
-            x = std::fmod(x + kPi / 2.0, kPi);
-            if (x < 0) x += kPi;
-            x -= kPi / 2.0;
-            return x;
-        };
 
+        // 各条目的检测展平后逐条并行转换（RLE 解码与最小外接矩形相互独立），再按原顺序写回各条目
+        struct DetSlot {
+            size_t Entry = 0;
+            Json* Det = nullptr;
+            bool Keep = false;
+        };
+        std::vector<Json*> entries;
+        std::vector<DetSlot> slots;
         for (auto& entryToken : outEntries) {
             if (!entryToken.is_object() || entryToken.value("type", "") != "local") {
                 continue;
@@ -1489,76 +1860,97 @@ private:
             if (!entry.contains("sample_results") || !entry.at("sample_results").is_array()) {
                 continue;
             }
-            Json newDets = Json::array();
-            auto& newDetArr = newDets.get_ref<Json::array_t&>();
-            auto& srcDetArr = entry["sample_results"].get_ref<Json::array_t&>();
-            newDetArr.reserve(srcDetArr.size());
-            for (auto& dToken : srcDetArr) {
-                if (!dToken.is_object()) continue;
-
-                Json& d = dToken;
-                const bool hasPrecomputedRect = d.contains("mask_min_area_rect")
-                    && d.at("mask_min_area_rect").is_array()
-                    && d.at("mask_min_area_rect").size() >= 5;
-                if (!hasPrecomputedRect && (!d.contains("mask_rle") || !d.at("mask_rle").is_object())) {
-                    continue; // 与 C# 对齐：无 mask_rle 直接跳过该条
-                }
-                if (!d.contains("bbox") || !d.at("bbox").is_array() || d.at("bbox").size() < 4) continue;
-                const Json& bbox = d.at("bbox");
-                const float offsetX = static_cast<float>(bbox.at(0).get<double>());
-                const float offsetY = static_cast<float>(bbox.at(1).get<double>());
+            const size_t entryIndex = entries.size();
+            entries.push_back(&entry);
+            for (auto& dToken : entry["sample_results"].get_ref<Json::array_t&>()) {
+                DetSlot slot;
+                slot.Entry = entryIndex;
+                slot.Det = &dToken;
+                slots.push_back(slot);
+            }
+        }
 
-                cv::RotatedRect rr;
-                if (hasPrecomputedRect) {
-                    try {
-                        const Json& maskRect = d.at("mask_min_area_rect");
-                        rr = cv::RotatedRect(
-                            cv::Point2f(
-                                static_cast<float>(maskRect.at(0).get<double>()),
-                                static_cast<float>(maskRect.at(1).get<double>())),
-                            cv::Size2f(
-                                static_cast<float>(std::abs(maskRect.at(2).get<double>())),
-                                static_cast<float>(std::abs(maskRect.at(3).get<double>()))),
-                            static_cast<float>(maskRect.at(4).get<double>()));
-                    } catch (...) {
-                        continue;
-                    }
-                } else {
-                    const Json& maskInfo = d.at("mask_rle");
-                    const Json* maskKey = &maskInfo;
-                    auto it = rectCache.find(maskKey);
-                    if (it != rectCache.end()) {
-                        rr = it->second;
-                    } else {
-                        if (!TryComputeMinAreaRectFromMaskInfo(maskInfo, rr)) continue;
-                        rectCache.emplace(maskKey, rr);
-                    }
-                }
-                rr.center += cv::Point2f(offsetX, offsetY);
-
-                float rw = rr.size.width;
-                float rh = rr.size.height;
-                float angDeg = rr.angle;
-                if (rw < rh) {
-                    std::swap(rw, rh);
-                    angDeg += 90.0f;
-                }
-                double angRad = NormalizeAngleLe90Rad(static_cast<double>(angDeg) * kPi / 180.0);
+        ParallelFor(slots.size(), 4, [&slots](size_t k) {
+            slots[k].Keep = ConvertToRBox(*slots[k].Det);
+        });
 
-                d.erase("mask_rle");
-                d.erase("mask");
-                d.erase("mask_min_area_rect");
-                d.erase("mask_area");
-                d["bbox"] = Json::array({ rr.center.x, rr.center.y, rw, rh, angRad });
-                d["with_angle"] = true;
-                d["angle"] = angRad;
-                newDetArr.push_back(std::move(d));
+        size_t k = 0;
+        for (size_t e = 0; e < entries.size(); e++) {
+            Json newDets = Json::array();
+            auto& newDetArr = newDets.get_ref<Json::array_t&>();
+            const size_t begin = k;
+            while (k < slots.size() && slots[k].Entry == e) k++;
+            newDetArr.reserve(k - begin);
+            for (size_t i = begin; i < k; i++) {
+                if (slots[i].Keep) newDetArr.push_back(std::move(*slots[i].Det));
             }
-            entry["sample_results"] = std::move(newDets);
+            (*entries[e])["sample_results"] = std::move(newDets);
         }
 
         return ModuleIO(images, std::move(outResults), Json::array());
     }
+
+    static double NormalizeAngleLe90Rad(double aRad) {
+        double x = aRad;
+        x = std::fmod(x + kPi / 2.0, kPi);
+        if (x < 0) x += kPi;
+        x -= kPi / 2.0;
+        return x;
+    }
+
+    // 单条检测转为旋转框（原地修改）；无 mask 或 bbox 不完整时返回 false，该条被丢弃
+    static bool ConvertToRBox(Json& d) {
+        if (!d.is_object()) return false;
+
+        const bool hasPrecomputedRect = d.contains("mask_min_area_rect")
+            && d.at("mask_min_area_rect").is_array()
+            && d.at("mask_min_area_rect").size() >= 5;
+        if (!hasPrecomputedRect && (!d.contains("mask_rle") || !d.at("mask_rle").is_object())) {
+            return false; // 与 C# 对齐：无 mask_rle 直接跳过该条
+        }
+        if (!d.contains("bbox") || !d.at("bbox").is_array() || d.at("bbox").size() < 4) return false;
+        const Json& bbox = d.at("bbox");
+        const float offsetX = static_cast<float>(bbox.at(0).get<double>());
+        const float offsetY = static_cast<float>(bbox.at(1).get<double>());
+
+        cv::RotatedRect rr;
+        if (hasPrecomputedRect) {
+            try {
+                const Json& maskRect = d.at("mask_min_area_rect");
+                rr = cv::RotatedRect(
+                    cv::Point2f(
+                        static_cast<float>(maskRect.at(0).get<double>()),
+                        static_cast<float>(maskRect.at(1).get<double>())),
+                    cv::Size2f(
+                        static_cast<float>(std::abs(maskRect.at(2).get<double>())),
+                        static_cast<float>(std::abs(maskRect.at(3).get<double>()))),
+                    static_cast<float>(maskRect.at(4).get<double>()));
+            } catch (...) {
+                return false;
+            }
+        } else {
+            if (!TryComputeMinAreaRectFromMaskInfo(d.at("mask_rle"), rr)) return false;
+        }
+        rr.center += cv::Point2f(offsetX, offsetY);
+
+        float rw = rr.size.width;
+        float rh = rr.size.height;
+        float angDeg = rr.angle;
+        if (rw < rh) {
+            std::swap(rw, rh);
+            angDeg += 90.0f;
+        }
+        double angRad = NormalizeAngleLe90Rad(static_cast<double>(angDeg) * kPi / 180.0);
+
+        d.erase("mask_rle");
+        d.erase("mask");
+        d.erase("mask_min_area_rect");
+        d.erase("mask_area");
+        d["bbox"] = Json::array({ rr.center.x, rr.center.y, rw, rh, angRad });
+        d["with_angle"] = true;
+        d["angle"] = angRad;
+        return true;
+    }
 };
 
 /// post_process/rbox_correction, features/rbox_correction
@@ -1570,7 +1962,7 @@ public:
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
 
-        const int fillVal = ReadInt("fill_value", 0);
+        const int fillVal = _props.FillValue;
 
         // 先按 index 建立 entry 列表
         std::unordered_map<int, std::vector<Json>> imgIdxToEntries;
@@ -1703,6 +2095,18 @@ public:
 
         return ModuleIO(std::move(outImages), std::move(outResults), Json::array());
     }
+
+private:
+    struct Props {
+        int FillValue = 0;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Int("fill_value", &Props::FillValue, 0);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// post_process/bbox_iou_dedup, features/bbox_iou_dedup
@@ -1723,10 +2127,10 @@ public:
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
 
-        std::string metric = NormalizeMetric(ReadString("metric", "iou"));
-        const double threshold = Clamp01(ReadDouble("iou_threshold", 0.5));
-        const bool perCategory = ReadBool("per_category", true);
-        const bool crossModel = ReadBool("cross_model", true);
+        const std::string& metric = _props.Metric;
+        const double threshold = Clamp01(_props.Threshold);
+        const bool perCategory = _props.PerCategory;
+        const bool crossModel = _props.CrossModel;
         const std::unordered_map<int, std::string> imageGroups = crossModel ? BuildImageGroupsByIndex(images) : std::unordered_map<int, std::string>();
         std::string singleImageGroup;
         if (!imageGroups.empty()) {
@@ -1753,7 +2157,7 @@ public:
 
             const int idx = entry.contains("index") ? SafeIntFromJson(entry.at("index"), -1) : -1;
             const int originIdx = entry.contains("origin_index") ? SafeIntFromJson(entry.at("origin_index"), idx) : idx;
-            const std::string transformSig = TransformGroupKey(entry.contains("transform") ? &entry.at("transform") : nullptr);
+            const std::uint64_t transformSig = TransformGroupKey(entry.contains("transform") ? &entry.at("transform") : nullptr);
             const std::string entryGroupKey = crossModel
                 ? BuildCrossModelGroupKey(entry, imageGroups, singleImageGroup)
                 : BuildStrictGroupKey(idx, originIdx, transformSig);
@@ -1889,12 +2293,13 @@ private:
         if (it != imageGroups.end()) return std::string("image|") + it->second;
 
         if (!singleImageGroup.empty()) return std::string("image|") + singleImageGroup;
-        const std::string transformSig = TransformGroupKey(entry.contains("transform") ? &entry.at("transform") : nullptr);
+        const std::uint64_t transformSig = TransformGroupKey(entry.contains("transform") ? &entry.at("transform") : nullptr);
         return BuildStrictGroupKey(idx, originIdx, transformSig);
     }
 
-    static std::string BuildStrictGroupKey(int idx, int originIdx, const std::string& transformSig) {
-        return std::to_string(idx) + "|" + std::to_string(originIdx) + "|" + transformSig;
+    static std::string BuildStrictGroupKey(int idx, int originIdx, std::uint64_t transformSig) {
+        return std::to_string(idx) + "|" + std::to_string(originIdx) + "|" +
+            (transformSig == 0 ? std::string("__global__") : std::to_string(transformSig));
     }
 
     static std::string ImageFingerprint(const ModuleImage& image) {
@@ -2062,17 +2467,6 @@ private:
         return std::max(0.0, bbox[2] - bbox[0]) * std::max(0.0, bbox[3] - bbox[1]);
     }
 
-    static std::string NormalizeMetric(std::string metricRaw) {
-        auto trim = [](std::string& s) {
-            while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.erase(s.begin());
-            while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.pop_back();
-        };
-        trim(metricRaw);
-        std::transform(metricRaw.begin(), metricRaw.end(), metricRaw.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
-        if (metricRaw == "ios") return "ios";
-        return "iou";
-    }
-
     static double Clamp01(double v) {
         if (std::isnan(v) || std::isinf(v)) return 0.0;
         if (v < 0.0) return 0.0;
@@ -2117,6 +2511,23 @@ private:
         const double h = std::max(0.0, y2 - y1);
         return w * h;
     }
+
+    struct Props {
+        std::string Metric;     // 去空白并转小写，仅 "ios" 按 IoS 计算，其余按 IoU
+        double Threshold = 0.5;
+        bool PerCategory = true;
+        bool CrossModel = true;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .String("metric", &Props::Metric, "iou", PropertyText::TrimLower)
+                .Double("iou_threshold", &Props::Threshold, 0.5)
+                .Bool("per_category", &Props::PerCategory, true)
+                .Bool("cross_model", &Props::CrossModel, true);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 
@@ -2140,7 +2551,7 @@ public:
             return ModuleIO(std::vector<ModuleImage>(), Json::array(), Json::array());
         }
 
-        const std::string fixedText = ReadString("fixed_text", std::string());
+        const std::string& fixedText = _props.FixedText;
 
         std::vector<std::unordered_map<std::string, Json>> groupMaps;
         groupMaps.reserve(groups.size());
@@ -2325,6 +2736,17 @@ private:
         }
         return out;
     }
+
+    struct Props {
+        std::string FixedText;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .String("fixed_text", &Props::FixedText, std::string());
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 // 注册
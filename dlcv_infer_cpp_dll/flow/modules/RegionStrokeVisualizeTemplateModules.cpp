@@ -1,4 +1,5 @@
-#include "flow/BaseModule.h"
+﻿#include "flow/BaseModule.h"
+#include "flow/ContextKeys.h"
 #include "flow/ModuleRegistry.h"
 #include "flow/utils/FlowPlatformUtils.h"
 #include "flow/utils/MaskRleUtils.h"
@@ -95,32 +96,28 @@ protected:
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
 
-        const int x = ReadInt("x", 0);
-        const int y = ReadInt("y", 0);
-        const int w = std::max(1, ReadInt("w", 100));
-        const int h = std::max(1, ReadInt("h", 100));
-
-        std::string resultRegionMode = ToLowerCopy(ReadString("result_region_mode", "any_bbox"));
-        if (resultRegionMode != "any_bbox" && resultRegionMode != "top1_bbox") {
-            resultRegionMode = "any_bbox";
-        }
+        const int x = _props.X;
+        const int y = _props.Y;
+        const int w = _props.W;
+        const int h = _props.H;
+        const bool top1Region = _props.Top1Region;
 
         std::unordered_map<int, int> originToWrapIndex;
-        std::unordered_map<std::string, int> sigToWrapIndex;
+        std::unordered_map<std::uint64_t, int> sigToWrapIndex;
         for (int i = 0; i < static_cast<int>(images.size()); i++) {
             const ModuleImage& wrap = images[static_cast<size_t>(i)];
             originToWrapIndex[wrap.OriginalIndex] = i;
-            const std::string sig = SerializeTransformSig(wrap.TransformState);
-            if (!sig.empty()) sigToWrapIndex[sig] = i;
+            const std::uint64_t sig = TransformSigId(wrap.TransformState);
+            if (sig != 0) sigToWrapIndex[sig] = i;
         }
 
         const auto pickWrapIndexForEntry = [&](const Json& entry) -> int {
             if (!entry.is_object()) return -1;
             try {
                 if (entry.contains("transform") && entry.at("transform").is_object()) {
-                    const std::string sig = SerializeTransformSig(entry.at("transform"));
+                    const std::uint64_t sig = TransformSigId(entry.at("transform"));
                     auto itSig = sigToWrapIndex.find(sig);
-                    if (!sig.empty() && itSig != sigToWrapIndex.end()) return itSig->second;
+                    if (sig != 0 && itSig != sigToWrapIndex.end()) return itSig->second;
                 }
             } catch (...) {}
 
@@ -275,7 +272,7 @@ protected:
                 const std::vector<BoxCandidate>& cands = kv.second;
                 if (cands.empty()) continue;
 
-                if (resultRegionMode == "top1_bbox") {
+                if (top1Region) {
                     bool foundScored = false;
                     double bestScore = -1e100;
                     Box bestBox{};
@@ -314,6 +311,30 @@ protected:
 
         bool hasAnyInside = false;
 
+        // 第一遍按条目准备区域与坐标空间，并把各条目的检测展平；检测的区域判定（mask 解码与重叠计算）
+        // 相互独立，逐条并行计算后再按原顺序分入区域内/外
+        struct EntryTask {
+            const Json* Entry = nullptr;
+            int WrapIndex = -1;
+            int W0 = 1;
+            int H0 = 1;
+            int Wc = 1;
+            int Hc = 1;
+            std::vector<Box> ActiveRois;
+            bool ForceOutsideByEmptyRegion = false;
+            size_t DetBegin = 0;
+            size_t DetEnd = 0;
+        };
+        struct DetSlot {
+            size_t Task = 0;
+            const Json* Det = nullptr;
+            Json Out;
+            bool IsIn = false;
+        };
+        std::vector<EntryTask> tasks;
+        std::vector<DetSlot> slots;
+        const bool useOriginal = forceOriginal;
+
         for (const auto& token : results) {
             if (!token.is_object()) {
                 others.push_back(token);
@@ -335,145 +356,166 @@ protected:
                 continue;
             }
 
+            EntryTask task;
+            task.Entry = &entry;
+            task.WrapIndex = wrapIndex;
             const ModuleImage& wrap = images[static_cast<size_t>(wrapIndex)];
-            const int Wc = std::max(1, wrap.ImageObject.empty() ? 1 : wrap.ImageObject.cols);
-            const int Hc = std::max(1, wrap.ImageObject.empty() ? 1 : wrap.ImageObject.rows);
-            int W0 = wrap.TransformState.OriginalWidth;
-            int H0 = wrap.TransformState.OriginalHeight;
-            if (W0 <= 0) W0 = Wc;
-            if (H0 <= 0) H0 = Hc;
+            task.Wc = std::max(1, wrap.ImageObject.empty() ? 1 : wrap.ImageObject.cols);
+            task.Hc = std::max(1, wrap.ImageObject.empty() ? 1 : wrap.ImageObject.rows);
+            task.W0 = wrap.TransformState.OriginalWidth;
+            task.H0 = wrap.TransformState.OriginalHeight;
+            if (task.W0 <= 0) task.W0 = task.Wc;
+            if (task.H0 <= 0) task.H0 = task.Hc;
 
-            const bool useOriginal = forceOriginal;
             const Box fallbackRoi = useOriginal
-                ? ClampXYXY(static_cast<double>(x), static_cast<double>(y), static_cast<double>(x + w), static_cast<double>(y + h), W0, H0)
-                : ClampXYXY(static_cast<double>(x), static_cast<double>(y), static_cast<double>(x + w), static_cast<double>(y + h), Wc, Hc);
+                ? ClampXYXY(static_cast<double>(x), static_cast<double>(y), static_cast<double>(x + w), static_cast<double>(y + h), task.W0, task.H0)
+                : ClampXYXY(static_cast<double>(x), static_cast<double>(y), static_cast<double>(x + w), static_cast<double>(y + h), task.Wc, task.Hc);
 
-            std::vector<Box> activeRois;
-            bool forceOutsideByEmptyRegion = false;
             if (resultRegionConnected) {
                 auto itRoi = regionBoxesByWrapIndex.find(wrapIndex);
                 if (itRoi != regionBoxesByWrapIndex.end() && !itRoi->second.empty()) {
-                    activeRois = itRoi->second;
+                    task.ActiveRois = itRoi->second;
                 } else {
-                    forceOutsideByEmptyRegion = true;
+                    task.ForceOutsideByEmptyRegion = true;
                 }
             } else {
-                activeRois.push_back(fallbackRoi);
+                task.ActiveRois.push_back(fallbackRoi);
             }
 
-            const int spaceW = useOriginal ? W0 : Wc;
-            const int spaceH = useOriginal ? H0 : Hc;
-
-            Json inArr = Json::array();
-            Json outArr = Json::array();
+            task.DetBegin = slots.size();
             for (const auto& detToken : entry.at("sample_results")) {
-                if (!detToken.is_object()) {
-                    outArr.push_back(detToken);
-                    continue;
-                }
-                const Json& det = detToken;
+                DetSlot slot;
+                slot.Task = tasks.size();
+                slot.Det = &detToken;
+                slots.push_back(std::move(slot));
+            }
+            task.DetEnd = slots.size();
+            tasks.push_back(std::move(task));
+        }
 
-                double bx1 = 0.0, by1 = 0.0, bx2 = 0.0, by2 = 0.0;
-                if (!TryExtractBboxAabbCurrent(det, bx1, by1, bx2, by2)) {
-                    outArr.push_back(det);
-                    continue;
-                }
+        ParallelFor(slots.size(), 4, [&](size_t k) {
+            DetSlot& slot = slots[k];
+            const EntryTask& task = tasks[slot.Task];
+            const Json& det = *slot.Det;
+            slot.IsIn = false;
+            if (!det.is_object()) {
+                slot.Out = det;
+                return;
+            }
 
-                const Box bboxCur = ClampXYXY(bx1, by1, bx2, by2, Wc, Hc);
-                Box bboxUse = bboxCur;
-                if (useOriginal) {
-                    Box bboxMetaOri{};
-                    bool hasMetaOri = false;
-                    try {
-                        if (det.contains("metadata") && det.at("metadata").is_object()) {
-                            const Json& meta = det.at("metadata");
-                            if (meta.contains("global_bbox") && meta.at("global_bbox").is_array()) {
-                                if (TryParseGlobalBboxToAabb(meta.at("global_bbox"), bboxMetaOri)) {
-                                    bboxMetaOri = ClampXYXY(
-                                        static_cast<double>(bboxMetaOri[0]), static_cast<double>(bboxMetaOri[1]),
-                                        static_cast<double>(bboxMetaOri[2]), static_cast<double>(bboxMetaOri[3]), W0, H0);
-                                    hasMetaOri = true;
-                                }
+            double bx1 = 0.0, by1 = 0.0, bx2 = 0.0, by2 = 0.0;
+            if (!TryExtractBboxAabbCurrent(det, bx1, by1, bx2, by2)) {
+                slot.Out = det;
+                return;
+            }
+
+            const ModuleImage& wrap = images[static_cast<size_t>(task.WrapIndex)];
+            const int spaceW = useOriginal ? task.W0 : task.Wc;
+            const int spaceH = useOriginal ? task.H0 : task.Hc;
+            const Box bboxCur = ClampXYXY(bx1, by1, bx2, by2, task.Wc, task.Hc);
+            Box bboxUse = bboxCur;
+            if (useOriginal) {
+                Box bboxMetaOri{};
+                bool hasMetaOri = false;
+                try {
+                    if (det.contains("metadata") && det.at("metadata").is_object()) {
+                        const Json& meta = det.at("metadata");
+                        if (meta.contains("global_bbox") && meta.at("global_bbox").is_array()) {
+                            if (TryParseGlobalBboxToAabb(meta.at("global_bbox"), bboxMetaOri)) {
+                                bboxMetaOri = ClampXYXY(
+                                    static_cast<double>(bboxMetaOri[0]), static_cast<double>(bboxMetaOri[1]),
+                                    static_cast<double>(bboxMetaOri[2]), static_cast<double>(bboxMetaOri[3]), task.W0, task.H0);
+                                hasMetaOri = true;
                             }
                         }
-                    } catch (...) { hasMetaOri = false; }
-
-                    if (hasMetaOri) {
-                        bboxUse = bboxMetaOri;
-                    } else {
-                        bboxUse = MapAabbToOriginalAndClamp(wrap.TransformState, bboxCur, W0, H0);
                     }
-                }
+                } catch (...) { hasMetaOri = false; }
 
-                bool isIn = false;
-                bool decided = false;
-                if (forceOutsideByEmptyRegion) {
-                    decided = true;
-                    isIn = false;
+                if (hasMetaOri) {
+                    bboxUse = bboxMetaOri;
+                } else {
+                    bboxUse = MapAabbToOriginalAndClamp(wrap.TransformState, bboxCur, task.W0, task.H0);
                 }
+            }
 
-                if (!decided && det.contains("mask_rle") && det.at("mask_rle").is_object()) {
-                    try {
-                        cv::Mat maskMat = MaskInfoToMat(det.at("mask_rle"));
-                        if (!maskMat.empty()) {
-                            isIn = false;
-                            for (const auto& roi : activeRois) {
-                                if (CheckMaskOverlapWithRegion(maskMat, bboxUse, roi, spaceW, spaceH)) {
-                                    isIn = true;
-                                    break;
-                                }
+            const std::vector<Box>& activeRois = task.ActiveRois;
+            bool isIn = false;
+            bool decided = false;
+            if (task.ForceOutsideByEmptyRegion) {
+                decided = true;
+                isIn = false;
+            }
+
+            if (!decided && det.contains("mask_rle") && det.at("mask_rle").is_object()) {
+                try {
+                    cv::Mat maskMat = MaskInfoToMat(det.at("mask_rle"));
+                    if (!maskMat.empty()) {
+                        isIn = false;
+                        for (const auto& roi : activeRois) {
+                            if (CheckMaskOverlapWithRegion(maskMat, bboxUse, roi, spaceW, spaceH)) {
+                                isIn = true;
+                                break;
                             }
-                            decided = true;
                         }
-                    } catch (...) {
-                        decided = false;
+                        decided = true;
                     }
+                } catch (...) {
+                    decided = false;
                 }
+            }
 
-                if (!decided && det.contains("mask_array") && det.at("mask_array").is_array()) {
-                    try {
-                        cv::Mat maskArray = TryParseMaskArrayToMat(det.at("mask_array"));
-                        if (!maskArray.empty()) {
-                            isIn = false;
-                            for (const auto& roi : activeRois) {
-                                if (CheckMaskOverlapWithRegion(maskArray, bboxUse, roi, spaceW, spaceH)) {
-                                    isIn = true;
-                                    break;
-                                }
+            if (!decided && det.contains("mask_array") && det.at("mask_array").is_array()) {
+                try {
+                    cv::Mat maskArray = TryParseMaskArrayToMat(det.at("mask_array"));
+                    if (!maskArray.empty()) {
+                        isIn = false;
+                        for (const auto& roi : activeRois) {
+                            if (CheckMaskOverlapWithRegion(maskArray, bboxUse, roi, spaceW, spaceH)) {
+                                isIn = true;
+                                break;
                             }
-                            decided = true;
                         }
-                    } catch (...) {
-                        decided = false;
+                        decided = true;
                     }
+                } catch (...) {
+                    decided = false;
                 }
+            }
 
-                if (!decided) {
-                    isIn = false;
-                    for (const auto& roi : activeRois) {
-                        if (BboxIntersects(bboxUse, roi)) {
-                            isIn = true;
-                            break;
-                        }
+            if (!decided) {
+                isIn = false;
+                for (const auto& roi : activeRois) {
+                    if (BboxIntersects(bboxUse, roi)) {
+                        isIn = true;
+                        break;
                     }
                 }
+            }
 
-                Json detOut = det;
-                if (convertOutputToOriginal && useOriginal) {
-                    detOut = ConvertDetToOriginal(det, bboxUse);
-                }
+            slot.Out = (convertOutputToOriginal && useOriginal) ? ConvertDetToOriginal(det, bboxUse) : det;
+            slot.IsIn = isIn;
+        });
+
+        for (const EntryTask& task : tasks) {
+            const Json& entry = *task.Entry;
+            const int wrapIndex = task.WrapIndex;
+            const ModuleImage& wrap = images[static_cast<size_t>(wrapIndex)];
 
-                if (isIn) {
-                    inArr.push_back(detOut);
+            Json inArr = Json::array();
+            Json outArr = Json::array();
+            for (size_t k = task.DetBegin; k < task.DetEnd; k++) {
+                DetSlot& slot = slots[k];
+                if (slot.IsIn) {
+                    inArr.push_back(std::move(slot.Out));
                     hasAnyInside = true;
                 } else {
-                    outArr.push_back(detOut);
+                    outArr.push_back(std::move(slot.Out));
                 }
             }
 
             if (!inArr.empty()) {
                 Json entryIn = entry;
-                entryIn["sample_results"] = inArr;
+                entryIn["sample_results"] = std::move(inArr);
                 if (convertOutputToOriginal && useOriginal) {
                     entryIn["transform"] = nullptr;
                     entryIn["origin_index"] = wrap.OriginalIndex;
@@ -483,7 +525,7 @@ protected:
             }
             if (!outArr.empty()) {
                 Json entryOut = entry;
-                entryOut["sample_results"] = outArr;
+                entryOut["sample_results"] = std::move(outArr);
                 if (convertOutputToOriginal && useOriginal) {
                     entryOut["transform"] = nullptr;
                     entryOut["origin_index"] = wrap.OriginalIndex;
@@ -542,6 +584,29 @@ protected:
     }
 
 private:
+    struct Props {
+        int X = 0;
+        int Y = 0;
+        int W = 100;
+        int H = 100;
+        bool Top1Region = false;   // result_region_mode：top1_bbox 只看置信度最高的框，其余取值按 any_bbox
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Int("x", &Props::X, 0)
+                .Int("y", &Props::Y, 0)
+                .Int("w", &Props::W, 100, 1)
+                .Int("h", &Props::H, 100, 1)
+                .Custom("result_region_mode", [](const Json& v, Props& out) {
+                    std::string mode;
+                    PropertyParser::ParseString(v, "result_region_mode", mode);
+                    out.Top1Region = ToLowerCopy(mode) == "top1_bbox";
+                });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
+
     static std::string ToLowerCopy(const std::string& s) {
         std::string out = s;
         std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c) {
@@ -568,38 +633,9 @@ private:
         return false;
     }
 
-    static std::string Round6(double v) {
-        if (std::isnan(v) || std::isinf(v)) return "0";
-        std::ostringstream oss;
-        oss << std::fixed << std::setprecision(6) << v;
-        std::string s = oss.str();
-        while (!s.empty() && s.back() == '0') s.pop_back();
-        if (!s.empty() && s.back() == '.') s.pop_back();
-        return s.empty() ? "0" : s;
-    }
-
-    static std::string SerializeTransformSig(const TransformationState& st) {
-        if (st.AffineMatrix2x3.size() < 6) return std::string();
-        int cbx = 0, cby = 0, cbw = 0, cbh = 0;
-        if (st.CropBox.size() >= 4) {
-            cbx = st.CropBox[0];
-            cby = st.CropBox[1];
-            cbw = st.CropBox[2];
-            cbh = st.CropBox[3];
-        }
-        int outW = 0, outH = 0;
-        if (st.OutputSize.size() >= 2) {
-            outW = st.OutputSize[0];
-            outH = st.OutputSize[1];
-        }
-        const std::vector<double>& a = st.AffineMatrix2x3;
-        std::ostringstream oss;
-        oss << "cb:" << cbx << "," << cby << "," << cbw << "," << cbh
-            << "|os:" << outW << "," << outH
-            << "|ori:" << st.OriginalWidth << "," << st.OriginalHeight
-            << "|A:" << Round6(a[0]) << "," << Round6(a[1]) << "," << Round6(a[2]) << ","
-            << Round6(a[3]) << "," << Round6(a[4]) << "," << Round6(a[5]);
-        return oss.str();
+    // 变换标识（同 TransformationState::TransformId）；无仿射时为 0
+    static std::uint64_t TransformSigId(const TransformationState& st) {
+        return st.HasAffine() ? st.TransformId : 0;
     }
 
     static bool TryGetAffine2x3FromJson(const Json& transformObj, std::array<double, 6>& outAffine) {
@@ -633,23 +669,24 @@ private:
         return false;
     }
 
-    static std::string SerializeTransformSig(const Json& transformObj) {
-        if (!transformObj.is_object()) return std::string();
+    // 结果条目 transform 的变换标识（兼容 original_size / affine_matrix 写法）；无仿射或解析失败时为 0
+    static std::uint64_t TransformSigId(const Json& transformObj) {
+        if (!transformObj.is_object()) return 0;
+        // 本库写出的 transform 携带标识（有仿射时写出 affine_2x3）
+        const std::uint64_t carried = TransformationState::CarriedId(transformObj);
+        if (carried != 0) return transformObj.contains("affine_2x3") ? carried : 0;
         try {
-            int cbx = 0, cby = 0, cbw = 0, cbh = 0;
+            int crop[4] = {0, 0, 0, 0};
             if (transformObj.contains("crop_box") && transformObj.at("crop_box").is_array() &&
                 transformObj.at("crop_box").size() >= 4) {
-                cbx = transformObj.at("crop_box").at(0).get<int>();
-                cby = transformObj.at("crop_box").at(1).get<int>();
-                cbw = transformObj.at("crop_box").at(2).get<int>();
-                cbh = transformObj.at("crop_box").at(3).get<int>();
+                for (int k = 0; k < 4; k++) crop[k] = transformObj.at("crop_box").at(static_cast<size_t>(k)).get<int>();
             }
 
-            int outW = 0, outH = 0;
+            int output[2] = {0, 0};
             if (transformObj.contains("output_size") && transformObj.at("output_size").is_array() &&
                 transformObj.at("output_size").size() >= 2) {
-                outW = transformObj.at("output_size").at(0).get<int>();
-                outH = transformObj.at("output_size").at(1).get<int>();
+                output[0] = transformObj.at("output_size").at(0).get<int>();
+                output[1] = transformObj.at("output_size").at(1).get<int>();
             }
 
             int ow = 0, oh = 0;
@@ -663,17 +700,10 @@ private:
             }
 
             std::array<double, 6> affine{};
-            if (!TryGetAffine2x3FromJson(transformObj, affine)) return std::string();
-
-            std::ostringstream oss;
-            oss << "cb:" << cbx << "," << cby << "," << cbw << "," << cbh
-                << "|os:" << outW << "," << outH
-                << "|ori:" << ow << "," << oh
-                << "|A:" << Round6(affine[0]) << "," << Round6(affine[1]) << "," << Round6(affine[2]) << ","
-                << Round6(affine[3]) << "," << Round6(affine[4]) << "," << Round6(affine[5]);
-            return oss.str();
+            if (!TryGetAffine2x3FromJson(transformObj, affine)) return 0;
+            return TransformationState::ComputeTransformId(ow, oh, crop, output, affine.data());
         } catch (...) {
-            return std::string();
+            return 0;
         }
     }
 
@@ -826,13 +856,13 @@ private:
     }
 
     static Box MapAabbToOriginalAndClamp(const TransformationState& st, const Box& bboxCur, int W0, int H0) {
-        if (st.AffineMatrix2x3.size() != 6) {
+        if (!st.HasAffine()) {
             return ClampXYXY(
                 static_cast<double>(bboxCur[0]), static_cast<double>(bboxCur[1]),
                 static_cast<double>(bboxCur[2]), static_cast<double>(bboxCur[3]), W0, H0);
         }
 
-        const std::vector<double> inv = TransformationState::Inverse2x3(st.AffineMatrix2x3);
+        const Affine2x3& inv = st.InverseAffine;
         int x0 = 0;
         int y0 = 0;
         bool hasCropOffset = false;
@@ -842,19 +872,18 @@ private:
             hasCropOffset = (x0 != 0 || y0 != 0);
         }
 
-        const std::array<std::array<double, 2>, 4> pts{{
-            { static_cast<double>(bboxCur[0]), static_cast<double>(bboxCur[1]) },
-            { static_cast<double>(bboxCur[2]), static_cast<double>(bboxCur[1]) },
-            { static_cast<double>(bboxCur[2]), static_cast<double>(bboxCur[3]) },
-            { static_cast<double>(bboxCur[0]), static_cast<double>(bboxCur[3]) }
-        }};
+        double pts[8] = {
+            static_cast<double>(bboxCur[0]), static_cast<double>(bboxCur[1]),
+            static_cast<double>(bboxCur[2]), static_cast<double>(bboxCur[1]),
+            static_cast<double>(bboxCur[2]), static_cast<double>(bboxCur[3]),
+            static_cast<double>(bboxCur[0]), static_cast<double>(bboxCur[3])
+        };
+        MapPoints(inv, pts, pts, 4);
 
         double minX = 1e100, minY = 1e100, maxX = -1e100, maxY = -1e100;
-        for (const auto& p : pts) {
-            const double x = p[0];
-            const double y = p[1];
-            double ox = inv[0] * x + inv[1] * y + inv[2];
-            double oy = inv[3] * x + inv[4] * y + inv[5];
+        for (int i = 0; i < 4; i++) {
+            double ox = pts[2 * i];
+            double oy = pts[2 * i + 1];
             if (hasCropOffset) {
                 ox += x0;
                 oy += y0;
@@ -1060,17 +1089,9 @@ public:
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
 
-        // counts_dict: { category_name: count }
-        std::unordered_map<std::string, int> counts;
-        try {
-            if (Properties.is_object() && Properties.contains("counts_dict") && Properties.at("counts_dict").is_object()) {
-                for (auto it = Properties.at("counts_dict").begin(); it != Properties.at("counts_dict").end(); ++it) {
-                    try { counts[it.key()] = it.value().get<int>(); } catch (...) {}
-                }
-            }
-        } catch (...) {}
-        const int pointW = std::max(1, ReadInt("point_width", 10));
-        const int pointH = std::max(1, ReadInt("point_height", 10));
+        const std::unordered_map<std::string, int>& counts = _props.Counts;
+        const int pointW = _props.PointW;
+        const int pointH = _props.PointH;
         if (counts.empty()) return ModuleIO(images, Json::array(), Json::array());
 
         Json outResults = Json::array();
@@ -1201,41 +1222,59 @@ public:
 
         return ModuleIO(images, outResults, Json::array());
     }
+
+private:
+    struct Props {
+        std::unordered_map<std::string, int> Counts;   // counts_dict: { category_name: count }
+        int PointW = 10;
+        int PointH = 10;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Custom("counts_dict", [](const Json& v, Props& out) {
+                    if (!v.is_object()) PropertyParser::Fail("counts_dict", "object", v);
+                    for (auto it = v.begin(); it != v.end(); ++it) {
+                        if (!it.value().is_number()) PropertyParser::Fail("counts_dict", "{name: int}", v);
+                        out.Counts[it.key()] = it.value().get<int>();
+                    }
+                })
+                .Int("point_width", &Props::PointW, 10, 1)
+                .Int("point_height", &Props::PointH, 10, 1);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 // -------------------- Visualize (简化版) --------------------
-static cv::Scalar ReadColorBgr(const Json& props, const std::string& key, cv::Scalar dv) {
-    if (!props.is_object() || !props.contains(key)) return dv;
-    try {
-        const Json& v = props.at(key);
-        if (v.is_array() && v.size() >= 3) {
-            const int b = v.at(0).get<int>();
-            const int g = v.at(1).get<int>();
-            const int r = v.at(2).get<int>();
-            return cv::Scalar(b, g, r);
-        }
-    } catch (...) {}
-    return dv;
+// 颜色属性：[b, g, r]；数组不足三项时保留默认值
+static void BindColorBgr(const Json& v, const char* name, cv::Scalar& out) {
+    if (!v.is_array()) PropertyParser::Fail(name, "[b, g, r]", v);
+    if (v.size() < 3) return;
+    for (size_t i = 0; i < 3; i++) {
+        if (!v.at(i).is_number()) PropertyParser::Fail(name, "[b, g, r]", v);
+    }
+    out = cv::Scalar(v.at(0).get<int>(), v.at(1).get<int>(), v.at(2).get<int>());
 }
 
-static std::vector<double> Inverse2x3FromTransform(const Json& tObj) {
-    if (!tObj.is_object() || !tObj.contains("affine_2x3") || !tObj.at("affine_2x3").is_array()) return {1,0,0, 0,1,0};
-    std::vector<double> a(6, 0.0);
+static Affine2x3 Inverse2x3FromTransform(const Json& tObj) {
+    if (!tObj.is_object() || !tObj.contains("affine_2x3") || !tObj.at("affine_2x3").is_array()) return Affine2x3();
+    double a[6] = { 0, 0, 0, 0, 0, 0 };
     try {
         for (size_t i = 0; i < 6; i++) a[i] = tObj.at("affine_2x3").at(i).get<double>();
-    } catch (...) { return {1,0,0, 0,1,0}; }
-    return TransformationState::Inverse2x3(a);
+    } catch (...) { return Affine2x3(); }
+    return Affine2x3(a[0], a[1], a[2], a[3], a[4], a[5]).Inverse();
 }
 
-static cv::Point2f Apply2x3(const std::vector<double>& A, const cv::Point2f& p) {
-    const double a = A.size() >= 6 ? A[0] : 1.0;
-    const double b = A.size() >= 6 ? A[1] : 0.0;
-    const double tx = A.size() >= 6 ? A[2] : 0.0;
-    const double c = A.size() >= 6 ? A[3] : 0.0;
-    const double d = A.size() >= 6 ? A[4] : 1.0;
-    const double ty = A.size() >= 6 ? A[5] : 0.0;
-    return cv::Point2f(static_cast<float>(a * p.x + b * p.y + tx),
-                       static_cast<float>(c * p.x + d * p.y + ty));
+// 映射一组角点并四舍五入为整数像素点
+static std::vector<cv::Point> MapCornersRounded(const Affine2x3& A, cv::Point2f (&corners)[4]) {
+    MapPoints(A, corners, corners, 4);
+    std::vector<cv::Point> pts;
+    pts.reserve(4);
+    for (const auto& g : corners) {
+        pts.push_back(cv::Point(static_cast<int>(std::llround(g.x)), static_cast<int>(std::llround(g.y))));
+    }
+    return pts;
 }
 
 class VisualizeOnOriginalModule final : public BaseModule {
@@ -1246,14 +1285,14 @@ public:
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
 
-        const bool blackBg = ReadBool("black_background", false);
-        const bool displayBbox = ReadBool("display_bbox", true);
-        const bool displayText = ReadBool("display_text", true);
-        const bool displayScore = ReadBool("display_score", true);
-        const double fontScale = ReadDouble("font_scale", 0.5);
-        const int fontThickness = std::max(1, ReadInt("font_thickness", 1));
-        const cv::Scalar bboxColor = ReadColorBgr(Properties, "bbox_color", cv::Scalar(0, 255, 0));
-        const cv::Scalar bboxColorRot = ReadColorBgr(Properties, "bbox_color_rot", cv::Scalar(0, 128, 255));
+        const bool blackBg = _props.BlackBackground;
+        const bool displayBbox = _props.DisplayBbox;
+        const bool displayText = _props.DisplayText;
+        const bool displayScore = _props.DisplayScore;
+        const double fontScale = _props.FontScale;
+        const int fontThickness = _props.FontThickness;
+        const cv::Scalar& bboxColor = _props.BboxColor;
+        const cv::Scalar& bboxColorRot = _props.BboxColorRot;
 
         // origin_index -> canvas
         std::unordered_map<int, cv::Mat> canvasMap;
@@ -1271,17 +1310,30 @@ public:
             }
         }
 
+        // 同一张原图上的条目按顺序绘制（后画覆盖先画）；不同原图的画布互不相关，按画布并行绘制
+        std::vector<cv::Mat*> targets;
+        std::vector<std::vector<const Json*>> entriesByTarget;
+        std::unordered_map<int, size_t> targetIndexByOrigin;
         for (const auto& token : results) {
             if (!token.is_object()) continue;
             const Json& entry = token;
             const int originIndex = entry.value("origin_index", entry.value("index", 0));
-            if (!canvasMap.count(originIndex)) continue;
-            cv::Mat& target = canvasMap[originIndex];
+            auto itCanvas = canvasMap.find(originIndex);
+            if (itCanvas == canvasMap.end()) continue;
             if (!entry.contains("sample_results") || !entry.at("sample_results").is_array()) continue;
+            auto itTarget = targetIndexByOrigin.find(originIndex);
+            if (itTarget == targetIndexByOrigin.end()) {
+                itTarget = targetIndexByOrigin.emplace(originIndex, targets.size()).first;
+                targets.push_back(&itCanvas->second);
+                entriesByTarget.emplace_back();
+            }
+            entriesByTarget[itTarget->second].push_back(&entry);
+        }
 
-            const std::vector<double> inv2x3 = (entry.contains("transform") && entry.at("transform").is_object())
+        const auto drawEntry = [&](cv::Mat& target, const Json& entry) {
+            const Affine2x3 inv2x3 = (entry.contains("transform") && entry.at("transform").is_object())
                 ? Inverse2x3FromTransform(entry.at("transform"))
-                : std::vector<double>{1,0,0,0,1,0};
+                : Affine2x3();
 
             for (const auto& s : entry.at("sample_results")) {
                 if (!s.is_object()) continue;
@@ -1301,26 +1353,26 @@ public:
                     const double c = std::cos(ang), sn = std::sin(ang);
                     const double dx[4] = { -hw, hw, hw, -hw };
                     const double dy[4] = { -hh, -hh, hh, hh };
+                    cv::Point2f corners[4];
                     for (int i = 0; i < 4; i++) {
                         const double x = cx + c * dx[i] - sn * dy[i];
                         const double y = cy + sn * dx[i] + c * dy[i];
-                        const cv::Point2f g = Apply2x3(inv2x3, cv::Point2f(static_cast<float>(x), static_cast<float>(y)));
-                        pts.push_back(cv::Point(static_cast<int>(std::llround(g.x)), static_cast<int>(std::llround(g.y))));
+                        corners[i] = cv::Point2f(static_cast<float>(x), static_cast<float>(y));
                     }
+                    pts = MapCornersRounded(inv2x3, corners);
                     cv::polylines(target, pts, true, bboxColorRot, 2, cv::LINE_AA);
                 } else {
                     const double x = bb.at(0).get<double>();
                     const double y = bb.at(1).get<double>();
                     const double w = bb.at(2).get<double>();
                     const double h = bb.at(3).get<double>();
-                    const cv::Point2f p1 = Apply2x3(inv2x3, cv::Point2f(static_cast<float>(x), static_cast<float>(y)));
-                    const cv::Point2f p2 = Apply2x3(inv2x3, cv::Point2f(static_cast<float>(x+w), static_cast<float>(y)));
-                    const cv::Point2f p3 = Apply2x3(inv2x3, cv::Point2f(static_cast<float>(x+w), static_cast<float>(y+h)));
-                    const cv::Point2f p4 = Apply2x3(inv2x3, cv::Point2f(static_cast<float>(x), static_cast<float>(y+h)));
-                    pts = { cv::Point((int)std::llround(p1.x),(int)std::llround(p1.y)),
-                            cv::Point((int)std::llround(p2.x),(int)std::llround(p2.y)),
-                            cv::Point((int)std::llround(p3.x),(int)std::llround(p3.y)),
-                            cv::Point((int)std::llround(p4.x),(int)std::llround(p4.y)) };
+                    cv::Point2f corners[4] = {
+                        cv::Point2f(static_cast<float>(x), static_cast<float>(y)),
+                        cv::Point2f(static_cast<float>(x+w), static_cast<float>(y)),
+                        cv::Point2f(static_cast<float>(x+w), static_cast<float>(y+h)),
+                        cv::Point2f(static_cast<float>(x), static_cast<float>(y+h))
+                    };
+                    pts = MapCornersRounded(inv2x3, corners);
                     cv::polylines(target, pts, true, bboxColor, 2, cv::LINE_AA);
                 }
 
@@ -1343,7 +1395,11 @@ public:
                     }
                 }
             }
-        }
+        };
+
+        ParallelFor(targets.size(), 1, [&](size_t t) {
+            for (const Json* entry : entriesByTarget[t]) drawEntry(*targets[t], *entry);
+        });
 
         std::vector<ModuleImage> outImages;
         for (const auto& kv : canvasMap) {
@@ -1357,6 +1413,32 @@ public:
 
         return ModuleIO(std::move(outImages), results, Json::array());
     }
+
+private:
+    struct Props {
+        bool BlackBackground = false;
+        bool DisplayBbox = true;
+        bool DisplayText = true;
+        bool DisplayScore = true;
+        double FontScale = 0.5;
+        int FontThickness = 1;
+        cv::Scalar BboxColor = cv::Scalar(0, 255, 0);
+        cv::Scalar BboxColorRot = cv::Scalar(0, 128, 255);
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Bool("black_background", &Props::BlackBackground, false)
+                .Bool("display_bbox", &Props::DisplayBbox, true)
+                .Bool("display_text", &Props::DisplayText, true)
+                .Bool("display_score", &Props::DisplayScore, true)
+                .Double("font_scale", &Props::FontScale, 0.5)
+                .Int("font_thickness", &Props::FontThickness, 1, 1)
+                .Custom("bbox_color", [](const Json& v, Props& out) { BindColorBgr(v, "bbox_color", out.BboxColor); })
+                .Custom("bbox_color_rot", [](const Json& v, Props& out) { BindColorBgr(v, "bbox_color_rot", out.BboxColorRot); });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 class VisualizeOnLocalModule final : public BaseModule {
@@ -1365,9 +1447,9 @@ public:
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
-        const cv::Scalar bboxColor = ReadColorBgr(Properties, "bbox_color", cv::Scalar(0, 255, 0));
-        const double fontScale = ReadDouble("font_scale", 0.5);
-        const int fontThickness = std::max(1, ReadInt("font_thickness", 1));
+        const cv::Scalar& bboxColor = _props.BboxColor;
+        const double fontScale = _props.FontScale;
+        const int fontThickness = _props.FontThickness;
 
         std::vector<ModuleImage> outImages;
         for (int i = 0; i < static_cast<int>(images.size()); i++) {
@@ -1403,12 +1485,30 @@ public:
         }
         return ModuleIO(std::move(outImages), results, Json::array());
     }
+
+private:
+    struct Props {
+        cv::Scalar BboxColor = cv::Scalar(0, 255, 0);
+        double FontScale = 0.5;
+        int FontThickness = 1;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Custom("bbox_color", [](const Json& v, Props& out) { BindColorBgr(v, "bbox_color", out.BboxColor); })
+                .Double("font_scale", &Props::FontScale, 0.5)
+                .Int("font_thickness", &Props::FontThickness, 1, 1);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 // -------------------- Templates (简化版) --------------------
 class TemplateFromResultsModule final : public BaseModule {
 public:
     using BaseModule::BaseModule;
+    // 读取上下文中的 barcode_text/face
+    bool IsOutputCacheable() const override { return false; }
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
@@ -1420,7 +1520,7 @@ public:
         // context barcode_text 覆盖 product_id
         try {
             if (Context) {
-                const std::string barcode = Context->Get<std::string>("barcode_text", "");
+                const std::string barcode = Context->Get(ContextKeys::BarcodeText, std::string());
                 if (!barcode.empty()) productId = barcode;
             }
         } catch (...) {}
@@ -1428,7 +1528,7 @@ public:
         int cameraPos = 0;
         try {
             if (Context) {
-                const std::string face = Context->Get<std::string>("face", "");
+                const std::string face = Context->Get(ContextKeys::Face, std::string());
                 if (!face.empty()) {
                     const char c = static_cast<char>(std::toupper(static_cast<unsigned char>(face[0])));
                     if (c == 'A') cameraPos = 0;
@@ -1453,7 +1553,7 @@ public:
             const Json& entry = token;
             if (entry.value("type", "") != "local") continue;
             if (!entry.contains("sample_results") || !entry.at("sample_results").is_array()) continue;
-            std::vector<double> inv = {1,0,0, 0,1,0};
+            Affine2x3 inv;
             try {
                 if (entry.contains("transform") && entry.at("transform").is_object()) {
                     inv = Inverse2x3FromTransform(entry.at("transform"));
@@ -1486,18 +1586,19 @@ public:
                     for (int i = 0; i < 4; i++) {
                         const double x = cx + c * dx[i] - sn * dy[i];
                         const double y = cy + sn * dx[i] + c * dy[i];
-                        corners.push_back(Apply2x3(inv, cv::Point2f((float)x,(float)y)));
+                        corners.push_back(cv::Point2f((float)x,(float)y));
                     }
                 } else {
                     const double x = bb.at(0).get<double>();
                     const double y = bb.at(1).get<double>();
                     const double w = bb.at(2).get<double>();
                     const double h = bb.at(3).get<double>();
-                    corners = { Apply2x3(inv, cv::Point2f((float)x,(float)y)),
-                                Apply2x3(inv, cv::Point2f((float)(x+w),(float)y)),
-                                Apply2x3(inv, cv::Point2f((float)(x+w),(float)(y+h))),
-                                Apply2x3(inv, cv::Point2f((float)x,(float)(y+h))) };
+                    corners = { cv::Point2f((float)x,(float)y),
+                                cv::Point2f((float)(x+w),(float)y),
+                                cv::Point2f((float)(x+w),(float)(y+h)),
+                                cv::Point2f((float)x,(float)(y+h)) };
                 }
+                MapPoints(inv, corners.data(), corners.data(), corners.size());
                 float minx=corners[0].x,miny=corners[0].y,maxx=corners[0].x,maxy=corners[0].y;
                 for (const auto& p : corners) { minx=std::min(minx,p.x); miny=std::min(miny,p.y); maxx=std::max(maxx,p.x); maxy=std::max(maxy,p.y); }
                 const int ix = (int)std::floor(minx);
@@ -1539,7 +1640,7 @@ public:
         Json tpl = MainTemplateList.at(0);
 
         std::string dir;
-        try { if (Context) dir = Context->Get<std::string>("templates_dir", ""); } catch (...) {}
+        try { if (Context) dir = Context->Get(ContextKeys::TemplatesDir, std::string()); } catch (...) {}
         if (dir.empty()) dir = "模版";
         EnsureDirExists(dir);
 
@@ -1572,6 +1673,8 @@ public:
 class TemplateLoadModule final : public BaseModule {
 public:
     using BaseModule::BaseModule;
+    // 模板取自磁盘文件
+    bool IsOutputCacheable() const override { return false; }
     ModuleIO Process(const std::vector<ModuleImage>& imageList, const Json& resultList) override {
         const std::vector<ModuleImage>& images = imageList;
         const Json results = resultList.is_array() ? resultList : Json::array();
@@ -1607,10 +1710,10 @@ public:
             return ModuleIO(std::vector<ModuleImage>(), Json::array(), Json::array());
         }
 
-        const double posTolX = ReadDouble("position_tolerance_x", 20.0);
-        const double posTolY = ReadDouble("position_tolerance_y", 20.0);
-        const double minConf = ReadDouble("min_confidence_threshold", 0.5);
-        const bool checkPos = ReadBool("check_position", true);
+        const double posTolX = _props.PosTolX;
+        const double posTolY = _props.PosTolY;
+        const double minConf = _props.MinConfidence;
+        const bool checkPos = _props.CheckPosition;
         const double errTh = std::sqrt(posTolX * posTolX + posTolY * posTolY);
 
         auto getItems = [&](const Json& tpl) -> std::vector<Json> {
@@ -1685,6 +1788,24 @@ public:
         this->ScalarOutputsByName["detail"] = detail.dump();
         return ModuleIO(std::vector<ModuleImage>(), Json::array(), Json::array());
     }
+
+private:
+    struct Props {
+        double PosTolX = 20.0;
+        double PosTolY = 20.0;
+        double MinConfidence = 0.5;
+        bool CheckPosition = true;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Double("position_tolerance_x", &Props::PosTolX, 20.0)
+                .Double("position_tolerance_y", &Props::PosTolY, 20.0)
+                .Double("min_confidence_threshold", &Props::MinConfidence, 0.5)
+                .Bool("check_position", &Props::CheckPosition, true);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 // 注册
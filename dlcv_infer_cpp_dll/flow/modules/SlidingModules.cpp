@@ -22,42 +22,33 @@
 namespace dlcv_infer {
 namespace flow {
 
-static std::pair<int, int> ReadInt2(const Json& props, const std::string& key, int dv1, int dv2) {
-    if (!props.is_object() || !props.contains(key)) return { dv1, dv2 };
-    const Json& v = props.at(key);
-    try {
-        if (v.is_array() && v.size() >= 2) {
-            return { v.at(0).get<int>(), v.at(1).get<int>() };
-        }
-        if (v.is_string()) {
-            const std::string s = v.get<std::string>();
-            int a = dv1, b = dv2;
+// 二元整数属性：[a, b] 或 "a,b"（分隔符可为逗号、分号、空格）；数组不足两项时保留默认值
+static void BindInt2(const Json& v, const char* name, int& a, int& b) {
+    if (v.is_array()) {
+        if (v.size() < 2) return;
+        if (!v.at(0).is_number() || !v.at(1).is_number()) PropertyParser::Fail(name, "[int, int]", v);
+        a = v.at(0).get<int>();
+        b = v.at(1).get<int>();
+        return;
+    }
+    if (v.is_string()) {
+        const std::string s = v.get<std::string>();
+        int x = 0, y = 0;
 #ifdef _WIN32
-            if (sscanf_s(s.c_str(), "%d%*[,; ]%d", &a, &b) == 2) {
+        if (sscanf_s(s.c_str(), "%d%*[,; ]%d", &x, &y) == 2) {
 #else
-            if (sscanf(s.c_str(), "%d%*[,; ]%d", &a, &b) == 2) {
+        if (sscanf(s.c_str(), "%d%*[,; ]%d", &x, &y) == 2) {
 #endif
-                return { a, b };
-            }
+            a = x;
+            b = y;
+            return;
         }
-    } catch (...) {}
-    return { dv1, dv2 };
-}
-
-static std::uint64_t ReadCurrentOutputMask(const ExecutionContext* ctx) {
-    if (ctx == nullptr) return std::numeric_limits<std::uint64_t>::max();
-    try {
-        return ctx->Get<std::uint64_t>(
-            "__graph_current_output_mask",
-            std::numeric_limits<std::uint64_t>::max());
-    } catch (...) {
-        return std::numeric_limits<std::uint64_t>::max();
     }
+    PropertyParser::Fail(name, "[int, int]", v);
 }
 
-static bool IsCurrentOutputConnected(const ExecutionContext* ctx, int outputIndex) {
+static bool IsCurrentOutputConnected(std::uint64_t mask, int outputIndex) {
     if (outputIndex < 0 || outputIndex >= 64) return true;
-    const std::uint64_t mask = ReadCurrentOutputMask(ctx);
     if (mask == std::numeric_limits<std::uint64_t>::max()) return true;
     return ((mask >> outputIndex) & static_cast<std::uint64_t>(1)) != 0;
 }
@@ -76,21 +67,9 @@ static bool TryReadDoubleToken(const Json& token, double& outVal) {
     return false;
 }
 
-static std::vector<double> BuildTC2O(const TransformationState& st) {
-    if (st.AffineMatrix2x3.size() != 6) return { 1,0,0, 0,1,0 };
-    return TransformationState::Inverse2x3(st.AffineMatrix2x3);
-}
-
-static cv::Point2f TransformPoint2x3(const std::vector<double>& T, const cv::Point2f& pt) {
-    const double a = (T.size() >= 6) ? T[0] : 1.0;
-    const double b = (T.size() >= 6) ? T[1] : 0.0;
-    const double tx = (T.size() >= 6) ? T[2] : 0.0;
-    const double c = (T.size() >= 6) ? T[3] : 0.0;
-    const double d = (T.size() >= 6) ? T[4] : 1.0;
-    const double ty = (T.size() >= 6) ? T[5] : 0.0;
-    return cv::Point2f(
-        static_cast<float>(a * pt.x + b * pt.y + tx),
-        static_cast<float>(c * pt.x + d * pt.y + ty));
+static const Affine2x3& BuildTC2O(const TransformationState& st) {
+    // 无仿射时 InverseAffine 为单位阵
+    return st.InverseAffine;
 }
 
 static double ReadAngleRad(const Json& det, const Json& bbox) {
@@ -190,16 +169,6 @@ static bool TryReadBboxXywh(const Json& det, double& x, double& y, double& w, do
 
 // ---- sliding_merge helpers（对齐 DlcvCsharpApi/SlidingMerge.cs）----
 
-static std::string Round6Sliding(double v) {
-    if (std::isnan(v) || std::isinf(v)) return "0";
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(6) << v;
-    std::string s = oss.str();
-    while (!s.empty() && s.back() == '0') s.pop_back();
-    if (!s.empty() && s.back() == '.') s.pop_back();
-    return s.empty() ? "0" : s;
-}
-
 static bool TryReadAffine2x3FromTransformJson(const Json& transformObj, std::array<double, 6>& outAffine) {
     try {
         if (transformObj.contains("affine_2x3") && transformObj.at("affine_2x3").is_array() &&
@@ -214,60 +183,36 @@ static bool TryReadAffine2x3FromTransformJson(const Json& transformObj, std::arr
     return false;
 }
 
-static std::string SerializeTransformStateSig(const TransformationState& st) {
-    if (st.AffineMatrix2x3.size() < 6) return std::string();
-    int cbx = 0, cby = 0, cbw = 0, cbh = 0;
-    if (st.CropBox.size() >= 4) {
-        cbx = st.CropBox[0];
-        cby = st.CropBox[1];
-        cbw = st.CropBox[2];
-        cbh = st.CropBox[3];
-    }
-    int outW = 0, outH = 0;
-    if (st.OutputSize.size() >= 2) {
-        outW = st.OutputSize[0];
-        outH = st.OutputSize[1];
-    }
-    const std::vector<double>& a = st.AffineMatrix2x3;
-    std::ostringstream oss;
-    oss << "cb:" << cbx << "," << cby << "," << cbw << "," << cbh
-        << "|os:" << outW << "," << outH
-        << "|ori:" << st.OriginalWidth << "," << st.OriginalHeight
-        << "|A:" << Round6Sliding(a[0]) << "," << Round6Sliding(a[1]) << "," << Round6Sliding(a[2]) << ","
-        << Round6Sliding(a[3]) << "," << Round6Sliding(a[4]) << "," << Round6Sliding(a[5]);
-    return oss.str();
+// 窗口的变换标识（同 TransformationState::TransformId）；无仿射时为 0
+static std::uint64_t TransformStateSigId(const TransformationState& st) {
+    return st.HasAffine() ? st.TransformId : 0;
 }
 
-static std::string SerializeTransformJsonSig(const Json& transformObj) {
-    if (!transformObj.is_object()) return std::string();
+// 结果条目 transform 的变换标识，字段缺省规则与 TransformationState 一致；无仿射或解析失败时为 0
+static std::uint64_t TransformJsonSigId(const Json& transformObj) {
+    if (!transformObj.is_object()) return 0;
+    // 本库写出的 transform 携带标识（有仿射时写出 affine_2x3）
+    const std::uint64_t carried = TransformationState::CarriedId(transformObj);
+    if (carried != 0) return transformObj.contains("affine_2x3") ? carried : 0;
     try {
-        int cbx = 0, cby = 0, cbw = 0, cbh = 0;
+        int crop[4] = {0, 0, 0, 0};
         if (transformObj.contains("crop_box") && transformObj.at("crop_box").is_array() &&
             transformObj.at("crop_box").size() >= 4) {
-            cbx = transformObj.at("crop_box").at(0).get<int>();
-            cby = transformObj.at("crop_box").at(1).get<int>();
-            cbw = transformObj.at("crop_box").at(2).get<int>();
-            cbh = transformObj.at("crop_box").at(3).get<int>();
+            for (int k = 0; k < 4; k++) crop[k] = transformObj.at("crop_box").at(static_cast<size_t>(k)).get<int>();
         }
-        int outW = 0, outH = 0;
+        int output[2] = {0, 0};
         if (transformObj.contains("output_size") && transformObj.at("output_size").is_array() &&
             transformObj.at("output_size").size() >= 2) {
-            outW = transformObj.at("output_size").at(0).get<int>();
-            outH = transformObj.at("output_size").at(1).get<int>();
+            output[0] = transformObj.at("output_size").at(0).get<int>();
+            output[1] = transformObj.at("output_size").at(1).get<int>();
         }
         int ow = transformObj.value("original_width", 0);
         int oh = transformObj.value("original_height", 0);
         std::array<double, 6> affine{};
-        if (!TryReadAffine2x3FromTransformJson(transformObj, affine)) return std::string();
-        std::ostringstream oss;
-        oss << "cb:" << cbx << "," << cby << "," << cbw << "," << cbh
-            << "|os:" << outW << "," << outH
-            << "|ori:" << ow << "," << oh
-            << "|A:" << Round6Sliding(affine[0]) << "," << Round6Sliding(affine[1]) << "," << Round6Sliding(affine[2]) << ","
-            << Round6Sliding(affine[3]) << "," << Round6Sliding(affine[4]) << "," << Round6Sliding(affine[5]);
-        return oss.str();
+        if (!TryReadAffine2x3FromTransformJson(transformObj, affine)) return 0;
+        return TransformationState::ComputeTransformId(ow, oh, crop, output, affine.data());
     } catch (...) {
-        return std::string();
+        return 0;
     }
 }
 
@@ -301,16 +246,6 @@ static int SafeJsonInt(const Json& o, const char* key, int dv) {
     return dv;
 }
 
-static std::string NormalizeTaskType(std::string s) {
-    size_t start = 0;
-    while (start < s.size() && std::isspace(static_cast<unsigned char>(s[start]))) start++;
-    size_t end = s.size();
-    while (end > start && std::isspace(static_cast<unsigned char>(s[end - 1]))) end--;
-    s = s.substr(start, end - start);
-    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
-    return s;
-}
-
 static bool IsRotatedDetJson(const Json& det) {
     if (!det.is_object()) return false;
     bool withAngle = false;
@@ -595,7 +530,7 @@ static bool TryMapDetToGlobal(const Json& det, const ModuleImage& wrap, SlidingM
     const Json& bbox = det.at("bbox");
     if (bbox.size() < 4) return false;
 
-    const std::vector<double> T_c2o = BuildTC2O(wrap.TransformState);
+    const Affine2x3& T_c2o = BuildTC2O(wrap.TransformState);
     Json detOut = det;
     // 保留 mask_rle（用于 UI 可视化）；但删除原始 mask 指针结构，避免悬空指针透传。
     detOut.erase("mask");
@@ -613,7 +548,7 @@ static bool TryMapDetToGlobal(const Json& det, const ModuleImage& wrap, SlidingM
 
         const double l00 = T_c2o[0], l01 = T_c2o[1];
         const double l10 = T_c2o[3], l11 = T_c2o[4];
-        const cv::Point2f center = TransformPoint2x3(T_c2o, cv::Point2f(static_cast<float>(cx), static_cast<float>(cy)));
+        const cv::Point2f center = T_c2o.Map(cv::Point2f(static_cast<float>(cx), static_cast<float>(cy)));
 
         const double ux = std::cos(angleRad);
         const double uy = std::sin(angleRad);
@@ -645,12 +580,13 @@ static bool TryMapDetToGlobal(const Json& det, const ModuleImage& wrap, SlidingM
         !TryReadDoubleToken(bbox.at(2), w) || !TryReadDoubleToken(bbox.at(3), h)) {
         return false;
     }
-    const std::vector<cv::Point2f> pts = {
-        TransformPoint2x3(T_c2o, cv::Point2f(static_cast<float>(x), static_cast<float>(y))),
-        TransformPoint2x3(T_c2o, cv::Point2f(static_cast<float>(x + w), static_cast<float>(y))),
-        TransformPoint2x3(T_c2o, cv::Point2f(static_cast<float>(x + w), static_cast<float>(y + h))),
-        TransformPoint2x3(T_c2o, cv::Point2f(static_cast<float>(x), static_cast<float>(y + h)))
+    std::vector<cv::Point2f> pts = {
+        cv::Point2f(static_cast<float>(x), static_cast<float>(y)),
+        cv::Point2f(static_cast<float>(x + w), static_cast<float>(y)),
+        cv::Point2f(static_cast<float>(x + w), static_cast<float>(y + h)),
+        cv::Point2f(static_cast<float>(x), static_cast<float>(y + h))
     };
+    MapPoints(T_c2o, pts.data(), pts.data(), pts.size());
     const auto aabb = AabbFromPoints(pts);
     detOut["bbox"] = Json::array({
         aabb[0],
@@ -685,18 +621,20 @@ public:
         (void)resultList;
         const std::vector<ModuleImage>& images = imageList;
 
-        const int minSize = std::max(1, ReadInt("min_size", 1));
-        const auto win = ReadInt2(Properties, "window_size", 640, 640);
-        const auto ov = ReadInt2(Properties, "overlap", 0, 0);
-        const int winW = std::max(minSize, win.first);
-        const int winH = std::max(minSize, win.second);
-        const int ovX = std::max(0, ov.first);
-        const int ovY = std::max(0, ov.second);
+        const int minSize = _props.MinSize;
+        const int winW = std::max(minSize, _props.WindowW);
+        const int winH = std::max(minSize, _props.WindowH);
+        const int ovX = std::max(0, _props.OverlapX);
+        const int ovY = std::max(0, _props.OverlapY);
+
+        const bool emitResultEntries = IsCurrentOutputConnected(CurrentOutputMask, 1);
 
-        std::vector<ModuleImage> outImages;
-        const bool emitResultEntries = IsCurrentOutputConnected(Context, 1);
-        Json outResults = emitResultEntries ? Json::array() : Json();
-        int outIndex = 0;
+        // 先按图像列出全部窗口，再逐窗口并行生成子图与结果条目（输出顺序与窗口顺序一致）
+        struct Tile {
+            size_t Image = 0;
+            ModuleImage::SlidingMetaInfo Meta;
+        };
+        std::vector<Tile> tiles;
 
         for (size_t i = 0; i < images.size(); i++) {
             const ModuleImage& wrap = images[i];
@@ -734,17 +672,9 @@ public:
                     const int endY = startY + smallH;
                     if ((endX - startX) < minSize || (endY - startY) < minSize) continue;
 
-                    const cv::Rect rect(startX, startY, endX - startX, endY - startY);
-                    // Use ROI view to avoid per-tile deep copy.
-                    cv::Mat cropped = mat(rect);
-
-                    const TransformationState parentState = (wrap.TransformState.OriginalWidth > 0 && wrap.TransformState.OriginalHeight > 0)
-                        ? wrap.TransformState
-                        : TransformationState(W, H);
-                    const std::vector<double> childA2x3 = { 1,0,-static_cast<double>(startX), 0,1,-static_cast<double>(startY) };
-                    const TransformationState childState = parentState.DeriveChild(childA2x3, rect.width, rect.height);
-
-                    ModuleImage::SlidingMetaInfo slidingMeta;
+                    Tile tile;
+                    tile.Image = i;
+                    ModuleImage::SlidingMetaInfo& slidingMeta = tile.Meta;
                     slidingMeta.Valid = true;
                     slidingMeta.GridX = c;
                     slidingMeta.GridY = r;
@@ -752,34 +682,76 @@ public:
                     slidingMeta.GridRows = rowNum;
                     slidingMeta.X = startX;
                     slidingMeta.Y = startY;
-                    slidingMeta.W = rect.width;
-                    slidingMeta.H = rect.height;
-
-                    ModuleImage childWrap(cropped,
-                                          wrap.OriginalImage.empty() ? mat : wrap.OriginalImage,
-                                          childState,
-                                          wrap.OriginalIndex);
-                    childWrap.SlidingMeta = slidingMeta;
-                    outImages.push_back(childWrap);
-
-                    if (emitResultEntries) {
-                        Json entry = Json::object();
-                        entry["type"] = "local";
-                        entry["index"] = outIndex;
-                        entry["origin_index"] = wrap.OriginalIndex;
-                        entry["transform"] = childState.ToJson();
-                        entry["sample_results"] = Json::array();
-                        entry["sliding_meta"] = slidingMeta.ToJson();
-                        outResults.push_back(std::move(entry));
-                        outIndex += 1;
-                    }
+                    slidingMeta.W = endX - startX;
+                    slidingMeta.H = endY - startY;
+                    tiles.push_back(tile);
                 }
             }
         }
 
-        if (!emitResultEntries) outResults = Json::array();
+        std::vector<ModuleImage> outImages(tiles.size());
+        std::vector<Json> outEntries(emitResultEntries ? tiles.size() : 0);
+        ParallelFor(tiles.size(), 8, [&](size_t k) {
+            const Tile& tile = tiles[k];
+            const ModuleImage& wrap = images[tile.Image];
+            const cv::Mat& mat = wrap.ImageObject;
+            const ModuleImage::SlidingMetaInfo& slidingMeta = tile.Meta;
+
+            const cv::Rect rect(slidingMeta.X, slidingMeta.Y, slidingMeta.W, slidingMeta.H);
+            // Use ROI view to avoid per-tile deep copy.
+            cv::Mat cropped = mat(rect);
+
+            const TransformationState parentState = (wrap.TransformState.OriginalWidth > 0 && wrap.TransformState.OriginalHeight > 0)
+                ? wrap.TransformState
+                : TransformationState(mat.cols, mat.rows);
+            const Affine2x3 childA2x3(1, 0, -static_cast<double>(rect.x), 0, 1, -static_cast<double>(rect.y));
+            const TransformationState childState = parentState.DeriveChild(childA2x3, rect.width, rect.height);
+
+            ModuleImage childWrap(cropped,
+                                  wrap.OriginalImage.empty() ? mat : wrap.OriginalImage,
+                                  childState,
+                                  wrap.OriginalIndex);
+            childWrap.SlidingMeta = slidingMeta;
+            outImages[k] = std::move(childWrap);
+
+            if (emitResultEntries) {
+                Json entry = Json::object();
+                entry["type"] = "local";
+                entry["index"] = static_cast<int>(k);
+                entry["origin_index"] = wrap.OriginalIndex;
+                entry["transform"] = childState.ToJson();
+                entry["sample_results"] = Json::array();
+                entry["sliding_meta"] = slidingMeta.ToJson();
+                outEntries[k] = std::move(entry);
+            }
+        });
+
+        Json outResults = Json::array();
+        if (emitResultEntries) {
+            auto& outArr = outResults.get_ref<Json::array_t&>();
+            outArr.reserve(outEntries.size());
+            for (auto& entry : outEntries) outArr.push_back(std::move(entry));
+        }
         return ModuleIO(std::move(outImages), std::move(outResults), Json::array());
     }
+
+private:
+    struct Props {
+        int MinSize = 1;
+        int WindowW = 640;
+        int WindowH = 640;
+        int OverlapX = 0;
+        int OverlapY = 0;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Int("min_size", &Props::MinSize, 1, 1)
+                .Custom("window_size", [](const Json& v, Props& out) { BindInt2(v, "window_size", out.WindowW, out.WindowH); })
+                .Custom("overlap", [](const Json& v, Props& out) { BindInt2(v, "overlap", out.OverlapX, out.OverlapY); });
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 /// pre_process/sliding_merge, features/sliding_merge（对齐 DlcvCsharpApi/SlidingMerge.cs）
@@ -794,11 +766,11 @@ public:
             return ModuleIO(std::vector<ModuleImage>(), inResults, Json::array());
         }
 
-        const double iouTh = std::max(0.0, ReadDouble("iou_threshold", 0.2));
-        const bool dedupResults = ReadBool("dedup_results", true);
-        const std::string taskType = NormalizeTaskType(ReadString("task_type", "auto"));
+        const double iouTh = _props.IoUThreshold;
+        const bool dedupResults = _props.DedupResults;
+        const std::string& taskType = _props.TaskType;
 
-        std::unordered_map<std::string, std::vector<Json>> transToSamples;
+        std::unordered_map<std::uint64_t, std::vector<Json>> transToSamples;
         std::unordered_map<int, std::vector<Json>> indexToSamples;
         std::unordered_map<int, std::vector<Json>> originToSamples;
         std::unordered_map<int, ModuleImage::SlidingMetaInfo> indexToSlidingMeta;
@@ -819,14 +791,14 @@ public:
 
             const int entryIndex = SafeJsonInt(entry, "index", -1);
 
-            std::string sig;
+            std::uint64_t sig = 0;
             try {
                 if (entry.contains("transform") && entry.at("transform").is_object()) {
-                    sig = SerializeTransformJsonSig(entry.at("transform"));
+                    sig = TransformJsonSigId(entry.at("transform"));
                 }
-            } catch (...) { sig.clear(); }
+            } catch (...) { sig = 0; }
 
-            if (!sig.empty()) {
+            if (sig != 0) {
                 auto& list = transToSamples[sig];
                 for (const auto& s : dets) {
                     if (s.is_object()) list.push_back(s);
@@ -856,8 +828,8 @@ public:
         for (int i = 0; i < nWin; i++) {
             const ModuleImage& wrap = wrappers[static_cast<size_t>(i)];
             std::vector<Json> dets;
-            const std::string ws = SerializeTransformStateSig(wrap.TransformState);
-            if (!ws.empty()) {
+            const std::uint64_t ws = TransformStateSigId(wrap.TransformState);
+            if (ws != 0) {
                 auto it = transToSamples.find(ws);
                 if (it != transToSamples.end()) dets = it->second;
             } else {
@@ -1105,6 +1077,22 @@ public:
 
         return buildOutput(originIdxToItems);
     }
+
+private:
+    struct Props {
+        double IoUThreshold = 0.2;
+        bool DedupResults = true;
+        std::string TaskType;
+
+        static const PropertySchema<Props>& Schema() {
+            static const PropertySchema<Props> schema = PropertySchema<Props>()
+                .Double("iou_threshold", &Props::IoUThreshold, 0.2, 0.0)
+                .Bool("dedup_results", &Props::DedupResults, true)
+                .String("task_type", &Props::TaskType, "auto", PropertyText::TrimLower);
+            return schema;
+        }
+    };
+    const Props _props = BindProperties<Props>();
 };
 
 // 注册